@@ -596,6 +596,12 @@ function(configure_lit_site_cfg input output)
     set(ENABLE_ASSERTIONS "0")
   endif()
 
+  if(LLVM_ENABLE_FUNCTION_ARENAS)
+    set(ENABLE_FUNCTION_ARENAS "1")
+  else()
+    set(ENABLE_FUNCTION_ARENAS "0")
+  endif()
+
   set(HOST_OS ${CMAKE_SYSTEM_NAME})
   set(HOST_ARCH ${CMAKE_SYSTEM_PROCESSOR})
 
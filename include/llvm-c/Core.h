@@ -2812,6 +2812,40 @@ void LLVMStopMultithreaded(void);
     @see llvm::llvm_is_multithreaded */
 LLVMBool LLVMIsMultithreaded(void);
 
+/**
+ * @}
+ */
+
+/**
+ * @defgroup LLVMCCorePassProfiling Pass profiling
+ *
+ * Record the wall time, instruction count change and memory change of every
+ * pass run, for example to find which pass is slow on which function.
+ *
+ * @{
+ */
+
+typedef enum {
+  LLVMPassProfileJSON,       /**< One object per pass run, plus totals */
+  LLVMPassProfileChromeTrace /**< Chrome trace-event format */
+} LLVMPassProfileFormat;
+
+/** Discard any pass runs recorded so far and record the following ones.
+    @see llvm::PassProfiler::start */
+void LLVMStartPassProfiling(void);
+
+/** Stop recording pass runs. The runs recorded so far are kept.
+    @see llvm::PassProfiler::stop */
+void LLVMStopPassProfiling(void);
+
+/** Write the recorded pass runs to the file Filename. Returns 0 on success
+    and 1 with an error message in ErrorMessage on failure. Use
+    LLVMDisposeMessage to free the message.
+    @see llvm::PassProfiler::write */
+LLVMBool LLVMWritePassProfile(const char *Filename,
+                              LLVMPassProfileFormat Format,
+                              char **ErrorMessage);
+
 /**
  * @}
  */
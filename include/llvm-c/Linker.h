@@ -23,7 +23,9 @@ extern "C" {
 
 typedef enum {
   LLVMLinkerDestroySource = 0, /* Allow source module to be destroyed. */
-  LLVMLinkerPreserveSource = 1 /* Preserve the source module. */
+  LLVMLinkerPreserveSource = 1, /* Preserve the source module. */
+  LLVMLinkerOnlyNeeded = 2 /* May be or'ed in: only link referenced
+                              definitions. */
 } LLVMLinkerMode;
 
 
@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 10
+#define LTO_API_VERSION 11
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -454,6 +454,30 @@ extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
 
+/**
+ * Sets the number of partitions lto_codegen_compile_to_files() splits the
+ * merged module into. Each partition is compiled on its own thread. Zero
+ * selects one partition per hardware thread. The default is 1.
+ *
+ * \since LTO_API_VERSION=11
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int num_partitions);
+
+/**
+ * Generates code for all added modules into one native object file per
+ * partition (see lto_codegen_set_parallelism()). The partitions are compiled in
+ * parallel. The names of the files are written to names, and their number to
+ * num_files. The names are owned by the lto_code_gen_t and remain valid until
+ * lto_codegen_dispose() is called, or lto_codegen_compile_to_files() is called
+ * again. Returns true on error.
+ *
+ * \since LTO_API_VERSION=11
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                             unsigned int *num_files);
+
 /**
  * Sets options to help debug codegen bugs.
  *
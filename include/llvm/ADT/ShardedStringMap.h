@@ -0,0 +1,146 @@
+//===--- ShardedStringMap.h - String map for concurrent use -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ShardedStringMap class, a string-keyed table that
+// several threads can look names up in and add names to at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SHARDEDSTRINGMAP_H
+#define LLVM_ADT_SHARDEDSTRINGMAP_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Mutex.h"
+
+namespace llvm {
+
+/// ShardedStringMap - A StringMap split into shards with a lock and an
+/// allocator each.  While the map is multithreaded, threads working on keys
+/// that fall into different shards do not contend; otherwise no lock is taken
+/// and it behaves like a plain StringMap.  Entries come from the shard's
+/// BumpPtrAllocator and are only freed by clear().
+///
+/// A shard lock is never held while anything else is locked, so the map may
+/// be used with or without other locks held.  In turn, the value for a
+/// missing key has to be created with no shard locked, and then published
+/// with insert(), which keeps whichever value got there first.
+template<typename ValueTy>
+class ShardedStringMap {
+public:
+  typedef StringMap<ValueTy, BumpPtrAllocator> MapTy;
+  enum { ShardBits = 4, NumShards = 1 << ShardBits };
+
+private:
+  struct Shard {
+    sys::MutexImpl Lock;
+    MapTy Map;
+    Shard() : Lock(/*recursive=*/false) {}
+  };
+
+  /// ShardGuard - Holds the lock of a shard while the map is multithreaded.
+  class ShardGuard {
+    Shard *Locked;
+  public:
+    ShardGuard(Shard &S, bool Multithreaded) : Locked(0) {
+      if (Multithreaded) {
+        S.Lock.acquire();
+        Locked = &S;
+      }
+    }
+    ~ShardGuard() {
+      if (Locked)
+        Locked->Lock.release();
+    }
+  };
+
+  bool Multithreaded;
+  mutable Shard Shards[NumShards];
+
+  ShardedStringMap(const ShardedStringMap &) LLVM_DELETED_FUNCTION;
+  void operator=(const ShardedStringMap &) LLVM_DELETED_FUNCTION;
+
+  Shard &getShard(unsigned Hash) const {
+    // The shard's table buckets by the low bits of the hash, so pick the
+    // shard from the high bits.
+    return Shards[Hash >> (32 - ShardBits)];
+  }
+
+public:
+  ShardedStringMap() : Multithreaded(false) {}
+
+  /// setMultithreaded - Enable or disable locking of the shards.  Must not be
+  /// called while other threads use the map.
+  void setMultithreaded(bool Enable) { Multithreaded = Enable; }
+  bool isMultithreaded() const { return Multithreaded; }
+
+  /// hash - Return the hash of \p Key, which picks both its shard and its
+  /// bucket.  Callers that look a key up more than once can compute it once
+  /// and pass it to the overloads below that take it.
+  static unsigned hash(StringRef Key) { return StringMapImpl::hash(Key); }
+
+  /// lookup - Return the value for \p Key, or a default-constructed value if
+  /// there is none.
+  ValueTy lookup(StringRef Key) const { return lookup(Key, hash(Key)); }
+  ValueTy lookup(StringRef Key, unsigned Hash) const {
+    Shard &S = getShard(Hash);
+    ShardGuard Guard(S, Multithreaded);
+    typename MapTy::const_iterator I = S.Map.find(Key, Hash);
+    return I == S.Map.end() ? ValueTy() : I->getValue();
+  }
+
+  /// insert - Map \p Key to \p V unless another value was inserted for it
+  /// first, and return the entry the table ends up holding.  Entries never
+  /// move, so the key it points to stays valid until the map is cleared.
+  StringMapEntry<ValueTy> &insert(StringRef Key, const ValueTy &V) {
+    return insert(Key, V, hash(Key));
+  }
+  StringMapEntry<ValueTy> &insert(StringRef Key, const ValueTy &V,
+                                  unsigned Hash) {
+    Shard &S = getShard(Hash);
+    ShardGuard Guard(S, Multithreaded);
+    return S.Map.GetOrCreateValue(Key, V, Hash);
+  }
+
+  /// GetOrCreateValue - Return the entry for \p Key, adding one with a
+  /// default-constructed value if there is none.  The entry is handed out
+  /// with no shard locked, so this is only for use while the map is not
+  /// multithreaded; it then costs a single lookup.
+  StringMapEntry<ValueTy> &GetOrCreateValue(StringRef Key, unsigned Hash) {
+    assert(!Multithreaded && "Entry would be used without its shard locked!");
+    return getShard(Hash).Map.GetOrCreateValue(Key, ValueTy(), Hash);
+  }
+
+  /// size - Return the number of entries.  Only for use while no other thread
+  /// can touch the map.
+  unsigned size() const {
+    unsigned Size = 0;
+    for (unsigned I = 0; I != NumShards; ++I)
+      Size += Shards[I].Map.size();
+    return Size;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /// clear - Remove all entries and release their memory.  Only for use while
+  /// no other thread can touch the map.
+  void clear() {
+    for (unsigned I = 0; I != NumShards; ++I) {
+      Shards[I].Map.clear();
+      Shards[I].Map.getAllocator().Reset();
+    }
+  }
+
+  /// getShardMap - Return the table of shard \p I, e.g. to walk all entries.
+  /// Only for use while no other thread can touch the map.
+  const MapTy &getShardMap(unsigned I) const { return Shards[I].Map; }
+};
+
+} // End llvm namespace
+
+#endif
@@ -62,13 +62,17 @@ protected:
   /// up in.  If it already exists as a key in the map, the Item pointer for the
   /// specified bucket will be non-null.  Otherwise, it will be null.  In either
   /// case, the FullHashValue field of the bucket will be set to the hash value
-  /// of the string.
-  unsigned LookupBucketFor(StringRef Key);
+  /// of the string, which is \p FullHashValue if given.
+  unsigned LookupBucketFor(StringRef Key) {
+    return LookupBucketFor(Key, hash(Key));
+  }
+  unsigned LookupBucketFor(StringRef Key, unsigned FullHashValue);
 
   /// FindKey - Look up the bucket that contains the specified key. If it exists
   /// in the map, return the bucket number of the key.  Otherwise return -1.
   /// This does not modify the map.
-  int FindKey(StringRef Key) const;
+  int FindKey(StringRef Key) const { return FindKey(Key, hash(Key)); }
+  int FindKey(StringRef Key, unsigned FullHashValue) const;
 
   /// RemoveKey - Remove the specified StringMapEntry from the table, but do not
   /// delete it.  This aborts if the value isn't in the table.
@@ -84,6 +88,11 @@ public:
     return (StringMapEntryBase*)-1;
   }
 
+  /// hash - Return the hash value of \p Key that picks its bucket.  Clients
+  /// that look a key up in several places can compute it once and pass it to
+  /// the overloads of find and GetOrCreateValue that take it.
+  static unsigned hash(StringRef Key);
+
   unsigned getNumBuckets() const { return NumBuckets; }
   unsigned getNumItems() const { return NumItems; }
 
@@ -271,13 +280,22 @@ public:
   }
 
   iterator find(StringRef Key) {
-    int Bucket = FindKey(Key);
+    return find(Key, hash(Key));
+  }
+
+  const_iterator find(StringRef Key) const {
+    return find(Key, hash(Key));
+  }
+
+  /// find - Find \p Key, whose hash(Key) is \p FullHashValue.
+  iterator find(StringRef Key, unsigned FullHashValue) {
+    int Bucket = FindKey(Key, FullHashValue);
     if (Bucket == -1) return end();
     return iterator(TheTable+Bucket, true);
   }
 
-  const_iterator find(StringRef Key) const {
-    int Bucket = FindKey(Key);
+  const_iterator find(StringRef Key, unsigned FullHashValue) const {
+    int Bucket = FindKey(Key, FullHashValue);
     if (Bucket == -1) return end();
     return const_iterator(TheTable+Bucket, true);
   }
@@ -342,7 +360,15 @@ public:
   /// return.
   template <typename InitTy>
   MapEntryTy &GetOrCreateValue(StringRef Key, InitTy Val) {
-    unsigned BucketNo = LookupBucketFor(Key);
+    return GetOrCreateValue(Key, Val, hash(Key));
+  }
+
+  /// GetOrCreateValue - Likewise for \p Key, whose hash(Key) is
+  /// \p FullHashValue.
+  template <typename InitTy>
+  MapEntryTy &GetOrCreateValue(StringRef Key, InitTy Val,
+                               unsigned FullHashValue) {
+    unsigned BucketNo = LookupBucketFor(Key, FullHashValue);
     StringMapEntryBase *&Bucket = TheTable[BucketNo];
     if (Bucket && Bucket != getTombstoneVal())
       return *static_cast<MapEntryTy*>(Bucket);
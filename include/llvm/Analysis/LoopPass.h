@@ -93,6 +93,10 @@ public:
   static char ID;
   explicit LPPassManager();
 
+  /// clone - Return an empty manager; PMDataManager::clonePass fills it with
+  /// copies of the contained passes.
+  virtual Pass *clone() const { return new LPPassManager(); }
+
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
   bool runOnFunction(Function &F);
@@ -91,6 +91,10 @@ public:
   static char ID;
   explicit RGPassManager();
 
+  /// clone - Return an empty manager; PMDataManager::clonePass fills it with
+  /// copies of the contained passes.
+  virtual Pass *clone() const { return new RGPassManager(); }
+
   /// @brief Execute all of the passes scheduled for execution.
   ///
   /// @return True if any of the passes modifies the function.
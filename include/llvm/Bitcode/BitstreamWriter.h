@@ -114,6 +114,29 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Overwrite the 32 bits starting at bit \p BitNo with \p NewWord.
+  /// The bits must already have been written out, but need not be aligned.
+  void BackpatchWordAtBit(uint64_t BitNo, uint32_t NewWord) {
+    assert(BitNo + 32 <= uint64_t(GetBufferOffset()) * 8 &&
+           "Backpatching bits that have not been flushed!");
+    unsigned ByteNo = unsigned(BitNo / 8);
+    unsigned StartBit = unsigned(BitNo & 7);
+    if (StartBit == 0) {
+      BackpatchWord(ByteNo, NewWord);
+      return;
+    }
+
+    // The word straddles five bytes; keep the bits around it intact.
+    uint64_t Val = uint64_t(NewWord) << StartBit;
+    uint64_t Mask = uint64_t(~0U) << StartBit;
+    for (unsigned i = 0; i != 5; ++i, Val >>= 8, Mask >>= 8) {
+      unsigned char Byte = (unsigned char)Out[ByteNo + i];
+      Byte = (Byte & ~(unsigned char)Mask) | ((unsigned char)Val &
+                                              (unsigned char)Mask);
+      Out[ByteNo + i] = Byte;
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -267,6 +290,51 @@ public:
     BlockScope.pop_back();
   }
 
+  /// SpliceSubblock - Append a complete block that was encoded separately, at
+  /// the top level of another BitstreamWriter starting on a 32-bit boundary.
+  /// Everything after a block's header is word aligned and self-contained, so
+  /// only the header has to be re-encoded for the current abbrev width; the
+  /// result is identical to having emitted the block here directly.
+  void SpliceSubblock(StringRef Encoded) {
+    assert(Encoded.size() >= 8 && (Encoded.size() & 3) == 0 &&
+           "Not a complete block!");
+    const unsigned char *Header = (const unsigned char *)Encoded.data();
+    uint32_t Word = Header[0] | (Header[1] << 8) | (Header[2] << 16) |
+                    (uint32_t(Header[3]) << 24);
+
+    // A fresh writer uses a 2-bit abbrev width, and the rest of the header
+    // (block ID and code length VBRs) always fits in the first word.
+    assert((Word & 3) == bitc::ENTER_SUBBLOCK && "Not a block!");
+    unsigned Bit = 2;
+    unsigned BlockID = ReadHeaderVBR(Word, Bit, bitc::BlockIDWidth);
+    unsigned CodeLen = ReadHeaderVBR(Word, Bit, bitc::CodeLenWidth);
+
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    Out.append(Encoded.begin() + 4, Encoded.end());
+  }
+
+private:
+  /// ReadHeaderVBR - Decode a VBR field of a block header that was encoded
+  /// within a single word, advancing \p Bit past it.
+  static unsigned ReadHeaderVBR(uint32_t Word, unsigned &Bit,
+                                unsigned NumBits) {
+    uint32_t HiBit = 1U << (NumBits - 1);
+    unsigned Result = 0;
+    for (unsigned Shift = 0; ; Shift += NumBits - 1) {
+      assert(Bit + NumBits <= 32 && "Block header does not fit in a word!");
+      uint32_t Piece = (Word >> Bit) & ((1U << NumBits) - 1);
+      Bit += NumBits;
+      Result |= (Piece & (HiBit - 1)) << Shift;
+      if (!(Piece & HiBit))
+        return Result;
+    }
+  }
+
+public:
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
@@ -506,6 +574,25 @@ public:
     EnterSubblock(bitc::BLOCKINFO_BLOCK_ID, CodeWidth);
     BlockInfoCurBID = ~0U;
   }
+
+  /// CopyBlockInfoFrom - Make the abbrevs that \p Other registered through
+  /// its BLOCKINFO_BLOCK available here, without emitting anything.  This lets
+  /// blocks be encoded separately and later spliced into \p Other's stream.
+  /// The abbrevs are copied rather than shared so that the two writers can be
+  /// used from different threads.
+  void CopyBlockInfoFrom(const BitstreamWriter &Other) {
+    for (unsigned i = 0, e = Other.BlockInfoRecords.size(); i != e; ++i) {
+      const BlockInfo &Src = Other.BlockInfoRecords[i];
+      BlockInfo &Info = getOrCreateBlockInfo(Src.BlockID);
+      for (unsigned j = 0, je = Src.Abbrevs.size(); j != je; ++j) {
+        BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+        for (unsigned k = 0, ke = Src.Abbrevs[j]->getNumOperandInfos();
+             k != ke; ++k)
+          Abbv->Add(Src.Abbrevs[j]->getOperandInfo(k));
+        Info.Abbrevs.push_back(Abbv);
+      }
+    }
+  }
 private:
   /// SwitchToBlockID - If we aren't already talking about the specified block
   /// ID, emit a BLOCKINFO_CODE_SETBID record.
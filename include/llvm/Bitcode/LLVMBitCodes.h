@@ -42,7 +42,12 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    FUNCTION_INDEX_BLOCK_ID,
+
+    // Top-level block placed in front of the module.
+    SYMBOL_SUMMARY_BLOCK_ID
   };
 
 
@@ -71,7 +76,11 @@ namespace bitc {
     // MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    // FNINDEXOFFSET: [offset] - The 32-bit word offset of the
+    // FUNCTION_INDEX_BLOCK from the start of the bitcode.
+    MODULE_CODE_FNINDEXOFFSET = 12
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -333,6 +342,25 @@ namespace bitc {
     USELIST_CODE_ENTRY = 1   // USELIST_CODE_ENTRY: TBD.
   };
 
+  /// The function index block (FUNCTION_INDEX_BLOCK_ID) records where the
+  /// body of each function lives so that readers can seek straight to it.
+  enum FunctionIndexCodes {
+    FUNCTION_INDEX_CODE_ENTRY = 1  // ENTRY: [valueid, bitoffset]
+  };
+
+  /// The symbol summary block (SYMBOL_SUMMARY_BLOCK_ID) describes the global
+  /// values of the module that follows it, so that linkers can resolve
+  /// symbols without parsing the module.
+  enum SymbolSummaryCodes {
+    SUMMARY_CODE_TRIPLE     = 1, // TRIPLE:     [strchr x N]
+    SUMMARY_CODE_DATALAYOUT = 2, // DATALAYOUT: [strchr x N]
+    SUMMARY_CODE_FLAGS      = 3, // FLAGS:      [flags]
+    // SYMBOL: [kind, linkage, visibility, flags, alignment, size, namelen,
+    //          namechar x namelen, linkernamechar x N]
+    SUMMARY_CODE_SYMBOL     = 4,
+    SUMMARY_CODE_CALLS      = 5  // CALLS:      [symbolindex, calleeindex x N]
+  };
+
   enum AttributeKindCodes {
     // = 0 is unused
     ATTR_KIND_ALIGNMENT = 1,
@@ -18,6 +18,7 @@
 #include <string>
 
 namespace llvm {
+  struct BitcodeSymbolSummary;
   class BitstreamWriter;
   class MemoryBuffer;
   class DataStreamer;
@@ -50,6 +51,13 @@ namespace llvm {
                                      LLVMContext &Context,
                                      std::string *ErrMsg = 0);
 
+  /// readBitcodeSymbolSummary - Read the symbol summary that the writer puts
+  /// in front of the module when asked to, without reading the module.
+  /// Returns null if the bitcode has no summary.  This *does not* take
+  /// ownership of Buffer.
+  ErrorOr<BitcodeSymbolSummary *>
+  readBitcodeSymbolSummary(MemoryBuffer *Buffer, LLVMContext &Context);
+
   /// Read the specified bitcode file, returning the module.
   /// This method *never* takes ownership of Buffer.
   ErrorOr<Module *> parseBitcodeFile(MemoryBuffer *Buffer,
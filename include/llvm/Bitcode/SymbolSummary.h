@@ -0,0 +1,100 @@
+//===-- llvm/Bitcode/SymbolSummary.h - Bitcode symbol summary ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This header defines the symbol summary that the bitcode writer can place in
+// front of a module.  Linkers and archivers read it to learn what a bitcode
+// file defines and references without parsing the module itself.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_BITCODE_SYMBOLSUMMARY_H
+#define LLVM_BITCODE_SYMBOLSUMMARY_H
+
+#include "llvm/IR/GlobalValue.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// BitcodeSymbol - What the summary records about one global value.
+struct BitcodeSymbol {
+  enum SymbolKind {
+    Function,
+    Variable,
+    Alias
+  };
+
+  enum SymbolFlags {
+    /// The value has no definition in the module.
+    Declaration        = 1 << 0,
+    /// The value is unnamed_addr.
+    UnnamedAddr        = 1 << 1,
+    /// The value is a constant global variable.
+    Constant           = 1 << 2,
+    /// The value is thread local.
+    ThreadLocal        = 1 << 3,
+    /// The value is an alias of a declaration or of an available_externally
+    /// definition.
+    AliasOfDeclaration = 1 << 4
+  };
+
+  /// Name - The name of the value in the IR.
+  std::string Name;
+
+  /// LinkerName - The name the linker sees, as the module's data layout
+  /// mangles it.  This is Name if the module has no data layout.
+  std::string LinkerName;
+
+  SymbolKind Kind;
+  GlobalValue::LinkageTypes Linkage;
+  GlobalValue::VisibilityTypes Visibility;
+  unsigned Flags;
+  unsigned Alignment;
+
+  /// Size - The allocation size of a global variable, or the number of
+  /// instructions in a function body.
+  uint64_t Size;
+
+  /// Callees - The indices of the symbols a function body calls directly.
+  std::vector<unsigned> Callees;
+
+  BitcodeSymbol()
+    : Kind(Function), Linkage(GlobalValue::ExternalLinkage),
+      Visibility(GlobalValue::DefaultVisibility), Flags(0), Alignment(0),
+      Size(0) {}
+
+  bool hasFlag(SymbolFlags F) const { return Flags & F; }
+};
+
+/// BitcodeSymbolSummary - The contents of a SYMBOL_SUMMARY_BLOCK.  It lists
+/// the functions, then the global variables, then the aliases of the module,
+/// in module order.
+struct BitcodeSymbolSummary {
+  enum ModuleFlags {
+    /// The module has module-level inline asm, which may define symbols.
+    HasModuleAsm     = 1 << 0,
+    /// The module has a "Linker Options" module flag.
+    HasLinkerOptions = 1 << 1,
+    /// A global lives in an Objective-C "__OBJC," section.
+    HasObjCSections  = 1 << 2
+  };
+
+  std::string TargetTriple;
+  std::string DataLayout;
+  unsigned Flags;
+  std::vector<BitcodeSymbol> Symbols;
+
+  BitcodeSymbolSummary() : Flags(0) {}
+
+  bool hasFlag(ModuleFlags F) const { return Flags & F; }
+};
+
+} // End llvm namespace
+
+#endif
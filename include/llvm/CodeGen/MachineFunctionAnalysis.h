@@ -14,7 +14,9 @@
 #ifndef LLVM_CODEGEN_MACHINEFUNCTIONANALYSIS_H
 #define LLVM_CODEGEN_MACHINEFUNCTIONANALYSIS_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Mutex.h"
 
 namespace llvm {
 
@@ -28,13 +30,31 @@ private:
   const TargetMachine &TM;
   MachineFunction *MF;
   unsigned NextFnNum;
+
+  /// Suspended - MachineFunctions set aside while the machine passes of
+  /// several functions are in flight, see suspendMF().
+  DenseMap<const Function *, MachineFunction *> Suspended;
+  mutable sys::Mutex Lock;
+
 public:
   static char ID;
   explicit MachineFunctionAnalysis(const TargetMachine &tm);
   ~MachineFunctionAnalysis();
 
   MachineFunction &getMF() const { return *MF; }
-  
+
+  /// getMF - Return the MachineFunction for F, which is either the current
+  /// one or a suspended one.  Safe to call from several threads.
+  MachineFunction &getMF(const Function &F) const;
+
+  /// suspendMF - Set the current MachineFunction aside, so that this pass can
+  /// build the next one while other threads keep working on it.
+  void suspendMF();
+
+  /// resumeMF - Make the suspended MachineFunction for F the current one
+  /// again, to be released once its last user has run.
+  void resumeMF(const Function &F);
+
   virtual const char* getPassName() const {
     return "Machine Function Analysis";
   }
@@ -42,6 +42,7 @@
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/DebugLoc.h"
 #include "llvm/Support/Dwarf.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/ValueHandle.h"
 
 namespace llvm {
@@ -106,40 +107,84 @@ class MachineModuleInfo : public ImmutablePass {
   /// want.
   MachineModuleInfoImpl *ObjFileMMI;
 
-  /// List of moves done by a function's prolog.  Used to construct frame maps
-  /// by debug and exception handling consumers.
-  std::vector<MCCFIInstruction> FrameInstructions;
+public:
+  typedef std::pair<unsigned, DebugLoc> UnsignedDebugLocPair;
+  typedef SmallVector<std::pair<TrackingVH<MDNode>, UnsignedDebugLocPair>, 4>
+    VariableDbgInfoMapTy;
+
+  /// FunctionInfo - The information collected about the function being
+  /// compiled.  EndFunction() resets it.
+  struct FunctionInfo {
+    /// List of moves done by a function's prolog.  Used to construct frame
+    /// maps by debug and exception handling consumers.
+    std::vector<MCCFIInstruction> FrameInstructions;
+
+    /// CompactUnwindEncoding - If the target supports it, this is the compact
+    /// unwind encoding. It replaces a function's CIE and FDE.
+    uint32_t CompactUnwindEncoding;
+
+    /// LandingPads - List of LandingPadInfo describing the landing pad
+    /// information in the current function.
+    std::vector<LandingPadInfo> LandingPads;
+
+    /// CallSiteMap - Map of invoke call site index values to associated begin
+    /// EH_LABEL for the current function.
+    DenseMap<MCSymbol*, unsigned> CallSiteMap;
 
-  /// CompactUnwindEncoding - If the target supports it, this is the compact
-  /// unwind encoding. It replaces a function's CIE and FDE.
-  uint32_t CompactUnwindEncoding;
+    /// TypeInfos - List of C++ TypeInfo used in the current function.
+    std::vector<const GlobalVariable *> TypeInfos;
 
-  /// LandingPads - List of LandingPadInfo describing the landing pad
-  /// information in the current function.
-  std::vector<LandingPadInfo> LandingPads;
+    /// FilterIds - List of typeids encoding filters used in the current
+    /// function.
+    std::vector<unsigned> FilterIds;
+
+    /// FilterEnds - List of the indices in FilterIds corresponding to filter
+    /// terminators.
+    std::vector<unsigned> FilterEnds;
+
+    bool CallsEHReturn;
+    bool CallsUnwindInit;
+
+    VariableDbgInfoMapTy VariableDbgInfo;
+
+    FunctionInfo()
+      : CompactUnwindEncoding(0), CallsEHReturn(false),
+        CallsUnwindInit(false) {}
+  };
+
+private:
+  /// CurFn - The current function's information.
+  FunctionInfo CurFn;
+
+  /// ThreadFn - Threads working on some other function than the current one
+  /// point this at that function's information instead.
+  mutable sys::ThreadLocal<const FunctionInfo> ThreadFn;
+
+  /// Multithreaded - True while functions are compiled on several threads.
+  /// Until then ThreadFn is never set and fn() does not look it up.
+  bool Multithreaded;
+
+  FunctionInfo &fn() {
+    if (!Multithreaded)
+      return CurFn;
+    const FunctionInfo *FI = ThreadFn.get();
+    return FI ? const_cast<FunctionInfo &>(*FI) : CurFn;
+  }
+  const FunctionInfo &fn() const {
+    if (!Multithreaded)
+      return CurFn;
+    const FunctionInfo *FI = ThreadFn.get();
+    return FI ? *FI : CurFn;
+  }
 
   /// LPadToCallSiteMap - Map a landing pad's EH symbol to the call site
   /// indexes.
   DenseMap<MCSymbol*, SmallVector<unsigned, 4> > LPadToCallSiteMap;
 
-  /// CallSiteMap - Map of invoke call site index values to associated begin
-  /// EH_LABEL for the current function.
-  DenseMap<MCSymbol*, unsigned> CallSiteMap;
-
   /// CurCallSite - The current call site index being processed, if any. 0 if
   /// none.
   unsigned CurCallSite;
 
-  /// TypeInfos - List of C++ TypeInfo used in the current function.
-  std::vector<const GlobalVariable *> TypeInfos;
-
-  /// FilterIds - List of typeids encoding filters used in the current function.
-  std::vector<unsigned> FilterIds;
-
-  /// FilterEnds - List of the indices in FilterIds corresponding to filter
-  /// terminators.
-  std::vector<unsigned> FilterEnds;
-
   /// Personalities - Vector of all personality functions ever seen. Used to
   /// emit common EH frames.
   std::vector<const Function *> Personalities;
@@ -153,9 +198,6 @@ class MachineModuleInfo : public ImmutablePass {
   /// the specified basic block's address of label.
   MMIAddrLabelMap *AddrLabelSymbols;
 
-  bool CallsEHReturn;
-  bool CallsUnwindInit;
-
   /// DbgInfoAvailable - True if debugging information is available
   /// in this module.
   bool DbgInfoAvailable;
@@ -168,11 +210,6 @@ class MachineModuleInfo : public ImmutablePass {
 public:
   static char ID; // Pass identification, replacement for typeid
 
-  typedef std::pair<unsigned, DebugLoc> UnsignedDebugLocPair;
-  typedef SmallVector<std::pair<TrackingVH<MDNode>, UnsignedDebugLocPair>, 4>
-    VariableDbgInfoMapTy;
-  VariableDbgInfoMapTy VariableDbgInfo;
-
   MachineModuleInfo();  // DUMMY CONSTRUCTOR, DO NOT CALL.
   // Real constructor.
   MachineModuleInfo(const MCAsmInfo &MAI, const MCRegisterInfo &MRI,
@@ -187,6 +224,26 @@ public:
   ///
   void EndFunction();
 
+  /// swapFunctionInfo - Exchange the current function's information with FI,
+  /// to set it aside while the next function is being compiled.
+  void swapFunctionInfo(FunctionInfo &FI) { std::swap(CurFn, FI); }
+
+  /// setMultithreaded - Allow or disallow setThreadFunctionInfo.  This must be
+  /// toggled while no other thread is using this object.
+  void setMultithreaded(bool Enable) { Multithreaded = Enable; }
+
+  /// setThreadFunctionInfo - Make the per-function queries and updates made
+  /// on the calling thread use FI rather than the current function's
+  /// information, or stop doing so if FI is null.  Only valid while the
+  /// object is multithreaded.
+  void setThreadFunctionInfo(FunctionInfo *FI) {
+    assert(Multithreaded && "Thread function info needs multithreaded mode!");
+    if (FI)
+      ThreadFn.set(FI);
+    else
+      ThreadFn.erase();
+  }
+
   const MCContext &getContext() const { return Context; }
   MCContext &getContext() { return Context; }
 
@@ -217,11 +274,11 @@ public:
   bool hasDebugInfo() const { return DbgInfoAvailable; }
   void setDebugInfoAvailability(bool avail) { DbgInfoAvailable = avail; }
 
-  bool callsEHReturn() const { return CallsEHReturn; }
-  void setCallsEHReturn(bool b) { CallsEHReturn = b; }
+  bool callsEHReturn() const { return fn().CallsEHReturn; }
+  void setCallsEHReturn(bool b) { fn().CallsEHReturn = b; }
 
-  bool callsUnwindInit() const { return CallsUnwindInit; }
-  void setCallsUnwindInit(bool b) { CallsUnwindInit = b; }
+  bool callsUnwindInit() const { return fn().CallsUnwindInit; }
+  void setCallsUnwindInit(bool b) { fn().CallsUnwindInit = b; }
 
   bool usesVAFloatArgument() const {
     return UsesVAFloatArgument;
@@ -235,21 +292,25 @@ public:
   /// function's prologue.  Used to construct frame maps for debug and exception
   /// handling comsumers.
   const std::vector<MCCFIInstruction> &getFrameInstructions() const {
-    return FrameInstructions;
+    return fn().FrameInstructions;
   }
 
   void addFrameInst(const MCCFIInstruction &Inst) {
-    FrameInstructions.push_back(Inst);
+    fn().FrameInstructions.push_back(Inst);
   }
 
   /// getCompactUnwindEncoding - Returns the compact unwind encoding for a
   /// function if the target supports the encoding. This encoding replaces a
   /// function's CIE and FDE.
-  uint32_t getCompactUnwindEncoding() const { return CompactUnwindEncoding; }
+  uint32_t getCompactUnwindEncoding() const {
+    return fn().CompactUnwindEncoding;
+  }
 
   /// setCompactUnwindEncoding - Set the compact unwind encoding for a function
   /// if the target supports the encoding.
-  void setCompactUnwindEncoding(uint32_t Enc) { CompactUnwindEncoding = Enc; }
+  void setCompactUnwindEncoding(uint32_t Enc) {
+    fn().CompactUnwindEncoding = Enc;
+  }
 
   /// getAddrLabelSymbol - Return the symbol to be used for the specified basic
   /// block when its address is taken.  This cannot be its normal LBB label
@@ -334,7 +395,7 @@ public:
   /// getLandingPads - Return a reference to the landing pad info for the
   /// current function.
   const std::vector<LandingPadInfo> &getLandingPads() const {
-    return LandingPads;
+    return fn().LandingPads;
   }
 
   /// setCallSiteLandingPad - Map the landing pad's EH symbol to the call
@@ -357,20 +418,20 @@ public:
 
   /// setCallSiteBeginLabel - Map the begin label for a call site.
   void setCallSiteBeginLabel(MCSymbol *BeginLabel, unsigned Site) {
-    CallSiteMap[BeginLabel] = Site;
+    fn().CallSiteMap[BeginLabel] = Site;
   }
 
   /// getCallSiteBeginLabel - Get the call site number for a begin label.
   unsigned getCallSiteBeginLabel(MCSymbol *BeginLabel) {
     assert(hasCallSiteBeginLabel(BeginLabel) &&
            "Missing call site number for EH_LABEL!");
-    return CallSiteMap[BeginLabel];
+    return fn().CallSiteMap[BeginLabel];
   }
 
   /// hasCallSiteBeginLabel - Return true if the begin label has a call site
   /// number associated with it.
   bool hasCallSiteBeginLabel(MCSymbol *BeginLabel) {
-    return CallSiteMap[BeginLabel] != 0;
+    return fn().CallSiteMap[BeginLabel] != 0;
   }
 
   /// setCurrentCallSite - Set the call site currently being processed.
@@ -383,13 +444,13 @@ public:
   /// getTypeInfos - Return a reference to the C++ typeinfo for the current
   /// function.
   const std::vector<const GlobalVariable *> &getTypeInfos() const {
-    return TypeInfos;
+    return fn().TypeInfos;
   }
 
   /// getFilterIds - Return a reference to the typeids encoding filters used in
   /// the current function.
   const std::vector<unsigned> &getFilterIds() const {
-    return FilterIds;
+    return fn().FilterIds;
   }
 
   /// getPersonality - Return a personality function if available.  The presence
@@ -399,10 +460,11 @@ public:
   /// setVariableDbgInfo - Collect information used to emit debugging
   /// information of a variable.
   void setVariableDbgInfo(MDNode *N, unsigned Slot, DebugLoc Loc) {
-    VariableDbgInfo.push_back(std::make_pair(N, std::make_pair(Slot, Loc)));
+    fn().VariableDbgInfo.push_back(
+        std::make_pair(N, std::make_pair(Slot, Loc)));
   }
 
-  VariableDbgInfoMapTy &getVariableDbgInfo() { return VariableDbgInfo; }
+  VariableDbgInfoMapTy &getVariableDbgInfo() { return fn().VariableDbgInfo; }
 
 }; // End class MachineModuleInfo
 
@@ -344,6 +344,10 @@ protected:
   /// those steps are enabled.
   ///
   void printAndVerify(const char *Banner);
+
+  /// getMachinePassThreads - Return how many functions the machine passes
+  /// after instruction selection may work on at once.
+  unsigned getMachinePassThreads() const;
 };
 } // namespace llvm
 
@@ -374,6 +378,15 @@ namespace llvm {
   /// matching during instruction selection.
   FunctionPass *createCodeGenPreparePass(const TargetMachine *TM = 0);
 
+  /// createMachineSectionBeginPass / createMachineSectionEndPass - Markers
+  /// around the machine passes that run on NumThreads functions at once, see
+  /// ParallelSectionPass.  The passes in between must not touch the state the
+  /// MachineFunctions of a module share, apart from the per-function
+  /// information kept by MachineModuleInfo.
+  FunctionPass *createMachineSectionBeginPass(TargetMachine *TM,
+                                              unsigned NumThreads);
+  FunctionPass *createMachineSectionEndPass();
+
   /// MachineLoopInfo - This pass is a loop analysis pass.
   extern char &MachineLoopInfoID;
 
@@ -22,6 +22,7 @@
 #include "llvm/ADT/ValueMap.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Target/TargetLowering.h"
 
 namespace llvm {
@@ -65,6 +66,10 @@ private:
   /// AllocaInst triggers a stack protector.
   SSPLayoutMap Layout;
 
+  /// LayoutLock - Machine passes running on several functions at once query
+  /// and adjust the layout concurrently.
+  mutable sys::Mutex LayoutLock;
+
   /// \brief The minimum size of buffers that will receive stack smashing
   /// protection when -fstack-protection is used.
   unsigned SSPBufferSize;
@@ -513,6 +513,9 @@
 /* Installation directory for documentation */
 #cmakedefine LLVM_DOCSDIR "${LLVM_DOCSDIR}"
 
+/* Define if function bodies can be allocated from arenas */
+#cmakedefine01 LLVM_ENABLE_FUNCTION_ARENAS
+
 /* Define if threads enabled */
 #cmakedefine01 LLVM_ENABLE_THREADS
 
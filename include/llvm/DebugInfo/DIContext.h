@@ -141,6 +141,13 @@ public:
 
   virtual void dump(raw_ostream &OS, DIDumpType DumpType = DIDT_All) = 0;
 
+  /// preload - Parse all debug information up front, using \p NumThreads
+  /// threads (0 means one per hardware thread), and build the indexes that
+  /// address queries use.  Without this, debug information is parsed as
+  /// queries need it.  Once preloaded, the context is not modified by
+  /// address queries, so they may be made from several threads at once.
+  virtual void preload(unsigned NumThreads) {}
+
   virtual DILineInfo getLineInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DILineInfoTable getLineInfoForAddressRange(uint64_t Address,
@@ -116,6 +116,9 @@ class ExecutionEngine {
   /// Whether lazy JIT compilation is enabled.
   bool CompilingLazily;
 
+  /// Whether MCJIT splits modules into lazily compiled function bodies.
+  bool SplittingModulesLazily;
+
   /// Whether JIT compilation of external global variables is allowed.
   bool GVCompilationDisabled;
 
@@ -490,6 +493,19 @@ public:
     return !CompilingLazily;
   }
 
+  /// EnableLazyModuleSplitting - When this is on (it is off by default) as
+  /// MCJIT generates code for a module, each function body is split into a
+  /// module of its own, which is only compiled when the stub left in its place
+  /// is first called.  The stubs may be called from any number of threads.
+  /// Local symbols are renamed and given hidden external linkage so that the
+  /// bodies can refer to them.
+  void EnableLazyModuleSplitting(bool Enabled = true) {
+    SplittingModulesLazily = Enabled;
+  }
+  bool isSplittingModulesLazily() const {
+    return SplittingModulesLazily;
+  }
+
   /// DisableGVCompilation - If called, the JIT will abort if it's asked to
   /// allocate space and populate a GlobalVariable that is not internal to
   /// the module.
@@ -0,0 +1,83 @@
+//===-- FileObjectCache.h - On-disk object cache for MCJIT ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FileObjectCache, an ObjectCache that keeps the objects
+// MCJIT generates in a directory so that later runs can skip code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// This is an ObjectCache that stores each compiled object as a file in a
+/// cache directory.
+///
+/// Objects are keyed by an MD5 hash of the module's bitcode together with
+/// the target triple, CPU, features and code generation options of the
+/// TargetMachine that compiles it, so a cached object is only reused when it
+/// would have been generated identically.  Several processes may share one
+/// directory: objects are written to a temporary file and renamed into place
+/// while holding a lock file, so readers never see a partially written
+/// object.
+///
+/// If a size limit is given, the least recently used objects are deleted
+/// whenever a new object pushes the total size of the cache over it.
+class FileObjectCache : public ObjectCache {
+  FileObjectCache(const FileObjectCache&) LLVM_DELETED_FUNCTION;
+  void operator=(const FileObjectCache&) LLVM_DELETED_FUNCTION;
+
+public:
+  /// Create a cache in \p CacheDir, which is created if it does not exist.
+  /// \p TM is the target machine the execution engine generates code with;
+  /// if it is null only the module and its target triple are hashed.  A
+  /// \p MaxSize of zero means the cache may grow without bound.
+  FileObjectCache(StringRef CacheDir, const TargetMachine *TM,
+                  uint64_t MaxSize = 0);
+  virtual ~FileObjectCache();
+
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj);
+  virtual MemoryBuffer *getObject(const Module *M);
+
+  /// \brief Return the cache key for \p M, as a string of hex digits.
+  std::string getCacheKey(const Module *M) const;
+
+  /// \brief Delete the least recently used objects until the cache is no
+  /// larger than its size limit.  This is a no-op without a limit or while
+  /// another process is pruning the same directory.
+  void prune();
+
+  StringRef getCacheDir() const { return CacheDir; }
+  uint64_t getMaxSize() const { return MaxSize; }
+
+private:
+  void getObjectPath(StringRef Key, SmallVectorImpl<char> &Path) const;
+
+  SmallString<128> CacheDir;
+  std::string CodeGenConfig;
+  uint64_t MaxSize;
+
+  /// Code generation may modify the module, so the key computed when MCJIT
+  /// looks a module up is remembered until the object is handed back.
+  DenseMap<const Module *, std::string> PendingKeys;
+  sys::Mutex PendingKeysLock;
+};
+
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
 
 namespace llvm {
 
@@ -35,12 +36,85 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// Sections are carved out of slabs taken from a SlabPool, which hands the
+/// slabs of destroyed memory managers on to new ones instead of unmapping
+/// them.  Each call to finalizeMemory only changes the permissions of the
+/// pages written since the previous call, and nothing is ever placed on a
+/// page once it has been made executable or read-only, so no page is
+/// writable and executable at the same time.
 class SectionMemoryManager : public RTDyldMemoryManager {
   SectionMemoryManager(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
   void operator=(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
 
 public:
-  SectionMemoryManager() { }
+  /// \brief A thread-safe cache of read-write memory slabs.
+  ///
+  /// Slabs come in power-of-two multiples of the base slab size, up to
+  /// MaxSizeClass doublings; larger requests are mapped to size and
+  /// unmapped when released.  Released slabs are kept for reuse until
+  /// \p MaxFreeBytes are cached.  A pool must outlive the memory managers
+  /// that use it.
+  class SlabPool {
+    SlabPool(const SlabPool&) LLVM_DELETED_FUNCTION;
+    void operator=(const SlabPool&) LLVM_DELETED_FUNCTION;
+
+  public:
+    enum { MaxSizeClass = 5 };
+
+    /// \p SlabSize is rounded up to a whole number of pages.  With
+    /// \p UseHugePages the slabs are mapped with sys::Memory::MF_HUGE_HINT,
+    /// which only pays off if \p SlabSize is a multiple of the huge page
+    /// size.
+    explicit SlabPool(size_t SlabSize = 64 * 1024,
+                      size_t MaxFreeBytes = 16 * 1024 * 1024,
+                      bool UseHugePages = false);
+    ~SlabPool();
+
+    /// \brief Return a read-write slab of at least \p MinSize bytes.
+    sys::MemoryBlock allocate(size_t MinSize, error_code &EC);
+
+    /// \brief Give back a slab returned by allocate().
+    void release(sys::MemoryBlock Slab);
+
+    size_t getSlabSize() const { return SlabSize; }
+
+    /// \brief Return the number of bytes currently mapped by the pool,
+    /// whether in use or cached.
+    size_t getMappedBytes() const;
+
+    /// \brief Return the number of bytes cached for reuse.
+    size_t getFreeBytes() const;
+
+    /// \brief The pool shared by all memory managers that are not given
+    /// one explicitly.
+    static SlabPool &getDefault();
+
+  private:
+    int getSizeClass(size_t Size) const;
+
+    size_t SlabSize;
+    size_t MaxFreeBytes;
+    bool UseHugePages;
+
+    mutable sys::Mutex Lock;
+    SmallVector<sys::MemoryBlock, 8> FreeSlabs[MaxSizeClass + 1];
+    size_t MappedBytes;
+    size_t FreeBytes;
+    /// The most recent mapping, used as a hint to keep the slabs close to
+    /// each other.
+    sys::MemoryBlock Near;
+  };
+
+  /// \brief Create a memory manager that takes its memory from the default
+  /// slab pool.  Once llvm_shutdown has destroyed that pool, the memory
+  /// manager maps and unmaps its slabs directly instead.
+  SectionMemoryManager();
+
+  /// \brief Create a memory manager that takes its memory from \p Pool.
+  explicit SectionMemoryManager(SlabPool &Pool);
+
+  /// \brief Return all memory to the slab pool.
   virtual ~SectionMemoryManager();
 
   /// \brief Allocates a memory block of (at least) the given size suitable for
@@ -85,10 +159,15 @@ public:
   virtual void invalidateInstructionCache();
 
 private:
+  /// Sections of one kind are allocated by bumping a pointer through the
+  /// most recent slab.  Pending is where the memory not yet finalized begins;
+  /// PendingMem holds the unfinalized tails of earlier slabs.
   struct MemoryGroup {
-      SmallVector<sys::MemoryBlock, 16> AllocatedMem;
-      SmallVector<sys::MemoryBlock, 16> FreeMem;
-      sys::MemoryBlock Near;
+      SmallVector<sys::MemoryBlock, 16> Slabs;
+      SmallVector<sys::MemoryBlock, 4> PendingMem;
+      uintptr_t Cur, End, Pending;
+
+      MemoryGroup() : Cur(0), End(0), Pending(0) {}
   };
 
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
@@ -97,6 +176,11 @@ private:
   error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                          unsigned Permissions);
 
+  SlabPool *getPool() const;
+  void releaseSlabs(MemoryGroup &MemGroup);
+
+  /// The pool slabs come from, or null for the default pool.
+  SlabPool *Pool;
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
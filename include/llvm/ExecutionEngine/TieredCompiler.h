@@ -0,0 +1,147 @@
+//===-- TieredCompiler.h - Background optimizing compiles -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares TieredCompiler, which runs a module with a quick first
+// tier while a fully optimized build of it is compiled on a background thread.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_TIEREDCOMPILER_H
+#define LLVM_EXECUTIONENGINE_TIEREDCOMPILER_H
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/Mutex.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class ExecutionEngine;
+class Function;
+class LLVMContext;
+class Module;
+class ThreadPool;
+
+/// TieredCompiler - Make a module executable straight away and swap in
+/// optimized code once a background thread has finished compiling it.
+///
+/// create() brings the module up with a cheap first tier, either MCJIT at
+/// CodeGenOpt::None with FastISel or the interpreter, and then queues an
+/// optimized MCJIT build of it on a background thread.  That build works on a
+/// bitcode copy of the module in an LLVMContext of its own, so the caller may
+/// keep running first-tier code, and keep using the module's context, while it
+/// is in progress.
+///
+/// Both tiers share the module's mutable global variables: the optimized code
+/// is linked against the storage the first tier allocated, so switching tiers
+/// does not lose program state.  To make that possible, create() gives
+/// internal mutable globals external, hidden linkage.
+///
+/// Native callers look up an entry slot with getEntrySlot() and call through
+/// it.  A slot holds the first-tier address of the function until the
+/// optimized code is finalized, and is then patched to point at the optimized
+/// code.  With the interpreter as first tier there is no native code to start
+/// with, so runFunction() is the way in: it dispatches to whichever tier is
+/// ready.
+class TieredCompiler {
+  TieredCompiler(const TieredCompiler &) LLVM_DELETED_FUNCTION;
+  void operator=(const TieredCompiler &) LLVM_DELETED_FUNCTION;
+
+public:
+  enum BaselineKind {
+    /// MCJIT at CodeGenOpt::None, selecting instructions with FastISel.
+    BaselineFastISel,
+    /// The LLVM IR interpreter.
+    BaselineInterpreter
+  };
+
+  /// Called on the background thread once the optimized code has been
+  /// installed, with an empty string, or with an error message if it could
+  /// not be built, in which case the first tier simply keeps running.
+  typedef std::function<void(const std::string &Error)> CallbackTy;
+
+  /// create - Take ownership of \p M, make it executable with \p Baseline and
+  /// start compiling it at \p OptLevel in the background.  \p OnOptimized, if
+  /// given, is called when that compile finishes.  Returns null and fills in
+  /// \p ErrorStr if the first tier cannot be created.
+  static TieredCompiler *create(Module *M, std::string *ErrorStr,
+                                BaselineKind Baseline = BaselineFastISel,
+                                CodeGenOpt::Level OptLevel =
+                                    CodeGenOpt::Default,
+                                CallbackTy OnOptimized = CallbackTy());
+
+  /// Wait for the background compile and release both tiers.
+  ~TieredCompiler();
+
+  /// getEntrySlot - Return the entry slot for the externally visible function
+  /// \p Name, or null if there is no such function or the first tier is the
+  /// interpreter and the optimized code is not ready yet.  The slot stays
+  /// valid for the lifetime of the TieredCompiler.
+  void *const volatile *getEntrySlot(StringRef Name);
+
+  /// runFunction - Run \p F, a function of the module passed to create(), on
+  /// the optimized code if it is ready and on the first tier otherwise.  The
+  /// usual ExecutionEngine::runFunction restrictions apply.
+  GenericValue runFunction(Function *F, const std::vector<GenericValue> &Args);
+
+  /// isOptimized - Return true once the optimized code has been installed.
+  bool isOptimized() const { return Optimized; }
+
+  /// waitForOptimizedCode - Block until the background compile has finished,
+  /// successfully or not.
+  void waitForOptimizedCode();
+
+  /// getBaselineEngine - Return the first-tier engine, which owns the module
+  /// passed to create().
+  ExecutionEngine *getBaselineEngine() const { return Baseline.get(); }
+
+  /// getOptimizedEngine - Return the optimized-tier engine, or null while
+  /// isOptimized() is false.  Its module is a copy of the one passed to
+  /// create() that shares the first tier's global variables.  The copy has no
+  /// static constructors or destructors, so that running them on both engines
+  /// does not initialize the shared globals twice; run them on the first
+  /// tier's engine.
+  ExecutionEngine *getOptimizedEngine() const;
+
+private:
+  TieredCompiler(ExecutionEngine *Baseline, BaselineKind Kind);
+
+  void compileOptimized(CodeGenOpt::Level OptLevel, CallbackTy OnOptimized);
+
+  OwningPtr<ExecutionEngine> Baseline;
+  BaselineKind Kind;
+
+  /// The module as it was handed to create(), for the background compile.
+  std::string Bitcode;
+
+  /// Addresses of the first-tier globals the optimized code links against.
+  StringMap<uint64_t> SharedGlobals;
+
+  /// The optimized tier lives in its own context so that the background
+  /// thread never touches the caller's.  Both are only valid once Optimized
+  /// is set.
+  OwningPtr<LLVMContext> OptContext;
+  OwningPtr<ExecutionEngine> OptEngine;
+  Module *OptModule;
+
+  /// Protects EntrySlots and the transition to the optimized tier.
+  sys::Mutex SlotLock;
+  StringMap<void *volatile> EntrySlots;
+  volatile bool Optimized;
+
+  OwningPtr<ThreadPool> Worker;
+};
+
+}
+
+#endif
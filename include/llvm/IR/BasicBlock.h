@@ -112,6 +112,11 @@ public:
   }
   ~BasicBlock();
 
+  /// \brief Allocate a basic block, from the arena of the innermost
+  /// FunctionArenaScope if there is one.
+  void *operator new(size_t s);
+  void operator delete(void *Ptr);
+
   /// \brief Return the enclosing method, or null if none.
   const Function *getParent() const { return Parent; }
         Function *getParent()       { return Parent; }
@@ -27,6 +27,7 @@
 
 namespace llvm {
 
+class FunctionArena;
 class FunctionType;
 class LLVMContext;
 
@@ -86,6 +87,7 @@ private:
   mutable ArgumentListType ArgumentList;  ///< The formal arguments
   ValueSymbolTable *SymTab;               ///< Symbol table of args/instructions
   AttributeSet AttributeSets;             ///< Parameter attributes
+  FunctionArena *Arena;                   ///< Allocates the body, or null
 
   // HasLazyArguments is stored in Value::SubclassData.
   /*bool HasLazyArguments;*/
@@ -454,6 +456,11 @@ public:
     return V->getValueID() == Value::FunctionVal;
   }
 
+  /// getArena - Return the arena the body of this function is allocated from
+  /// while a FunctionArenaScope for it is open, creating it on first use.
+  /// Returns null if function arenas are disabled for the context.
+  FunctionArena *getArena();
+
   /// dropAllReferences() - This method causes all the subinstructions to "let
   /// go" of all references that they are maintaining.  This allows one to
   /// 'delete' a whole module at a time, even though there may be circular
@@ -0,0 +1,175 @@
+//===- llvm/IR/FunctionArena.h - Arenas for function bodies -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FunctionArena, from which the instructions, operands and
+// basic blocks of a function are allocated when function arenas are enabled
+// for its context (see LLVMContext::setFunctionArenas), and
+// FunctionArenaScope, which selects the arena new IR is allocated from.
+//
+// An arena carves objects out of the slabs of a BumpPtrAllocator, so the
+// body of a function is laid out close together and is freed a slab at a
+// time.  Objects that are deleted go to free lists, one per size for
+// instructions with their operands and a Recycler for basic blocks, and are
+// reused by later allocations of the same size.
+//
+// Every allocation is preceded by a word naming the arena it came from, so an
+// instruction that was moved to another function is still freed to the right
+// arena.  An arena lives until its function is destroyed and the last object
+// allocated from it is freed.
+//
+// operator new cannot tell which function an object is being created for, so
+// allocation follows the innermost FunctionArenaScope of the current thread.
+// The bitcode reader, the IR parser and the function pass manager open one
+// for the function they work on.  IR created outside of any scope comes from
+// the heap, as it does when arenas are disabled.
+//
+// Function passes running on different threads work on different functions,
+// but an instruction moved out of its function, for example by the block
+// extractor, is freed by the thread working on its new function while another
+// thread may be allocating from its arena.  Each arena therefore has a lock,
+// which is only taken while some context is multithreaded (see
+// LLVMContext::setMultithreaded).
+//
+// Arenas are only available if LLVM was configured with
+// LLVM_ENABLE_FUNCTION_ARENAS, since the arena word costs memory for every
+// instruction and basic block.  Otherwise all IR comes from the heap and
+// LLVMContext::setFunctionArenas has no effect.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_FUNCTIONARENA_H
+#define LLVM_IR_FUNCTIONARENA_H
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/Support/AlignOf.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Recycler.h"
+
+namespace llvm {
+
+class Function;
+
+class FunctionArena {
+  FunctionArena(const FunctionArena &) LLVM_DELETED_FUNCTION;
+  void operator=(const FunctionArena &) LLVM_DELETED_FUNCTION;
+
+  /// Chunk - The unit instruction allocations are measured in.
+  struct Chunk {
+    void *Words[2];
+  };
+
+  /// BlockStorage - A basic block with the arena word in front of it.
+  struct BlockStorage {
+    uintptr_t Header;
+    AlignedCharArrayUnion<BasicBlock> Block;
+  };
+
+  /// FreeInst - An instruction on a free list.
+  struct FreeInst {
+    FreeInst *Next;
+  };
+
+  /// The size of an instruction in chunks is stored in the low bits of the
+  /// arena word, which arenas are aligned to leave clear.  Instructions are
+  /// only rounded up to a whole chunk, not to a power of two, so an arena
+  /// takes about as much memory as the heap would.  Larger instructions, such
+  /// as calls with many arguments, come from the heap.
+  enum {
+    SizeBits = 6,
+    SizeMask = (1 << SizeBits) - 1,
+    MaxChunks = SizeMask,
+    ArenaAlignment = 1 << SizeBits
+  };
+
+  BumpPtrAllocator Allocator;
+  /// FreeInsts - Free lists of instructions, indexed by their size in chunks.
+  FreeInst *FreeInsts[MaxChunks + 1];
+  Recycler<BlockStorage> BlockRecycler;
+
+  /// NumLive - The number of objects allocated from this arena that have not
+  /// been freed yet.
+  unsigned NumLive;
+
+  /// HasOwner - False once the function owning this arena is destroyed.
+  bool HasOwner;
+
+  /// Lock - Protects the members above while some context is multithreaded.
+  /// Use LockGuard rather than locking it directly.
+  sys::MutexImpl Lock;
+  class LockGuard;
+
+  /// needsLock - Return true if arenas must be locked, because some context
+  /// is multithreaded.
+  static bool needsLock() { return Use::anyContextMultithreaded(); }
+
+  FunctionArena();
+  ~FunctionArena();
+
+  /// Arenas are allocated with ArenaAlignment.
+  void *operator new(size_t Size);
+  void operator delete(void *Ptr);
+
+  /// getCurrent - Return the arena of the innermost FunctionArenaScope on
+  /// this thread, or null.
+  static FunctionArena *getCurrent();
+
+  /// releaseObject - Note that an object allocated from this arena was freed.
+  /// Returns true if the arena is no longer used and should be deleted once
+  /// its lock is released.
+  bool releaseObject() {
+    return --NumLive == 0 && !HasOwner;
+  }
+
+  /// releaseOwner - Note that the function owning this arena was destroyed.
+  void releaseOwner();
+
+  friend class Function;
+  friend class FunctionArenaScope;
+
+public:
+  /// allocateInstruction - Allocate \p Size bytes for an instruction and its
+  /// co-allocated operands.
+  static void *allocateInstruction(size_t Size);
+
+  /// deallocateInstruction - Free memory returned by allocateInstruction.
+  static void deallocateInstruction(void *Ptr);
+
+  /// allocateBlock - Allocate memory for a basic block.
+  static void *allocateBlock(size_t Size);
+
+  /// deallocateBlock - Free memory returned by allocateBlock.
+  static void deallocateBlock(void *Ptr);
+
+  /// getTotalMemory - Return the size of the slabs of this arena.
+  size_t getTotalMemory() const { return Allocator.getTotalMemory(); }
+};
+
+/// FunctionArenaScope - While alive, instructions and basic blocks created on
+/// this thread are allocated from the arena of a function.  Scopes nest; the
+/// innermost one wins.
+class FunctionArenaScope {
+  FunctionArenaScope(const FunctionArenaScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const FunctionArenaScope &) LLVM_DELETED_FUNCTION;
+
+  FunctionArena *Arena;
+  FunctionArena *Saved;
+  bool Installed;
+
+public:
+  /// Allocate from the arena of \p F, or from the heap if function arenas
+  /// are disabled for the context of \p F.
+  explicit FunctionArenaScope(Function &F);
+  ~FunctionArenaScope();
+};
+
+} // End llvm namespace
+
+#endif
@@ -466,6 +466,17 @@ protected:
               BasicBlock *InsertAtEnd);
   virtual Instruction *clone_impl() const = 0;
 
+  /// operator new - Allocate an instruction and its \p Us operands, from the
+  /// arena of the innermost FunctionArenaScope if there is one.
+  void *operator new(size_t s, unsigned Us);
+public:
+  /// operator delete - Free memory allocated for an instruction and its
+  /// operands.
+  void operator delete(void *Usr);
+  /// placement delete - required by std, but never called.
+  void operator delete(void*, unsigned) {
+    llvm_unreachable("Constructor throws?");
+  }
 };
 
 // Instruction* is only 4-byte aligned.
@@ -33,8 +33,9 @@ template <typename T> class SmallVectorImpl;
 /// This is an important class for using LLVM in a threaded context.  It
 /// (opaquely) owns and manages the core "global" data of LLVM's core
 /// infrastructure, including the type and constant uniquing tables.
-/// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// LLVMContext itself provides no locking guarantees unless it is put into
+/// multithreaded mode (see setMultithreaded), so you should be careful to
+/// have one context per thread.
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
@@ -116,6 +117,42 @@ public:
   /// for RS_Error, "warning: " for RS_Warning, and "note: " for RS_Note.
   void diagnose(const DiagnosticInfo &DI);
 
+  /// setMultithreaded - Enable or disable locking of the context-wide state
+  /// (type, constant and metadata uniquing tables, value handles and the use
+  /// lists of values shared between functions).  While enabled, several
+  /// threads may build or transform *different* functions of modules in this
+  /// context at the same time; each function must still be touched by only
+  /// one thread.  Of the module-level state, only creating functions, global
+  /// variables and aliases, naming them, looking them up by name (getFunction,
+  /// getNamedValue, getOrInsertFunction, ...) and named metadata lookups are
+  /// locked.  Erasing or removing globals from a module, or iterating over its
+  /// function, global or alias lists, still requires that no other thread is
+  /// using that module.  Walking the use list of a constant or global
+  /// meanwhile needs a SharedUseListGuard; use_empty, hasOneUse and
+  /// removeDeadConstantUsers take one themselves, as do the function passes
+  /// that walk such use lists.  Values of contexts that are not multithreaded
+  /// are never locked.  This must be toggled while no other thread is using
+  /// the context.
+  void setMultithreaded(bool Enable);
+
+  /// isMultithreaded - Return true if the context-wide state is locked.
+  bool isMultithreaded() const;
+
+  /// setFunctionArenas - Enable or disable arena allocation of function
+  /// bodies.  While enabled, the instructions and basic blocks created for a
+  /// function inside a FunctionArenaScope are allocated from an arena owned
+  /// by the function, which makes walking and deleting large functions
+  /// cheaper.  It only affects functions that have not allocated from an
+  /// arena yet, and has no effect unless LLVM was configured with
+  /// LLVM_ENABLE_FUNCTION_ARENAS.  See FunctionArena.h.
+  void setFunctionArenas(bool Enable);
+
+  /// hasFunctionArenas - Return true if function bodies are allocated from
+  /// arenas, either because setFunctionArenas enabled them or because
+  /// -function-arenas was given.  Always false if LLVM was configured
+  /// without LLVM_ENABLE_FUNCTION_ARENAS.
+  bool hasFunctionArenas() const;
+
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
   /// be prepared to drop the erroneous construct on the floor and "not crash".
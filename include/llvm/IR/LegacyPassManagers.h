@@ -198,6 +198,14 @@ public:
   /// Find analysis usage information for the pass P.
   AnalysisUsage *findAnalysisUsage(Pass *P);
 
+  /// isImplicitPass - Return true if the pass manager created P itself from
+  /// the pass registry, to provide an analysis that another pass requires.
+  /// Another instance from the registry is then an exact copy of P.
+  bool isImplicitPass(Pass *P) const { return ImplicitPasses.count(P); }
+
+  /// noteImplicitPass - Record that the pass manager created P itself.
+  void noteImplicitPass(Pass *P) { ImplicitPasses.insert(P); }
+
   virtual ~PMTopLevelManager();
 
   /// Add immutable pass and initialize it.
@@ -251,6 +259,9 @@ private:
   SmallVector<ImmutablePass *, 8> ImmutablePasses;
 
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
+
+  /// Passes the pass manager created on its own.  See isImplicitPass.
+  SmallPtrSet<Pass *, 16> ImplicitPasses;
 };
 
 
@@ -263,7 +274,7 @@ private:
 class PMDataManager {
 public:
 
-  explicit PMDataManager() : TPM(NULL), Depth(0) {
+  explicit PMDataManager() : TPM(NULL), WorkerParent(NULL), Depth(0) {
     initializeAnalysisInfo();
   }
 
@@ -356,9 +367,18 @@ public:
     return &AvailableAnalysis;
   }
 
-  // Collect AvailableAnalysis from all the active Pass Managers.
+  // Collect AvailableAnalysis from all the active Pass Managers.  A copy of
+  // a nested manager inherits what the manager it runs in inherits, plus the
+  // analyses of that manager itself.
   void populateInheritedAnalysis(PMStack &PMS) {
     unsigned Index = 0;
+    if (WorkerParent) {
+      for (; Index + 1 < PMT_Last && WorkerParent->InheritedAnalysis[Index];
+           ++Index)
+        InheritedAnalysis[Index] = WorkerParent->InheritedAnalysis[Index];
+      InheritedAnalysis[Index++] = WorkerParent->getAvailableAnalysis();
+      return;
+    }
     for (PMStack::iterator I = PMS.begin(), E = PMS.end();
          I != E; ++I)
       InheritedAnalysis[Index++] = (*I)->getAvailableAnalysis();
@@ -381,6 +401,35 @@ protected:
   /// or higher is specified.
   bool isPassDebuggingExecutionsOrMore() const;
 
+  /// clonePass - Return a copy of the contained pass P for a worker of a
+  /// parallel FPPassManager, or null if P cannot be copied faithfully.  A
+  /// nested pass manager is copied along with the passes it contains.
+  Pass *clonePass(Pass *P);
+
+  /// addCopy - Add a pass made by clonePass.  Its analyses are not scheduled
+  /// again: the copy mirrors the schedule of the manager it was made from.
+  void addCopy(Pass *Copy);
+
+  /// collectDeadPasses - Set Dead[i] to the indices of the contained passes
+  /// that can be freed after pass i has run.
+  void collectDeadPasses(std::vector<SmallVector<unsigned, 4> > &Dead);
+
+  /// removeNotPreservedByNestedPasses - Call removeNotPreservedAnalysis for
+  /// every pass of PM and of the managers nested in it.
+  void removeNotPreservedByNestedPasses(PMDataManager &PM);
+
+  /// WorkerParent - Only set for copies of nested managers made by
+  /// clonePass: the manager the copy was added to.  The copy looks up and
+  /// invalidates the analyses of its parent managers there rather than
+  /// through the top level manager, which knows nothing of the copies.
+  PMDataManager *WorkerParent;
+
+  /// DeadPasses - Only set for copies made for workers: DeadPasses[i] holds
+  /// the indices of the contained passes that can be freed after pass i has
+  /// run, mirroring the last-user information the top level manager keeps
+  /// for the original passes.
+  std::vector<SmallVector<unsigned, 4> > DeadPasses;
+
 private:
   void dumpAnalysisUsage(StringRef Msg, const Pass *P,
                          const AnalysisUsage::VectorType &Set) const;
@@ -398,6 +447,60 @@ private:
   unsigned Depth;
 };
 
+//===----------------------------------------------------------------------===//
+// ParallelSectionPass
+//
+/// ParallelSectionPass - A begin and an end marker of this kind delimit a
+/// section of a function pass manager whose passes may process several
+/// functions at once.  FPPassManager then runs the passes before the section
+/// on a batch of functions, hands the batch to worker threads running their
+/// own instances of the section's passes, and finally runs the passes after
+/// the section on the batch in module order.  The markers do nothing when run;
+/// the begin marker tells the pass manager what it cannot work out itself.
+///
+/// The workers see the analyses the begin marker leaves available, so it
+/// should preserve only those that can serve several functions at once.  The
+/// end marker should preserve nothing computed inside the section, which
+/// makes the pass manager schedule fresh instances for the passes after it.
+class ParallelSectionPass : public FunctionPass {
+  bool IsBegin;
+
+public:
+  static char ID;
+  explicit ParallelSectionPass(bool IsBegin)
+    : FunctionPass(ID), IsBegin(IsBegin) {}
+
+  bool isBegin() const { return IsBegin; }
+
+  virtual bool runOnFunction(Function &F) { return false; }
+
+  /// getNumThreads - Return the number of threads to run the section on.
+  virtual unsigned getNumThreads() const = 0;
+
+  /// createSectionPasses - Fill \p Copies with one fresh instance of each pass
+  /// in \p Section for a worker, or with null for passes the pass manager
+  /// can copy on its own with Pass::clone.
+  virtual void createSectionPasses(ArrayRef<Pass *> Section,
+                                   SmallVectorImpl<Pass *> &Copies) {
+    Copies.assign(Section.size(), 0);
+  }
+
+  /// enterSection - Called on the main thread once F has been through the
+  /// passes before the section.  The analyses the marker requires are
+  /// available as in runOnFunction.
+  virtual void enterSection(Function &F) {}
+
+  /// beginWorker / endWorker - Called on the worker thread before and after
+  /// it runs the section's passes on F.
+  virtual void beginWorker(Function &F) {}
+  virtual void endWorker(Function &F) {}
+
+  /// leaveSection - Called on the main thread before F goes through the
+  /// passes after the section, with the same analyses as enterSection.  No
+  /// worker is running by then.
+  virtual void leaveSection(Function &F) {}
+};
+
 //===----------------------------------------------------------------------===//
 // FPPassManager
 //
@@ -409,10 +512,14 @@ class FPPassManager : public ModulePass, public PMDataManager {
 public:
   static char ID;
   explicit FPPassManager()
-  : ModulePass(ID), PMDataManager() { }
+  : ModulePass(ID), PMDataManager(), WorkersInitialized(false) { }
+  ~FPPassManager();
 
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
+  /// With -function-pass-threads, runOnModule spreads the functions of the
+  /// module over several threads; a ParallelSectionPass pair makes it do so
+  /// for just the passes between the markers.
   bool runOnFunction(Function &F);
   bool runOnModule(Module &M);
 
@@ -461,6 +568,53 @@ public:
   virtual PassManagerType getPassManagerType() const {
     return PMT_FunctionPassManager;
   }
+
+private:
+  /// canRunInParallel - Return false if there are no contained passes or
+  /// something needs the serial pass order (pass timing, IR printing, pass
+  /// execution tracing).
+  bool canRunInParallel();
+
+  /// createWorkers - Make sure there are at least NumWorkers copies of this
+  /// manager to run functions on.  Return false if some pass cannot be
+  /// copied.
+  bool createWorkers(unsigned NumWorkers);
+
+  /// runOnModuleInParallel - Run the contained passes on all functions of M
+  /// using NumThreads worker threads.
+  bool runOnModuleInParallel(Module &M, unsigned NumThreads);
+
+  /// findParallelSection - Return the begin marker of a parallel section of
+  /// the contained passes and set Begin and End to the marker indices, or
+  /// return null if there is no section or it has to run serially.
+  ParallelSectionPass *findParallelSection(unsigned &Begin, unsigned &End);
+
+  /// createSectionWorkers - Make sure there are at least NumWorkers managers
+  /// holding copies of the passes strictly between Begin and End.  Return
+  /// false if some pass cannot be copied.
+  bool createSectionWorkers(unsigned NumWorkers, ParallelSectionPass *Marker,
+                            unsigned Begin, unsigned End);
+
+  /// runPasses - Run contained passes [First, Last) on F.
+  bool runPasses(Function &F, unsigned First, unsigned Last);
+
+  /// runOnModuleWithSection - Run the contained passes on all functions of M,
+  /// running the parallel section between Begin and End on worker threads.
+  bool runOnModuleWithSection(Module &M, ParallelSectionPass *Marker,
+                              unsigned Begin, unsigned End);
+
+  /// Workers - Copies of this manager, each running its own instances of the
+  /// contained passes on one thread.  They live as long as this manager since
+  /// the top level manager caches their analysis usage by address.
+  SmallVector<FPPassManager *, 8> Workers;
+
+  /// SectionWorkers - Managers running copies of the passes of a parallel
+  /// section, one per thread.
+  SmallVector<FPPassManager *, 8> SectionWorkers;
+
+  /// WorkersInitialized - True once doInitialization has been run on the
+  /// workers; doFinalization finalizes them and clears it.
+  bool WorkersInitialized;
 };
 
 Timer *getPassTimer(Pass *);
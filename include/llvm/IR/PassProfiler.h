@@ -0,0 +1,140 @@
+//===- llvm/IR/PassProfiler.h - Record the cost of each pass run -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the PassProfiler, which records every run of a pass by
+// the legacy pass manager: the wall time it took, the IR unit it ran on, how
+// the number of instructions in that unit changed and how the amount of
+// allocated memory changed.  Unlike -time-passes, which prints totals per
+// pass, this keeps each run so that a slow pass can be tied to the function
+// it was slow on.
+//
+// The profile can be written as JSON, or as a Chrome trace-event file which
+// chrome://tracing and similar viewers display as a timeline per thread.
+//
+// Tools get it with -pass-profile=<file>, which is written at llvm_shutdown;
+// libLTO clients can pass the same option through lto_codegen_debug_options,
+// and the file is written each time LTOCodeGenerator has generated code.
+// Other clients, such as MCJIT users, call start() and write() directly or
+// through the C API in llvm-c/Core.h.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PASSPROFILER_H
+#define LLVM_IR_PASSPROFILER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+
+class BasicBlock;
+class Function;
+class Module;
+class Pass;
+class raw_ostream;
+
+/// PassProfiler - Records the runs of passes while it is started.  All
+/// members are static and safe to call from several threads, as function
+/// passes may run on a thread pool.
+class PassProfiler {
+public:
+  enum OutputFormat {
+    JSON,       ///< One object per pass run, plus totals per pass.
+    ChromeTrace ///< A trace-event file with one complete event per run.
+  };
+
+  /// start - Discard any runs recorded so far and record the following ones.
+  static void start();
+
+  /// stop - Stop recording.  The runs recorded so far are kept.
+  static void stop();
+
+  /// isStarted - Return true if pass runs are being recorded.
+  static bool isStarted() { return Started != 0; }
+
+  /// print - Print the recorded runs to \p OS in format \p Format.
+  static void print(raw_ostream &OS, OutputFormat Format);
+
+  /// write - Write the recorded runs to the file \p Filename.  Returns true
+  /// and sets \p ErrMsg if the file can't be written.
+  static bool write(StringRef Filename, OutputFormat Format,
+                    std::string &ErrMsg);
+
+  /// startIfRequested - Start the profiler if -pass-profile was given, and
+  /// arrange for the profile to be written at llvm_shutdown.  The pass
+  /// managers call this before running passes.
+  static void startIfRequested();
+
+  /// writeIfRequested - Write the profile to the -pass-profile file now if
+  /// the profiler was started for it.  Clients that may never call
+  /// llvm_shutdown, such as libLTO inside a linker, call this once they have
+  /// run their passes.
+  static void writeIfRequested();
+
+private:
+  friend class PassProfileRegion;
+
+  static volatile sys::cas_flag Started;
+};
+
+/// PassProfileRegion - Records one run of a pass for the PassProfiler, from
+/// its construction to its destruction.  It does nothing unless the profiler
+/// is started.
+class PassProfileRegion {
+  PassProfileRegion(const PassProfileRegion &) LLVM_DELETED_FUNCTION;
+  void operator=(const PassProfileRegion &) LLVM_DELETED_FUNCTION;
+
+public:
+  PassProfileRegion(Pass *P, Module &M);
+  PassProfileRegion(Pass *P, Function &F);
+  PassProfileRegion(Pass *P, BasicBlock &BB);
+  /// Record a run on the strongly connected component \p SCC of the call
+  /// graph.  Null entries stand for external nodes and are skipped.  The pass
+  /// may delete and replace functions of the component, so the region does
+  /// not look at them again; the caller counts the instructions of the
+  /// component it ends up with and passes them to setInstructionsAfter.
+  PassProfileRegion(Pass *P, ArrayRef<Function *> SCC);
+  ~PassProfileRegion();
+
+  /// setInstructionsAfter - Record that the unit has \p Count instructions
+  /// after the run.  Only needed for strongly connected components.
+  void setInstructionsAfter(uint64_t Count) { InstructionsAfter = Count; }
+
+  /// countInstructions - Return the number of instructions in \p Functions,
+  /// skipping null entries.
+  static uint64_t countInstructions(ArrayRef<Function *> Functions);
+
+private:
+  void begin(Pass *P, const char *Kind);
+  uint64_t countInstructions() const;
+
+  /// The pass being run, or null if the run is not recorded.
+  Pass *P;
+  const char *Kind;
+  std::string Unit;
+  Module *M;
+  BasicBlock *BB;
+  SmallVector<Function *, 1> Functions;
+  uint64_t StartTime;
+  uint64_t InstructionsBefore;
+  /// The count given to setInstructionsAfter, for strongly connected
+  /// components.
+  uint64_t InstructionsAfter;
+  bool IsSCC;
+  uint64_t MemoryBefore;
+};
+
+} // End llvm namespace
+
+#endif
@@ -29,6 +29,7 @@
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Compiler.h"
+#include <atomic>
 #include <cstddef>
 #include <iterator>
 
@@ -133,18 +134,76 @@ private:
     Prev.setPointer(NewPrev);
   }
   void addToList(Use **List) {
+    if (LLVM_UNLIKELY(anyContextMultithreaded()))
+      return addToListLocked(List);
+    addToListImpl(List);
+  }
+  void removeFromList() {
+    if (LLVM_UNLIKELY(anyContextMultithreaded()))
+      return removeFromListLocked();
+    removeFromListImpl();
+  }
+  void addToListImpl(Use **List) {
     Next = *List;
     if (Next) Next->setPrev(&Next);
     setPrev(List);
     *List = this;
   }
-  void removeFromList() {
+  void removeFromListImpl() {
     Use **StrippedPrev = Prev.getPointer();
     *StrippedPrev = Next;
     if (Next) Next->setPrev(StrippedPrev);
   }
 
+  /// addToListLocked/removeFromListLocked - Variants used while some context
+  /// is multithreaded: the use lists of values that can be shared between
+  /// functions of a multithreaded context are only updated under a global
+  /// lock.  Values of other contexts take the unlocked path.
+  void addToListLocked(Use **List);
+  void removeFromListLocked();
+
+  /// NumMultithreadedContexts - The number of LLVMContexts currently in
+  /// multithreaded mode.  Threads working on other contexts read it without
+  /// synchronizing with the thread toggling a context, so it is atomic; a
+  /// relaxed load is all the fast path needs since each context checks its
+  /// own flag before locking.
+  static std::atomic<unsigned> NumMultithreadedContexts;
+
+  static bool anyContextMultithreaded() {
+    return NumMultithreadedContexts.load(std::memory_order_relaxed) != 0;
+  }
+
   friend class Value;
+  friend class LLVMContext;
+  friend class FunctionArena;
+  friend class SharedUseListGuard;
+};
+
+/// SharedUseListGuard - While the context of a value is multithreaded, keeps
+/// other threads from adding or removing uses of the value for as long as the
+/// guard is alive, so that the use list of a constant or global can be read.
+/// It does nothing for instructions and arguments, whose use lists only the
+/// thread working on their function touches, or while the context is not
+/// multithreaded.  Take the context lock first when both are needed, and do
+/// not create constants while holding the guard.
+class SharedUseListGuard {
+  bool Locked;
+
+  SharedUseListGuard(const SharedUseListGuard &) LLVM_DELETED_FUNCTION;
+  void operator=(const SharedUseListGuard &) LLVM_DELETED_FUNCTION;
+
+  void lock(const Value *V);
+  void unlock();
+
+public:
+  explicit SharedUseListGuard(const Value *V) : Locked(false) {
+    if (LLVM_UNLIKELY(Use::anyContextMultithreaded()))
+      lock(V);
+  }
+  ~SharedUseListGuard() {
+    if (Locked)
+      unlock();
+  }
 };
 
 // simplify_type - Allow clients to treat uses just like values when using
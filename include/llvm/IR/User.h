@@ -49,6 +49,9 @@ protected:
   unsigned NumOperands;
 
   void *operator new(size_t s, unsigned Us);
+  /// initOperands - Set up \p Us operands at the start of \p Storage for the
+  /// User that follows them, and return the address of the User.
+  static void *initOperands(void *Storage, unsigned Us);
   User(Type *ty, unsigned vty, Use *OpList, unsigned NumOps)
     : Value(ty, vty), OperandList(OpList), NumOperands(NumOps) {}
   Use *allocHungoffUses(unsigned) const;
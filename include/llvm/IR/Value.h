@@ -154,7 +154,10 @@ public:
   typedef value_use_iterator<User>       use_iterator;
   typedef value_use_iterator<const User> const_use_iterator;
 
-  bool               use_empty() const { return UseList == 0; }
+  bool use_empty() const {
+    SharedUseListGuard Guard(this);
+    return UseList == 0;
+  }
   use_iterator       use_begin()       { return use_iterator(UseList); }
   const_use_iterator use_begin() const { return const_use_iterator(UseList); }
   use_iterator       use_end()         { return use_iterator(0);   }
@@ -167,6 +170,7 @@ public:
   /// traversing the whole use list.
   ///
   bool hasOneUse() const {
+    SharedUseListGuard Guard(this);
     const_use_iterator I = use_begin(), E = use_end();
     if (I == E) return false;
     return ++I == E;
@@ -40,6 +40,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
 #include <vector>
@@ -75,6 +76,12 @@ struct LTOCodeGenerator {
 
   void setCpu(const char *mCpu) { MCpu = mCpu; }
 
+  // Set the number of partitions the merged module is split into for code
+  // generation by compile_to_files(). Each partition is compiled on its own
+  // thread in its own LLVMContext. A value of 0 uses one partition per
+  // hardware thread.
+  void setCodeGenParallelism(unsigned N) { CodeGenParallelism = N; }
+
   void addMustPreserveSymbol(const char *sym) { MustPreserveSymbols[sym] = 1; }
 
   // To pass options to the driver and optimization passes. These options are
@@ -116,6 +123,22 @@ struct LTOCodeGenerator {
                       bool disableGVNLoadPRE,
                       std::string &errMsg);
 
+  // Like compile_to_file(), but splits the optimized merged module into as
+  // many partitions as set by setCodeGenParallelism() and generates one object file
+  // per partition, in parallel. The paths to the object files are returned via
+  // "names"; they stay valid until the next call or until the LTOCodeGenerator
+  // is destroyed; their number is returned via "numNames". Return true on
+  // success.
+  //
+  // As with compile_to_file(), it is up to the linker to remove the object
+  // files.
+  bool compile_to_files(const char ***names,
+                        unsigned *numNames,
+                        bool disableOpt,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   bool shouldInternalize() const {
@@ -129,11 +152,20 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
+  bool optimize(bool disableOpt,
+                bool disableInline,
+                bool disableGVNLoadPRE,
+                std::string &errMsg);
+
   bool generateObjectFile(llvm::raw_ostream &out,
                           bool disableOpt,
                           bool disableInline,
                           bool disableGVNLoadPRE,
                           std::string &errMsg);
+  void splitCodeGenModule(unsigned N, std::vector<std::string> &Partitions);
+  bool generateObjectFiles(llvm::ArrayRef<std::string> partitions,
+                           llvm::ArrayRef<llvm::raw_ostream *> outs,
+                           std::string &errMsg);
   void applyScopeRestrictions();
   void applyRestriction(llvm::GlobalValue &GV,
                         const llvm::ArrayRef<llvm::StringRef> &Libcalls,
@@ -161,9 +193,13 @@ private:
   std::vector<char *> CodegenOptions;
   std::string MCpu;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::vector<const char *> NativeObjectNames;
+  unsigned CodeGenParallelism;
   llvm::TargetOptions Options;
   lto_diagnostic_handler_t DiagHandler;
   void *DiagContext;
+  llvm::sys::Mutex DiagLock;
 };
 
 #endif // LTO_CODE_GENERATOR_H
@@ -21,15 +21,16 @@
 #include "llvm/IR/Module.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Target/TargetMachine.h"
 #include <string>
 #include <vector>
 
 // Forward references to llvm classes.
 namespace llvm {
+  struct BitcodeSymbolSummary;
   class Function;
   class GlobalValue;
-  class MemoryBuffer;
   class TargetOptions;
   class Value;
 }
@@ -49,6 +50,10 @@ private:
   };
 
   llvm::OwningPtr<llvm::Module>           _module;
+  // The bitcode and triple of a module whose symbols came from its summary
+  // and that has not been parsed yet.
+  llvm::OwningPtr<llvm::MemoryBuffer>     _buffer;
+  std::string                             _triple;
   llvm::OwningPtr<llvm::TargetMachine>    _target;
   llvm::MCObjectFileInfo ObjFileInfo;
   StringSet                               _linkeropt_strings;
@@ -105,12 +110,17 @@ public:
 
   /// getTargetTriple - Return the Module's target triple.
   const char *getTargetTriple() {
+    if (!_module)
+      return _triple.c_str();
     return _module->getTargetTriple().c_str();
   }
 
   /// setTargetTriple - Set the Module's target triple.
   void setTargetTriple(const char *triple) {
-    _module->setTargetTriple(triple);
+    if (!_module)
+      _triple = triple;
+    else
+      _module->setTargetTriple(triple);
   }
 
   /// getSymbolCount - Get the number of symbols
@@ -157,7 +167,11 @@ public:
     return NULL;
   }
 
-  /// getLLVVMModule - Return the Module.
+  /// parseModule - Parse the module if its symbols came from a symbol summary.
+  /// Returns true on error.
+  bool parseModule(std::string &errMsg);
+
+  /// getLLVVMModule - Return the Module, or null if it has not been parsed.
   llvm::Module *getLLVVMModule() { return _module.get(); }
 
   /// getAsmUndefinedRefs -
@@ -174,12 +188,24 @@ private:
   /// add them to either the defined or undefined lists.
   bool parseSymbols(std::string &errMsg);
 
+  /// parseSummarySymbols - Add the symbols of a symbol summary to the defined
+  /// and undefined lists.
+  void parseSummarySymbols(const llvm::BitcodeSymbolSummary &summary);
+
+  /// addUndefinedSymbols - Add the undefined symbols which have not been
+  /// defined after all to the list.
+  void addUndefinedSymbols();
+
   /// addPotentialUndefinedSymbol - Add a symbol which isn't defined just yet
   /// to a list to be resolved later.
   void addPotentialUndefinedSymbol(const llvm::GlobalValue *dcl, bool isFunc);
+  void addPotentialUndefinedSymbol(llvm::StringRef name, bool isWeak,
+                                   bool isFunc, const llvm::GlobalValue *dcl);
 
   /// addDefinedSymbol - Add a defined symbol to the list.
   void addDefinedSymbol(const llvm::GlobalValue *def, bool isFunction);
+  void addDefinedSymbol(llvm::StringRef name, uint32_t attr, bool isFunction,
+                        const llvm::GlobalValue *def);
 
   /// addDefinedFunctionSymbol - Add a function symbol as defined to the list.
   void addDefinedFunctionSymbol(const llvm::Function *f);
@@ -27,7 +27,8 @@ class Linker {
   public:
     enum LinkerMode {
       DestroySource = 0, // Allow source module to be destroyed.
-      PreserveSource = 1 // Preserve the source module.
+      PreserveSource = 1, // Preserve the source module.
+      LinkOnlyNeeded = 2 // Link in only the definitions that are referenced.
     };
 
     Linker(Module *M, bool SuppressWarnings=false);
@@ -38,6 +39,13 @@ class Linker {
 
     /// \brief Link \p Src into the composite. The source is destroyed if
     /// \p Mode is DestroySource and preserved if it is PreserveSource.
+    ///
+    /// If \p Mode also has LinkOnlyNeeded set, function definitions from
+    /// \p Src are only linked in if the composite references them, directly
+    /// or through other linked-in definitions, globals or aliases. Bodies that
+    /// are never reached are never materialized, which makes linking lazily
+    /// loaded modules (see getLazyBitcodeModule) cheap.
+    ///
     /// If \p ErrorMsg is not null, information about any error is written
     /// to it.
     /// Returns true on error.
@@ -928,13 +928,22 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
-  /// \brief Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  /// The relaxation worklist: the fragments which may need relaxing, which
+  /// of them have to be looked at again, and what their encodings depend on.
+  struct RelaxState;
 
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD);
+  /// \brief Perform one layout iteration, revisiting only the fragments that
+  /// earlier changes may have affected, and return true if any fragment still
+  /// needs to be looked at again.
+  bool layoutOnce(MCAsmLayout &Layout, RelaxState &State);
+
+  /// \brief Perform one layout iteration of the given section, in layout
+  /// order, and queue up the fragments affected by the changes it made.
+  void layoutSectionOnce(MCAsmLayout &Layout, RelaxState &State,
+                         unsigned SectionIndex);
+
+  /// \brief Relax the given fragment if needed, returning true if it changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
@@ -970,6 +979,12 @@ public:
   void writeSectionData(const MCSectionData *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Emit the section contents through \p OW instead, which need not be the
+  /// assembler's writer.  Only the layout is read, so sections may be written
+  /// concurrently once it is final.
+  void writeSectionData(const MCSectionData *Section, const MCAsmLayout &Layout,
+                        MCObjectWriter *OW) const;
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const {
     return ThumbFuncs.count(Func);
@@ -11,6 +11,7 @@
 #define LLVM_MC_MCCONTEXT_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/ShardedStringMap.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
@@ -18,6 +19,7 @@
 #include "llvm/MC/SectionKind.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 #include <vector> // FIXME: Shouldn't be needed.
@@ -47,7 +49,7 @@ namespace llvm {
     MCContext(const MCContext&) LLVM_DELETED_FUNCTION;
     MCContext &operator=(const MCContext&) LLVM_DELETED_FUNCTION;
   public:
-    typedef StringMap<MCSymbol*, BumpPtrAllocator&> SymbolTable;
+    typedef ShardedStringMap<MCSymbol*> SymbolTable;
   private:
     /// The SourceMgr for this object, if any.
     const SourceMgr *SrcMgr;
@@ -67,7 +69,8 @@ namespace llvm {
     /// objects.
     BumpPtrAllocator Allocator;
 
-    /// Symbols - Bindings of names to symbols.
+    /// Symbols - Bindings of names to symbols.  Looking up a symbol that
+    /// exists only locks its shard of the table.
     SymbolTable Symbols;
 
     /// UsedNames - Keeps tracks of names that were used both for used declared
@@ -78,6 +81,13 @@ namespace llvm {
     /// symbol.
     unsigned NextUniqueID;
 
+    /// Multithreaded - True while several threads may create symbols.
+    bool Multithreaded;
+
+    /// CreationLock - Protects UsedNames, NextUniqueID and Allocator while the
+    /// context is multithreaded.
+    sys::MutexImpl CreationLock;
+
     /// Instances of directional local labels.
     DenseMap<unsigned, MCLabel *> Instances;
     /// NextInstance() creates the next instance of the directional local label
@@ -180,6 +190,16 @@ namespace llvm {
 
     void setAllowTemporaryLabels(bool Value) { AllowTemporaryLabels = Value; }
 
+    /// setMultithreaded - Enable or disable the locking that lets several
+    /// threads create and look up symbols, and allocate from the context, at
+    /// once.  Everything else still belongs to a single thread.  Must not be
+    /// called while other threads use the context.
+    void setMultithreaded(bool Enable) {
+      Multithreaded = Enable;
+      Symbols.setMultithreaded(Enable);
+    }
+    bool isMultithreaded() const { return Multithreaded; }
+
     /// @name Module Lifetime Management
     /// @{
 
@@ -198,7 +218,7 @@ namespace llvm {
 
     /// getUniqueSymbolID() - Return a unique identifier for use in constructing
     /// symbol names.
-    unsigned getUniqueSymbolID() { return NextUniqueID++; }
+    unsigned getUniqueSymbolID();
 
     /// CreateDirectionalLocalSymbol - Create the definition of a directional
     /// local symbol for numbered label (used for "1:" definitions).
@@ -223,7 +243,7 @@ namespace llvm {
     /// getSymbols - Get a reference for the symbol table for clients that
     /// want to, for example, iterate over all symbols. 'const' because we
     /// still want any modifications to the table itself to use the MCContext
-    /// APIs.
+    /// APIs.  Only for use while the context is not multithreaded.
     const SymbolTable &getSymbols() const {
       return Symbols;
     }
@@ -408,7 +428,12 @@ namespace llvm {
     }
 
     void *Allocate(unsigned Size, unsigned Align = 8) {
-      return Allocator.Allocate(Size, Align);
+      if (!Multithreaded)
+        return Allocator.Allocate(Size, Align);
+      CreationLock.acquire();
+      void *Mem = Allocator.Allocate(Size, Align);
+      CreationLock.release();
+      return Mem;
     }
     void Deallocate(void *Ptr) {
     }
@@ -14,12 +14,15 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
 
 namespace llvm {
 namespace object {
@@ -150,6 +153,10 @@ public:
       return &symbol;
     }
 
+    const Symbol &operator*() const {
+      return symbol;
+    }
+
     bool operator==(const symbol_iterator &other) const {
       return symbol == other.symbol;
     }
@@ -189,15 +196,25 @@ public:
   }
 
   // check if a symbol is in the archive
+  //
+  // The first call builds a hash table of the symbol table, so that it and
+  // later calls take constant time.  If several members define the symbol,
+  // the first one in the symbol table is returned.
   child_iterator findSym(StringRef name) const;
 
   bool hasSymbolTable() const;
 
 private:
+  void buildSymbolIndex() const;
+
   child_iterator SymbolTable;
   child_iterator StringTable;
   child_iterator FirstRegular;
   Kind Format;
+
+  /// Maps each name in the symbol table to its first entry, for findSym.
+  mutable OwningPtr<StringMap<Symbol> > SymbolIndex;
+  mutable sys::Mutex SymbolIndexLock;
 };
 
 }
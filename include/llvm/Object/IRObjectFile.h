@@ -16,22 +16,41 @@
 
 #include "llvm/Object/SymbolicFile.h"
 
+#include <vector>
+
 namespace llvm {
+struct BitcodeSymbolSummary;
 class Mangler;
 class Module;
 class GlobalValue;
 
 namespace object {
+/// IRObjectFile - The symbols of a bitcode file.  If the file starts with a
+/// symbol summary, they come from the summary and the module is only parsed
+/// once somebody asks for a GlobalValue.
 class IRObjectFile : public SymbolicFile {
-  OwningPtr<Module> M;
-  OwningPtr<Mangler> Mang;
+  LLVMContext &Context;
+  OwningPtr<BitcodeSymbolSummary> Summary;
+  mutable OwningPtr<Module> M;
+  mutable OwningPtr<Mangler> Mang;
+
+  /// Symbols - The functions, global variables and aliases of M, in that
+  /// order.  A DataRefImpl is an index into it, or into the summary.
+  mutable std::vector<const GlobalValue *> Symbols;
+
+  error_code parseModule() const;
+  size_t getNumSymbols() const;
+
 public:
   IRObjectFile(MemoryBuffer *Object, error_code &EC, LLVMContext &Context,
                bool BufferOwned);
+  ~IRObjectFile();
   void moveSymbolNext(DataRefImpl &Symb) const LLVM_OVERRIDE;
   error_code printSymbolName(raw_ostream &OS, DataRefImpl Symb) const
       LLVM_OVERRIDE;
   uint32_t getSymbolFlags(DataRefImpl Symb) const LLVM_OVERRIDE;
+  /// getSymbolGV - Return the GlobalValue of a symbol, parsing the module if
+  /// the symbols came from a summary.
   const GlobalValue &getSymbolGV(DataRefImpl Symb) const;
   basic_symbol_iterator symbol_begin_impl() const LLVM_OVERRIDE;
   basic_symbol_iterator symbol_end_impl() const LLVM_OVERRIDE;
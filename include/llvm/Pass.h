@@ -175,6 +175,14 @@ public:
   /// check state of analysis information.
   virtual void verifyAnalysis() const;
 
+  /// clone - Return a new instance of this pass that behaves exactly like
+  /// this one, including any constructor arguments, or null if the pass
+  /// cannot be copied.  Pass managers that run a pipeline on several threads
+  /// at once give each thread its own copies, and run serially when a pass
+  /// returns null.  The copy is created before the pass runs, so it need not
+  /// carry over state computed by runOn*.
+  virtual Pass *clone() const;
+
   // dumpPassStructure - Implement the -debug-passes=PassStructure option
   virtual void dumpPassStructure(unsigned Offset = 0);
 
@@ -0,0 +1,100 @@
+//=-- SampleProf.h - Sampling profiling format support --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains common definitions used in the reading and writing of
+// sample profile data.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROF_H
+#define LLVM_PROFILEDATA_SAMPLEPROF_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+class raw_ostream;
+
+namespace sampleprof {
+
+/// \brief The magic number at the start of a binary sample profile.
+///
+/// The first byte cannot start a line of a text profile, so readers tell the
+/// two formats apart by it.
+inline uint64_t SPMagic() {
+  return uint64_t(0xff) << 56 | uint64_t('L') << 48 | uint64_t('S') << 40 |
+         uint64_t('P') << 32 | uint64_t('R') << 24 | uint64_t('O') << 16 |
+         uint64_t('F') << 8 | uint64_t('B');
+}
+
+/// \brief The version of the binary sample profile format.
+inline uint32_t SPVersion() { return 1; }
+
+} // End namespace sampleprof
+
+typedef DenseMap<uint32_t, uint32_t> BodySampleMap;
+
+/// \brief Representation of the samples collected for a function.
+///
+/// This data structure contains the total number of samples collected in
+/// the function, the number of samples collected at its head, and a map of
+/// samples collected in every statement, keyed by the line offset of the
+/// statement from the start of the function.
+class FunctionSamples {
+public:
+  FunctionSamples() : TotalSamples(0), TotalHeadSamples(0) {}
+
+  void addTotalSamples(unsigned Num) { TotalSamples += Num; }
+  void addHeadSamples(unsigned Num) { TotalHeadSamples += Num; }
+  void addBodySamples(unsigned LineOffset, unsigned Num) {
+    BodySamples[LineOffset] += Num;
+  }
+
+  /// \brief Accumulate the samples of \p Other, multiplied by \p Weight,
+  /// into this profile.
+  ///
+  /// \returns false if a sample count overflowed, in which case this profile
+  /// is left partially merged.
+  bool merge(const FunctionSamples &Other, unsigned Weight = 1);
+
+  unsigned getTotalSamples() const { return TotalSamples; }
+  unsigned getHeadSamples() const { return TotalHeadSamples; }
+  const BodySampleMap &getBodySamples() const { return BodySamples; }
+
+  /// \brief Return the samples collected at \p LineOffset, or zero.
+  uint32_t getBodySamples(unsigned LineOffset) const {
+    return BodySamples.lookup(LineOffset);
+  }
+
+  bool empty() const { return BodySamples.empty(); }
+
+  void print(raw_ostream &OS) const;
+
+private:
+  /// \brief Total number of samples collected inside this function.
+  ///
+  /// Samples are cumulative, they include all the samples collected
+  /// inside this function and all its inlined callees.
+  unsigned TotalSamples;
+
+  /// \brief Total number of samples collected at the head of the function.
+  unsigned TotalHeadSamples;
+
+  /// \brief Map line offsets to collected samples.
+  ///
+  /// Each entry in this map contains the number of samples
+  /// collected at the corresponding line offset. All line locations
+  /// are an offset from the start of the function.
+  BodySampleMap BodySamples;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,137 @@
+//===- SampleProfReader.h - Read LLVM sample profile data -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for reading sample profiles, in either the text
+// or the binary format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROFREADER_H
+#define LLVM_PROFILEDATA_SAMPLEPROFREADER_H
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// \brief Sample-based profile reader.
+///
+/// Each profile contains sample counts for all the functions
+/// executed. Inside each function, statements are annotated with the
+/// collected samples on all the instructions associated with that
+/// statement.
+///
+/// Readers are created with create(), which picks the reader for the
+/// format of the file.  Malformed profiles are reported with
+/// report_fatal_error, as a compilation cannot go on with a profile it
+/// does not understand.
+class SampleProfileReader {
+public:
+  SampleProfileReader(MemoryBuffer *B, StringRef F) : Buffer(B), Filename(F) {}
+  virtual ~SampleProfileReader();
+
+  /// \brief Open the profile in \p Filename and read it.
+  static SampleProfileReader *create(StringRef Filename);
+
+  /// \brief Read the profile.  Depending on the format, this either loads
+  /// every function profile or just checks the index.
+  virtual void read() = 0;
+
+  /// \brief Load the samples of function \p FName into \p FS.
+  ///
+  /// \returns false if the profile has no samples for \p FName.
+  virtual bool getSamples(StringRef FName, FunctionSamples &FS) = 0;
+
+  /// \brief Append the names of all the functions in the profile to
+  /// \p Names.
+  virtual void getFunctionNames(std::vector<StringRef> &Names) = 0;
+
+  /// \brief Print the function profile for \p FName on stream \p OS.
+  void printFunctionProfile(raw_ostream &OS, StringRef FName);
+
+  /// \brief Dump the function profile for \p FName.
+  void dumpFunctionProfile(StringRef FName);
+
+  /// \brief Dump all the function profiles found.
+  void dump();
+
+protected:
+  /// \brief Report a parse error message and stop compilation.
+  void reportParseError(int64_t LineNumber, Twine Msg) const;
+
+  /// \brief The contents of the profile.
+  OwningPtr<MemoryBuffer> Buffer;
+
+  /// \brief Path name to the file holding the profile data.
+  std::string Filename;
+};
+
+/// \brief Reader for the text format, which is meant for tests and
+/// debugging.  It parses the whole profile in read().
+class SampleProfileReaderText : public SampleProfileReader {
+public:
+  SampleProfileReaderText(MemoryBuffer *B, StringRef F)
+      : SampleProfileReader(B, F) {}
+
+  virtual void read();
+  virtual bool getSamples(StringRef FName, FunctionSamples &FS);
+  virtual void getFunctionNames(std::vector<StringRef> &Names);
+
+private:
+  /// \brief Map every function to its associated profile.
+  StringMap<FunctionSamples> Profiles;
+};
+
+/// \brief Reader for the binary format.
+///
+/// A binary profile is an on-disk hash table keyed by function name.  The
+/// file is memory-mapped, and getSamples() decodes only the record of the
+/// function asked for, so the cost of reading a profile follows the number
+/// of functions looked up rather than the size of the profile.
+class SampleProfileReaderBinary : public SampleProfileReader {
+public:
+  SampleProfileReaderBinary(MemoryBuffer *B, StringRef F)
+      : SampleProfileReader(B, F), NumFunctions(0), NumBuckets(0) {}
+
+  virtual void read();
+  virtual bool getSamples(StringRef FName, FunctionSamples &FS);
+  virtual void getFunctionNames(std::vector<StringRef> &Names);
+
+  /// \brief Return true if \p Buffer starts with the binary magic number.
+  static bool hasFormat(const MemoryBuffer &Buffer);
+
+private:
+  /// \brief Return a pointer to the \p Size bytes at \p Offset in the file,
+  /// reporting an error if they are not all in it.
+  const char *getData(uint64_t Offset, uint64_t Size) const;
+
+  /// \brief Read the little-endian word at \p Offset.
+  uint32_t readWord(uint64_t Offset) const;
+
+  /// \brief Read the ULEB128 number at \p Offset and move past it.
+  uint32_t readULEB(uint64_t &Offset) const;
+
+  /// \brief Read the name at \p Offset and move past it.
+  StringRef readName(uint64_t &Offset) const;
+
+  void reportFormatError(Twine Msg) const;
+
+  uint32_t NumFunctions;
+  uint32_t NumBuckets;
+};
+
+} // End llvm namespace
+
+#endif
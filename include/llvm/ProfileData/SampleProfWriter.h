@@ -0,0 +1,59 @@
+//===- SampleProfWriter.h - Write LLVM sample profile data ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains support for writing sample profiles, in either the text
+// or the binary format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
+#define LLVM_PROFILEDATA_SAMPLEPROFWRITER_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ProfileData/SampleProf.h"
+
+namespace llvm {
+
+class raw_ostream;
+
+/// \brief Collects function profiles and writes them out as one profile.
+///
+/// Samples added for the same function more than once are accumulated.
+/// Functions are written in name order, so the output does not depend on
+/// the order they were added in.
+class SampleProfileWriter {
+public:
+  enum ProfileFormat {
+    Text,
+    Binary
+  };
+
+  /// \brief Add the samples \p FS of function \p FName, multiplied by
+  /// \p Weight.
+  ///
+  /// \returns false if a sample count of \p FName overflowed.
+  bool addFunctionSamples(StringRef FName, const FunctionSamples &FS,
+                          unsigned Weight = 1);
+
+  /// \brief Write all the function profiles to \p OS in format \p Format.
+  ///
+  /// A binary profile has to go to a stream opened in binary mode.
+  void write(raw_ostream &OS, ProfileFormat Format) const;
+
+private:
+  void writeText(raw_ostream &OS) const;
+  void writeBinary(raw_ostream &OS) const;
+
+  StringMap<FunctionSamples> Profiles;
+};
+
+} // End llvm namespace
+
+#endif
@@ -47,7 +47,13 @@ namespace sys {
     enum ProtectionFlags {
       MF_READ  = 0x1000000,
       MF_WRITE = 0x2000000,
-      MF_EXEC  = 0x4000000
+      MF_EXEC  = 0x4000000,
+      MF_RWE_MASK = 0x7000000,
+
+      /// Ask for the mapping to be backed by huge pages where the system
+      /// supports that for anonymous memory.  This is only a hint: it is
+      /// ignored elsewhere and by protectMappedMemory.
+      MF_HUGE_HINT = 0x0000001
     };
 
     /// This method allocates a block of memory that is suitable for loading
@@ -0,0 +1,89 @@
+//===-- llvm/Support/ThreadPool.h - A simple thread pool --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a simple fixed-size pool of worker threads that runs
+// independent tasks, for clients that want to spread work over several cores.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include <deque>
+#include <functional>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace llvm {
+
+/// ThreadPool - A pool of worker threads that execute tasks in FIFO order.
+///
+/// Tasks must not depend on each other and must not touch shared LLVM state
+/// (an LLVMContext, a Module, ...) without their own synchronization.  When
+/// LLVM is built without thread support every task is run synchronously on
+/// the calling thread from async().
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+
+  /// Create a pool with \p ThreadCount workers.  A count of zero picks one
+  /// worker per hardware thread.  Creating the pool puts LLVM into
+  /// multithreaded mode (see llvm_start_multithreaded()) if it is not already,
+  /// so it must happen while no other thread is using LLVM.
+  explicit ThreadPool(unsigned ThreadCount = 0);
+
+  /// Wait for all pending tasks and join the workers.
+  ~ThreadPool();
+
+  /// Queue \p Task for execution on one of the workers.
+  void async(TaskTy Task);
+
+  /// Block until every queued task has completed.
+  void wait();
+
+  /// getThreadCount - Return the number of workers in the pool.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+  /// getDefaultThreadCount - Return the number of workers a pool created with
+  /// a count of zero gets.
+  static unsigned getDefaultThreadCount();
+
+private:
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+
+  unsigned ThreadCount;
+
+#if LLVM_ENABLE_THREADS
+  void runWorker();
+
+  std::vector<std::thread> Workers;
+  std::deque<TaskTy> Tasks;
+
+  /// Protects Tasks, ActiveTasks and Stopping.
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+  std::condition_variable CompletionCondition;
+
+  /// Number of tasks that have been dequeued but not yet finished.
+  unsigned ActiveTasks;
+  bool Stopping;
+#endif
+};
+
+}
+
+#endif
@@ -455,18 +455,11 @@ namespace {
 
     virtual AliasResult alias(const Location &LocA,
                               const Location &LocB) {
-      assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
-      AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.TBAATag,
-                                     LocB.Ptr, LocB.Size, LocB.TBAATag);
-      // AliasCache rarely has more than 1 or 2 elements, always use
-      // shrink_and_clear so it quickly returns to the inline capacity of the
-      // SmallDenseMap if it ever grows larger.
-      // FIXME: This should really be shrink_to_inline_capacity_and_clear().
-      AliasCache.shrink_and_clear();
-      VisitedPhiBBs.clear();
-      return Alias;
+      AliasQuery Q;
+      return aliasCheck(Q, LocA.Ptr, LocA.Size, LocA.TBAATag,
+                        LocB.Ptr, LocB.Size, LocB.TBAATag);
     }
 
     virtual ModRefResult getModRefInfo(ImmutableCallSite CS,
@@ -501,27 +494,31 @@ namespace {
     }
 
   private:
-    // AliasCache - Track alias queries to guard against recursion.
     typedef std::pair<Location, Location> LocPair;
     typedef SmallDenseMap<LocPair, AliasResult, 8> AliasCacheTy;
-    AliasCacheTy AliasCache;
-
-    /// \brief Track phi nodes we have visited. When interpret "Value" pointer
-    /// equality as value equality we need to make sure that the "Value" is not
-    /// part of a cycle. Otherwise, two uses could come from different
-    /// "iterations" of a cycle and see different values for the same "Value"
-    /// pointer.
-    /// The following example shows the problem:
-    ///   %p = phi(%alloca1, %addr2)
-    ///   %l = load %ptr
-    ///   %addr1 = gep, %alloca2, 0, %l
-    ///   %addr2 = gep  %alloca2, 0, (%l + 1)
-    ///      alias(%p, %addr1) -> MayAlias !
-    ///   store %l, ...
-    SmallPtrSet<const BasicBlock*, 8> VisitedPhiBBs;
-
-    // Visited - Track instructions visited by pointsToConstantMemory.
-    SmallPtrSet<const Value*, 16> Visited;
+
+    // AliasQuery - The scratch state of a single alias query.  This pass is
+    // shared by every function pass manager, which may optimize functions on
+    // several threads at once, so the state lives on the stack of alias()
+    // rather than in the pass.
+    struct AliasQuery {
+      // AliasCache - Track alias queries to guard against recursion.
+      AliasCacheTy AliasCache;
+
+      /// \brief Track phi nodes we have visited. When interpret "Value"
+      /// pointer equality as value equality we need to make sure that the
+      /// "Value" is not part of a cycle. Otherwise, two uses could come from
+      /// different "iterations" of a cycle and see different values for the
+      /// same "Value" pointer.
+      /// The following example shows the problem:
+      ///   %p = phi(%alloca1, %addr2)
+      ///   %l = load %ptr
+      ///   %addr1 = gep, %alloca2, 0, %l
+      ///   %addr2 = gep  %alloca2, 0, (%l + 1)
+      ///      alias(%p, %addr1) -> MayAlias !
+      ///   store %l, ...
+      SmallPtrSet<const BasicBlock*, 8> VisitedPhiBBs;
+    };
 
     /// \brief Check whether two Values can be considered equivalent.
     ///
@@ -530,18 +527,21 @@ namespace {
     /// all visited phi nodes an making sure that the phis cannot reach the
     /// value. We have to do this because we are looking through phi nodes (That
     /// is we say noalias(V, phi(VA, VB)) if noalias(V, VA) and noalias(V, VB).
-    bool isValueEqualInPotentialCycles(const Value *V1, const Value *V2);
+    bool isValueEqualInPotentialCycles(AliasQuery &Q, const Value *V1,
+                                       const Value *V2);
 
     /// \brief Dest and Src are the variable indices from two decomposed
     /// GetElementPtr instructions GEP1 and GEP2 which have common base
     /// pointers.  Subtract the GEP2 indices from GEP1 to find the symbolic
     /// difference between the two pointers.
-    void GetIndexDifference(SmallVectorImpl<VariableGEPIndex> &Dest,
+    void GetIndexDifference(AliasQuery &Q,
+                            SmallVectorImpl<VariableGEPIndex> &Dest,
                             const SmallVectorImpl<VariableGEPIndex> &Src);
 
     // aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP
     // instruction against another.
-    AliasResult aliasGEP(const GEPOperator *V1, uint64_t V1Size,
+    AliasResult aliasGEP(AliasQuery &Q,
+                         const GEPOperator *V1, uint64_t V1Size,
                          const MDNode *V1TBAAInfo,
                          const Value *V2, uint64_t V2Size,
                          const MDNode *V2TBAAInfo,
@@ -549,18 +549,19 @@ namespace {
 
     // aliasPHI - Provide a bunch of ad-hoc rules to disambiguate a PHI
     // instruction against another.
-    AliasResult aliasPHI(const PHINode *PN, uint64_t PNSize,
+    AliasResult aliasPHI(AliasQuery &Q, const PHINode *PN, uint64_t PNSize,
                          const MDNode *PNTBAAInfo,
                          const Value *V2, uint64_t V2Size,
                          const MDNode *V2TBAAInfo);
 
     /// aliasSelect - Disambiguate a Select instruction against another value.
-    AliasResult aliasSelect(const SelectInst *SI, uint64_t SISize,
+    AliasResult aliasSelect(AliasQuery &Q,
+                            const SelectInst *SI, uint64_t SISize,
                             const MDNode *SITBAAInfo,
                             const Value *V2, uint64_t V2Size,
                             const MDNode *V2TBAAInfo);
 
-    AliasResult aliasCheck(const Value *V1, uint64_t V1Size,
+    AliasResult aliasCheck(AliasQuery &Q, const Value *V1, uint64_t V1Size,
                            const MDNode *V1TBAATag,
                            const Value *V2, uint64_t V2Size,
                            const MDNode *V2TBAATag);
@@ -587,17 +588,14 @@ ImmutablePass *llvm::createBasicAliasAnalysisPass() {
 /// considered local to all functions.
 bool
 BasicAliasAnalysis::pointsToConstantMemory(const Location &Loc, bool OrLocal) {
-  assert(Visited.empty() && "Visited must be cleared after use!");
-
   unsigned MaxLookup = 8;
+  SmallPtrSet<const Value *, 16> Visited;
   SmallVector<const Value *, 16> Worklist;
   Worklist.push_back(Loc.Ptr);
   do {
     const Value *V = GetUnderlyingObject(Worklist.pop_back_val(), DL);
-    if (!Visited.insert(V)) {
-      Visited.clear();
+    if (!Visited.insert(V))
       return AliasAnalysis::pointsToConstantMemory(Loc, OrLocal);
-    }
 
     // An alloca instruction defines local memory.
     if (OrLocal && isa<AllocaInst>(V))
@@ -608,10 +606,8 @@ BasicAliasAnalysis::pointsToConstantMemory(const Location &Loc, bool OrLocal) {
       // Note: this doesn't require GV to be "ODR" because it isn't legal for a
       // global to be marked constant in some modules and non-constant in
       // others.  GV may even be a declaration, not a definition.
-      if (!GV->isConstant()) {
-        Visited.clear();
+      if (!GV->isConstant())
         return AliasAnalysis::pointsToConstantMemory(Loc, OrLocal);
-      }
       continue;
     }
 
@@ -626,22 +622,18 @@ BasicAliasAnalysis::pointsToConstantMemory(const Location &Loc, bool OrLocal) {
     // the phi.
     if (const PHINode *PN = dyn_cast<PHINode>(V)) {
       // Don't bother inspecting phi nodes with many operands.
-      if (PN->getNumIncomingValues() > MaxLookup) {
-        Visited.clear();
+      if (PN->getNumIncomingValues() > MaxLookup)
         return AliasAnalysis::pointsToConstantMemory(Loc, OrLocal);
-      }
       for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
         Worklist.push_back(PN->getIncomingValue(i));
       continue;
     }
 
     // Otherwise be conservative.
-    Visited.clear();
     return AliasAnalysis::pointsToConstantMemory(Loc, OrLocal);
 
   } while (!Worklist.empty() && --MaxLookup);
 
-  Visited.clear();
   return Worklist.empty();
 }
 
@@ -881,7 +873,8 @@ static bool areVarIndicesEqual(SmallVectorImpl<VariableGEPIndex> &Indices1,
 /// UnderlyingV2 is the same for V2.
 ///
 AliasAnalysis::AliasResult
-BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
+BasicAliasAnalysis::aliasGEP(AliasQuery &Q,
+                             const GEPOperator *GEP1, uint64_t V1Size,
                              const MDNode *V1TBAAInfo,
                              const Value *V2, uint64_t V2Size,
                              const MDNode *V2TBAAInfo,
@@ -895,14 +888,14 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
   // derived pointer.
   if (const GEPOperator *GEP2 = dyn_cast<GEPOperator>(V2)) {
     // Do the base pointers alias?
-    AliasResult BaseAlias = aliasCheck(UnderlyingV1, UnknownSize, 0,
+    AliasResult BaseAlias = aliasCheck(Q, UnderlyingV1, UnknownSize, 0,
                                        UnderlyingV2, UnknownSize, 0);
 
     // Check for geps of non-aliasing underlying pointers where the offsets are
     // identical.
     if ((BaseAlias == MayAlias) && V1Size == V2Size) {
       // Do the base pointers alias assuming type and size.
-      AliasResult PreciseBaseAlias = aliasCheck(UnderlyingV1, V1Size,
+      AliasResult PreciseBaseAlias = aliasCheck(Q, UnderlyingV1, V1Size,
                                                 V1TBAAInfo, UnderlyingV2,
                                                 V2Size, V2TBAAInfo);
       if (PreciseBaseAlias == NoAlias) {
@@ -955,7 +948,7 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // Subtract the GEP2 pointer from the GEP1 pointer to find out their
     // symbolic difference.
     GEP1BaseOffset -= GEP2BaseOffset;
-    GetIndexDifference(GEP1VariableIndices, GEP2VariableIndices);
+    GetIndexDifference(Q, GEP1VariableIndices, GEP2VariableIndices);
 
   } else {
     // Check to see if these two pointers are related by the getelementptr
@@ -966,7 +959,7 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     if (V1Size == UnknownSize && V2Size == UnknownSize)
       return MayAlias;
 
-    AliasResult R = aliasCheck(UnderlyingV1, UnknownSize, 0,
+    AliasResult R = aliasCheck(Q, UnderlyingV1, UnknownSize, 0,
                                V2, V2Size, V2TBAAInfo);
     if (R != MustAlias)
       // If V2 may alias GEP base pointer, conservatively returns MayAlias.
@@ -1068,7 +1061,8 @@ MergeAliasResults(AliasAnalysis::AliasResult A, AliasAnalysis::AliasResult B) {
 /// aliasSelect - Provide a bunch of ad-hoc rules to disambiguate a Select
 /// instruction against another.
 AliasAnalysis::AliasResult
-BasicAliasAnalysis::aliasSelect(const SelectInst *SI, uint64_t SISize,
+BasicAliasAnalysis::aliasSelect(AliasQuery &Q,
+                                const SelectInst *SI, uint64_t SISize,
                                 const MDNode *SITBAAInfo,
                                 const Value *V2, uint64_t V2Size,
                                 const MDNode *V2TBAAInfo) {
@@ -1077,12 +1071,12 @@ BasicAliasAnalysis::aliasSelect(const SelectInst *SI, uint64_t SISize,
   if (const SelectInst *SI2 = dyn_cast<SelectInst>(V2))
     if (SI->getCondition() == SI2->getCondition()) {
       AliasResult Alias =
-        aliasCheck(SI->getTrueValue(), SISize, SITBAAInfo,
+        aliasCheck(Q, SI->getTrueValue(), SISize, SITBAAInfo,
                    SI2->getTrueValue(), V2Size, V2TBAAInfo);
       if (Alias == MayAlias)
         return MayAlias;
       AliasResult ThisAlias =
-        aliasCheck(SI->getFalseValue(), SISize, SITBAAInfo,
+        aliasCheck(Q, SI->getFalseValue(), SISize, SITBAAInfo,
                    SI2->getFalseValue(), V2Size, V2TBAAInfo);
       return MergeAliasResults(ThisAlias, Alias);
     }
@@ -1090,25 +1084,27 @@ BasicAliasAnalysis::aliasSelect(const SelectInst *SI, uint64_t SISize,
   // If both arms of the Select node NoAlias or MustAlias V2, then returns
   // NoAlias / MustAlias. Otherwise, returns MayAlias.
   AliasResult Alias =
-    aliasCheck(V2, V2Size, V2TBAAInfo, SI->getTrueValue(), SISize, SITBAAInfo);
+    aliasCheck(Q, V2, V2Size, V2TBAAInfo,
+               SI->getTrueValue(), SISize, SITBAAInfo);
   if (Alias == MayAlias)
     return MayAlias;
 
   AliasResult ThisAlias =
-    aliasCheck(V2, V2Size, V2TBAAInfo, SI->getFalseValue(), SISize, SITBAAInfo);
+    aliasCheck(Q, V2, V2Size, V2TBAAInfo,
+               SI->getFalseValue(), SISize, SITBAAInfo);
   return MergeAliasResults(ThisAlias, Alias);
 }
 
 // aliasPHI - Provide a bunch of ad-hoc rules to disambiguate a PHI instruction
 // against another.
 AliasAnalysis::AliasResult
-BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
+BasicAliasAnalysis::aliasPHI(AliasQuery &Q, const PHINode *PN, uint64_t PNSize,
                              const MDNode *PNTBAAInfo,
                              const Value *V2, uint64_t V2Size,
                              const MDNode *V2TBAAInfo) {
   // Track phi nodes we have visited. We use this information when we determine
   // value equivalence.
-  VisitedPhiBBs.insert(PN->getParent());
+  Q.VisitedPhiBBs.insert(PN->getParent());
 
   // If the values are PHIs in the same block, we can do a more precise
   // as well as efficient check: just check for aliases between the values
@@ -1127,14 +1123,14 @@ BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
       // that causes a MayAlias.
       // Pretend the phis do not alias.
       AliasResult Alias = NoAlias;
-      assert(AliasCache.count(Locs) &&
+      assert(Q.AliasCache.count(Locs) &&
              "There must exist an entry for the phi node");
-      AliasResult OrigAliasResult = AliasCache[Locs];
-      AliasCache[Locs] = NoAlias;
+      AliasResult OrigAliasResult = Q.AliasCache[Locs];
+      Q.AliasCache[Locs] = NoAlias;
 
       for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i) {
         AliasResult ThisAlias =
-          aliasCheck(PN->getIncomingValue(i), PNSize, PNTBAAInfo,
+          aliasCheck(Q, PN->getIncomingValue(i), PNSize, PNTBAAInfo,
                      PN2->getIncomingValueForBlock(PN->getIncomingBlock(i)),
                      V2Size, V2TBAAInfo);
         Alias = MergeAliasResults(ThisAlias, Alias);
@@ -1144,7 +1140,7 @@ BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
 
       // Reset if speculation failed.
       if (Alias != NoAlias)
-        AliasCache[Locs] = OrigAliasResult;
+        Q.AliasCache[Locs] = OrigAliasResult;
 
       return Alias;
     }
@@ -1163,7 +1159,7 @@ BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
       V1Srcs.push_back(PV1);
   }
 
-  AliasResult Alias = aliasCheck(V2, V2Size, V2TBAAInfo,
+  AliasResult Alias = aliasCheck(Q, V2, V2Size, V2TBAAInfo,
                                  V1Srcs[0], PNSize, PNTBAAInfo);
   // Early exit if the check of the first PHI source against V2 is MayAlias.
   // Other results are not possible.
@@ -1175,7 +1171,7 @@ BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
   for (unsigned i = 1, e = V1Srcs.size(); i != e; ++i) {
     Value *V = V1Srcs[i];
 
-    AliasResult ThisAlias = aliasCheck(V2, V2Size, V2TBAAInfo,
+    AliasResult ThisAlias = aliasCheck(Q, V2, V2Size, V2TBAAInfo,
                                        V, PNSize, PNTBAAInfo);
     Alias = MergeAliasResults(ThisAlias, Alias);
     if (Alias == MayAlias)
@@ -1189,7 +1185,7 @@ BasicAliasAnalysis::aliasPHI(const PHINode *PN, uint64_t PNSize,
 // such as array references.
 //
 AliasAnalysis::AliasResult
-BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
+BasicAliasAnalysis::aliasCheck(AliasQuery &Q, const Value *V1, uint64_t V1Size,
                                const MDNode *V1TBAAInfo,
                                const Value *V2, uint64_t V2Size,
                                const MDNode *V2TBAAInfo) {
@@ -1208,7 +1204,7 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   // case. The function isValueEqualInPotentialCycles ensures that this cannot
   // happen by looking at the visited phi nodes and making sure they cannot
   // reach the value.
-  if (isValueEqualInPotentialCycles(V1, V2))
+  if (isValueEqualInPotentialCycles(Q, V1, V2))
     return MustAlias;
 
   if (!V1->getType()->isPointerTy() || !V2->getType()->isPointerTy())
@@ -1277,7 +1273,7 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   if (V1 > V2)
     std::swap(Locs.first, Locs.second);
   std::pair<AliasCacheTy::iterator, bool> Pair =
-    AliasCache.insert(std::make_pair(Locs, MayAlias));
+    Q.AliasCache.insert(std::make_pair(Locs, MayAlias));
   if (!Pair.second)
     return Pair.first->second;
 
@@ -1290,8 +1286,9 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
     std::swap(V1TBAAInfo, V2TBAAInfo);
   }
   if (const GEPOperator *GV1 = dyn_cast<GEPOperator>(V1)) {
-    AliasResult Result = aliasGEP(GV1, V1Size, V1TBAAInfo, V2, V2Size, V2TBAAInfo, O1, O2);
-    if (Result != MayAlias) return AliasCache[Locs] = Result;
+    AliasResult Result = aliasGEP(Q, GV1, V1Size, V1TBAAInfo,
+                                  V2, V2Size, V2TBAAInfo, O1, O2);
+    if (Result != MayAlias) return Q.AliasCache[Locs] = Result;
   }
 
   if (isa<PHINode>(V2) && !isa<PHINode>(V1)) {
@@ -1300,9 +1297,9 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
     std::swap(V1TBAAInfo, V2TBAAInfo);
   }
   if (const PHINode *PN = dyn_cast<PHINode>(V1)) {
-    AliasResult Result = aliasPHI(PN, V1Size, V1TBAAInfo,
+    AliasResult Result = aliasPHI(Q, PN, V1Size, V1TBAAInfo,
                                   V2, V2Size, V2TBAAInfo);
-    if (Result != MayAlias) return AliasCache[Locs] = Result;
+    if (Result != MayAlias) return Q.AliasCache[Locs] = Result;
   }
 
   if (isa<SelectInst>(V2) && !isa<SelectInst>(V1)) {
@@ -1311,9 +1308,9 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
     std::swap(V1TBAAInfo, V2TBAAInfo);
   }
   if (const SelectInst *S1 = dyn_cast<SelectInst>(V1)) {
-    AliasResult Result = aliasSelect(S1, V1Size, V1TBAAInfo,
+    AliasResult Result = aliasSelect(Q, S1, V1Size, V1TBAAInfo,
                                      V2, V2Size, V2TBAAInfo);
-    if (Result != MayAlias) return AliasCache[Locs] = Result;
+    if (Result != MayAlias) return Q.AliasCache[Locs] = Result;
   }
 
   // If both pointers are pointing into the same object and one of them
@@ -1322,15 +1319,16 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
   if (DL && O1 == O2)
     if ((V1Size != UnknownSize && isObjectSize(O1, V1Size, *DL, *TLI)) ||
         (V2Size != UnknownSize && isObjectSize(O2, V2Size, *DL, *TLI)))
-      return AliasCache[Locs] = PartialAlias;
+      return Q.AliasCache[Locs] = PartialAlias;
 
   AliasResult Result =
     AliasAnalysis::alias(Location(V1, V1Size, V1TBAAInfo),
                          Location(V2, V2Size, V2TBAAInfo));
-  return AliasCache[Locs] = Result;
+  return Q.AliasCache[Locs] = Result;
 }
 
-bool BasicAliasAnalysis::isValueEqualInPotentialCycles(const Value *V,
+bool BasicAliasAnalysis::isValueEqualInPotentialCycles(AliasQuery &Q,
+                                                       const Value *V,
                                                        const Value *V2) {
   if (V != V2)
     return false;
@@ -1339,7 +1337,7 @@ bool BasicAliasAnalysis::isValueEqualInPotentialCycles(const Value *V,
   if (!Inst)
     return true;
 
-  if (VisitedPhiBBs.size() > MaxNumPhiBBsValueReachabilityCheck)
+  if (Q.VisitedPhiBBs.size() > MaxNumPhiBBsValueReachabilityCheck)
     return false;
 
   // Use dominance or loop info if available.
@@ -1351,8 +1349,8 @@ bool BasicAliasAnalysis::isValueEqualInPotentialCycles(const Value *V,
   // Make sure that the visited phis cannot reach the Value. This ensures that
   // the Values cannot come from different iterations of a potential cycle the
   // phi nodes could be involved in.
-  for (SmallPtrSet<const BasicBlock *, 8>::iterator PI = VisitedPhiBBs.begin(),
-                                                    PE = VisitedPhiBBs.end();
+  for (SmallPtrSet<const BasicBlock *, 8>::iterator
+           PI = Q.VisitedPhiBBs.begin(), PE = Q.VisitedPhiBBs.end();
        PI != PE; ++PI)
     if (isPotentiallyReachable((*PI)->begin(), Inst, DT, LI))
       return false;
@@ -1365,6 +1363,7 @@ bool BasicAliasAnalysis::isValueEqualInPotentialCycles(const Value *V,
 /// pointers.  Subtract the GEP2 indices from GEP1 to find the symbolic
 /// difference between the two pointers.
 void BasicAliasAnalysis::GetIndexDifference(
+    AliasQuery &Q,
     SmallVectorImpl<VariableGEPIndex> &Dest,
     const SmallVectorImpl<VariableGEPIndex> &Src) {
   if (Src.empty())
@@ -1378,7 +1377,7 @@ void BasicAliasAnalysis::GetIndexDifference(
     // Find V in Dest.  This is N^2, but pointer indices almost never have more
     // than a few variable indexes.
     for (unsigned j = 0, e = Dest.size(); j != e; ++j) {
-      if (!isValueEqualInPotentialCycles(Dest[j].V, V) ||
+      if (!isValueEqualInPotentialCycles(Q, Dest[j].V, V) ||
           Dest[j].Extension != Extension)
         continue;
 
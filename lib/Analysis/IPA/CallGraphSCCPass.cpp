@@ -23,6 +23,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LegacyPassManagers.h"
+#include "llvm/IR/PassProfiler.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
@@ -119,9 +120,27 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
       CallGraphUpToDate = true;
     }
 
+    SmallVector<Function *, 4> SCCFunctions;
+    if (PassProfiler::isStarted())
+      for (CallGraphSCC::iterator I = CurSCC.begin(), E = CurSCC.end();
+           I != E; ++I)
+        SCCFunctions.push_back((*I)->getFunction());
+
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassProfileRegion Profile(CGSP, SCCFunctions);
       Changed = CGSP->runOnSCC(CurSCC);
+      // The pass may have deleted functions of the SCC, so count what is
+      // left in CurSCC, which the pass keeps up to date, rather than
+      // SCCFunctions.
+      if (!SCCFunctions.empty()) {
+        SCCFunctions.clear();
+        for (CallGraphSCC::iterator I = CurSCC.begin(), E = CurSCC.end();
+             I != E; ++I)
+          SCCFunctions.push_back((*I)->getFunction());
+        Profile.setInstructionsAfter(
+            PassProfileRegion::countInstructions(SCCFunctions));
+      }
     }
     
     // After the CGSCCPass is done, when assertions are enabled, use
@@ -236,8 +236,10 @@ Value *PHITransAddr::PHITranslateSubExpr(Value *V, BasicBlock *CurBB,
       return AddAsInput(V);
     }
 
-    // Scan to see if we have this GEP available.
+    // Scan to see if we have this GEP available.  The base may be a global
+    // that other threads are adding uses to.
     Value *APHIOp = GEPOps[0];
+    SharedUseListGuard UseListGuard(APHIOp);
     for (Value::use_iterator UI = APHIOp->use_begin(), E = APHIOp->use_end();
          UI != E; ++UI) {
       if (GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(*UI))
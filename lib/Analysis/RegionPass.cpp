@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 #include "llvm/Analysis/RegionPass.h"
 #include "llvm/Analysis/RegionIterator.h"
+#include "llvm/IR/PassProfiler.h"
 #include "llvm/Support/Timer.h"
 
 #define DEBUG_TYPE "regionpassmgr"
@@ -93,6 +94,7 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        PassProfileRegion Profile(P, *CurrentRegion->getEntry()->getParent());
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
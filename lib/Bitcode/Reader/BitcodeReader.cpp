@@ -9,12 +9,15 @@
 
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "BitcodeReader.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/AutoUpgrade.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
+#include "llvm/Bitcode/SymbolSummary.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/FunctionArena.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
@@ -1633,6 +1636,67 @@ error_code BitcodeReader::RememberAndSkipFunctionBody() {
   return error_code::success();
 }
 
+/// ParseFunctionIndex - Read the FUNCTION_INDEX_BLOCK and record where every
+/// function body starts, so that none of the function blocks needs to be
+/// scanned.  On return the stream is positioned just past the index.
+error_code BitcodeReader::ParseFunctionIndex() {
+  // The index records the position of the ENTER_SUBBLOCK abbrev ID of each
+  // function block, while materialization expects to resume right after the
+  // block ID.  FUNCTION_BLOCK_ID always fits in a single VBR chunk.
+  unsigned BlockHeaderBits = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+
+  if (!Stream.canSkipToPos(FunctionIndexOffset / 8))
+    return Error(MalformedBlock);
+  Stream.JumpToBit(FunctionIndexOffset);
+
+  BitstreamEntry Entry = Stream.advance();
+  if (Entry.Kind != BitstreamEntry::SubBlock ||
+      Entry.ID != bitc::FUNCTION_INDEX_BLOCK_ID ||
+      Stream.EnterSubBlock(bitc::FUNCTION_INDEX_BLOCK_ID))
+    return Error(MalformedBlock);
+
+  SmallPtrSet<Function*, 64> HasBody(FunctionsWithBodies.begin(),
+                                     FunctionsWithBodies.end());
+  unsigned NumIndexed = 0;
+  SmallVector<uint64_t, 2> Record;
+  while (1) {
+    Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      // Every function with a body must have been accounted for.
+      if (NumIndexed != FunctionsWithBodies.size())
+        return Error(InsufficientFunctionProtos);
+      FunctionsWithBodies.clear();
+      return error_code::success();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default:  // Default behavior: ignore.
+      break;
+    case bitc::FUNCTION_INDEX_CODE_ENTRY: { // ENTRY: [valueid, bitoffset]
+      if (Record.size() < 2)
+        return Error(InvalidRecord);
+      if (Record[0] >= ValueList.size())
+        return Error(InvalidID);
+      Function *F = dyn_cast_or_null<Function>(ValueList[Record[0]]);
+      if (!F || !HasBody.count(F) || DeferredFunctionInfo.count(F))
+        return Error(InvalidValue);
+      DeferredFunctionInfo[F] = Record[1] + BlockHeaderBits;
+      ++NumIndexed;
+      break;
+    }
+    }
+  }
+}
+
 error_code BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -1724,6 +1788,15 @@ error_code BitcodeReader::ParseModule(bool Resume) {
           if (error_code EC = GlobalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+
+          // If the module has a function index, use it to locate every body
+          // and continue right after it, skipping all the function blocks.
+          // Streamed bitcode is read in order, so it is left alone there.
+          if (FunctionIndexOffset && !LazyStreamer) {
+            if (error_code EC = ParseFunctionIndex())
+              return EC;
+            break;
+          }
         }
 
         if (error_code EC = RememberAndSkipFunctionBody())
@@ -1815,6 +1888,12 @@ error_code BitcodeReader::ParseModule(bool Resume) {
       GCTable.push_back(S);
       break;
     }
+    case bitc::MODULE_CODE_FNINDEXOFFSET: { // FNINDEXOFFSET: [offset]
+      if (Record.size() < 1 || Record[0] == 0)
+        return Error(InvalidRecord);
+      FunctionIndexOffset = Record[0] * 32;
+      break;
+    }
     // GLOBALVAR: [pointer type, isconst, initid,
     //             linkage, alignment, section, visibility, threadlocal,
     //             unnamed_addr, dllstorageclass]
@@ -2156,6 +2235,123 @@ error_code BitcodeReader::ParseTriple(std::string &Triple) {
   }
 }
 
+error_code
+BitcodeReader::ParseSymbolSummaryBlock(BitcodeSymbolSummary &Summary) {
+  if (Stream.EnterSubBlock(bitc::SYMBOL_SUMMARY_BLOCK_ID))
+    return Error(InvalidRecord);
+
+  SmallVector<uint64_t, 64> Record;
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      return error_code::success();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: break;  // Default behavior, ignore unknown content.
+    case bitc::SUMMARY_CODE_TRIPLE:      // TRIPLE: [strchr x N]
+      if (ConvertToString(Record, 0, Summary.TargetTriple))
+        return Error(InvalidRecord);
+      break;
+    case bitc::SUMMARY_CODE_DATALAYOUT:  // DATALAYOUT: [strchr x N]
+      if (ConvertToString(Record, 0, Summary.DataLayout))
+        return Error(InvalidRecord);
+      break;
+    case bitc::SUMMARY_CODE_FLAGS:       // FLAGS: [flags]
+      if (Record.empty())
+        return Error(InvalidRecord);
+      Summary.Flags = Record[0];
+      break;
+    case bitc::SUMMARY_CODE_SYMBOL: {
+      // SYMBOL: [kind, linkage, visibility, flags, alignment, size, namelen,
+      //          namechar x namelen, linkernamechar x N]
+      if (Record.size() < 7 || Record[0] > BitcodeSymbol::Alias ||
+          Record.size() - 7 < Record[6])
+        return Error(InvalidRecord);
+      Summary.Symbols.push_back(BitcodeSymbol());
+      BitcodeSymbol &Sym = Summary.Symbols.back();
+      Sym.Kind = BitcodeSymbol::SymbolKind(Record[0]);
+      Sym.Linkage = GetDecodedLinkage(Record[1]);
+      Sym.Visibility = GetDecodedVisibility(Record[2]);
+      Sym.Flags = Record[3];
+      Sym.Alignment = (1 << Record[4]) >> 1;
+      Sym.Size = Record[5];
+      unsigned NameEnd = 7 + Record[6];
+      for (unsigned i = 7; i != NameEnd; ++i)
+        Sym.Name += (char)Record[i];
+      for (unsigned i = NameEnd, e = Record.size(); i != e; ++i)
+        Sym.LinkerName += (char)Record[i];
+      break;
+    }
+    case bitc::SUMMARY_CODE_CALLS: {     // CALLS: [symbolindex, calleeindex x N]
+      if (Record.empty() || Record[0] >= Summary.Symbols.size())
+        return Error(InvalidRecord);
+      std::vector<unsigned> &Callees = Summary.Symbols[Record[0]].Callees;
+      Callees.assign(Record.begin() + 1, Record.end());
+      break;
+    }
+    }
+  }
+}
+
+error_code BitcodeReader::ParseSymbolSummary(BitcodeSymbolSummary &Summary,
+                                             bool &Found) {
+  Found = false;
+  if (error_code EC = InitStream())
+    return EC;
+
+  // Sniff for the signature.
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return Error(InvalidBitcodeSignature);
+
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return error_code::success();
+
+    BitstreamEntry Entry = Stream.advance();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      return error_code::success();
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::SYMBOL_SUMMARY_BLOCK_ID) {
+        Found = true;
+        return ParseSymbolSummaryBlock(Summary);
+      }
+
+      // The writer puts the summary in front of the module, so there is none
+      // to be found after it.
+      if (Entry.ID == bitc::MODULE_BLOCK_ID)
+        return error_code::success();
+
+      if (Stream.SkipBlock())
+        return Error(MalformedBlock);
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
 /// ParseMetadataAttachment - Parse metadata attachments.
 error_code BitcodeReader::ParseMetadataAttachment() {
   if (Stream.EnterSubBlock(bitc::METADATA_ATTACHMENT_ID))
@@ -2205,6 +2401,7 @@ error_code BitcodeReader::ParseMetadataAttachment() {
 
 /// ParseFunctionBody - Lazily parse the specified function body block.
 error_code BitcodeReader::ParseFunctionBody(Function *F) {
+  FunctionArenaScope ArenaScope(*F);
   if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return Error(InvalidRecord);
 
@@ -3426,3 +3623,18 @@ std::string llvm::getBitcodeTargetTriple(MemoryBuffer *Buffer,
   delete R;
   return Triple;
 }
+
+ErrorOr<BitcodeSymbolSummary *>
+llvm::readBitcodeSymbolSummary(MemoryBuffer *Buffer, LLVMContext &Context) {
+  OwningPtr<BitcodeReader> R(new BitcodeReader(Buffer, Context));
+  // Don't let the BitcodeReader dtor delete 'Buffer'.
+  R->setBufferOwned(false);
+
+  OwningPtr<BitcodeSymbolSummary> Summary(new BitcodeSymbolSummary());
+  bool Found;
+  if (error_code EC = R->ParseSymbolSummary(*Summary, Found))
+    return EC;
+  if (!Found)
+    return static_cast<BitcodeSymbolSummary *>(0);
+  return Summary.take();
+}
@@ -26,6 +26,7 @@
 #include <vector>
 
 namespace llvm {
+  struct BitcodeSymbolSummary;
   class MemoryBuffer;
   class LLVMContext;
 
@@ -133,6 +134,10 @@ class BitcodeReader : public GVMaterializer {
   uint64_t NextUnreadBit;
   bool SeenValueSymbolTable;
 
+  /// FunctionIndexOffset - The bit offset of the FUNCTION_INDEX_BLOCK, or zero
+  /// if the module does not have one.
+  uint64_t FunctionIndexOffset;
+
   std::vector<Type*> TypeList;
   BitcodeReaderValueList ValueList;
   BitcodeReaderMDValueList MDValueList;
@@ -226,13 +231,13 @@ public:
   explicit BitcodeReader(MemoryBuffer *buffer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       LazyStreamer(0), NextUnreadBit(0), SeenValueSymbolTable(false),
-      ValueList(C), MDValueList(C),
+      FunctionIndexOffset(0), ValueList(C), MDValueList(C),
       SeenFirstFunctionBody(false), UseRelativeIDs(false) {
   }
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
       LazyStreamer(streamer), NextUnreadBit(0), SeenValueSymbolTable(false),
-      ValueList(C), MDValueList(C),
+      FunctionIndexOffset(0), ValueList(C), MDValueList(C),
       SeenFirstFunctionBody(false), UseRelativeIDs(false) {
   }
   ~BitcodeReader() {
@@ -261,6 +266,11 @@ public:
   /// @returns true if an error occurred.
   error_code ParseTriple(std::string &Triple);
 
+  /// @brief Read the symbol summary block, if there is one, leaving the
+  /// module alone.
+  /// @returns true if an error occurred.
+  error_code ParseSymbolSummary(BitcodeSymbolSummary &Summary, bool &Found);
+
   static uint64_t decodeSignRotatedValue(uint64_t V);
 
 private:
@@ -356,6 +366,7 @@ private:
   error_code ParseValueSymbolTable();
   error_code ParseConstants();
   error_code RememberAndSkipFunctionBody();
+  error_code ParseFunctionIndex();
   error_code ParseFunctionBody(Function *F);
   error_code GlobalCleanup();
   error_code ResolveGlobalAndAliasInits();
@@ -363,6 +374,7 @@ private:
   error_code ParseMetadataAttachment();
   error_code ParseTypeMetadataAttachment();
   error_code ParseModuleTriple(std::string &Triple);
+  error_code ParseSymbolSummaryBlock(BitcodeSymbolSummary &Summary);
   error_code ParseUseLists();
   error_code InitStream();
   error_code InitStreamFromBuffer();
@@ -16,17 +16,24 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
+#include "llvm/Bitcode/SymbolSummary.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/CallSite.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/InstIterator.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
@@ -38,6 +45,18 @@ EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
                                        "use-list order preservation."),
                               cl::init(false), cl::Hidden);
 
+static cl::opt<unsigned>
+BitcodeWriterThreads("bitcode-writer-threads",
+                     cl::desc("Number of threads used to encode function "
+                              "bodies (0 = one per hardware thread)"),
+                     cl::init(1), cl::Hidden);
+
+static cl::opt<bool>
+EmitSymbolSummary("bitcode-symbol-summary",
+                  cl::desc("Emit a summary of the module's symbols in front "
+                           "of it for linkers"),
+                  cl::init(false), cl::Hidden);
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -1919,8 +1938,125 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
-/// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+namespace {
+/// FunctionBlockEncoder - The state one thread needs to encode function blocks
+/// on its own: a private copy of the module's ValueEnumerator and a
+/// BitstreamWriter with the module's BLOCKINFO abbrevs.
+struct FunctionBlockEncoder {
+  ValueEnumerator VE;
+  SmallVector<char, 0> Buffer;
+  BitstreamWriter Stream;
+
+  FunctionBlockEncoder(const ValueEnumerator &ModuleVE,
+                       const BitstreamWriter &ModuleStream)
+    : VE(ModuleVE), Stream(Buffer) {
+    Stream.CopyBlockInfoFrom(ModuleStream);
+  }
+};
+}
+
+/// WriteFunctionsInParallel - Encode the given function bodies on NumThreads
+/// threads, each into its own buffer, then splice the blocks into Stream in
+/// order.  The output is identical to calling WriteFunction on each of them.
+static void WriteFunctionsInParallel(
+    ArrayRef<const Function *> Functions, const ValueEnumerator &VE,
+    BitstreamWriter &Stream, unsigned NumThreads, uint64_t BitcodeStartBit,
+    SmallVectorImpl<std::pair<unsigned, uint64_t> > &FunctionOffsets) {
+  std::vector<FunctionBlockEncoder*> Encoders;
+  for (unsigned i = 0; i != NumThreads; ++i)
+    Encoders.push_back(new FunctionBlockEncoder(VE, Stream));
+
+  // For each function, the encoder that handled it and where its block lives
+  // in that encoder's buffer.
+  struct EncodedBlock {
+    unsigned Encoder;
+    size_t Begin, End;
+  };
+  std::vector<EncodedBlock> Blocks(Functions.size());
+
+  volatile sys::cas_flag NextFunction = 0;
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned i = 0; i != NumThreads; ++i) {
+      Pool.async([&, i] {
+        FunctionBlockEncoder &E = *Encoders[i];
+        while (true) {
+          unsigned FI = sys::AtomicIncrement(&NextFunction) - 1;
+          if (FI >= Functions.size())
+            break;
+          Blocks[FI].Encoder = i;
+          Blocks[FI].Begin = E.Buffer.size();
+          WriteFunction(*Functions[FI], E.VE, E.Stream);
+          Blocks[FI].End = E.Buffer.size();
+        }
+      });
+    }
+    Pool.wait();
+  }
+
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    const SmallVectorImpl<char> &Buffer = Encoders[Blocks[i].Encoder]->Buffer;
+    FunctionOffsets.push_back(std::make_pair(
+        VE.getValueID(Functions[i]),
+        Stream.GetCurrentBitNo() - BitcodeStartBit));
+    Stream.SpliceSubblock(StringRef(Buffer.data() + Blocks[i].Begin,
+                                    Blocks[i].End - Blocks[i].Begin));
+  }
+
+  for (unsigned i = 0; i != NumThreads; ++i)
+    delete Encoders[i];
+}
+
+/// WriteFunctionIndexOffset - Emit a placeholder MODULE_CODE_FNINDEXOFFSET
+/// record and return the bit position of its operand, to be backpatched once
+/// the function index block has been written.
+static uint64_t WriteFunctionIndexOffset(BitstreamWriter &Stream) {
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEXOFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned AbbrevID = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(0);
+  Stream.EmitRecord(bitc::MODULE_CODE_FNINDEXOFFSET, Vals, AbbrevID);
+  return Stream.GetCurrentBitNo() - 32;
+}
+
+/// WriteFunctionIndex - Emit the FUNCTION_INDEX_BLOCK, which maps the value ID
+/// of each function with a body to the bit offset of its FUNCTION_BLOCK, and
+/// point the MODULE_CODE_FNINDEXOFFSET record at it.
+static void WriteFunctionIndex(
+    const SmallVectorImpl<std::pair<unsigned, uint64_t> > &FunctionOffsets,
+    uint64_t OffsetPlaceholder, uint64_t BitcodeStartBit,
+    BitstreamWriter &Stream) {
+  // The preceding function block left the stream 32-bit aligned.
+  uint64_t IndexOffset = Stream.GetCurrentBitNo() - BitcodeStartBit;
+  assert((IndexOffset & 31) == 0 && "Function index is not word aligned!");
+  Stream.BackpatchWordAtBit(OffsetPlaceholder, IndexOffset / 32);
+
+  Stream.EnterSubblock(bitc::FUNCTION_INDEX_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FUNCTION_INDEX_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 16));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<uint64_t, 2> Vals;
+  for (unsigned i = 0, e = FunctionOffsets.size(); i != e; ++i) {
+    Vals.push_back(FunctionOffsets[i].first);
+    Vals.push_back(FunctionOffsets[i].second);
+    Stream.EmitRecord(bitc::FUNCTION_INDEX_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  }
+
+  Stream.ExitBlock();
+}
+
+/// WriteModule - Emit the specified module to the bitstream.  BitcodeStartBit
+/// is the position of the bitcode magic number in the stream.
+static void WriteModule(const Module *M, BitstreamWriter &Stream,
+                        uint64_t BitcodeStartBit) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -1947,6 +2083,14 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   // descriptors for global variables, and function prototype info.
   WriteModuleInfo(M, VE, Stream);
 
+  // Reserve room for the offset of the function index, if there will be one.
+  uint64_t IndexOffsetPlaceholder = 0;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      IndexOffsetPlaceholder = WriteFunctionIndexOffset(Stream);
+      break;
+    }
+
   // Emit constants.
   WriteModuleConstants(VE, Stream);
 
@@ -1963,10 +2107,167 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
-  // Emit function bodies.
+  // Emit function bodies, remembering where each one starts so that readers
+  // can seek directly to any of them through the function index.
+  SmallVector<std::pair<unsigned, uint64_t>, 64> FunctionOffsets;
+  SmallVector<const Function *, 64> Functions;
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
     if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+      Functions.push_back(F);
+
+  unsigned NumThreads = BitcodeWriterThreads;
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  NumThreads = std::min<unsigned>(NumThreads, Functions.size());
+
+  if (NumThreads > 1) {
+    WriteFunctionsInParallel(Functions, VE, Stream, NumThreads,
+                             BitcodeStartBit, FunctionOffsets);
+  } else {
+    for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+      FunctionOffsets.push_back(std::make_pair(
+          VE.getValueID(Functions[i]),
+          Stream.GetCurrentBitNo() - BitcodeStartBit));
+      WriteFunction(*Functions[i], VE, Stream);
+    }
+  }
+
+  if (!FunctionOffsets.empty())
+    WriteFunctionIndex(FunctionOffsets, IndexOffsetPlaceholder,
+                       BitcodeStartBit, Stream);
+
+  Stream.ExitBlock();
+}
+
+/// addSummarySymbol - Append the SYMBOL record for GV to the summary and
+/// give it the next index.
+static void addSummarySymbol(const GlobalValue *GV, BitcodeSymbol::SymbolKind
+                             Kind, unsigned Flags, uint64_t Size,
+                             const Mangler *Mang, BitstreamWriter &Stream,
+                             DenseMap<const GlobalValue *, unsigned> &Index) {
+  SmallString<64> LinkerName;
+  if (Mang)
+    Mang->getNameWithPrefix(LinkerName, GV, false);
+  else
+    LinkerName = GV->getName();
+
+  SmallVector<uint64_t, 64> Vals;
+  Vals.push_back(Kind);
+  Vals.push_back(getEncodedLinkage(GV));
+  Vals.push_back(getEncodedVisibility(GV));
+  if (GV->hasUnnamedAddr())
+    Flags |= BitcodeSymbol::UnnamedAddr;
+  Vals.push_back(Flags);
+  Vals.push_back(Log2_32(GV->getAlignment()) + 1);
+  Vals.push_back(Size);
+  StringRef Name = GV->getName();
+  Vals.push_back(Name.size());
+  Vals.append(Name.begin(), Name.end());
+  Vals.append(LinkerName.begin(), LinkerName.end());
+  Stream.EmitRecord(bitc::SUMMARY_CODE_SYMBOL, Vals);
+
+  unsigned NextIndex = Index.size();
+  Index[GV] = NextIndex;
+}
+
+/// WriteSymbolSummary - Emit the SYMBOL_SUMMARY_BLOCK for M: what a linker
+/// needs to know about each global value, and the direct calls each function
+/// makes.  It goes in front of the module so that reading it touches only the
+/// first few pages of the file.
+static void WriteSymbolSummary(const Module *M, BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::SYMBOL_SUMMARY_BLOCK_ID, 3);
+
+  WriteStringRecord(bitc::SUMMARY_CODE_TRIPLE, M->getTargetTriple(), 0,
+                    Stream);
+  WriteStringRecord(bitc::SUMMARY_CODE_DATALAYOUT, M->getDataLayoutStr(), 0,
+                    Stream);
+
+  unsigned ModuleFlags = 0;
+  if (!M->getModuleInlineAsm().empty())
+    ModuleFlags |= BitcodeSymbolSummary::HasModuleAsm;
+  if (M->getModuleFlag("Linker Options"))
+    ModuleFlags |= BitcodeSymbolSummary::HasLinkerOptions;
+  for (Module::const_global_iterator I = M->global_begin(),
+         E = M->global_end(); I != E; ++I)
+    if (I->hasSection() && StringRef(I->getSection()).startswith("__OBJC,"))
+      ModuleFlags |= BitcodeSymbolSummary::HasObjCSections;
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(ModuleFlags);
+  Stream.EmitRecord(bitc::SUMMARY_CODE_FLAGS, Vals);
+
+  const DataLayout *DL = M->getDataLayout();
+  OwningPtr<Mangler> Mang;
+  if (DL)
+    Mang.reset(new Mangler(DL));
+
+  // Number every symbol before emitting the calls, which may refer forward.
+  DenseMap<const GlobalValue *, unsigned> Index;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F) {
+    uint64_t NumInsts = 0;
+    for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+         ++BB)
+      NumInsts += BB->size();
+    addSummarySymbol(F, BitcodeSymbol::Function,
+                     F->isDeclaration() ? BitcodeSymbol::Declaration : 0,
+                     NumInsts, Mang.get(), Stream, Index);
+  }
+  for (Module::const_global_iterator GV = M->global_begin(),
+         E = M->global_end(); GV != E; ++GV) {
+    unsigned Flags = 0;
+    if (GV->isDeclaration())
+      Flags |= BitcodeSymbol::Declaration;
+    if (GV->isConstant())
+      Flags |= BitcodeSymbol::Constant;
+    if (GV->isThreadLocal())
+      Flags |= BitcodeSymbol::ThreadLocal;
+    uint64_t Size = 0;
+    if (DL && !GV->isDeclaration())
+      Size = DL->getTypeAllocSize(GV->getType()->getElementType());
+    addSummarySymbol(GV, BitcodeSymbol::Variable, Flags, Size, Mang.get(),
+                     Stream, Index);
+  }
+  for (Module::const_alias_iterator GA = M->alias_begin(),
+         E = M->alias_end(); GA != E; ++GA) {
+    unsigned Flags = 0;
+    const GlobalValue *Aliasee = GA->getAliasedGlobal();
+    // An available_externally aliasee is not emitted with the module either.
+    if (!Aliasee || Aliasee->isDeclaration() ||
+        Aliasee->hasAvailableExternallyLinkage())
+      Flags |= BitcodeSymbol::AliasOfDeclaration;
+    addSummarySymbol(GA, BitcodeSymbol::Alias, Flags, 0, Mang.get(), Stream,
+                     Index);
+  }
+
+  // Functions come first, so a function's symbol index is its position in
+  // the module.
+  SmallVector<unsigned, 16> Callees;
+  unsigned FnIndex = 0;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E;
+       ++F, ++FnIndex) {
+    Callees.clear();
+    for (const_inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE;
+         ++I) {
+      ImmutableCallSite CS(&*I);
+      if (!CS)
+        continue;
+      const GlobalValue *Callee =
+          dyn_cast<GlobalValue>(CS.getCalledValue()->stripPointerCasts());
+      if (!Callee)
+        continue;
+      DenseMap<const GlobalValue *, unsigned>::iterator It =
+          Index.find(Callee);
+      if (It != Index.end() &&
+          std::find(Callees.begin(), Callees.end(), It->second) ==
+              Callees.end())
+        Callees.push_back(It->second);
+    }
+    if (Callees.empty())
+      continue;
+    Vals.clear();
+    Vals.push_back(FnIndex);
+    Vals.append(Callees.begin(), Callees.end());
+    Stream.EmitRecord(bitc::SUMMARY_CODE_CALLS, Vals);
+  }
 
   Stream.ExitBlock();
 }
@@ -2059,6 +2360,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   // Emit the module into the buffer.
   {
     BitstreamWriter Stream(Buffer);
+    uint64_t BitcodeStartBit = Stream.GetCurrentBitNo();
 
     // Emit the file header.
     Stream.Emit((unsigned)'B', 8);
@@ -2068,8 +2370,12 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     Stream.Emit(0xE, 4);
     Stream.Emit(0xD, 4);
 
+    // Emit the symbol summary, if asked to.
+    if (EmitSymbolSummary)
+      WriteSymbolSummary(M, Stream);
+
     // Emit the module.
-    WriteModule(M, Stream);
+    WriteModule(M, Stream, BitcodeStartBit);
   }
 
   if (TT.isOSDarwin())
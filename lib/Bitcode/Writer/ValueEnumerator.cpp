@@ -114,6 +114,17 @@ ValueEnumerator::ValueEnumerator(const Module *M) {
   OptimizeConstants(FirstConstant, Values.size());
 }
 
+ValueEnumerator::ValueEnumerator(const ValueEnumerator &Other)
+  : TypeMap(Other.TypeMap), Types(Other.Types), ValueMap(Other.ValueMap),
+    Values(Other.Values), MDValues(Other.MDValues),
+    MDValueMap(Other.MDValueMap), AttributeGroupMap(Other.AttributeGroupMap),
+    AttributeGroups(Other.AttributeGroups), AttributeMap(Other.AttributeMap),
+    Attribute(Other.Attribute), InstructionCount(0), NumModuleValues(0),
+    NumModuleMDValues(0), FirstFuncConstantID(0), FirstInstID(0) {
+  assert(Other.BasicBlocks.empty() && Other.FunctionLocalMDs.empty() &&
+         "Cannot copy an enumerator with a function incorporated!");
+}
+
 unsigned ValueEnumerator::getInstructionID(const Instruction *Inst) const {
   InstructionMapType::const_iterator I = InstructionMap.find(Inst);
   assert(I != InstructionMap.end() && "Instruction is not mapped!");
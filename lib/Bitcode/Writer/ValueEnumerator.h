@@ -83,11 +83,15 @@ private:
   unsigned FirstFuncConstantID;
   unsigned FirstInstID;
 
-  ValueEnumerator(const ValueEnumerator &) LLVM_DELETED_FUNCTION;
   void operator=(const ValueEnumerator &) LLVM_DELETED_FUNCTION;
 public:
   ValueEnumerator(const Module *M);
 
+  // Copying a ValueEnumerator that has no function incorporated gives an
+  // independent enumerator for the same module, so that function bodies can
+  // be encoded on several threads at once.
+  ValueEnumerator(const ValueEnumerator &Other);
+
   void dump() const;
   void print(raw_ostream &OS, const ValueMapType &Map, const char *Name) const;
 
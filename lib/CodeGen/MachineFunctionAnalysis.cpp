@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/MachineFunctionAnalysis.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/CodeGen/GCMetadata.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
@@ -27,6 +28,7 @@ MachineFunctionAnalysis::MachineFunctionAnalysis(const TargetMachine &tm) :
 MachineFunctionAnalysis::~MachineFunctionAnalysis() {
   releaseMemory();
   assert(!MF && "MachineFunctionAnalysis left initialized!");
+  DeleteContainerSeconds(Suspended);
 }
 
 void MachineFunctionAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
@@ -44,14 +46,44 @@ bool MachineFunctionAnalysis::doInitialization(Module &M) {
 
 
 bool MachineFunctionAnalysis::runOnFunction(Function &F) {
+  MachineFunction *NewMF =
+      new MachineFunction(&F, TM, NextFnNum++,
+                          getAnalysis<MachineModuleInfo>(),
+                          getAnalysisIfAvailable<GCModuleInfo>());
+  sys::ScopedLock Guard(Lock);
   assert(!MF && "MachineFunctionAnalysis already initialized!");
-  MF = new MachineFunction(&F, TM, NextFnNum++,
-                           getAnalysis<MachineModuleInfo>(),
-                           getAnalysisIfAvailable<GCModuleInfo>());
+  MF = NewMF;
   return false;
 }
 
 void MachineFunctionAnalysis::releaseMemory() {
+  sys::ScopedLock Guard(Lock);
   delete MF;
   MF = 0;
 }
+
+MachineFunction &MachineFunctionAnalysis::getMF(const Function &F) const {
+  sys::ScopedLock Guard(Lock);
+  if (MF && MF->getFunction() == &F)
+    return *MF;
+  MachineFunction *SuspendedMF = Suspended.lookup(&F);
+  assert(SuspendedMF && "No MachineFunction for this function!");
+  return *SuspendedMF;
+}
+
+void MachineFunctionAnalysis::suspendMF() {
+  sys::ScopedLock Guard(Lock);
+  assert(MF && "No MachineFunction to suspend!");
+  Suspended[MF->getFunction()] = MF;
+  MF = 0;
+}
+
+void MachineFunctionAnalysis::resumeMF(const Function &F) {
+  sys::ScopedLock Guard(Lock);
+  assert(!MF && "MachineFunctionAnalysis already initialized!");
+  DenseMap<const Function *, MachineFunction *>::iterator I =
+      Suspended.find(&F);
+  assert(I != Suspended.end() && "MachineFunction was not suspended!");
+  MF = I->second;
+  Suspended.erase(I);
+}
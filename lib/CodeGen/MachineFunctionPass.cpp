@@ -29,7 +29,7 @@ bool MachineFunctionPass::runOnFunction(Function &F) {
   if (F.hasAvailableExternallyLinkage())
     return false;
 
-  MachineFunction &MF = getAnalysis<MachineFunctionAnalysis>().getMF();
+  MachineFunction &MF = getAnalysis<MachineFunctionAnalysis>().getMF(F);
   return runOnMachineFunction(MF);
 }
 
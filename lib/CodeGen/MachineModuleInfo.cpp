@@ -253,12 +253,13 @@ void MMIAddrLabelMapCallbackPtr::allUsesReplacedWith(Value *V2) {
 MachineModuleInfo::MachineModuleInfo(const MCAsmInfo &MAI,
                                      const MCRegisterInfo &MRI,
                                      const MCObjectFileInfo *MOFI)
-  : ImmutablePass(ID), Context(&MAI, &MRI, MOFI, 0, false) {
+  : ImmutablePass(ID), Context(&MAI, &MRI, MOFI, 0, false),
+    Multithreaded(false) {
   initializeMachineModuleInfoPass(*PassRegistry::getPassRegistry());
 }
 
 MachineModuleInfo::MachineModuleInfo()
-  : ImmutablePass(ID), Context(0, 0, 0) {
+  : ImmutablePass(ID), Context(0, 0, 0), Multithreaded(false) {
   llvm_unreachable("This MachineModuleInfo constructor should never be called, "
                    "MMI should always be explicitly constructed by "
                    "LLVMTargetMachine");
@@ -270,10 +271,8 @@ MachineModuleInfo::~MachineModuleInfo() {
 bool MachineModuleInfo::doInitialization(Module &M) {
 
   ObjFileMMI = 0;
-  CompactUnwindEncoding = 0;
+  CurFn = FunctionInfo();
   CurCallSite = 0;
-  CallsEHReturn = 0;
-  CallsUnwindInit = 0;
   DbgInfoAvailable = UsesVAFloatArgument = false; 
   // Always emit some info, by default "no personality" info.
   Personalities.push_back(NULL);
@@ -301,19 +300,21 @@ bool MachineModuleInfo::doFinalization(Module &M) {
 /// EndFunction - Discard function meta information.
 ///
 void MachineModuleInfo::EndFunction() {
+  FunctionInfo &FI = fn();
+
   // Clean up frame info.
-  FrameInstructions.clear();
+  FI.FrameInstructions.clear();
 
   // Clean up exception info.
-  LandingPads.clear();
-  CallSiteMap.clear();
-  TypeInfos.clear();
-  FilterIds.clear();
-  FilterEnds.clear();
-  CallsEHReturn = 0;
-  CallsUnwindInit = 0;
-  CompactUnwindEncoding = 0;
-  VariableDbgInfo.clear();
+  FI.LandingPads.clear();
+  FI.CallSiteMap.clear();
+  FI.TypeInfos.clear();
+  FI.FilterIds.clear();
+  FI.FilterEnds.clear();
+  FI.CallsEHReturn = 0;
+  FI.CallsUnwindInit = 0;
+  FI.CompactUnwindEncoding = 0;
+  FI.VariableDbgInfo.clear();
 }
 
 /// AnalyzeModule - Scan the module for global debug information.
@@ -377,6 +378,7 @@ takeDeletedSymbolsForFunction(const Function *F,
 /// specified MachineBasicBlock.
 LandingPadInfo &MachineModuleInfo::getOrCreateLandingPadInfo
     (MachineBasicBlock *LandingPad) {
+  std::vector<LandingPadInfo> &LandingPads = fn().LandingPads;
   unsigned N = LandingPads.size();
   for (unsigned i = 0; i < N; ++i) {
     LandingPadInfo &LP = LandingPads[i];
@@ -457,6 +459,7 @@ void MachineModuleInfo::addCleanup(MachineBasicBlock *LandingPad) {
 /// TidyLandingPads - Remap landing pad labels and remove any deleted landing
 /// pads.
 void MachineModuleInfo::TidyLandingPads(DenseMap<MCSymbol*, uintptr_t> *LPMap) {
+  std::vector<LandingPadInfo> &LandingPads = fn().LandingPads;
   for (unsigned i = 0; i != LandingPads.size(); ) {
     LandingPadInfo &LandingPad = LandingPads[i];
     if (LandingPad.LandingPadLabel &&
@@ -509,6 +512,7 @@ void MachineModuleInfo::setCallSiteLandingPad(MCSymbol *Sym,
 /// getTypeIDFor - Return the type id for the specified typeinfo.  This is
 /// function wide.
 unsigned MachineModuleInfo::getTypeIDFor(const GlobalVariable *TI) {
+  std::vector<const GlobalVariable *> &TypeInfos = fn().TypeInfos;
   for (unsigned i = 0, N = TypeInfos.size(); i != N; ++i)
     if (TypeInfos[i] == TI) return i + 1;
 
@@ -519,6 +523,9 @@ unsigned MachineModuleInfo::getTypeIDFor(const GlobalVariable *TI) {
 /// getFilterIDFor - Return the filter id for the specified typeinfos.  This is
 /// function wide.
 int MachineModuleInfo::getFilterIDFor(std::vector<unsigned> &TyIds) {
+  std::vector<unsigned> &FilterIds = fn().FilterIds;
+  std::vector<unsigned> &FilterEnds = fn().FilterEnds;
+
   // If the new filter coincides with the tail of an existing filter, then
   // re-use the existing filter.  Folding filters more than this requires
   // re-ordering filters and/or their elements - probably not worth it.
@@ -550,6 +557,7 @@ try_next:;
 const Function *MachineModuleInfo::getPersonality() const {
   // FIXME: Until PR1414 will be fixed, we're using 1 personality function per
   // function
+  const std::vector<LandingPadInfo> &LandingPads = fn().LandingPads;
   return !LandingPads.empty() ? LandingPads[0].Personality : NULL;
 }
 
@@ -557,6 +565,7 @@ const Function *MachineModuleInfo::getPersonality() const {
 /// function. NULL/first personality function should always get zero index.
 unsigned MachineModuleInfo::getPersonalityIndex() const {
   const Function* Personality = NULL;
+  const std::vector<LandingPadInfo> &LandingPads = fn().LandingPads;
 
   // Scan landing pads. If there is at least one non-NULL personality - use it.
   for (unsigned i = 0, e = LandingPads.size(); i != e; ++i)
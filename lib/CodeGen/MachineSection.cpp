@@ -0,0 +1,249 @@
+//===-- MachineSection.cpp - Machine passes run on several functions ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the markers around the machine passes that run on
+// several functions at once.  Once instruction selection is done, the machine
+// passes up to prologue/epilogue insertion only look at their own
+// MachineFunction, so the pass manager can hand a batch of functions to
+// worker threads before emitting them in order.  The markers keep the
+// MachineFunctions and the per-function MachineModuleInfo state of the
+// functions in flight apart.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/CodeGen/MachineFunctionAnalysis.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/IR/LegacyPassManagers.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+namespace {
+/// PassCollector - Keeps the passes a TargetPassConfig adds instead of
+/// scheduling them.
+class PassCollector : public PassManagerBase {
+public:
+  SmallVector<Pass *, 64> Passes;
+
+  ~PassCollector() { DeleteContainerPointers(Passes); }
+
+  virtual void add(Pass *P) { Passes.push_back(P); }
+};
+
+/// MachineSectionBegin - Starts the section.  Only MachineFunctionAnalysis,
+/// which hands each thread the right MachineFunction, and the stack protector
+/// analysis, whose per-function results live side by side, carry over into
+/// it; everything else is recomputed by the workers.
+class MachineSectionBegin : public ParallelSectionPass {
+  LLVMTargetMachine *TM;
+  unsigned NumThreads;
+  MachineModuleInfo *MMI;
+
+  /// SameOptions - True if every function of the module asks for the same
+  /// target options.  Instruction selection resets the shared TargetOptions
+  /// from each function's attributes, and the passes in the section read
+  /// them, so functions that disagree cannot be in flight together.
+  bool SameOptions;
+
+  /// InFlight - The MachineModuleInfo function information of the functions
+  /// between enterSection and leaveSection.
+  DenseMap<const Function *, MachineModuleInfo::FunctionInfo *> InFlight;
+
+public:
+  MachineSectionBegin(LLVMTargetMachine *TM, unsigned NumThreads)
+    : ParallelSectionPass(/*IsBegin=*/true), TM(TM), NumThreads(NumThreads),
+      MMI(0), SameOptions(true) {}
+
+  ~MachineSectionBegin() { DeleteContainerSeconds(InFlight); }
+
+  virtual const char *getPassName() const {
+    return "Begin Parallel Machine Passes";
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<MachineFunctionAnalysis>();
+    AU.addRequired<MachineModuleInfo>();
+    AU.addPreserved<MachineFunctionAnalysis>();
+    AU.addPreserved("stack-protector");
+  }
+
+  virtual bool doInitialization(Module &M);
+
+  virtual unsigned getNumThreads() const {
+    return SameOptions ? NumThreads : 1;
+  }
+
+  virtual void createSectionPasses(ArrayRef<Pass *> Section,
+                                   SmallVectorImpl<Pass *> &Copies);
+  virtual void enterSection(Function &F);
+  virtual void beginWorker(Function &F);
+  virtual void endWorker(Function &F);
+  virtual void leaveSection(Function &F);
+};
+
+/// MachineSectionEnd - Ends the section.  The analyses computed by the
+/// workers stay with them, so it preserves only what the begin marker does.
+class MachineSectionEnd : public ParallelSectionPass {
+public:
+  MachineSectionEnd() : ParallelSectionPass(/*IsBegin=*/false) {}
+
+  virtual const char *getPassName() const {
+    return "End Parallel Machine Passes";
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addPreserved<MachineFunctionAnalysis>();
+    AU.addPreserved("stack-protector");
+  }
+
+  virtual unsigned getNumThreads() const { return 1; }
+};
+}
+
+/// occursIn - Return true if a pass of the same kind as P is in Passes.
+static bool occursIn(ArrayRef<Pass *> Passes, Pass *P) {
+  for (unsigned I = 0, E = Passes.size(); I != E; ++I)
+    if (Passes[I]->getPassID() == P->getPassID())
+      return true;
+  return false;
+}
+
+/// haveSameOptions - Return true if \p A and \p B set the target options
+/// that TargetMachine::resetTargetOptions reads alike.
+static bool haveSameOptions(const Function &A, const Function &B) {
+  static const char *const Options[] = {
+    "no-frame-pointer-elim", "less-precise-fpmad", "unsafe-fp-math",
+    "no-infs-fp-math", "no-nans-fp-math", "use-soft-float",
+    "disable-tail-calls"
+  };
+  for (unsigned I = 0; I != array_lengthof(Options); ++I) {
+    if (A.hasFnAttribute(Options[I]) != B.hasFnAttribute(Options[I]))
+      return false;
+    if (A.hasFnAttribute(Options[I]) &&
+        A.getAttributes()
+                .getAttribute(AttributeSet::FunctionIndex, Options[I])
+                .getValueAsString() !=
+            B.getAttributes()
+                .getAttribute(AttributeSet::FunctionIndex, Options[I])
+                .getValueAsString())
+      return false;
+  }
+  return true;
+}
+
+bool MachineSectionBegin::doInitialization(Module &M) {
+  SameOptions = true;
+  const Function *First = 0;
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (!First)
+      First = I;
+    else if (!haveSameOptions(*First, *I)) {
+      SameOptions = false;
+      break;
+    }
+  }
+  return false;
+}
+
+/// createSectionPasses - Passes the target adds may take constructor
+/// arguments and need not be in the pass registry, so build the machine
+/// pipeline once more and take the passes of its section.  Analyses the pass
+/// manager scheduled on its own come from the registry.
+void MachineSectionBegin::createSectionPasses(ArrayRef<Pass *> Section,
+                                              SmallVectorImpl<Pass *> &Copies) {
+  Copies.assign(Section.size(), 0);
+
+  PassCollector Collector;
+  OwningPtr<TargetPassConfig> PassConfig(TM->createPassConfig(Collector));
+  PassConfig->addMachinePasses();
+
+  SmallVectorImpl<Pass *> &Passes = Collector.Passes;
+  unsigned Next = 0, End = Passes.size();
+  for (unsigned I = 0, E = Passes.size(); I != E; ++I) {
+    if (Passes[I]->getPassID() != &ParallelSectionPass::ID)
+      continue;
+    if (static_cast<ParallelSectionPass *>(Passes[I])->isBegin())
+      Next = I + 1;
+    else
+      End = I;
+  }
+
+  // Walk both lists in step.  The section has analyses the pass manager
+  // scheduled in between, and lacks analyses that were added explicitly but
+  // found to be available already.
+  for (unsigned I = 0, E = Section.size(); I != E; ++I) {
+    while (Next != End && !occursIn(Section.slice(I), Passes[Next]))
+      ++Next;
+    if (Next != End && Passes[Next]->getPassID() == Section[I]->getPassID()) {
+      Copies[I] = Passes[Next];
+      Passes[Next++] = 0;
+    }
+  }
+}
+
+void MachineSectionBegin::enterSection(Function &F) {
+  getAnalysis<MachineFunctionAnalysis>().suspendMF();
+
+  MachineModuleInfo::FunctionInfo *&FI = InFlight[&F];
+  assert(!FI && "Function entered the section twice!");
+  FI = new MachineModuleInfo::FunctionInfo();
+  MMI = &getAnalysis<MachineModuleInfo>();
+  MMI->swapFunctionInfo(*FI);
+
+  // The workers create labels, e.g. for jump tables and the PIC base, and
+  // reach the information of their own function through thread-local
+  // storage.  A section run on one thread needs neither.
+  if (getNumThreads() > 1) {
+    MMI->getContext().setMultithreaded(true);
+    MMI->setMultithreaded(true);
+  }
+}
+
+void MachineSectionBegin::beginWorker(Function &F) {
+  MMI->setThreadFunctionInfo(InFlight.lookup(&F));
+}
+
+void MachineSectionBegin::endWorker(Function &F) {
+  MMI->setThreadFunctionInfo(0);
+}
+
+void MachineSectionBegin::leaveSection(Function &F) {
+  getAnalysis<MachineFunctionAnalysis>().resumeMF(F);
+
+  DenseMap<const Function *, MachineModuleInfo::FunctionInfo *>::iterator I =
+      InFlight.find(&F);
+  assert(I != InFlight.end() && "Function did not enter the section!");
+  MMI->swapFunctionInfo(*I->second);
+  delete I->second;
+  InFlight.erase(I);
+
+  // The workers are done with the batch once the first of its functions
+  // leaves the section, so the passes after it, AsmPrinter in particular,
+  // need not pay for the locking.
+  MMI->getContext().setMultithreaded(false);
+  MMI->setMultithreaded(false);
+}
+
+FunctionPass *llvm::createMachineSectionBeginPass(TargetMachine *TM,
+                                                  unsigned NumThreads) {
+  // Pass configurations only ever come from an LLVMTargetMachine.
+  return new MachineSectionBegin(static_cast<LLVMTargetMachine *>(TM),
+                                 NumThreads);
+}
+
+FunctionPass *llvm::createMachineSectionEndPass() {
+  return new MachineSectionEnd();
+}
@@ -24,6 +24,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
 #include "llvm/Transforms/Scalar.h"
@@ -98,6 +99,12 @@ PrintMachineInstrs("print-machineinstrs", cl::ValueOptional,
 static cl::opt<bool> MISchedPostRA("misched-postra", cl::Hidden,
   cl::desc("Run MachineScheduler post regalloc (independent of preRA sched)"));
 
+static cl::opt<unsigned> MachinePassThreads("machine-pass-threads", cl::Hidden,
+    cl::init(1),
+    cl::desc("Run the machine passes between instruction selection and "
+             "prologue/epilogue insertion on this many functions at once "
+             "(0 = one per hardware thread)"));
+
 // Experimental option to run live interval analysis early.
 static cl::opt<bool> EarlyLiveIntervals("early-live-intervals", cl::Hidden,
     cl::desc("Run live interval analysis earlier in the pipeline"));
@@ -496,6 +503,12 @@ void TargetPassConfig::addMachinePasses() {
   if (addPass(&ExpandISelPseudosID))
     printAndVerify("After ExpandISelPseudos");
 
+  // Everything up to prologue/epilogue insertion, which starts emitting frame
+  // information and symbols, only looks at the function at hand.
+  unsigned NumThreads = getMachinePassThreads();
+  if (NumThreads > 1)
+    addPass(createMachineSectionBeginPass(TM, NumThreads));
+
   // Add passes that optimize machine instructions in SSA form.
   if (getOptLevel() != CodeGenOpt::None) {
     addMachineSSAOptimization();
@@ -520,6 +533,9 @@ void TargetPassConfig::addMachinePasses() {
   if (addPostRegAlloc())
     printAndVerify("After PostRegAlloc passes");
 
+  if (NumThreads > 1)
+    addPass(createMachineSectionEndPass());
+
   // Insert prolog/epilog code.  Eliminate abstract frame index references...
   addPass(&PrologEpilogCodeInserterID);
   printAndVerify("After PrologEpilogCodeInserter");
@@ -562,6 +578,22 @@ void TargetPassConfig::addMachinePasses() {
     addPass(&StackMapLivenessID);
 }
 
+/// getMachinePassThreads - Return the number of functions the machine passes
+/// between instruction selection and prologue/epilogue insertion may work on
+/// at once.  Printing machine code, -debug output and partial pipelines keep
+/// them serial.
+unsigned TargetPassConfig::getMachinePassThreads() const {
+  if (TM->Options.PrintMachineCode || StartAfter || StopAfter ||
+      PrintMachineInstrs.getNumOccurrences())
+    return 1;
+#ifndef NDEBUG
+  if (DebugFlag)
+    return 1;
+#endif
+  return MachinePassThreads ? MachinePassThreads
+                            : ThreadPool::getDefaultThreadCount();
+}
+
 /// Add passes that optimize machine instructions in SSA form.
 void TargetPassConfig::addMachineSSAOptimization() {
   // Pre-ra tail duplication.
@@ -50,6 +50,7 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumOverBudget,   "Number of functions that ran out of budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode>
 SplitSpillMode("split-spill-mode", cl::Hidden,
@@ -71,6 +72,19 @@ static cl::opt<unsigned> LastChanceRecoloringMaxInterference(
              " interference at a time"),
     cl::init(8));
 
+static cl::opt<unsigned>
+BudgetPerInstr("regalloc-budget", cl::Hidden,
+               cl::desc("Work the greedy allocator may spend per machine "
+                        "instruction before it stops splitting global live "
+                        "ranges; twice that and it only assigns free "
+                        "registers or spills (0 = no limit)"),
+               cl::init(2000));
+
+static cl::opt<bool>
+ReportBudget("regalloc-report-budget", cl::Hidden,
+             cl::desc("Report the strategy the greedy allocator ended up "
+                      "using for each function"));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -105,6 +119,33 @@ class RAGreedy : public MachineFunctionPass,
   PQueue Queue;
   unsigned NextCascade;
 
+  // The allocator keeps track of the work it does on a function: interference
+  // checks, eviction attempts and blocks examined for splitting.  Splitting
+  // and eviction cascades can make that superlinear in the size of huge
+  // functions, so once the work crosses the budget, the allocator falls back
+  // to cheaper strategies for the rest of the function.
+  enum AllocStrategy {
+    /// Assign, evict, split and spill as usual.
+    AS_Full,
+
+    /// Only split live ranges local to a block; spill global ones.
+    AS_LocalSplit,
+
+    /// Assign a free register or spill, like a linear scan.  Eviction is
+    /// left to unspillable live ranges, which have no other way out.
+    AS_AssignOrSpill
+  };
+
+  static const char *const StrategyName[];
+
+  AllocStrategy Strategy;
+  uint64_t Work;
+  uint64_t Budget;
+
+  /// chargeWork - Account for Units of work and fall back to a cheaper
+  /// strategy when the budget runs out.
+  void chargeWork(unsigned Units);
+
   // Live ranges pass through a number of stages as we try to allocate them.
   // Some of the stages may also create new live ranges:
   //
@@ -326,6 +367,12 @@ private:
 
 char RAGreedy::ID = 0;
 
+const char *const RAGreedy::StrategyName[] = {
+    "full",
+    "local-split",
+    "assign-or-spill"
+};
+
 #ifndef NDEBUG
 const char *const RAGreedy::StageName[] = {
     "RS_New",
@@ -434,6 +481,18 @@ void RAGreedy::releaseMemory() {
   GlobalCand.clear();
 }
 
+void RAGreedy::chargeWork(unsigned Units) {
+  Work += Units;
+  if (!Budget || Strategy == AS_AssignOrSpill || Work <= Budget)
+    return;
+  if (Strategy == AS_Full)
+    ++NumOverBudget;
+  Strategy = Work > 2 * Budget ? AS_AssignOrSpill : AS_LocalSplit;
+  DEBUG(dbgs() << "Used " << Work << " of " << Budget
+               << " work units, switching to " << StrategyName[Strategy]
+               << " allocation\n");
+}
+
 void RAGreedy::enqueue(LiveInterval *LI) { enqueue(Queue, LI); }
 
 void RAGreedy::enqueue(PQueue &CurQueue, LiveInterval *LI) {
@@ -512,11 +571,14 @@ unsigned RAGreedy::tryAssign(LiveInterval &VirtReg,
                              AllocationOrder &Order,
                              SmallVectorImpl<unsigned> &NewVRegs) {
   Order.rewind();
-  unsigned PhysReg;
-  while ((PhysReg = Order.next()))
+  unsigned PhysReg, Checked = 0;
+  while ((PhysReg = Order.next())) {
+    ++Checked;
     if (!Matrix->checkInterference(VirtReg, PhysReg))
       break;
-  if (!PhysReg || Order.isHint())
+  }
+  chargeWork(Checked);
+  if (!PhysReg || Order.isHint() || Strategy == AS_AssignOrSpill)
     return PhysReg;
 
   // PhysReg is available, but there may be a better choice.
@@ -638,7 +700,9 @@ bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
     LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
     // If there is 10 or more interferences, chances are one is heavier.
-    if (Q.collectInterferingVRegs(10) >= 10)
+    unsigned NumIntf = Q.collectInterferingVRegs(10);
+    chargeWork(NumIntf + 1);
+    if (NumIntf >= 10)
       return false;
 
     // Check if any interfering live range is heavier than MaxWeight.
@@ -1814,15 +1878,22 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   if (LIS->intervalIsInOneMBB(VirtReg)) {
     NamedRegionTimer T("Local Splitting", TimerGroupName, TimePassesIsEnabled);
     SA->analyze(&VirtReg);
+    chargeWork(SA->getUseSlots().size() * Order.getOrder().size());
     unsigned PhysReg = tryLocalSplit(VirtReg, Order, NewVRegs);
     if (PhysReg || !NewVRegs.empty())
       return PhysReg;
     return tryInstructionSplit(VirtReg, Order, NewVRegs);
   }
 
+  // Global splitting is what goes superlinear on huge functions.
+  if (Strategy != AS_Full)
+    return 0;
+
   NamedRegionTimer T("Global Splitting", TimerGroupName, TimePassesIsEnabled);
 
   SA->analyze(&VirtReg);
+  chargeWork((SA->getUseBlocks().size() + SA->getNumThroughBlocks()) *
+             Order.getOrder().size());
 
   // FIXME: SplitAnalysis may repair broken live ranges coming from the
   // coalescer. That may cause the range to become allocatable which means that
@@ -2089,7 +2160,8 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
   // Try to evict a less worthy live range, but only for ranges from the primary
   // queue. The RS_Split ranges already failed to do this, and they should not
   // get a second chance until they have been split.
-  if (Stage != RS_Split)
+  bool MayEvict = Strategy != AS_AssignOrSpill || !VirtReg.isSpillable();
+  if (Stage != RS_Split && MayEvict)
     if (unsigned PhysReg = tryEvict(VirtReg, Order, NewVRegs))
       return PhysReg;
 
@@ -2098,7 +2170,7 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
   // The first time we see a live range, don't try to split or spill.
   // Wait until the second time, when all smaller ranges have been allocated.
   // This gives a better picture of the interference to split around.
-  if (Stage < RS_Split) {
+  if (Stage < RS_Split && Strategy != AS_AssignOrSpill) {
     setStage(VirtReg, RS_Split);
     DEBUG(dbgs() << "wait for second round\n");
     NewVRegs.push_back(VirtReg.reg);
@@ -2112,9 +2184,11 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
                                    Depth);
 
   // Try splitting VirtReg or interferences.
-  unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs);
-  if (PhysReg || !NewVRegs.empty())
-    return PhysReg;
+  if (Strategy != AS_AssignOrSpill) {
+    unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs);
+    if (PhysReg || !NewVRegs.empty())
+      return PhysReg;
+  }
 
   // Finally spill VirtReg itself.
   NamedRegionTimer T("Spiller", TimerGroupName, TimePassesIsEnabled);
@@ -2165,7 +2239,22 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
 
+  Strategy = AS_Full;
+  Work = 0;
+  Budget = 0;
+  if (BudgetPerInstr) {
+    uint64_t NumInstrs = 0;
+    for (MachineFunction::const_iterator I = MF->begin(), E = MF->end();
+         I != E; ++I)
+      NumInstrs += I->size();
+    Budget = BudgetPerInstr * NumInstrs;
+  }
+
   allocatePhysRegs();
+
+  if (ReportBudget)
+    errs() << "regalloc: " << mf.getName() << ": " << StrategyName[Strategy]
+           << " allocation, " << Work << " of " << Budget << " work units\n";
   releaseMemory();
   return true;
 }
@@ -14,7 +14,9 @@
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -296,6 +298,65 @@ DWARFContext::getLineTableForCompileUnit(DWARFCompileUnit *cu) {
   return Line->getOrParseLineTable(lineData, stmtOffset);
 }
 
+void DWARFContext::preload(unsigned NumThreads) {
+  // Unit headers are cheap to read, and each one gives the offset of the
+  // next, so this part stays serial.
+  unsigned NumCUs = getNumCompileUnits();
+  if (!Line)
+    Line.reset(new DWARFDebugLine(&getLineSection().Relocs));
+
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  NumThreads = std::min(NumThreads, NumCUs);
+
+  // The line table cache is not thread-safe, so each unit's table is parsed
+  // into a slot of its own and cached afterwards.
+  const Section &LineSection = getLineSection();
+  std::vector<DWARFDebugLine::State> LineTables(NumCUs);
+  std::vector<uint32_t> LineTableOffsets(NumCUs, -1U);
+  volatile sys::cas_flag NextCU = 0;
+  auto ParseUnits = [&] {
+    while (true) {
+      unsigned i = sys::AtomicIncrement(&NextCU) - 1;
+      if (i >= NumCUs)
+        break;
+      DWARFCompileUnit *CU = CUs[i];
+      CU->buildSubprogramIndex();
+
+      uint32_t StmtOffset =
+          CU->getCompileUnitDIE()->getAttributeValueAsSectionOffset(
+              CU, DW_AT_stmt_list, -1U);
+      if (StmtOffset == -1U || Line->getLineTable(StmtOffset))
+        continue;
+      DataExtractor LineData(LineSection.Data, isLittleEndian(),
+                             CU->getAddressByteSize());
+      uint32_t Offset = StmtOffset;
+      // A table that fails to parse is cached empty, as the lazy path ends
+      // up doing, so that queries never have to modify the cache.
+      if (!DWARFDebugLine::parseStatementTable(LineData, &LineSection.Relocs,
+                                               &Offset, LineTables[i]))
+        LineTables[i].LineTable::clear();
+      LineTableOffsets[i] = StmtOffset;
+    }
+  };
+  if (NumThreads > 1) {
+    ThreadPool Pool(NumThreads);
+    for (unsigned i = 0; i != NumThreads; ++i)
+      Pool.async(ParseUnits);
+    Pool.wait();
+  } else {
+    ParseUnits();
+  }
+
+  for (unsigned i = 0; i != NumCUs; ++i)
+    if (LineTableOffsets[i] != -1U)
+      Line->addLineTable(LineTableOffsets[i], LineTables[i]);
+
+  // The units are indexed now, so this no longer walks their DIEs.
+  Aranges.reset(new DWARFDebugAranges());
+  Aranges->generate(this);
+}
+
 void DWARFContext::parseCompileUnits() {
   uint32_t offset = 0;
   const DataExtractor &DIData = DataExtractor(getInfoSection().Data,
@@ -73,6 +73,10 @@ public:
 
   virtual void dump(raw_ostream &OS, DIDumpType DumpType = DIDT_All);
 
+  /// Parse the DIEs and line tables of all compile units on a thread pool and
+  /// index their subprograms and address ranges.
+  virtual void preload(unsigned NumThreads);
+
   /// Get the number of compile units in this context.
   unsigned getNumCompileUnits() {
     if (CUs.empty())
@@ -165,6 +165,19 @@ DWARFDebugLine::getOrParseLineTable(DataExtractor debug_line_data,
   return &pos.first->second;
 }
 
+const DWARFDebugLine::LineTable *
+DWARFDebugLine::addLineTable(uint32_t offset, LineTable &Table) {
+  std::pair<LineTableIter, bool> pos =
+    LineTableMap.insert(LineTableMapTy::value_type(offset, LineTable()));
+  if (pos.second) {
+    LineTable &Cached = pos.first->second;
+    Cached.Prologue = Table.Prologue;
+    Cached.Rows.swap(Table.Rows);
+    Cached.Sequences.swap(Table.Sequences);
+  }
+  return &pos.first->second;
+}
+
 bool
 DWARFDebugLine::parsePrologue(DataExtractor debug_line_data,
                               uint32_t *offset_ptr, Prologue *prologue) {
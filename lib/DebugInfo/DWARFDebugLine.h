@@ -246,6 +246,10 @@ public:
   const LineTable *getLineTable(uint32_t offset) const;
   const LineTable *getOrParseLineTable(DataExtractor debug_line_data,
                                        uint32_t offset);
+  /// Cache \p Table, which was parsed from \p offset, unless a table has
+  /// already been cached for that offset.  The contents of \p Table are
+  /// moved into the cache.
+  const LineTable *addLineTable(uint32_t offset, LineTable &Table);
 
 private:
   typedef std::map<uint32_t, LineTable> LineTableMapTy;
@@ -71,6 +71,7 @@ public:
   /// address. Has to be passed base address of the compile unit that
   /// references this range list.
   bool containsAddress(uint64_t BaseAddress, uint64_t Address) const;
+  const std::vector<RangeListEntry> &getEntries() const { return Entries; }
 };
 
 }  // namespace llvm
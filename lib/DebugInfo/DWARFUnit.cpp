@@ -12,6 +12,7 @@
 #include "llvm/DebugInfo/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace llvm;
@@ -282,6 +283,9 @@ bool DWARFUnit::parseDWO() {
 }
 
 void DWARFUnit::clearDIEs(bool KeepCUDie) {
+  // The index refers to the DIEs by position.
+  SubprogramIndex.clear();
+  HasSubprogramIndex = false;
   if (DieArray.size() > (unsigned)KeepCUDie) {
     // std::vectors never get any smaller when resized to a smaller size,
     // or when clear() or erase() are called, the size will report that it
@@ -310,7 +314,13 @@ DWARFUnit::buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
   // down.
   const bool clear_dies = extractDIEsIfNeeded(false) > 1 &&
                           clear_dies_if_already_not_parsed;
-  DieArray[0].buildAddressRangeTable(this, debug_aranges, CUOffsetInAranges);
+  if (HasSubprogramIndex) {
+    for (size_t i = 0, n = SubprogramIndex.size(); i != n; ++i)
+      debug_aranges->appendRange(CUOffsetInAranges, SubprogramIndex[i].LowPC,
+                                 SubprogramIndex[i].HighPC);
+  } else {
+    DieArray[0].buildAddressRangeTable(this, debug_aranges, CUOffsetInAranges);
+  }
   bool DWOCreated = parseDWO();
   if (DWO.get()) {
     // If there is a .dwo file for this compile unit, then skeleton CU DIE
@@ -328,8 +338,76 @@ DWARFUnit::buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
     clearDIEs(true);
 }
 
+void DWARFUnit::buildSubprogramIndex() {
+  if (HasSubprogramIndex)
+    return;
+  extractDIEsIfNeeded(false);
+
+  for (size_t i = 0, n = DieArray.size(); i != n; ++i) {
+    const DWARFDebugInfoEntryMinimal &DIE = DieArray[i];
+    if (!DIE.isSubprogramDIE())
+      continue;
+    SubprogramRange Range;
+    Range.DIEIndex = i;
+    if (DIE.getLowAndHighPC(this, Range.LowPC, Range.HighPC)) {
+      if (Range.LowPC < Range.HighPC)
+        SubprogramIndex.push_back(Range);
+      continue;
+    }
+
+    uint32_t RangesOffset =
+        DIE.getAttributeValueAsSectionOffset(this, DW_AT_ranges, -1U);
+    DWARFDebugRangeList RangeList;
+    if (RangesOffset == -1U || !extractRangeList(RangesOffset, RangeList))
+      continue;
+    uint64_t BaseAddress = getBaseAddress();
+    const std::vector<DWARFDebugRangeList::RangeListEntry> &Entries =
+        RangeList.getEntries();
+    for (size_t j = 0, e = Entries.size(); j != e; ++j) {
+      if (Entries[j].isBaseAddressSelectionEntry(getAddressByteSize())) {
+        BaseAddress = Entries[j].EndAddress;
+        continue;
+      }
+      Range.LowPC = BaseAddress + Entries[j].StartAddress;
+      Range.HighPC = BaseAddress + Entries[j].EndAddress;
+      if (Range.LowPC < Range.HighPC)
+        SubprogramIndex.push_back(Range);
+    }
+  }
+
+  std::stable_sort(SubprogramIndex.begin(), SubprogramIndex.end());
+  uint64_t MaxHighPC = 0;
+  for (size_t i = 0, n = SubprogramIndex.size(); i != n; ++i) {
+    MaxHighPC = std::max(MaxHighPC, SubprogramIndex[i].HighPC);
+    SubprogramIndex[i].MaxHighPC = MaxHighPC;
+  }
+  HasSubprogramIndex = true;
+
+  parseDWO();
+  if (DWO.get())
+    DWO->getUnit()->buildSubprogramIndex();
+}
+
 const DWARFDebugInfoEntryMinimal *
 DWARFUnit::getSubprogramForAddress(uint64_t Address) {
+  if (HasSubprogramIndex) {
+    SubprogramRange Key;
+    Key.LowPC = Address;
+    std::vector<SubprogramRange>::const_iterator I =
+        std::upper_bound(SubprogramIndex.begin(), SubprogramIndex.end(), Key);
+    // Of the ranges containing the address, prefer the subprogram that comes
+    // first in the DIE tree, as the linear search below does.
+    const SubprogramRange *Found = 0;
+    while (I != SubprogramIndex.begin()) {
+      --I;
+      if (I->MaxHighPC <= Address)
+        break;
+      if (Address < I->HighPC && (!Found || I->DIEIndex < Found->DIEIndex))
+        Found = &*I;
+    }
+    return Found ? &DieArray[Found->DIEIndex] : 0;
+  }
+
   extractDIEsIfNeeded(false);
   for (size_t i = 0, n = DieArray.size(); i != n; i++)
     if (DieArray[i].isSubprogramDIE() &&
@@ -349,8 +427,10 @@ DWARFUnit::getInlinedChainForAddress(uint64_t Address) {
   if (SubprogramDIE) {
     ChainCU = this;
   } else {
-    // Try to look for subprogram DIEs in the DWO file.
-    parseDWO();
+    // Try to look for subprogram DIEs in the DWO file.  An indexed unit has
+    // already tried to load it.
+    if (!HasSubprogramIndex)
+      parseDWO();
     if (DWO.get()) {
       SubprogramDIE = DWO->getUnit()->getSubprogramForAddress(Address);
       if (SubprogramDIE)
@@ -59,6 +59,24 @@ class DWARFUnit {
   };
   OwningPtr<DWOHolder> DWO;
 
+  /// An address range of a subprogram DIE.  MaxHighPC is the largest HighPC
+  /// of this and all preceding ranges in the index, which bounds how far
+  /// back a lookup has to search.
+  struct SubprogramRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    uint64_t MaxHighPC;
+    uint32_t DIEIndex;
+
+    bool operator<(const SubprogramRange &RHS) const {
+      return LowPC < RHS.LowPC;
+    }
+  };
+  /// The address ranges of all subprograms, sorted by LowPC, once
+  /// buildSubprogramIndex has been called.
+  std::vector<SubprogramRange> SubprogramIndex;
+  bool HasSubprogramIndex;
+
 protected:
   virtual bool extractImpl(DataExtractor debug_info, uint32_t *offset_ptr);
 
@@ -134,6 +152,13 @@ public:
                               bool clear_dies_if_already_not_parsed,
                               uint32_t CUOffsetInAranges);
 
+  /// buildSubprogramIndex - Parses all DIEs of this unit, and of its .dwo
+  /// unit if it has one, and indexes the address ranges of its subprograms.
+  /// Address lookups and buildAddressRangeTable then use the index instead of
+  /// walking the DIEs.  Units do not share any lazily built state, so
+  /// different units may be indexed on different threads.
+  void buildSubprogramIndex();
+
   /// getInlinedChainForAddress - fetches inlined chain for a given address.
   /// Returns empty chain if there is no subprogram containing address. The
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
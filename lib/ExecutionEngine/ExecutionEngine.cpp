@@ -64,6 +64,7 @@ ExecutionEngine::ExecutionEngine(Module *M)
   : EEState(*this),
     LazyFunctionCreator(0) {
   CompilingLazily         = false;
+  SplittingModulesLazily  = false;
   GVCompilationDisabled   = false;
   SymbolSearchingDisabled = false;
   Modules.push_back(M);
@@ -0,0 +1,211 @@
+//===-- FileObjectCache.cpp - On-disk object cache for MCJIT --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements FileObjectCache, an ObjectCache that keeps the objects
+// MCJIT generates in a directory shared between runs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+
+using namespace llvm;
+
+/// getCodeGenConfig - Describe everything about \p TM that can change the
+/// object it generates for a given module.
+static std::string getCodeGenConfig(const TargetMachine *TM) {
+  std::string Config;
+  raw_string_ostream OS(Config);
+  OS << "LLVM " PACKAGE_VERSION "\n";
+  if (!TM)
+    return OS.str();
+
+  const TargetOptions &Opts = TM->Options;
+  OS << TM->getTargetTriple() << '\n'
+     << TM->getTargetCPU() << '\n'
+     << TM->getTargetFeatureString() << '\n'
+     << TM->getRelocationModel() << ' ' << TM->getCodeModel() << ' '
+     << TM->getOptLevel() << '\n'
+     << Opts.NoFramePointerElim << Opts.LessPreciseFPMADOption
+     << Opts.UnsafeFPMath << Opts.NoInfsFPMath << Opts.NoNaNsFPMath
+     << Opts.HonorSignDependentRoundingFPMathOption << Opts.UseSoftFloat
+     << Opts.NoZerosInBSS << Opts.JITEmitDebugInfo
+     << Opts.GuaranteedTailCallOpt << Opts.DisableTailCalls
+     << Opts.EnableFastISel << Opts.PositionIndependentExecutable
+     << Opts.EnableSegmentedStacks << Opts.UseInitArray << ' '
+     << Opts.StackAlignmentOverride << ' ' << Opts.FloatABIType << ' '
+     << Opts.AllowFPOpFusion << ' ' << Opts.TrapFuncName << '\n';
+  return OS.str();
+}
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, const TargetMachine *TM,
+                                 uint64_t MaxSize)
+  : CacheDir(CacheDir), CodeGenConfig(getCodeGenConfig(TM)),
+    MaxSize(MaxSize) {
+  // A failure here shows up as cache misses and failed writes later on.
+  sys::fs::create_directories(CacheDir);
+}
+
+FileObjectCache::~FileObjectCache() {}
+
+std::string FileObjectCache::getCacheKey(const Module *M) const {
+  SmallString<256> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  MD5 Hash;
+  Hash.update(CodeGenConfig);
+  // The triple is part of the bitcode, but a module without one is compiled
+  // for whatever the TargetMachine targets, which is hashed above.
+  Hash.update(M->getTargetTriple());
+  Hash.update(Bitcode.str());
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+void FileObjectCache::getObjectPath(StringRef Key,
+                                    SmallVectorImpl<char> &Path) const {
+  Path.clear();
+  Path.append(CacheDir.begin(), CacheDir.end());
+  sys::path::append(Path, Key + ".o");
+}
+
+MemoryBuffer *FileObjectCache::getObject(const Module *M) {
+  std::string Key = getCacheKey(M);
+  SmallString<128> Path;
+  getObjectPath(Key, Path);
+
+  OwningPtr<MemoryBuffer> Obj;
+  if (MemoryBuffer::getFile(Path.str(), Obj, -1, false)) {
+    // Remember the key for when the compiled object comes back to us.
+    sys::ScopedLock Guard(PendingKeysLock);
+    PendingKeys[M] = Key;
+    return 0;
+  }
+
+  // Mark the object as recently used, for the benefit of prune().  Objects
+  // are only ever replaced by rename, so this cannot corrupt them.
+  int FD;
+  if (!sys::fs::openFileForWrite(Path.str(), FD, sys::fs::F_Append)) {
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+    raw_fd_ostream Closer(FD, /*shouldClose=*/true);
+  }
+
+  return Obj.take();
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           const MemoryBuffer *Obj) {
+  std::string Key;
+  {
+    sys::ScopedLock Guard(PendingKeysLock);
+    DenseMap<const Module *, std::string>::iterator I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = I->second;
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getCacheKey(M);
+
+  SmallString<128> Path;
+  getObjectPath(Key, Path);
+
+  // If another process is writing the same object, let it finish the job.
+  LockFileManager Locker(Path);
+  if (Locker != LockFileManager::LFS_Owned)
+    return;
+
+  // Write to a temporary file and rename it into place, so that readers
+  // that do not take the lock never see a partial object.
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(Twine(Path) + "-%%%%%%%%.tmp", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Obj->getBuffer();
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath.str(), Path.str())) {
+    sys::fs::remove(TempPath.str());
+    return;
+  }
+
+  if (MaxSize)
+    prune();
+}
+
+namespace {
+struct CacheEntry {
+  std::string Path;
+  uint64_t Size;
+  sys::TimeValue LastUsed;
+
+  bool operator<(const CacheEntry &RHS) const {
+    return LastUsed < RHS.LastUsed;
+  }
+};
+}
+
+void FileObjectCache::prune() {
+  if (!MaxSize)
+    return;
+
+  // Only one process needs to prune at a time.
+  SmallString<128> PruneLock(CacheDir);
+  sys::path::append(PruneLock, "prune");
+  LockFileManager Locker(PruneLock);
+  if (Locker != LockFileManager::LFS_Owned)
+    return;
+
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir.str(), EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (sys::path::extension(I->path()) != ".o")
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status) || Status.type() != sys::fs::file_type::regular_file)
+      continue;
+    CacheEntry Entry;
+    Entry.Path = I->path();
+    Entry.Size = Status.getSize();
+    Entry.LastUsed = Status.getLastModificationTime();
+    Entries.push_back(Entry);
+    TotalSize += Entry.Size;
+  }
+
+  // Evict the least recently used objects first.
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned i = 0, e = Entries.size(); i != e && TotalSize > MaxSize; ++i)
+    if (!sys::fs::remove(Entries[i].Path))
+      TotalSize -= Entries[i].Size;
+}
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCJIT.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
@@ -18,6 +19,7 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmInfo.h"
@@ -28,6 +30,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
 #include "llvm/Target/TargetLowering.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
 using namespace llvm;
 
@@ -42,6 +45,15 @@ static struct RegisterJIT {
 extern "C" void LLVMLinkInMCJIT() {
 }
 
+// Lazy stubs refer to the engine and its compile callback through these
+// symbols, rather than by address, so that the objects stay cacheable.
+static const char LazyCompileName[] = "__llvm_mcjit_lazy_compile";
+static const char LazyEngineName[] = "__llvm_mcjit_lazy_engine";
+
+static void *LazyCompileCallback(MCJIT *Engine, unsigned Id) {
+  return (void *)(uintptr_t)Engine->compileLazyFunction(Id);
+}
+
 ExecutionEngine *MCJIT::createJIT(Module *M,
                                   std::string *ErrorStr,
                                   RTDyldMemoryManager *MemMgr,
@@ -59,7 +71,7 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
   : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(this, MM), Dyld(&MemMgr),
-    ObjCache(0) {
+    ObjCache(0), NumLazyModules(0) {
 
   OwnedModules.addModule(m);
   setDataLayout(TM->getDataLayout());
@@ -98,6 +110,11 @@ MCJIT::~MCJIT() {
   }
   Archives.clear();
 
+  // Bodies that were never called are still ours to delete.
+  for (unsigned i = 0, e = LazyFunctions.size(); i != e; ++i)
+    if (!OwnedModules.ownsModule(LazyFunctions[i].Body))
+      delete LazyFunctions[i].Body;
+
   delete TM;
 }
 
@@ -183,6 +200,12 @@ void MCJIT::generateCodeForModule(Module *M) {
   if (OwnedModules.hasModuleBeenLoaded(M))
     return;
 
+  // Leave stubs behind for the function bodies; they are compiled one at a
+  // time as they are first called.  Objects that go into a cache must stand
+  // on their own, without the bodies this engine holds on to.
+  if (isSplittingModulesLazily() && !ObjCache && !LazyBodies.count(M))
+    emitLazyStubs(M);
+
   OwningPtr<ObjectBuffer> ObjectToLoad;
   // Try to load the pre-compiled object from cache if possible
   if (0 != ObjCache) {
@@ -212,6 +235,217 @@ void MCJIT::generateCodeForModule(Module *M) {
   OwnedModules.markModuleAsLoaded(M);
 }
 
+/// canCompileLazily - Return true if the body of \p F can be moved out of its
+/// module and replaced by a stub that forwards every call to it.
+static bool canCompileLazily(const Function &F) {
+  if (F.isDeclaration() || F.hasAvailableExternallyLinkage() ||
+      F.isVarArg() || F.hasPrefixData())
+    return false;
+  // The stub would get in the way of these.
+  if (F.hasFnAttribute(Attribute::Naked) ||
+      F.hasFnAttribute(Attribute::ReturnsTwice) ||
+      F.getAttributes().hasAttrSomewhere(Attribute::InAlloca))
+    return false;
+  // blockaddress constants refer to the function's own blocks.
+  for (Function::const_iterator I = F.begin(), E = F.end(); I != E; ++I)
+    if (I->hasAddressTaken())
+      return false;
+  return true;
+}
+
+namespace {
+/// Declares, in a lazily compiled body's module, the globals the body uses
+/// from the module it was taken out of.
+class LazyBodyMaterializer : public ValueMaterializer {
+  Module *Dest;
+
+public:
+  LazyBodyMaterializer(Module *Dest) : Dest(Dest) {}
+
+  virtual Value *materializeValueFor(Value *V) {
+    GlobalValue *GV = dyn_cast<GlobalValue>(V);
+    if (!GV)
+      return 0;
+    Type *Ty = GV->getType()->getElementType();
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty)) {
+      Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                     GV->getName(), Dest);
+      if (Function *Src = dyn_cast<Function>(GV))
+        F->copyAttributesFrom(Src);
+      return F;
+    }
+    GlobalVariable *Src = dyn_cast<GlobalVariable>(GV);
+    return new GlobalVariable(
+        *Dest, Ty, Src && Src->isConstant(), GlobalValue::ExternalLinkage, 0,
+        GV->getName(), 0,
+        Src ? Src->getThreadLocalMode() : GlobalVariable::NotThreadLocal,
+        GV->getType()->getAddressSpace());
+  }
+};
+}
+
+void MCJIT::emitLazyStubs(Module *M) {
+  // Stubs and bodies end up in different objects, which the small code
+  // models cannot expect to be placed near each other.
+  CodeModel::Model CM = TM->getCodeModel();
+  if (CM == CodeModel::Small || CM == CodeModel::Kernel)
+    return;
+
+  SmallVector<Function *, 16> Lazy;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    if (canCompileLazily(*I))
+      Lazy.push_back(I);
+  if (Lazy.empty())
+    return;
+
+  // The bodies refer back to this module's globals by name once they are
+  // moved out, so local symbols have to become visible to the linker.  The
+  // prefix keeps them apart from those of other modules, and from the
+  // assembler's private label prefix.  RuntimeDyld keeps common symbols to
+  // the object that defines them, so those become ordinary definitions.
+  std::string Prefix = "lazy" + utostr(NumLazyModules++) + ".";
+  SmallVector<GlobalValue *, 16> Locals;
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    Locals.push_back(I);
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    Locals.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    Locals.push_back(I);
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    GlobalValue *GV = Locals[i];
+    if (GV->hasCommonLinkage()) {
+      GV->setLinkage(GlobalValue::ExternalLinkage);
+      continue;
+    }
+    if (!GV->hasLocalLinkage() || GV->getName().startswith("llvm."))
+      continue;
+    GV->setName(Prefix + GV->getName());
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  LLVMContext &Context = M->getContext();
+  Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+  // The engine's address is loaded from memory, rather than used as an
+  // immediate, so that it need not fit the code model.
+  Constant *EngineSym = M->getOrInsertGlobal(LazyEngineName,
+                                             Type::getInt8Ty(Context));
+  GlobalVariable *Engine =
+      new GlobalVariable(*M, Int8PtrTy, true, GlobalValue::InternalLinkage,
+                         EngineSym, "lazy.engine");
+  Constant *Compile = M->getOrInsertFunction(LazyCompileName, Int8PtrTy,
+                                             Int8PtrTy,
+                                             Type::getInt32Ty(Context),
+                                             (Type *)0);
+  unsigned PtrAlign = TM->getDataLayout()->getPointerABIAlignment();
+
+  for (unsigned i = 0, e = Lazy.size(); i != e; ++i) {
+    Function *F = Lazy[i];
+    unsigned Id = LazyFunctions.size();
+
+    // Move the body into a function of its own module...
+    Module *Body =
+        new Module((M->getModuleIdentifier() + "." + F->getName()).str(),
+                   Context);
+    Body->setTargetTriple(M->getTargetTriple());
+    Body->setDataLayout(M->getDataLayoutStr());
+    Function *Impl = Function::Create(F->getFunctionType(),
+                                      GlobalValue::ExternalLinkage,
+                                      F->getName() + ".lazy.impl", Body);
+    Impl->copyAttributesFrom(F);
+    Impl->setVisibility(GlobalValue::DefaultVisibility);
+    Impl->getBasicBlockList().splice(Impl->end(), F->getBasicBlockList());
+    for (Function::arg_iterator I = F->arg_begin(), E = F->arg_end(),
+                                J = Impl->arg_begin();
+         I != E; ++I, ++J) {
+      I->replaceAllUsesWith(J);
+      J->takeName(I);
+    }
+    ValueToValueMapTy VMap;
+    LazyBodyMaterializer Materializer(Body);
+    for (Function::iterator BB = Impl->begin(), BE = Impl->end(); BB != BE;
+         ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        RemapInstruction(I, VMap,
+                         RF_IgnoreMissingEntries | RF_NoModuleLevelChanges, 0,
+                         &Materializer);
+
+    // ...and leave a stub behind that compiles it on the first call and
+    // forwards every call to it:
+    //
+    //   %fn = load atomic @F.lazy.ptr
+    //   if (!%fn) store atomic (%fn = __llvm_mcjit_lazy_compile(engine, Id))
+    //   tail call %fn(args...)
+    GlobalVariable *Slot = new GlobalVariable(
+        *M, F->getType(), false, GlobalValue::InternalLinkage,
+        ConstantPointerNull::get(F->getType()), F->getName() + ".lazy.ptr");
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+    BasicBlock *CompileBB = BasicBlock::Create(Context, "compile", F);
+    BasicBlock *CallBB = BasicBlock::Create(Context, "call", F);
+
+    IRBuilder<> Builder(Entry);
+    LoadInst *Cached = Builder.CreateLoad(Slot);
+    Cached->setAtomic(Acquire);
+    Cached->setAlignment(PtrAlign);
+    Builder.CreateCondBr(Builder.CreateIsNull(Cached), CompileBB, CallBB);
+
+    Builder.SetInsertPoint(CompileBB);
+    Value *Addr = Builder.CreateCall2(Compile, Builder.CreateLoad(Engine),
+                                      Builder.getInt32(Id));
+    Value *Compiled = Builder.CreateBitCast(Addr, F->getType());
+    StoreInst *Store = Builder.CreateStore(Compiled, Slot);
+    Store->setAtomic(Release);
+    Store->setAlignment(PtrAlign);
+    Builder.CreateBr(CallBB);
+
+    Builder.SetInsertPoint(CallBB);
+    PHINode *Target = Builder.CreatePHI(F->getType(), 2);
+    Target->addIncoming(Cached, Entry);
+    Target->addIncoming(Compiled, CompileBB);
+    SmallVector<Value *, 8> Args;
+    for (Function::arg_iterator I = F->arg_begin(), E = F->arg_end(); I != E;
+         ++I)
+      Args.push_back(I);
+    CallInst *Call = Builder.CreateCall(Target, Args);
+    Call->setCallingConv(F->getCallingConv());
+    AttributeSet Attrs = F->getAttributes();
+    Call->setAttributes(Attrs.removeAttributes(
+        Context, AttributeSet::FunctionIndex, Attrs.getFnAttributes()));
+    Call->setTailCall();
+    if (F->getReturnType()->isVoidTy())
+      Builder.CreateRetVoid();
+    else
+      Builder.CreateRet(Call);
+
+    // The stub writes memory even if the function it stands in for does not.
+    F->removeFnAttr(Attribute::ReadNone);
+    F->removeFnAttr(Attribute::ReadOnly);
+
+    LazyFunctions.push_back(LazyFunction(Body, Impl->getName()));
+    LazyBodies.insert(Body);
+  }
+}
+
+uint64_t MCJIT::compileLazyFunction(unsigned Id) {
+  MutexGuard locked(lock);
+  assert(Id < LazyFunctions.size() && "Unknown lazy function!");
+  Module *Body = LazyFunctions[Id].Body;
+
+  // Another thread may have gotten here first.
+  if (!OwnedModules.ownsModule(Body))
+    OwnedModules.addModule(Body);
+  generateCodeForModule(Body);
+  finalizeLoadedModules();
+
+  uint64_t Addr = getExistingSymbolAddress(LazyFunctions[Id].ImplName);
+  if (!Addr)
+    report_fatal_error("Lazily compiled function '" +
+                       LazyFunctions[Id].ImplName + "' has no address!");
+  return Addr;
+}
+
 void MCJIT::finalizeLoadedModules() {
   MutexGuard locked(lock);
 
@@ -293,6 +527,12 @@ uint64_t MCJIT::getSymbolAddress(const std::string &Name,
 {
   MutexGuard locked(lock);
 
+  // The symbols that lazy stubs call back into the engine through.
+  if (Name == LazyCompileName)
+    return (uint64_t)(uintptr_t)&LazyCompileCallback;
+  if (Name == LazyEngineName)
+    return (uint64_t)(uintptr_t)this;
+
   // First, check to see if we already have this symbol.
   uint64_t Addr = getExistingSymbolAddress(Name);
   if (Addr)
@@ -224,6 +224,22 @@ class MCJIT : public ExecutionEngine {
   // perform lookup of pre-compiled code to avoid re-compilation.
   ObjectCache *ObjCache;
 
+  // When compiling lazily, every function body that has not been called yet
+  // lives in a module of its own.  The stubs left behind pass the index of
+  // their body in this list to compileLazyFunction().  A body module is
+  // owned by this list until it is compiled, and by OwnedModules after that.
+  struct LazyFunction {
+    LazyFunction(Module *Body, StringRef ImplName)
+      : Body(Body), ImplName(ImplName) {}
+    Module *Body;
+    std::string ImplName;
+  };
+  std::vector<LazyFunction> LazyFunctions;
+  ModulePtrSet LazyBodies;
+  unsigned NumLazyModules;
+
+  void emitLazyStubs(Module *M);
+
   Function *FindFunctionNamedInModulePtrSet(const char *FnName,
                                             ModulePtrSet::iterator I,
                                             ModulePtrSet::iterator E);
@@ -328,6 +344,11 @@ public:
 
   // @}
 
+  /// compileLazyFunction - Compile the body of the function whose lazy stub
+  /// was assigned \p Id and return its address.  This is called from the
+  /// stubs themselves, the first time each one runs.
+  uint64_t compileLazyFunction(unsigned Id);
+
   // This is not directly exposed via the ExecutionEngine API, but it is
   // used by the LinkingMemoryManager.
   uint64_t getSymbolAddress(const std::string &Name,
@@ -12,12 +12,119 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "llvm/Config/config.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
 
 namespace llvm {
 
+static size_t getPageSize() {
+  static const size_t PageSize = sys::process::get_self()->page_size();
+  return PageSize;
+}
+
+SectionMemoryManager::SlabPool::SlabPool(size_t SlabSize, size_t MaxFreeBytes,
+                                         bool UseHugePages)
+  : SlabSize(RoundUpToAlignment(std::max<size_t>(SlabSize, 1), getPageSize())),
+    MaxFreeBytes(MaxFreeBytes), UseHugePages(UseHugePages), MappedBytes(0),
+    FreeBytes(0) {}
+
+SectionMemoryManager::SlabPool::~SlabPool() {
+  for (unsigned Class = 0; Class <= MaxSizeClass; ++Class)
+    for (unsigned i = 0, e = FreeSlabs[Class].size(); i != e; ++i)
+      sys::Memory::releaseMappedMemory(FreeSlabs[Class][i]);
+}
+
+int SectionMemoryManager::SlabPool::getSizeClass(size_t Size) const {
+  for (unsigned Class = 0; Class <= MaxSizeClass; ++Class)
+    if ((SlabSize << Class) >= Size)
+      return Class;
+  return -1;
+}
+
+sys::MemoryBlock SectionMemoryManager::SlabPool::allocate(size_t MinSize,
+                                                          error_code &EC) {
+  EC = error_code::success();
+  int Class = getSizeClass(MinSize);
+
+  sys::ScopedLock Guard(Lock);
+  if (Class >= 0 && !FreeSlabs[Class].empty()) {
+    sys::MemoryBlock Slab = FreeSlabs[Class].pop_back_val();
+    FreeBytes -= Slab.size();
+    return Slab;
+  }
+
+  unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+  if (UseHugePages)
+    Flags |= sys::Memory::MF_HUGE_HINT;
+  sys::MemoryBlock Slab = sys::Memory::allocateMappedMemory(
+      Class >= 0 ? SlabSize << Class : MinSize, &Near, Flags, EC);
+  if (EC)
+    return sys::MemoryBlock();
+
+  Near = Slab;
+  MappedBytes += Slab.size();
+  return Slab;
+}
+
+void SectionMemoryManager::SlabPool::release(sys::MemoryBlock Slab) {
+  if (!Slab.base())
+    return;
+
+  // Only slabs that came out of a size class can go back into one, and
+  // only once they are writable again.
+  int Class = getSizeClass(Slab.size());
+  bool Keep = Class >= 0 && (SlabSize << Class) == Slab.size() &&
+              !sys::Memory::protectMappedMemory(Slab, sys::Memory::MF_READ |
+                                                          sys::Memory::MF_WRITE);
+
+  sys::ScopedLock Guard(Lock);
+  if (Keep && FreeBytes + Slab.size() <= MaxFreeBytes) {
+    FreeSlabs[Class].push_back(Slab);
+    FreeBytes += Slab.size();
+    return;
+  }
+  MappedBytes -= Slab.size();
+  sys::Memory::releaseMappedMemory(Slab);
+}
+
+size_t SectionMemoryManager::SlabPool::getMappedBytes() const {
+  sys::ScopedLock Guard(Lock);
+  return MappedBytes;
+}
+
+size_t SectionMemoryManager::SlabPool::getFreeBytes() const {
+  sys::ScopedLock Guard(Lock);
+  return FreeBytes;
+}
+
+static ManagedStatic<SectionMemoryManager::SlabPool> DefaultPool;
+
+SectionMemoryManager::SlabPool &SectionMemoryManager::SlabPool::getDefault() {
+  return *DefaultPool;
+}
+
+SectionMemoryManager::SectionMemoryManager() : Pool(0) {
+  // Construct the default pool now, so that finding it gone later means
+  // llvm_shutdown has run rather than that nobody has used it yet.
+  SlabPool::getDefault();
+}
+
+SectionMemoryManager::SectionMemoryManager(SlabPool &Pool) : Pool(&Pool) {}
+
+SectionMemoryManager::SlabPool *SectionMemoryManager::getPool() const {
+  if (Pool)
+    return Pool;
+  // Dereferencing DefaultPool after llvm_shutdown would quietly construct a
+  // new pool that nothing destroys.
+  if (!DefaultPool.isConstructed())
+    return 0;
+  return &*DefaultPool;
+}
+
 uint8_t *SectionMemoryManager::allocateDataSection(uintptr_t Size,
                                                    unsigned Alignment,
                                                    unsigned SectionID,
@@ -43,62 +150,37 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
 
   assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
 
-  uintptr_t RequiredSize = Alignment * ((Size + Alignment - 1)/Alignment + 1);
-  uintptr_t Addr = 0;
-
-  // Look in the list of free memory regions and use a block there if one
-  // is available.
-  for (int i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
-    sys::MemoryBlock &MB = MemGroup.FreeMem[i];
-    if (MB.size() >= RequiredSize) {
-      Addr = (uintptr_t)MB.base();
-      uintptr_t EndOfBlock = Addr + MB.size();
-      // Align the address.
-      Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
-      // Store cutted free memory block.
-      MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
-                                             EndOfBlock - Addr - Size);
-      return (uint8_t*)Addr;
-    }
-  }
+  uintptr_t Addr = (MemGroup.Cur + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+  if (!MemGroup.Cur || Addr + Size > MemGroup.End) {
+    // The current slab is full.  Whatever was written to it still has to
+    // have its permissions applied.
+    if (MemGroup.Cur > MemGroup.Pending)
+      MemGroup.PendingMem.push_back(
+          sys::MemoryBlock((void *)MemGroup.Pending,
+                           MemGroup.Cur - MemGroup.Pending));
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
-  //
-  // FIXME: Initialize the Near member for each memory group to avoid
-  // interleaving.
-  error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
-  if (ec) {
-    // FIXME: Add error propagation to the interface.
-    return NULL;
+    // Note that all sections get allocated as read-write.  The permissions
+    // will be updated later based on memory group.
+    error_code ec;
+    sys::MemoryBlock MB;
+    if (SlabPool *P = getPool())
+      MB = P->allocate(Size + Alignment, ec);
+    else
+      MB = sys::Memory::allocateMappedMemory(Size + Alignment, 0,
+                                             sys::Memory::MF_READ |
+                                                 sys::Memory::MF_WRITE,
+                                             ec);
+    if (ec) {
+      // FIXME: Add error propagation to the interface.
+      return NULL;
+    }
+    MemGroup.Slabs.push_back(MB);
+    MemGroup.Cur = MemGroup.Pending = (uintptr_t)MB.base();
+    MemGroup.End = MemGroup.Cur + MB.size();
+    Addr = (MemGroup.Cur + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
   }
 
-  // Save this address as the basis for our next request
-  MemGroup.Near = MB;
-
-  MemGroup.AllocatedMem.push_back(MB);
-  Addr = (uintptr_t)MB.base();
-  uintptr_t EndOfBlock = Addr + MB.size();
-
-  // Align the address.
-  Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
-
-  // The allocateMappedMemory may allocate much more memory than we need. In
-  // this case, we store the unused memory as a free memory block.
-  unsigned FreeSize = EndOfBlock-Addr-Size;
-  if (FreeSize > 16)
-    MemGroup.FreeMem.push_back(sys::MemoryBlock((void*)(Addr + Size), FreeSize));
-
-  // Return aligned address
+  MemGroup.Cur = Addr + Size;
   return (uint8_t*)Addr;
 }
 
@@ -107,9 +189,6 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   // FIXME: Should in-progress permissions be reverted if an error occurs?
   error_code ec;
 
-  // Don't allow free memory blocks to be used after setting protection flags.
-  CodeMem.FreeMem.clear();
-
   // Make code memory executable.
   ec = applyMemoryGroupPermissions(CodeMem,
                                    sys::Memory::MF_READ | sys::Memory::MF_EXEC);
@@ -120,12 +199,8 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
     return true;
   }
 
-  // Don't allow free memory blocks to be used after setting protection flags.
-  RODataMem.FreeMem.clear();
-
   // Make read-only data memory read-only.
-  ec = applyMemoryGroupPermissions(RODataMem,
-                                   sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  ec = applyMemoryGroupPermissions(RODataMem, sys::Memory::MF_READ);
   if (ec) {
     if (ErrMsg) {
       *ErrMsg = ec.message();
@@ -133,7 +208,10 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
     return true;
   }
 
-  // Read-write data memory already has the correct permissions
+  // Read-write data memory already has the correct permissions, and can
+  // keep on being filled.
+  RWDataMem.PendingMem.clear();
+  RWDataMem.Pending = RWDataMem.Cur;
 
   // Some platforms with separate data cache and instruction cache require
   // explicit cache flush, otherwise JIT code manipulations (like resolved
@@ -143,35 +221,64 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   return false;
 }
 
+static bool compareBase(const sys::MemoryBlock &LHS,
+                        const sys::MemoryBlock &RHS) {
+  return LHS.base() < RHS.base();
+}
+
 error_code SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                              unsigned Permissions) {
+  // Close off the current slab at the next page boundary; later sections
+  // start on a fresh page that is still writable.
+  if (MemGroup.Cur > MemGroup.Pending) {
+    uintptr_t End = std::min<uintptr_t>(
+        RoundUpToAlignment(MemGroup.Cur, getPageSize()), MemGroup.End);
+    MemGroup.PendingMem.push_back(
+        sys::MemoryBlock((void *)MemGroup.Pending, End - MemGroup.Pending));
+    MemGroup.Cur = MemGroup.Pending = End;
+  }
+
+  // Slabs are mapped near each other, so merging adjacent ranges usually
+  // leaves a single mprotect call.
+  SmallVectorImpl<sys::MemoryBlock> &Pending = MemGroup.PendingMem;
+  std::sort(Pending.begin(), Pending.end(), compareBase);
+  for (unsigned i = 0, e = Pending.size(); i != e;) {
+    uintptr_t Start = (uintptr_t)Pending[i].base();
+    uintptr_t End = Start + Pending[i].size();
+    for (++i; i != e && (uintptr_t)Pending[i].base() == End; ++i)
+      End += Pending[i].size();
 
-  for (int i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
-      error_code ec;
-      ec = sys::Memory::protectMappedMemory(MemGroup.AllocatedMem[i],
-                                            Permissions);
-      if (ec) {
-        return ec;
-      }
+    error_code ec = sys::Memory::protectMappedMemory(
+        sys::MemoryBlock((void *)Start, End - Start), Permissions);
+    if (ec)
+      return ec;
   }
+  Pending.clear();
 
   return error_code::success();
 }
 
 void SectionMemoryManager::invalidateInstructionCache() {
-  for (int i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::InvalidateInstructionCache(CodeMem.AllocatedMem[i].base(),
-                                            CodeMem.AllocatedMem[i].size());
+  for (int i = 0, e = CodeMem.Slabs.size(); i != e; ++i)
+    sys::Memory::InvalidateInstructionCache(CodeMem.Slabs[i].base(),
+                                            CodeMem.Slabs[i].size());
+}
+
+void SectionMemoryManager::releaseSlabs(MemoryGroup &MemGroup) {
+  SlabPool *P = getPool();
+  for (unsigned i = 0, e = MemGroup.Slabs.size(); i != e; ++i) {
+    if (P)
+      P->release(MemGroup.Slabs[i]);
+    else
+      sys::Memory::releaseMappedMemory(MemGroup.Slabs[i]);
+  }
+  MemGroup.Slabs.clear();
 }
 
 SectionMemoryManager::~SectionMemoryManager() {
-  for (unsigned i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(CodeMem.AllocatedMem[i]);
-  for (unsigned i = 0, e = RWDataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RWDataMem.AllocatedMem[i]);
-  for (unsigned i = 0, e = RODataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RODataMem.AllocatedMem[i]);
+  releaseSlabs(CodeMem);
+  releaseSlabs(RWDataMem);
+  releaseSlabs(RODataMem);
 }
 
 } // namespace llvm
-
@@ -0,0 +1,270 @@
+//===-- TieredCompiler.cpp - Background optimizing compiles ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements TieredCompiler, which runs a module on a quick first
+// tier while an optimized build of it is compiled on a background thread.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/TieredCompiler.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+
+using namespace llvm;
+
+namespace {
+/// A memory manager for the optimized tier that resolves the globals it
+/// shares with the first tier to the first tier's storage.
+class SharedGlobalsMemoryManager : public SectionMemoryManager {
+public:
+  SharedGlobalsMemoryManager(const StringMap<uint64_t> &Globals)
+    : Globals(Globals) {}
+
+  virtual uint64_t getSymbolAddress(const std::string &Name) {
+    StringMap<uint64_t>::const_iterator I = Globals.find(Name);
+    // Names may arrive with the platform's global prefix attached.
+    if (I == Globals.end() && !Name.empty() && Name[0] == '_')
+      I = Globals.find(StringRef(Name).substr(1));
+    if (I != Globals.end())
+      return I->getValue();
+    return SectionMemoryManager::getSymbolAddress(Name);
+  }
+
+private:
+  const StringMap<uint64_t> &Globals;
+};
+}
+
+/// isShared - Return true if both tiers should use the first tier's copy of
+/// \p GV.  Constants that cannot be named from outside the module may just as
+/// well be duplicated.  Appending globals such as llvm.global_ctors are
+/// consumed by the code generator and have no address to share.
+static bool isShared(const GlobalVariable &GV) {
+  return !GV.isDeclaration() && !GV.hasAppendingLinkage() &&
+         !(GV.isConstant() && GV.hasLocalLinkage());
+}
+
+TieredCompiler::TieredCompiler(ExecutionEngine *Baseline, BaselineKind Kind)
+  : Baseline(Baseline), Kind(Kind), OptModule(0), Optimized(false) {}
+
+TieredCompiler *TieredCompiler::create(Module *M, std::string *ErrorStr,
+                                       BaselineKind Baseline,
+                                       CodeGenOpt::Level OptLevel,
+                                       CallbackTy OnOptimized) {
+  // The engine only takes ownership of M once it has been created.
+  OwningPtr<Module> Owner(M);
+
+  // The optimized code finds the shared globals by name, so internal ones
+  // have to become visible to the linker.
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I) {
+    if (!isShared(*I) || !I->hasLocalLinkage())
+      continue;
+    if (!I->hasName())
+      I->setName("tiered.global");
+    I->setLinkage(GlobalValue::ExternalLinkage);
+    I->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  EngineBuilder EB(M);
+  EB.setErrorStr(ErrorStr).setMCPU(sys::getHostCPUName());
+  if (Baseline == BaselineInterpreter) {
+    // The interpreter lays memory out as the module says, which must agree
+    // with the optimized code about the shared globals.
+    OwningPtr<TargetMachine> TM(EB.selectTarget());
+    if (!TM)
+      return 0;
+    M->setDataLayout(TM->getDataLayout());
+    EB.setEngineKind(EngineKind::Interpreter);
+  } else {
+    TargetOptions Options;
+    Options.EnableFastISel = true;
+    EB.setEngineKind(EngineKind::JIT)
+      .setUseMCJIT(true)
+      .setOptLevel(CodeGenOpt::None)
+      .setTargetOptions(Options);
+  }
+
+  // Snapshot the module before the first tier's code generator changes it.
+  std::string Bitcode;
+  {
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  ExecutionEngine *EE = EB.create();
+  if (!EE)
+    return 0;
+  Owner.take();
+
+  OwningPtr<TieredCompiler> TC(new TieredCompiler(EE, Baseline));
+  TC->Bitcode.swap(Bitcode);
+
+  // Compile the first tier now; its globals must exist before the optimized
+  // code can be linked against them.
+  if (Baseline == BaselineFastISel)
+    EE->finalizeObject();
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I) {
+    if (!isShared(*I))
+      continue;
+    uint64_t Addr = Baseline == BaselineFastISel
+                        ? EE->getGlobalValueAddress(I->getName())
+                        : (uint64_t)(uintptr_t)EE->getPointerToGlobal(I);
+    TC->SharedGlobals[I->getName()] = Addr;
+  }
+
+  TC->Worker.reset(new ThreadPool(1));
+  TieredCompiler *Self = TC.get();
+  TC->Worker->async([=] { Self->compileOptimized(OptLevel, OnOptimized); });
+  return TC.take();
+}
+
+TieredCompiler::~TieredCompiler() {
+  // Let the background compile finish before tearing anything down, and
+  // release the optimized module before its context.
+  Worker.reset();
+  OptEngine.reset();
+  OptContext.reset();
+}
+
+void TieredCompiler::compileOptimized(CodeGenOpt::Level OptLevel,
+                                      CallbackTy OnOptimized) {
+  OwningPtr<LLVMContext> Context(new LLVMContext());
+  OwningPtr<MemoryBuffer> Buffer(
+      MemoryBuffer::getMemBuffer(Bitcode, "", /*RequiresNullTerminator=*/false));
+  ErrorOr<Module *> MOrErr = parseBitcodeFile(Buffer.get(), *Context);
+  if (error_code EC = MOrErr.getError()) {
+    if (OnOptimized)
+      OnOptimized(EC.message());
+    return;
+  }
+  OwningPtr<Module> M(MOrErr.get());
+  std::string().swap(Bitcode);
+
+  // Static constructors and destructors are the first tier's to run.  The
+  // copy's would initialize or tear down the shared globals a second time.
+  if (GlobalVariable *GV = M->getNamedGlobal("llvm.global_ctors"))
+    GV->eraseFromParent();
+  if (GlobalVariable *GV = M->getNamedGlobal("llvm.global_dtors"))
+    GV->eraseFromParent();
+
+  // Point the copy at the first tier's globals.
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I) {
+    if (!isShared(*I))
+      continue;
+    I->setInitializer(0);
+    I->setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  std::string Error;
+  Module *OptM = M.get();
+  OwningPtr<ExecutionEngine> EE(
+      EngineBuilder(M.take())
+          .setEngineKind(EngineKind::JIT)
+          .setUseMCJIT(true)
+          .setOptLevel(OptLevel)
+          .setMCPU(sys::getHostCPUName())
+          .setMCJITMemoryManager(new SharedGlobalsMemoryManager(SharedGlobals))
+          .setErrorStr(&Error)
+          .create());
+  if (!EE) {
+    if (OnOptimized)
+      OnOptimized(Error);
+    return;
+  }
+
+  // MCJIT only generates code, so run the IR optimizer here, with the same
+  // inlining thresholds opt uses.
+  if (OptLevel != CodeGenOpt::None) {
+    OptM->setDataLayout(EE->getDataLayout());
+    PassManager PM;
+    PM.add(new DataLayoutPass(OptM));
+    PassManagerBuilder Builder;
+    Builder.OptLevel = OptLevel;
+    Builder.Inliner = createFunctionInliningPass(OptLevel > 2 ? 275 : 225);
+    Builder.populateModulePassManager(PM);
+    PM.run(*OptM);
+  }
+  EE->finalizeObject();
+
+  {
+    sys::ScopedLock Guard(SlotLock);
+    OptContext.swap(Context);
+    OptEngine.swap(EE);
+    OptModule = OptM;
+    // Make sure the new code is visible before any slot points at it.
+    sys::MemoryFence();
+    for (StringMap<void *volatile>::iterator I = EntrySlots.begin(),
+                                             E = EntrySlots.end();
+         I != E; ++I)
+      if (uint64_t Addr = OptEngine->getFunctionAddress(I->getKey()))
+        I->getValue() = (void *)(uintptr_t)Addr;
+    Optimized = true;
+  }
+
+  if (OnOptimized)
+    OnOptimized(std::string());
+}
+
+void *const volatile *TieredCompiler::getEntrySlot(StringRef Name) {
+  sys::ScopedLock Guard(SlotLock);
+  StringMap<void *volatile>::iterator I = EntrySlots.find(Name);
+  if (I != EntrySlots.end())
+    return &I->getValue();
+
+  uint64_t Addr = 0;
+  if (Optimized)
+    Addr = OptEngine->getFunctionAddress(Name);
+  else if (Kind == BaselineFastISel)
+    Addr = Baseline->getFunctionAddress(Name);
+  if (!Addr)
+    return 0;
+  return &EntrySlots.GetOrCreateValue(Name, (void *)(uintptr_t)Addr)
+              .getValue();
+}
+
+GenericValue TieredCompiler::runFunction(Function *F,
+                                         const std::vector<GenericValue> &Args) {
+  if (Optimized) {
+    sys::MemoryFence();
+    // Internal functions have no symbol to look them up by in MCJIT.
+    Function *OptF = OptModule->getFunction(F->getName());
+    if (OptF && !OptF->isDeclaration() && !OptF->hasLocalLinkage())
+      return OptEngine->runFunction(OptF, Args);
+  }
+  return Baseline->runFunction(F, Args);
+}
+
+ExecutionEngine *TieredCompiler::getOptimizedEngine() const {
+  if (!Optimized)
+    return 0;
+  sys::MemoryFence();
+  return OptEngine.get();
+}
+
+void TieredCompiler::waitForOptimizedCode() {
+  Worker->wait();
+}
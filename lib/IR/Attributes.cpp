@@ -38,6 +38,7 @@ Attribute Attribute::get(LLVMContext &Context, Attribute::AttrKind Kind,
   if (Val) ID.AddInteger(Val);
 
   void *InsertPoint;
+  ContextLockGuard Guard(pImpl);
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (!PA) {
@@ -61,6 +62,7 @@ Attribute Attribute::get(LLVMContext &Context, StringRef Kind, StringRef Val) {
   if (!Val.empty()) ID.AddString(Val);
 
   void *InsertPoint;
+  ContextLockGuard Guard(pImpl);
   AttributeImpl *PA = pImpl->AttrsSet.FindNodeOrInsertPos(ID, InsertPoint);
 
   if (!PA) {
@@ -416,6 +418,7 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
     I->Profile(ID);
 
   void *InsertPoint;
+  ContextLockGuard Guard(pImpl);
   AttributeSetNode *PA =
     pImpl->AttrsSetNodes.FindNodeOrInsertPos(ID, InsertPoint);
 
@@ -534,6 +537,7 @@ AttributeSet::getImpl(LLVMContext &C,
   AttributeSetImpl::Profile(ID, Attrs);
 
   void *InsertPoint;
+  ContextLockGuard Guard(pImpl);
   AttributeSetImpl *PA = pImpl->AttrsLists.FindNodeOrInsertPos(ID, InsertPoint);
 
   // If we didn't find any existing attributes of the same shape then
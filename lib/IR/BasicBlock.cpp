@@ -15,6 +15,7 @@
 #include "SymbolTableListTraitsImpl.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/FunctionArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
@@ -86,6 +87,14 @@ BasicBlock::~BasicBlock() {
   InstList.clear();
 }
 
+void *BasicBlock::operator new(size_t s) {
+  return FunctionArena::allocateBlock(s);
+}
+
+void BasicBlock::operator delete(void *Ptr) {
+  FunctionArena::deallocateBlock(Ptr);
+}
+
 void BasicBlock::setParent(Function *parent) {
   if (getParent())
     LeakDetector::addGarbageObject(this);
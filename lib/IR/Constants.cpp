@@ -393,6 +393,10 @@ static bool removeDeadUsersOfConstant(const Constant *C) {
 /// that want to check to see if a global is unused, but don't want to deal
 /// with potentially dead constants hanging off of the globals.
 void Constant::removeDeadConstantUsers() const {
+  // Function passes running on other threads may add and remove uses of
+  // this constant meanwhile, and destroy constants in the same tree.
+  ContextLockGuard ContextGuard(getContext());
+  SharedUseListGuard UseListGuard(this);
   Value::const_use_iterator I = use_begin(), E = use_end();
   Value::const_use_iterator LastNonDeadUser = E;
   while (I != E) {
@@ -437,6 +441,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl);
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
   return pImpl->TheTrueVal;
@@ -444,6 +449,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl);
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
   return pImpl->TheFalseVal;
@@ -484,9 +490,14 @@ ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
-  ConstantInt *&Slot = pImpl->IntConstants[DenseMapAPIntKeyInfo::KeyTy(V, ITy)];
-  if (!Slot) Slot = new ConstantInt(ITy, V);
-  return Slot;
+  DenseMapAPIntKeyInfo::KeyTy Key(V, ITy);
+  if (ConstantInt *CI = pImpl->IntConstants.lookup(Key))
+    return CI;
+  ConstantInt *NewCI = new ConstantInt(ITy, V);
+  ConstantInt *CI = pImpl->IntConstants.insert(Key, NewCI);
+  if (CI != NewCI)
+    delete NewCI; // Another thread created it first.
+  return CI;
 }
 
 Constant *ConstantInt::get(Type *Ty, uint64_t V, bool isSigned) {
@@ -607,30 +618,31 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
-
-  ConstantFP *&Slot = pImpl->FPConstants[DenseMapAPFloatKeyInfo::KeyTy(V)];
-
-  if (!Slot) {
-    Type *Ty;
-    if (&V.getSemantics() == &APFloat::IEEEhalf)
-      Ty = Type::getHalfTy(Context);
-    else if (&V.getSemantics() == &APFloat::IEEEsingle)
-      Ty = Type::getFloatTy(Context);
-    else if (&V.getSemantics() == &APFloat::IEEEdouble)
-      Ty = Type::getDoubleTy(Context);
-    else if (&V.getSemantics() == &APFloat::x87DoubleExtended)
-      Ty = Type::getX86_FP80Ty(Context);
-    else if (&V.getSemantics() == &APFloat::IEEEquad)
-      Ty = Type::getFP128Ty(Context);
-    else {
-      assert(&V.getSemantics() == &APFloat::PPCDoubleDouble && 
-             "Unknown FP format");
-      Ty = Type::getPPC_FP128Ty(Context);
-    }
-    Slot = new ConstantFP(Ty, V);
+  DenseMapAPFloatKeyInfo::KeyTy Key(V);
+  if (ConstantFP *CFP = pImpl->FPConstants.lookup(Key))
+    return CFP;
+
+  Type *Ty;
+  if (&V.getSemantics() == &APFloat::IEEEhalf)
+    Ty = Type::getHalfTy(Context);
+  else if (&V.getSemantics() == &APFloat::IEEEsingle)
+    Ty = Type::getFloatTy(Context);
+  else if (&V.getSemantics() == &APFloat::IEEEdouble)
+    Ty = Type::getDoubleTy(Context);
+  else if (&V.getSemantics() == &APFloat::x87DoubleExtended)
+    Ty = Type::getX86_FP80Ty(Context);
+  else if (&V.getSemantics() == &APFloat::IEEEquad)
+    Ty = Type::getFP128Ty(Context);
+  else {
+    assert(&V.getSemantics() == &APFloat::PPCDoubleDouble && 
+           "Unknown FP format");
+    Ty = Type::getPPC_FP128Ty(Context);
   }
-
-  return Slot;
+  ConstantFP *NewCFP = new ConstantFP(Ty, V);
+  ConstantFP *CFP = pImpl->FPConstants.insert(Key, NewCFP);
+  if (CFP != NewCFP)
+    delete NewCFP; // Another thread created it first.
+  return CFP;
 }
 
 Constant *ConstantFP::getInfinity(Type *Ty, bool Negative) {
@@ -835,6 +847,7 @@ Constant *ConstantArray::get(ArrayType *Ty, ArrayRef<Constant*> V) {
   }
 
   // Otherwise, we really do want to create a ConstantArray.
+  ContextLockGuard Guard(pImpl);
   return pImpl->ArrayConstants.getOrCreate(Ty, V);
 }
 
@@ -898,6 +911,7 @@ Constant *ConstantStruct::get(StructType *ST, ArrayRef<Constant*> V) {
   if (isUndef)
     return UndefValue::get(ST);
 
+  ContextLockGuard Guard(ST->getContext());
   return ST->getContext().pImpl->StructConstants.getOrCreate(ST, V);
 }
 
@@ -1017,6 +1031,7 @@ Constant *ConstantVector::get(ArrayRef<Constant*> V) {
 
   // Otherwise, the element type isn't compatible with ConstantDataVector, or
   // the operand list constants a ConstantExpr or something else strange.
+  ContextLockGuard Guard(pImpl);
   return pImpl->VectorConstants.getOrCreate(T, V);
 }
 
@@ -1234,6 +1249,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
+  ContextLockGuard Guard(Ty->getContext());
   ConstantAggregateZero *&Entry = Ty->getContext().pImpl->CAZConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantAggregateZero(Ty);
@@ -1244,6 +1260,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getContext().pImpl->CAZConstants.erase(getType());
   destroyConstantImpl();
 }
@@ -1251,6 +1268,7 @@ void ConstantAggregateZero::destroyConstant() {
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getType()->getContext().pImpl->ArrayConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1262,6 +1280,7 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getType()->getContext().pImpl->StructConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1269,6 +1288,7 @@ void ConstantStruct::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getType()->getContext().pImpl->VectorConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1314,6 +1334,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  ContextLockGuard Guard(Ty->getContext());
   ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantPointerNull(Ty);
@@ -1324,6 +1345,7 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getContext().pImpl->CPNConstants.erase(getType());
   // Free the constant and any dangling references to it.
   destroyConstantImpl();
@@ -1334,6 +1356,7 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
+  ContextLockGuard Guard(Ty->getContext());
   UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (Entry == 0)
     Entry = new UndefValue(Ty);
@@ -1344,6 +1367,7 @@ UndefValue *UndefValue::get(Type *Ty) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   // Free the constant and any dangling references to it.
   getContext().pImpl->UVConstants.erase(getType());
   destroyConstantImpl();
@@ -1358,6 +1382,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  ContextLockGuard Guard(F->getContext());
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (BA == 0)
@@ -1381,6 +1406,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 
   const Function *F = BB->getParent();
   assert(F != 0 && "Block must have a parent");
+  ContextLockGuard Guard(F->getContext());
   BlockAddress *BA =
       F->getContext().pImpl->BlockAddresses.lookup(std::make_pair(F, BB));
   assert(BA && "Refcount and block address map disagree!");
@@ -1390,6 +1416,7 @@ BlockAddress *BlockAddress::lookup(const BasicBlock *BB) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getFunction()->getType()->getContext().pImpl
     ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
@@ -1397,6 +1424,7 @@ void BlockAddress::destroyConstant() {
 }
 
 void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
+  ContextLockGuard Guard(getContext());
   // This could be replacing either the Basic Block or the Function.  In either
   // case, we have to remove the map entry.
   Function *NewF = getFunction();
@@ -1451,6 +1479,7 @@ static inline Constant *getFoldedCast(
   // Look up the constant in the table first to ensure uniqueness.
   ExprMapKeyType Key(opc, C);
 
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(Ty, Key);
 }
 
@@ -1774,6 +1803,7 @@ Constant *ConstantExpr::get(unsigned Opcode, Constant *C1, Constant *C2,
   ExprMapKeyType Key(Opcode, ArgVec, 0, Flags);
 
   LLVMContextImpl *pImpl = C1->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(C1->getType(), Key);
 }
 
@@ -1851,6 +1881,7 @@ Constant *ConstantExpr::getSelect(Constant *C, Constant *V1, Constant *V2) {
   ExprMapKeyType Key(Instruction::Select, ArgVec);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(V1->getType(), Key);
 }
 
@@ -1887,6 +1918,7 @@ Constant *ConstantExpr::getGetElementPtr(Constant *C, ArrayRef<Value *> Idxs,
                            InBounds ? GEPOperator::IsInBounds : 0);
 
   LLVMContextImpl *pImpl = C->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1909,6 +1941,7 @@ ConstantExpr::getICmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1930,6 +1963,7 @@ ConstantExpr::getFCmp(unsigned short pred, Constant *LHS, Constant *RHS) {
     ResultTy = VectorType::get(ResultTy, VT->getNumElements());
 
   LLVMContextImpl *pImpl = LHS->getType()->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ResultTy, Key);
 }
 
@@ -1948,6 +1982,7 @@ Constant *ConstantExpr::getExtractElement(Constant *Val, Constant *Idx) {
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
   Type *ReqTy = Val->getType()->getVectorElementType();
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -1967,6 +2002,7 @@ Constant *ConstantExpr::getInsertElement(Constant *Val, Constant *Elt,
   const ExprMapKeyType Key(Instruction::InsertElement, ArgVec);
 
   LLVMContextImpl *pImpl = Val->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(Val->getType(), Key);
 }
 
@@ -1987,6 +2023,7 @@ Constant *ConstantExpr::getShuffleVector(Constant *V1, Constant *V2,
   const ExprMapKeyType Key(Instruction::ShuffleVector, ArgVec);
 
   LLVMContextImpl *pImpl = ShufTy->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ShufTy, Key);
 }
 
@@ -2007,6 +2044,7 @@ Constant *ConstantExpr::getInsertValue(Constant *Agg, Constant *Val,
   const ExprMapKeyType Key(Instruction::InsertValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2028,6 +2066,7 @@ Constant *ConstantExpr::getExtractValue(Constant *Agg,
   const ExprMapKeyType Key(Instruction::ExtractValue, ArgVec, 0, 0, Idxs);
 
   LLVMContextImpl *pImpl = Agg->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   return pImpl->ExprConstants.getOrCreate(ReqTy, Key);
 }
 
@@ -2182,6 +2221,7 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   getType()->getContext().pImpl->ExprConstants.remove(this);
   destroyConstantImpl();
 }
@@ -2277,6 +2317,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
+  ContextLockGuard Guard(Ty->getContext());
   StringMap<ConstantDataSequential*>::MapEntryTy &Slot =
     Ty->getContext().pImpl->CDSConstants.GetOrCreateValue(Elements);
 
@@ -2300,6 +2341,7 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
 }
 
 void ConstantDataSequential::destroyConstant() {
+  ContextLockGuard Guard(getContext());
   // Remove the constant from the StringMap.
   StringMap<ConstantDataSequential*> &CDSConstants = 
     getType()->getContext().pImpl->CDSConstants;
@@ -2583,6 +2625,7 @@ Constant *ConstantDataVector::getSplatValue() const {
 ///
 void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                 Use *U) {
+  ContextLockGuard Guard(getContext());
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2658,6 +2701,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  ContextLockGuard Guard(getContext());
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2733,6 +2777,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  ContextLockGuard Guard(getContext());
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
 
   SmallVector<Constant*, 8> Values;
@@ -2755,6 +2800,7 @@ void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
                                                Use *U) {
+  ContextLockGuard Guard(getContext());
   assert(isa<Constant>(ToV) && "Cannot make Constant refer to non-constant!");
   Constant *To = cast<Constant>(ToV);
 
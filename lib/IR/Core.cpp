@@ -24,6 +24,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassProfiler.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/Debug.h"
@@ -2632,3 +2633,27 @@ void LLVMStopMultithreaded() {
 LLVMBool LLVMIsMultithreaded() {
   return llvm_is_multithreaded();
 }
+
+/*===-- Pass profiling ----------------------------------------------------===*/
+
+void LLVMStartPassProfiling() {
+  PassProfiler::start();
+}
+
+void LLVMStopPassProfiling() {
+  PassProfiler::stop();
+}
+
+LLVMBool LLVMWritePassProfile(const char *Filename,
+                              LLVMPassProfileFormat Format,
+                              char **ErrorMessage) {
+  std::string Error;
+  if (PassProfiler::write(Filename, Format == LLVMPassProfileChromeTrace
+                                        ? PassProfiler::ChromeTrace
+                                        : PassProfiler::JSON,
+                          Error)) {
+    *ErrorMessage = strdup(Error.c_str());
+    return true;
+  }
+  return false;
+}
@@ -22,6 +22,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
@@ -504,7 +505,29 @@ DataLayout::~DataLayout() {
   clear();
 }
 
+/// LayoutMapLock - Guards the lazily built struct layout caches, which may be
+/// queried from several threads when functions are optimized in parallel.
+/// It is only taken while the context of the queried type is multithreaded.
+static ManagedStatic<sys::SmartMutex<true> > LayoutMapLock;
+
+namespace {
+/// LayoutMapGuard - Hold LayoutMapLock if Locked is true.
+class LayoutMapGuard {
+  bool Locked;
+public:
+  explicit LayoutMapGuard(bool Locked) : Locked(Locked) {
+    if (Locked)
+      LayoutMapLock->acquire();
+  }
+  ~LayoutMapGuard() {
+    if (Locked)
+      LayoutMapLock->release();
+  }
+};
+}
+
 const StructLayout *DataLayout::getStructLayout(StructType *Ty) const {
+  LayoutMapGuard Guard(Ty->getContext().isMultithreaded());
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
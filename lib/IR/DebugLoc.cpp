@@ -19,7 +19,8 @@ using namespace llvm;
 
 MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
   if (ScopeIdx == 0) return 0;
-  
+
+  ContextLockGuard Guard(Ctx.pImpl);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -38,7 +39,8 @@ MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
   // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
   // position specified.  Zero is invalid.
   if (ScopeIdx >= 0) return 0;
-  
+
+  ContextLockGuard Guard(Ctx.pImpl);
   // Otherwise, the index is in the ScopeInlinedAtRecords array.
   assert(unsigned(-ScopeIdx) <= Ctx.pImpl->ScopeInlinedAtRecords.size() &&
          "Invalid ScopeIdx");
@@ -52,7 +54,8 @@ void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
     Scope = IA = 0;
     return;
   }
-  
+
+  ContextLockGuard Guard(Ctx.pImpl);
   if (ScopeIdx > 0) {
     // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
     // position specified.
@@ -104,7 +107,8 @@ DebugLoc DebugLoc::get(unsigned Line, unsigned Col,
   Result.LineCol = Line | (Col << 24);
   
   LLVMContext &Ctx = Scope->getContext();
-  
+  ContextLockGuard Guard(Ctx);
+
   // If there is no inlined-at location, use the ScopeRecords array.
   if (InlinedAt == 0)
     Result.ScopeIdx = Ctx.pImpl->getOrAddScopeRecordIdxEntry(Scope, 0);
@@ -19,6 +19,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/CodeGen/ValueTypes.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/FunctionArena.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -210,7 +211,7 @@ void Function::eraseFromParent() {
 Function::Function(FunctionType *Ty, LinkageTypes Linkage,
                    const Twine &name, Module *ParentModule)
   : GlobalValue(PointerType::getUnqual(Ty),
-                Value::FunctionVal, 0, 0, Linkage, name) {
+                Value::FunctionVal, 0, 0, Linkage, name), Arena(0) {
   assert(FunctionType::isValidReturnType(getReturnType()) &&
          "invalid return type");
   SymTab = new ValueSymbolTable();
@@ -222,8 +223,11 @@ Function::Function(FunctionType *Ty, LinkageTypes Linkage,
   // Make sure that we get added to a function
   LeakDetector::addGarbageObject(this);
 
-  if (ParentModule)
+  if (ParentModule) {
+    // Other threads may be adding functions to the module as well.
+    ContextLockGuard Guard(getContext());
     ParentModule->getFunctionList().push_back(this);
+  }
 
   // Ensure intrinsics have the right parameter attributes.
   if (unsigned IID = getIntrinsicID())
@@ -242,8 +246,21 @@ Function::~Function() {
   clearGC();
 
   // Remove the intrinsicID from the Cache.
-  if (getValueName() && isIntrinsic())
+  if (getValueName() && isIntrinsic()) {
+    ContextLockGuard Guard(getContext());
     getContext().pImpl->IntrinsicIDCache.erase(this);
+  }
+
+  // Instructions that were moved to other functions keep the arena alive
+  // until they are deleted.
+  if (Arena)
+    Arena->releaseOwner();
+}
+
+FunctionArena *Function::getArena() {
+  if (!Arena && getContext().hasFunctionArenas())
+    Arena = new FunctionArena();
+  return Arena;
 }
 
 void Function::BuildLazyArguments() const {
@@ -388,6 +405,7 @@ unsigned Function::getIntrinsicID() const {
   if (!ValName || !isIntrinsic())
     return 0;
 
+  ContextLockGuard Guard(getContext());
   LLVMContextImpl::IntrinsicIDCacheTy &IntrinsicIDCache =
     getContext().pImpl->IntrinsicIDCache;
   if (!IntrinsicIDCache.count(this)) {
@@ -757,6 +775,7 @@ bool Function::callsFunctionThatReturnsTwice() const {
 
 Constant *Function::getPrefixData() const {
   assert(hasPrefixData());
+  ContextLockGuard Guard(getContext());
   const LLVMContextImpl::PrefixDataMapTy &PDMap =
       getContext().pImpl->PrefixDataMap;
   assert(PDMap.find(this) != PDMap.end());
@@ -768,6 +787,7 @@ void Function::setPrefixData(Constant *PrefixData) {
     return;
 
   unsigned SCData = getSubclassDataFromValue();
+  ContextLockGuard Guard(getContext());
   LLVMContextImpl::PrefixDataMapTy &PDMap = getContext().pImpl->PrefixDataMap;
   ReturnInst *&PDHolder = PDMap[this];
   if (PrefixData) {
@@ -0,0 +1,225 @@
+//===- FunctionArena.cpp - Arenas for function bodies ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements FunctionArena and FunctionArenaScope.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FunctionArena.h"
+#include "llvm/Config/config.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <algorithm>
+#include <new>
+
+using namespace llvm;
+
+/// The arena of the innermost FunctionArenaScope of each thread.
+static ManagedStatic<sys::ThreadLocal<const FunctionArena> > CurrentArena;
+
+/// The number of FunctionArenaScopes with an arena, on all threads.  While
+/// there are none, allocation goes straight to the heap without looking up
+/// the current arena.
+static volatile sys::cas_flag NumArenaScopes = 0;
+
+/// LockGuard - Scoped lock for an arena.  This is a no-op unless some context
+/// is multithreaded.
+class FunctionArena::LockGuard {
+  FunctionArena &A;
+  bool Locked;
+
+  LockGuard(const LockGuard &) LLVM_DELETED_FUNCTION;
+  void operator=(const LockGuard &) LLVM_DELETED_FUNCTION;
+public:
+  explicit LockGuard(FunctionArena &A) : A(A), Locked(needsLock()) {
+    if (Locked)
+      A.Lock.acquire();
+  }
+  ~LockGuard() {
+    if (Locked)
+      A.Lock.release();
+  }
+};
+
+FunctionArena::FunctionArena()
+    : NumLive(0), HasOwner(true), Lock(/*recursive=*/false) {
+  assert((reinterpret_cast<uintptr_t>(this) & SizeMask) == 0 &&
+         "Arena is not aligned enough to hold a size in its low bits");
+  std::fill(FreeInsts, FreeInsts + MaxChunks + 1, (FreeInst *)0);
+}
+
+FunctionArena::~FunctionArena() {
+  assert(NumLive == 0 && "Arena deleted while objects are still allocated");
+  BlockRecycler.clear(Allocator);
+}
+
+void *FunctionArena::operator new(size_t Size) {
+  // Keep the heap pointer just in front of the aligned arena.
+  char *Storage =
+      static_cast<char *>(::operator new(Size + ArenaAlignment));
+  uintptr_t Arena = (reinterpret_cast<uintptr_t>(Storage) + sizeof(char *) +
+                     ArenaAlignment - 1) & ~uintptr_t(ArenaAlignment - 1);
+  reinterpret_cast<char **>(Arena)[-1] = Storage;
+  return reinterpret_cast<void *>(Arena);
+}
+
+void FunctionArena::operator delete(void *Ptr) {
+  ::operator delete(static_cast<char **>(Ptr)[-1]);
+}
+
+void FunctionArena::releaseOwner() {
+  bool Dead;
+  {
+    LockGuard Guard(*this);
+    HasOwner = false;
+    Dead = NumLive == 0;
+  }
+  if (Dead)
+    delete this;
+}
+
+FunctionArena *FunctionArena::getCurrent() {
+  if (NumArenaScopes == 0)
+    return 0;
+  return const_cast<FunctionArena *>(CurrentArena->get());
+}
+
+#if LLVM_ENABLE_FUNCTION_ARENAS
+
+void *FunctionArena::allocateInstruction(size_t Size) {
+  size_t NumChunks = (sizeof(uintptr_t) + Size + sizeof(Chunk) - 1) /
+                     sizeof(Chunk);
+  FunctionArena *A = getCurrent();
+  uintptr_t *Header;
+  if (A && NumChunks <= MaxChunks) {
+    LockGuard Guard(*A);
+    if (FreeInst *Free = A->FreeInsts[NumChunks]) {
+      A->FreeInsts[NumChunks] = Free->Next;
+      Header = reinterpret_cast<uintptr_t *>(Free);
+    } else {
+      Header = static_cast<uintptr_t *>(A->Allocator.Allocate(
+          NumChunks * sizeof(Chunk), AlignOf<Chunk>::Alignment));
+    }
+    *Header = reinterpret_cast<uintptr_t>(A) | NumChunks;
+    ++A->NumLive;
+  } else {
+    Header = static_cast<uintptr_t *>(
+        ::operator new(sizeof(uintptr_t) + Size));
+    *Header = 0;
+  }
+  return Header + 1;
+}
+
+void FunctionArena::deallocateInstruction(void *Ptr) {
+  uintptr_t *Header = static_cast<uintptr_t *>(Ptr) - 1;
+  if (*Header == 0) {
+    ::operator delete(Header);
+    return;
+  }
+
+  FunctionArena *A =
+      reinterpret_cast<FunctionArena *>(*Header & ~uintptr_t(SizeMask));
+  unsigned NumChunks = *Header & SizeMask;
+  bool Dead;
+  {
+    LockGuard Guard(*A);
+    FreeInst *Free = reinterpret_cast<FreeInst *>(Header);
+    Free->Next = A->FreeInsts[NumChunks];
+    A->FreeInsts[NumChunks] = Free;
+    Dead = A->releaseObject();
+  }
+  if (Dead)
+    delete A;
+}
+
+void *FunctionArena::allocateBlock(size_t Size) {
+  assert(Size <= sizeof(BasicBlock) && "Not a basic block");
+  FunctionArena *A = getCurrent();
+  BlockStorage *Storage;
+  if (A) {
+    LockGuard Guard(*A);
+    Storage = A->BlockRecycler.Allocate(A->Allocator);
+    Storage->Header = reinterpret_cast<uintptr_t>(A);
+    ++A->NumLive;
+  } else {
+    Storage =
+        static_cast<BlockStorage *>(::operator new(sizeof(BlockStorage)));
+    Storage->Header = 0;
+  }
+  return Storage->Block.buffer;
+}
+
+void FunctionArena::deallocateBlock(void *Ptr) {
+  BlockStorage *Storage = reinterpret_cast<BlockStorage *>(
+      static_cast<char *>(Ptr) - offsetof(BlockStorage, Block));
+  if (Storage->Header == 0) {
+    ::operator delete(Storage);
+    return;
+  }
+
+  FunctionArena *A = reinterpret_cast<FunctionArena *>(Storage->Header);
+  bool Dead;
+  {
+    LockGuard Guard(*A);
+    A->BlockRecycler.Deallocate(A->Allocator, Storage);
+    Dead = A->releaseObject();
+  }
+  if (Dead)
+    delete A;
+}
+
+#else
+
+// Without arenas there is no arena word, and instructions and blocks take
+// exactly as much memory as they would without the FunctionArena hooks.
+
+void *FunctionArena::allocateInstruction(size_t Size) {
+  return ::operator new(Size);
+}
+
+void FunctionArena::deallocateInstruction(void *Ptr) {
+  ::operator delete(Ptr);
+}
+
+void *FunctionArena::allocateBlock(size_t Size) {
+  return ::operator new(Size);
+}
+
+void FunctionArena::deallocateBlock(void *Ptr) {
+  ::operator delete(Ptr);
+}
+
+#endif // LLVM_ENABLE_FUNCTION_ARENAS
+
+//===----------------------------------------------------------------------===//
+// FunctionArenaScope Implementation
+//===----------------------------------------------------------------------===//
+
+FunctionArenaScope::FunctionArenaScope(Function &F)
+    : Arena(F.getArena()), Saved(0), Installed(false) {
+  // Leave the thread alone if there is neither an arena to install nor one
+  // to hide.
+  if (!Arena && NumArenaScopes == 0)
+    return;
+  Saved = const_cast<FunctionArena *>(CurrentArena->get());
+  CurrentArena->set(Arena);
+  if (Arena)
+    sys::AtomicIncrement(&NumArenaScopes);
+  Installed = true;
+}
+
+FunctionArenaScope::~FunctionArenaScope() {
+  if (!Installed)
+    return;
+  CurrentArena->set(Saved);
+  if (Arena)
+    sys::AtomicDecrement(&NumArenaScopes);
+}
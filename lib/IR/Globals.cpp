@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/GlobalValue.h"
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -127,7 +128,8 @@ GlobalVariable::GlobalVariable(Module &M, Type *Ty, bool constant,
   }
   
   LeakDetector::addGarbageObject(this);
-  
+
+  ContextLockGuard Guard(getContext());
   if (Before)
     Before->getParent()->getGlobalList().insert(Before, this);
   else
@@ -209,8 +211,10 @@ GlobalAlias::GlobalAlias(Type *Ty, LinkageTypes Link,
     assert(aliasee->getType() == Ty && "Alias and aliasee types should match!");
   Op<0>() = aliasee;
 
-  if (ParentModule)
+  if (ParentModule) {
+    ContextLockGuard Guard(getContext());
     ParentModule->getAliasList().push_back(this);
+  }
 }
 
 void GlobalAlias::setParent(Module *parent) {
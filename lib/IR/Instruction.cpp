@@ -13,6 +13,7 @@
 
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/FunctionArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
@@ -58,6 +59,17 @@ Instruction::~Instruction() {
     clearMetadataHashEntries();
 }
 
+void *Instruction::operator new(size_t s, unsigned Us) {
+  return initOperands(FunctionArena::allocateInstruction(s + sizeof(Use) * Us),
+                      Us);
+}
+
+void Instruction::operator delete(void *Usr) {
+  Instruction *Obj = static_cast<Instruction*>(Usr);
+  Use *Storage = static_cast<Use*>(Usr) - Obj->NumOperands;
+  FunctionArena::deallocateInstruction(Storage);
+}
+
 
 void Instruction::setParent(BasicBlock *P) {
   if (getParent()) {
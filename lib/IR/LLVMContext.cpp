@@ -14,13 +14,16 @@
 
 #include "llvm/IR/LLVMContext.h"
 #include "LLVMContextImpl.h"
+#include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 #include <cctype>
 using namespace llvm;
 
@@ -66,7 +69,10 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
   assert(InvariantLdId == MD_invariant_load && "invariant.load kind id drifted");
   (void)InvariantLdId;
 }
-LLVMContext::~LLVMContext() { delete pImpl; }
+LLVMContext::~LLVMContext() {
+  setMultithreaded(false);
+  delete pImpl;
+}
 
 void LLVMContext::addModule(Module *M) {
   pImpl->OwnedModules.insert(M);
@@ -76,6 +82,52 @@ void LLVMContext::removeModule(Module *M) {
   pImpl->OwnedModules.erase(M);
 }
 
+//===----------------------------------------------------------------------===//
+// Multithreaded Mode
+//===----------------------------------------------------------------------===//
+
+void LLVMContext::setMultithreaded(bool Enable) {
+  if (pImpl->Multithreaded == Enable)
+    return;
+
+  // The shared use-list lock and the ManagedStatics reached from worker
+  // threads rely on LLVM knowing that it runs multithreaded.
+  if (Enable && !llvm_is_multithreaded())
+    llvm_start_multithreaded();
+
+  pImpl->Multithreaded = Enable;
+
+  if (Enable)
+    ++Use::NumMultithreadedContexts;
+  else
+    --Use::NumMultithreadedContexts;
+}
+
+bool LLVMContext::isMultithreaded() const {
+  return pImpl->Multithreaded;
+}
+
+//===----------------------------------------------------------------------===//
+// Function Arenas
+//===----------------------------------------------------------------------===//
+
+static cl::opt<bool>
+EnableFunctionArenas("function-arenas", cl::Hidden,
+  cl::desc("Allocate function bodies from per-function arenas in every "
+           "context"));
+
+void LLVMContext::setFunctionArenas(bool Enable) {
+  pImpl->FunctionArenas = Enable;
+}
+
+bool LLVMContext::hasFunctionArenas() const {
+#if LLVM_ENABLE_FUNCTION_ARENAS
+  return pImpl->FunctionArenas || EnableFunctionArenas;
+#else
+  return false;
+#endif
+}
+
 //===----------------------------------------------------------------------===//
 // Recoverable Backend Errors
 //===----------------------------------------------------------------------===//
@@ -183,6 +235,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
   assert(isValidName(Name) && "Invalid MDNode name");
 
   // If this is new, assign it its ID.
+  ContextLockGuard Guard(pImpl);
   return
     pImpl->CustomMDKindNames.GetOrCreateValue(
       Name, pImpl->CustomMDKindNames.size()).second;
@@ -191,6 +244,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  ContextLockGuard Guard(pImpl);
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
@@ -19,7 +19,8 @@
 using namespace llvm;
 
 LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
-  : TheTrueVal(0), TheFalseVal(0),
+  : Multithreaded(false), FunctionArenas(false), IntConstants(Multithreaded),
+    FPConstants(Multithreaded), TheTrueVal(0), TheFalseVal(0),
     VoidTy(C, Type::VoidTyID),
     LabelTy(C, Type::LabelTyID),
     HalfTy(C, Type::HalfTyID),
@@ -34,7 +35,7 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
     Int8Ty(C, 8),
     Int16Ty(C, 16),
     Int32Ty(C, 32),
-    Int64Ty(C, 64) {
+    Int64Ty(C, 64), PointerTypes(Multithreaded) {
   InlineAsmDiagHandler = 0;
   InlineAsmDiagContext = 0;
   DiagnosticHandler = 0;
@@ -89,8 +90,10 @@ LLVMContextImpl::~LLVMContextImpl() {
   DeleteContainerSeconds(CPNConstants);
   DeleteContainerSeconds(UVConstants);
   InlineAsms.freeConstants();
-  DeleteContainerSeconds(IntConstants);
-  DeleteContainerSeconds(FPConstants);
+  for (unsigned i = 0; i != IntMapTy::NumShards; ++i) {
+    DeleteContainerSeconds(IntConstants.getShardMap(i));
+    DeleteContainerSeconds(FPConstants.getShardMap(i));
+  }
   
   for (StringMap<ConstantDataSequential*>::iterator I = CDSConstants.begin(),
        E = CDSConstants.end(); I != E; ++I)
@@ -30,6 +30,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/ValueHandle.h"
 #include <vector>
 
@@ -207,6 +208,77 @@ template<> struct FoldingSetTrait<MDNode> : DefaultFoldingSetTrait<MDNode> {
   }
 };
 
+/// ShardedUniqueMap - A uniquing table split into shards with a lock each.
+/// While the context is multithreaded, threads looking up keys that fall into
+/// different shards do not contend, neither with each other nor with the
+/// context lock.  Otherwise it behaves like a plain DenseMap.
+///
+/// A shard lock is never held while anything else is locked, so lookups may
+/// happen with or without the context lock held.  In turn, the value for a
+/// missing key has to be created with no shard locked, and then published
+/// with insert(), which keeps whichever value got there first.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT> >
+class ShardedUniqueMap {
+public:
+  typedef DenseMap<KeyT, ValueT, KeyInfoT> MapTy;
+  enum { ShardBits = 4, NumShards = 1 << ShardBits };
+
+private:
+  struct Shard {
+    sys::MutexImpl Lock;
+    MapTy Map;
+    Shard() : Lock(/*recursive=*/false) {}
+  };
+
+  const bool &Multithreaded;
+  Shard Shards[NumShards];
+
+  ShardedUniqueMap(const ShardedUniqueMap &) LLVM_DELETED_FUNCTION;
+  void operator=(const ShardedUniqueMap &) LLVM_DELETED_FUNCTION;
+
+  Shard &getShard(const KeyT &Key) {
+    // The shard's DenseMap buckets by the low bits of the hash, so pick the
+    // shard from the high bits of a scrambled copy.
+    unsigned Hash = KeyInfoT::getHashValue(Key) * 0x9E3779B9U;
+    return Shards[Hash >> (32 - ShardBits)];
+  }
+
+public:
+  /// Multithreaded - The owning context's flag; shards are only locked while
+  /// it is set.
+  explicit ShardedUniqueMap(const bool &Multithreaded)
+    : Multithreaded(Multithreaded) {}
+
+  /// lookup - Return the value for \p Key, or a default-constructed value if
+  /// there is none.
+  ValueT lookup(const KeyT &Key) {
+    Shard &S = getShard(Key);
+    if (!Multithreaded)
+      return S.Map.lookup(Key);
+    S.Lock.acquire();
+    ValueT V = S.Map.lookup(Key);
+    S.Lock.release();
+    return V;
+  }
+
+  /// insert - Map \p Key to \p V unless another value was inserted for it
+  /// first, and return the value the table ends up holding.
+  ValueT insert(const KeyT &Key, const ValueT &V) {
+    Shard &S = getShard(Key);
+    if (!Multithreaded)
+      return S.Map.insert(std::make_pair(Key, V)).first->second;
+    S.Lock.acquire();
+    ValueT Result = S.Map.insert(std::make_pair(Key, V)).first->second;
+    S.Lock.release();
+    return Result;
+  }
+
+  /// getShardMap - Return the table of shard \p I.  Only for use while no
+  /// other thread can touch the map, e.g. when tearing the context down.
+  MapTy &getShardMap(unsigned I) { return Shards[I].Map; }
+};
+
 /// DebugRecVH - This is a CallbackVH used to keep the Scope -> index maps
 /// up to date as MDNodes mutate.  This class is implemented in DebugLoc.cpp.
 class DebugRecVH : public CallbackVH {
@@ -242,19 +314,37 @@ public:
   LLVMContext::DiagnosticHandlerTy DiagnosticHandler;
   void *DiagnosticContext;
 
-  typedef DenseMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt *,
-                   DenseMapAPIntKeyInfo> IntMapTy;
+  /// Multithreaded - True while several threads may be working on modules
+  /// owned by this context at once.  See LLVMContext::setMultithreaded.
+  bool Multithreaded;
+
+  /// FunctionArenas - True if function bodies are allocated from arenas.
+  /// See LLVMContext::setFunctionArenas.
+  bool FunctionArenas;
+
+  /// Lock - Recursive lock protecting the uniquing tables, value handle lists
+  /// and other context-wide state below, except for the ShardedUniqueMaps,
+  /// which lock themselves.  It is only taken while the context is
+  /// multithreaded; use ContextLockGuard rather than locking it directly.
+  sys::MutexImpl Lock;
+
+  // Integer and FP constants and the address space 0 pointer types are looked
+  // up far more often than anything else, so they live in sharded tables.
+  typedef ShardedUniqueMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt *,
+                           DenseMapAPIntKeyInfo> IntMapTy;
   IntMapTy IntConstants;
   
-  typedef DenseMap<DenseMapAPFloatKeyInfo::KeyTy, ConstantFP*, 
-                         DenseMapAPFloatKeyInfo> FPMapTy;
+  typedef ShardedUniqueMap<DenseMapAPFloatKeyInfo::KeyTy, ConstantFP*,
+                           DenseMapAPFloatKeyInfo> FPMapTy;
   FPMapTy FPConstants;
 
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeSetImpl> AttrsLists;
   FoldingSet<AttributeSetNode> AttrsSetNodes;
 
-  StringMap<Value*> MDStringCache;
+  // MDStrings live as long as the context, so their entries, which are also
+  // their names, come from an arena.
+  StringMap<Value*, BumpPtrAllocator> MDStringCache;
 
   FoldingSet<MDNode> MDNodeSet;
 
@@ -315,7 +405,7 @@ public:
     
   DenseMap<std::pair<Type *, uint64_t>, ArrayType*> ArrayTypes;
   DenseMap<std::pair<Type *, unsigned>, VectorType*> VectorTypes;
-  DenseMap<Type*, PointerType*> PointerTypes;  // Pointers in AddrSpace = 0
+  ShardedUniqueMap<Type*, PointerType*> PointerTypes;  // AddrSpace = 0
   DenseMap<std::pair<Type*, unsigned>, PointerType*> ASPointerTypes;
 
 
@@ -374,6 +464,32 @@ public:
   ~LLVMContextImpl();
 };
 
+/// ContextLockGuard - Scoped lock for the context-wide tables in
+/// LLVMContextImpl.  This is a no-op unless the context is multithreaded, so
+/// single-threaded clients keep paying nothing for it.
+class ContextLockGuard {
+  LLVMContextImpl *Impl;
+  bool Locked;
+
+  ContextLockGuard(const ContextLockGuard &) LLVM_DELETED_FUNCTION;
+  void operator=(const ContextLockGuard &) LLVM_DELETED_FUNCTION;
+public:
+  explicit ContextLockGuard(LLVMContextImpl *Impl, bool Enable = true)
+    : Impl(Impl), Locked(Enable && Impl->Multithreaded) {
+    if (Locked)
+      Impl->Lock.acquire();
+  }
+  explicit ContextLockGuard(LLVMContext &C)
+    : Impl(C.pImpl), Locked(Impl->Multithreaded) {
+    if (Locked)
+      Impl->Lock.acquire();
+  }
+  ~ContextLockGuard() {
+    if (Locked)
+      Impl->Lock.release();
+  }
+};
+
 }
 
 #endif
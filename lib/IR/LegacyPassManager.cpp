@@ -12,16 +12,22 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/FunctionArena.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/LegacyPassManagers.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassProfiler.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -81,6 +87,11 @@ PrintAfterAll("print-after-all",
               llvm::cl::desc("Print IR after each pass"),
               cl::init(false));
 
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads", cl::Hidden, cl::init(1),
+  cl::desc("Run function passes on this many threads, one function per "
+           "thread at a time (0 = one thread per hardware thread)"));
+
 /// This is a helper to determine whether to print IR before or
 /// after a pass.
 
@@ -162,6 +173,10 @@ public:
   explicit BBPassManager()
     : PMDataManager(), FunctionPass(ID) {}
 
+  /// clone - Return an empty manager; PMDataManager::clonePass fills it with
+  /// copies of the contained passes.
+  virtual Pass *clone() const { return new BBPassManager(); }
+
   /// Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the function, and if so, return true.
   bool runOnFunction(Function &F);
@@ -643,6 +658,7 @@ void PMTopLevelManager::schedulePass(Pass *P) {
 
         assert(PI && "Expected required passes to be initialized");
         AnalysisPass = PI->createPass();
+        noteImplicitPass(AnalysisPass);
         if (P->getPotentialPassManagerType () ==
             AnalysisPass->getPotentialPassManagerType())
           // Schedule analysis pass that is managed by the same pass manager.
@@ -654,10 +670,12 @@ void PMTopLevelManager::schedulePass(Pass *P) {
           // Recheck analysis passes to ensure that required analyses that
           // are already checked are still available.
           checkAnalysis = true;
-        } else
+        } else {
           // Do not schedule this analysis. Lower level analsyis
           // passes are run on the fly.
+          ImplicitPasses.erase(AnalysisPass);
           delete AnalysisPass;
+        }
       }
     }
   }
@@ -927,6 +945,18 @@ void PMDataManager::removeNotPreservedAnalysis(Pass *P) {
 void PMDataManager::removeDeadPasses(Pass *P, StringRef Msg,
                                      enum PassDebuggingString DBG_STR) {
 
+  // Copies made for workers are unknown to the top level manager, so free
+  // whatever the corresponding original pass is the last user of.
+  if (!this->DeadPasses.empty()) {
+    unsigned Index = std::find(PassVector.begin(), PassVector.end(), P) -
+                     PassVector.begin();
+    assert(Index < this->DeadPasses.size() && "Pass is not contained here!");
+    const SmallVectorImpl<unsigned> &Dead = this->DeadPasses[Index];
+    for (unsigned I = 0, E = Dead.size(); I != E; ++I)
+      freePass(PassVector[Dead[I]], Msg, DBG_STR);
+    return;
+  }
+
   SmallVector<Pass *, 12> DeadPasses;
 
   // If this is a on the fly manager then it does not have TPM.
@@ -1041,6 +1071,7 @@ void PMDataManager::add(Pass *P, bool ProcessAnalysis) {
          E = ReqAnalysisNotAvailable.end() ;I != E; ++I) {
     const PassInfo *PI = PassRegistry::getPassRegistry()->getPassInfo(*I);
     Pass *AnalysisPass = PI->createPass();
+    TPM->noteImplicitPass(AnalysisPass);
     this->addLowerLevelRequiredPass(P, AnalysisPass);
   }
 
@@ -1112,9 +1143,11 @@ Pass *PMDataManager::findAnalysisPass(AnalysisID AID, bool SearchParent) {
   if (I != AvailableAnalysis.end())
     return I->second;
 
-  // Search Parents through TopLevelManager
+  // Search Parents through TopLevelManager, or through the manager a copy
+  // made for a worker runs in.
   if (SearchParent)
-    return TPM->findAnalysisPass(AID);
+    return WorkerParent ? WorkerParent->findAnalysisPass(AID, true)
+                        : TPM->findAnalysisPass(AID);
 
   return NULL;
 }
@@ -1306,6 +1339,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassProfileRegion Profile(BP, *I);
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1482,6 +1516,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassProfiler::startIfRequested();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
@@ -1498,6 +1533,7 @@ bool FunctionPassManagerImpl::run(Function &F) {
 // FPPassManager implementation
 
 char FPPassManager::ID = 0;
+char ParallelSectionPass::ID = 0;
 /// Print passes managed by this manager
 void FPPassManager::dumpPassStructure(unsigned Offset) {
   dbgs().indent(Offset*2) << "FunctionPass Manager\n";
@@ -1516,12 +1552,17 @@ bool FPPassManager::runOnFunction(Function &F) {
   if (F.isDeclaration())
     return false;
 
+  return runPasses(F, 0, getNumContainedPasses());
+}
+
+bool FPPassManager::runPasses(Function &F, unsigned First, unsigned Last) {
   bool Changed = false;
+  FunctionArenaScope ArenaScope(F);
 
   // Collect inherited analysis from Module level pass manager.
   populateInheritedAnalysis(TPM->activeStack);
 
-  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+  for (unsigned Index = First; Index < Last; ++Index) {
     FunctionPass *FP = getContainedPass(Index);
     bool LocalChanged = false;
 
@@ -1533,6 +1574,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassProfileRegion Profile(FP, F);
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1551,6 +1593,16 @@ bool FPPassManager::runOnFunction(Function &F) {
 }
 
 bool FPPassManager::runOnModule(Module &M) {
+  unsigned Begin, End;
+  if (ParallelSectionPass *Marker = findParallelSection(Begin, End))
+    return runOnModuleWithSection(M, Marker, Begin, End);
+
+  unsigned NumThreads = FunctionPassThreads;
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  if (NumThreads > 1 && canRunInParallel())
+    return runOnModuleInParallel(M, NumThreads);
+
   bool Changed = false;
 
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
@@ -1559,6 +1611,420 @@ bool FPPassManager::runOnModule(Module &M) {
   return Changed;
 }
 
+FPPassManager::~FPPassManager() {
+  for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+    delete Workers[I];
+  for (unsigned I = 0, E = SectionWorkers.size(); I != E; ++I)
+    delete SectionWorkers[I];
+}
+
+/// needsSerialPassOrder - Return true if an option relies on the passes
+/// running one at a time in pipeline order.
+static bool needsSerialPassOrder() {
+  return TimePassesIsEnabled || PassDebugging >= Executions ||
+         PrintBeforeAll || PrintAfterAll ||
+         !PrintBefore.empty() || !PrintAfter.empty();
+}
+
+bool FPPassManager::canRunInParallel() {
+  return !needsSerialPassOrder() && getNumContainedPasses() != 0;
+}
+
+Pass *PMDataManager::clonePass(Pass *P) {
+  if (PMDataManager *PM = P->getAsPMDataManager()) {
+    // A nested manager clones into an empty manager of the same kind, which
+    // then gets copies of the passes the original contains.
+    Pass *Copy = P->clone();
+    if (!Copy)
+      return 0;
+    PMDataManager *CopyPM = Copy->getAsPMDataManager();
+    CopyPM->setTopLevelManager(TPM);
+    CopyPM->setDepth(PM->getDepth());
+    PM->collectDeadPasses(CopyPM->DeadPasses);
+    for (unsigned Index = 0; Index < PM->getNumContainedPasses(); ++Index) {
+      Pass *Contained = PM->clonePass(PM->PassVector[Index]);
+      if (!Contained) {
+        delete Copy;
+        return 0;
+      }
+      CopyPM->addCopy(Contained);
+    }
+    return Copy;
+  }
+
+  if (Pass *Copy = P->clone())
+    return Copy;
+
+  // Analyses the pass manager scheduled on its own were default constructed
+  // from the registry, so another registry instance is an exact copy.
+  // Anything else may have been given constructor arguments.
+  if (!TPM->isImplicitPass(P))
+    return 0;
+  const PassInfo *PI =
+      PassRegistry::getPassRegistry()->getPassInfo(P->getPassID());
+  if (!PI || !PI->getNormalCtor())
+    return 0;
+  return PI->createPass();
+}
+
+void PMDataManager::addCopy(Pass *Copy) {
+  add(Copy, /*ProcessAnalysis=*/false);
+  // The top level manager caches analysis usage lazily; fill the cache now
+  // while only this thread touches it.
+  TPM->findAnalysisUsage(Copy);
+  if (PMDataManager *PM = Copy->getAsPMDataManager())
+    PM->WorkerParent = this;
+}
+
+void PMDataManager::collectDeadPasses(
+    std::vector<SmallVector<unsigned, 4> > &Dead) {
+  DenseMap<Pass *, unsigned> IndexOf;
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index)
+    IndexOf[PassVector[Index]] = Index;
+
+  Dead.assign(getNumContainedPasses(), SmallVector<unsigned, 4>());
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    SmallVector<Pass *, 12> LastUses;
+    TPM->collectLastUses(LastUses, PassVector[Index]);
+    for (unsigned I = 0, E = LastUses.size(); I != E; ++I) {
+      DenseMap<Pass *, unsigned>::iterator It = IndexOf.find(LastUses[I]);
+      if (It != IndexOf.end())
+        Dead[Index].push_back(It->second);
+    }
+  }
+}
+
+void PMDataManager::removeNotPreservedByNestedPasses(PMDataManager &PM) {
+  for (unsigned Index = 0; Index < PM.getNumContainedPasses(); ++Index) {
+    Pass *P = PM.PassVector[Index];
+    removeNotPreservedAnalysis(P);
+    if (PMDataManager *Nested = P->getAsPMDataManager())
+      removeNotPreservedByNestedPasses(*Nested);
+  }
+}
+
+bool FPPassManager::createWorkers(unsigned NumWorkers) {
+  if (Workers.size() >= NumWorkers)
+    return true;
+
+  // Work out which contained passes become dead after each pass.
+  std::vector<SmallVector<unsigned, 4> > Dead;
+  collectDeadPasses(Dead);
+
+  while (Workers.size() < NumWorkers) {
+    SmallVector<Pass *, 32> Copies;
+    for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+      Pass *P = clonePass(PassVector[Index]);
+      if (!P) {
+        DeleteContainerPointers(Copies);
+        return false;
+      }
+      assert(P->getPassID() == PassVector[Index]->getPassID() &&
+             "Pass cloned into a different kind of pass!");
+      Copies.push_back(P);
+    }
+
+    // The worker mirrors the schedule of this manager pass for pass,
+    // including the analyses scheduled for it, so its copies are added
+    // without scheduling their analyses again.  Doing so would create
+    // further analysis instances and register the copies as last users with
+    // the top level manager; the dead pass table stands in for the latter.
+    // Copies of nested managers look up the analyses of the functions they
+    // run on in the worker.
+    FPPassManager *W = new FPPassManager();
+    W->setTopLevelManager(TPM);
+    W->setDepth(getDepth());
+    W->DeadPasses = Dead;
+    for (unsigned Index = 0, E = Copies.size(); Index != E; ++Index)
+      W->addCopy(Copies[Index]);
+    Workers.push_back(W);
+  }
+  return true;
+}
+
+/// mapAnalyses - Copy the available analysis table From of manager FromPM
+/// into To, replacing passes contained in FromPM with the pass at the same
+/// position in ToPM.  Analyses provided by other managers are kept as is.
+static void mapAnalyses(const DenseMap<AnalysisID, Pass *> &From,
+                        FPPassManager &FromPM,
+                        DenseMap<AnalysisID, Pass *> &To,
+                        FPPassManager &ToPM) {
+  DenseMap<Pass *, unsigned> IndexOf;
+  for (unsigned Index = 0; Index < FromPM.getNumContainedPasses(); ++Index)
+    IndexOf[FromPM.getContainedPass(Index)] = Index;
+
+  To.clear();
+  for (DenseMap<AnalysisID, Pass *>::const_iterator I = From.begin(),
+       E = From.end(); I != E; ++I) {
+    DenseMap<Pass *, unsigned>::iterator It = IndexOf.find(I->second);
+    To[I->first] = It == IndexOf.end() ? I->second
+                                       : ToPM.getContainedPass(It->second);
+  }
+}
+
+bool FPPassManager::runOnModuleInParallel(Module &M, unsigned NumThreads) {
+  SmallVector<Function *, 64> Functions;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Functions.push_back(I);
+  if (Functions.empty())
+    return false;
+  if (NumThreads > Functions.size())
+    NumThreads = Functions.size();
+
+  if (!createWorkers(NumThreads)) {
+    bool Changed = false;
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+      Changed |= runOnFunction(*I);
+    return Changed;
+  }
+  if (!WorkersInitialized) {
+    for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+      Workers[I]->doInitialization(M);
+    WorkersInitialized = true;
+  }
+
+  // Every worker starts from the analyses this manager has available, with
+  // its own instances standing in for the contained passes.  While the
+  // workers run, this manager advertises nothing, so that lookups through the
+  // top level manager never hand out the original passes.
+  DenseMap<AnalysisID, Pass *> &Available = *getAvailableAnalysis();
+  for (unsigned I = 0; I != NumThreads; ++I)
+    mapAnalyses(Available, *this, *Workers[I]->getAvailableAnalysis(),
+                *Workers[I]);
+  Available.clear();
+
+  // Invalidate the inherited analyses that the passes, including those of
+  // nested managers, do not preserve now, as running them on the first
+  // function would, so that the workers only ever read the tables shared
+  // with the parent managers.
+  populateInheritedAnalysis(TPM->activeStack);
+  removeNotPreservedByNestedPasses(*this);
+
+  LLVMContext &Ctx = M.getContext();
+  bool WasMultithreaded = Ctx.isMultithreaded();
+  Ctx.setMultithreaded(true);
+
+  volatile sys::cas_flag NextFunction = 0;
+  SmallVector<bool, 8> WorkerChanged(NumThreads, false);
+  // The worker that handled the last function leaves the analysis state this
+  // manager would have ended up with when running serially.
+  unsigned LastWorker = 0;
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0; I != NumThreads; ++I) {
+      Pool.async([&, I] {
+        FPPassManager *W = Workers[I];
+        while (true) {
+          unsigned FI = sys::AtomicIncrement(&NextFunction) - 1;
+          if (FI >= Functions.size())
+            break;
+          if (FI == Functions.size() - 1)
+            LastWorker = I;
+          WorkerChanged[I] |= W->runOnFunction(*Functions[FI]);
+        }
+      });
+    }
+    Pool.wait();
+  }
+
+  Ctx.setMultithreaded(WasMultithreaded);
+
+  mapAnalyses(*Workers[LastWorker]->getAvailableAnalysis(), *Workers[LastWorker],
+              Available, *this);
+
+  bool Changed = false;
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Changed |= WorkerChanged[I];
+  return Changed;
+}
+
+ParallelSectionPass *FPPassManager::findParallelSection(unsigned &Begin,
+                                                        unsigned &End) {
+  if (needsSerialPassOrder())
+    return 0;
+
+  ParallelSectionPass *Marker = 0;
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    if (FP->getPassID() != &ParallelSectionPass::ID)
+      continue;
+    ParallelSectionPass *P = static_cast<ParallelSectionPass *>(FP);
+    if (P->isBegin()) {
+      Marker = P;
+      Begin = Index;
+    } else if (Marker) {
+      End = Index;
+      if (End == Begin + 1 || Marker->getNumThreads() <= 1)
+        return 0;
+      return Marker;
+    }
+  }
+  return 0;
+}
+
+bool FPPassManager::createSectionWorkers(unsigned NumWorkers,
+                                         ParallelSectionPass *Marker,
+                                         unsigned Begin, unsigned End) {
+  if (SectionWorkers.size() >= NumWorkers)
+    return true;
+
+  ArrayRef<Pass *> Section(&PassVector[Begin + 1], End - Begin - 1);
+  for (unsigned Index = 0; Index < Section.size(); ++Index)
+    if (Section[Index]->getAsPMDataManager())
+      return false;
+
+  // Work out which section passes become dead after each section pass; the
+  // ones before and after the section are freed by this manager.
+  DenseMap<Pass *, unsigned> IndexOf;
+  for (unsigned Index = 0; Index < Section.size(); ++Index)
+    IndexOf[Section[Index]] = Index;
+
+  std::vector<SmallVector<unsigned, 4> > Dead(Section.size());
+  for (unsigned Index = 0; Index < Section.size(); ++Index) {
+    SmallVector<Pass *, 12> LastUses;
+    TPM->collectLastUses(LastUses, Section[Index]);
+    for (unsigned I = 0, E = LastUses.size(); I != E; ++I) {
+      DenseMap<Pass *, unsigned>::iterator It = IndexOf.find(LastUses[I]);
+      if (It != IndexOf.end())
+        Dead[Index].push_back(It->second);
+    }
+  }
+
+  while (SectionWorkers.size() < NumWorkers) {
+    SmallVector<Pass *, 32> Copies;
+    Marker->createSectionPasses(Section, Copies);
+    assert(Copies.size() == Section.size() && "Wrong number of copies!");
+    bool Complete = true;
+    for (unsigned Index = 0; Index < Section.size(); ++Index) {
+      if (Copies[Index])
+        continue;
+      Copies[Index] = clonePass(Section[Index]);
+      if (!Copies[Index])
+        Complete = false;
+    }
+    if (!Complete) {
+      DeleteContainerPointers(Copies);
+      return false;
+    }
+
+    FPPassManager *W = new FPPassManager();
+    W->setTopLevelManager(TPM);
+    W->setDepth(getDepth());
+    W->DeadPasses = Dead;
+    for (unsigned Index = 0; Index < Section.size(); ++Index)
+      W->addCopy(Copies[Index]);
+    SectionWorkers.push_back(W);
+  }
+  return true;
+}
+
+bool FPPassManager::runOnModuleWithSection(Module &M,
+                                           ParallelSectionPass *Marker,
+                                           unsigned Begin, unsigned End) {
+  SmallVector<Function *, 64> Functions;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Functions.push_back(I);
+  unsigned NumThreads = std::min<size_t>(Marker->getNumThreads(),
+                                         Functions.size());
+
+  if (NumThreads <= 1 ||
+      !createSectionWorkers(NumThreads, Marker, Begin, End)) {
+    bool Changed = false;
+    for (unsigned I = 0, E = Functions.size(); I != E; ++I)
+      Changed |= runOnFunction(*Functions[I]);
+    return Changed;
+  }
+
+  if (!WorkersInitialized) {
+    for (unsigned I = 0, E = SectionWorkers.size(); I != E; ++I)
+      SectionWorkers[I]->doInitialization(M);
+    WorkersInitialized = true;
+  }
+
+  // Passes before the section that are last used inside it are freed once
+  // the workers are done with a batch.
+  SmallVector<Pass *, 8> EnteringDead;
+  for (unsigned Index = Begin + 1; Index < End; ++Index) {
+    SmallVector<Pass *, 12> LastUses;
+    TPM->collectLastUses(LastUses, PassVector[Index]);
+    for (unsigned I = 0, E = LastUses.size(); I != E; ++I)
+      if (std::find(PassVector.begin(), PassVector.begin() + Begin,
+                    LastUses[I]) != PassVector.begin() + Begin &&
+          std::find(EnteringDead.begin(), EnteringDead.end(), LastUses[I]) ==
+              EnteringDead.end())
+        EnteringDead.push_back(LastUses[I]);
+  }
+
+  LLVMContext &Ctx = M.getContext();
+  bool WasMultithreaded = Ctx.isMultithreaded();
+  DenseMap<AnalysisID, Pass *> &Available = *getAvailableAnalysis();
+  DenseMap<AnalysisID, Pass *> Entering;
+  SmallVector<bool, 8> WorkerChanged(NumThreads, false);
+  bool Changed = false;
+
+  // Functions go through the section in batches, which bounds how many of
+  // them are in flight while keeping every thread busy.
+  const unsigned FunctionsPerThread = 8;
+  unsigned BatchSize = NumThreads * FunctionsPerThread;
+  ThreadPool Pool(NumThreads);
+  for (unsigned First = 0; First < Functions.size(); First += BatchSize) {
+    ArrayRef<Function *> Batch = makeArrayRef(Functions).slice(
+        First, std::min<size_t>(BatchSize, Functions.size() - First));
+
+    for (unsigned I = 0, E = Batch.size(); I != E; ++I) {
+      Changed |= runPasses(*Batch[I], 0, Begin + 1);
+      initializeAnalysisImpl(Marker);
+      Marker->enterSection(*Batch[I]);
+    }
+
+    // The workers start every function from the analyses available on
+    // entry to the section.  Invalidate the inherited analyses the section
+    // does not preserve up front, so that the workers only ever read the
+    // tables shared with the parent managers; this manager is idle until
+    // they are done.
+    Entering = Available;
+    populateInheritedAnalysis(TPM->activeStack);
+    for (unsigned Index = Begin + 1; Index < End; ++Index)
+      removeNotPreservedAnalysis(getContainedPass(Index));
+
+    Ctx.setMultithreaded(true);
+    volatile sys::cas_flag NextFunction = 0;
+    for (unsigned I = 0; I != NumThreads; ++I) {
+      Pool.async([&, I] {
+        FPPassManager *W = SectionWorkers[I];
+        while (true) {
+          unsigned FI = sys::AtomicIncrement(&NextFunction) - 1;
+          if (FI >= Batch.size())
+            break;
+          Function &F = *Batch[FI];
+          *W->getAvailableAnalysis() = Entering;
+          Marker->beginWorker(F);
+          WorkerChanged[I] |= W->runPasses(F, 0, W->getNumContainedPasses());
+          Marker->endWorker(F);
+        }
+      });
+    }
+    Pool.wait();
+    Ctx.setMultithreaded(WasMultithreaded);
+
+    for (unsigned I = 0, E = EnteringDead.size(); I != E; ++I)
+      freePass(EnteringDead[I], Batch.back()->getName(), ON_FUNCTION_MSG);
+
+    for (unsigned I = 0, E = Batch.size(); I != E; ++I) {
+      Available = Entering;
+      initializeAnalysisImpl(Marker);
+      Marker->leaveSection(*Batch[I]);
+      Changed |= runPasses(*Batch[I], End, getNumContainedPasses());
+    }
+  }
+
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Changed |= WorkerChanged[I];
+  return Changed;
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1571,6 +2037,14 @@ bool FPPassManager::doInitialization(Module &M) {
 bool FPPassManager::doFinalization(Module &M) {
   bool Changed = false;
 
+  if (WorkersInitialized) {
+    for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+      Changed |= Workers[I]->doFinalization(M);
+    for (unsigned I = 0, E = SectionWorkers.size(); I != E; ++I)
+      Changed |= SectionWorkers[I]->doFinalization(M);
+    WorkersInitialized = false;
+  }
+
   for (int Index = getNumContainedPasses() - 1; Index >= 0; --Index)
     Changed |= getContainedPass(Index)->doFinalization(M);
 
@@ -1611,6 +2085,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassProfileRegion Profile(MP, M);
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1695,6 +2170,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassProfiler::startIfRequested();
 
   dumpArguments();
   dumpPasses();
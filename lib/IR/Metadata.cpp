@@ -38,6 +38,7 @@ MDString::MDString(LLVMContext &C)
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl);
   StringMapEntry<Value*> &Entry =
     pImpl->MDStringCache.GetOrCreateValue(Str);
   Value *&S = Entry.getValue();
@@ -135,6 +136,7 @@ MDNode::~MDNode() {
   assert((getSubclassDataFromValue() & DestroyFlag) != 0 &&
          "Not being destroyed through destroy()?");
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   if (isNotUniqued()) {
     pImpl->NonUniquedMDNodes.erase(this);
   } else {
@@ -218,6 +220,7 @@ static bool isFunctionLocalValue(Value *V) {
 MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
                           FunctionLocalness FL, bool Insert) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl);
 
   // Add all the operand pointers. Note that we don't have to add the
   // isFunctionLocal bit because that's implied by the operands.
@@ -322,11 +325,13 @@ void MDNode::Profile(FoldingSetNodeID &ID) const {
 void MDNode::setIsNotUniqued() {
   setValueSubclassData(getSubclassDataFromValue() | NotUniquedBit);
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   pImpl->NonUniquedMDNodes.insert(this);
 }
 
 // Replace value from this node's operand list.
 void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
+  ContextLockGuard Guard(getContext());
   Value *From = *Op;
 
   // If is possible that someone did GV->RAUW(inst), replacing a global variable
@@ -595,6 +600,7 @@ void Instruction::dropUnknownMetadata(ArrayRef<unsigned> KnownIDs) {
   if (!hasMetadataHashEntry())
     return; // Nothing to remove!
 
+  ContextLockGuard Guard(getContext());
   DenseMap<const Instruction *, LLVMContextImpl::MDMapTy> &MetadataStore =
       getContext().pImpl->MetadataStore;
 
@@ -639,7 +645,9 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     DbgLoc = DebugLoc::getFromDILocation(Node);
     return;
   }
-  
+
+  ContextLockGuard Guard(getContext());
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
@@ -693,7 +701,8 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
     return DbgLoc.getAsMDNode(getContext());
   
   if (!hasMetadataHashEntry()) return 0;
-  
+
+  ContextLockGuard Guard(getContext());
   LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -714,7 +723,8 @@ void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
                                     DbgLoc.getAsMDNode(getContext())));
     if (!hasMetadataHashEntry()) return;
   }
-  
+
+  ContextLockGuard Guard(getContext());
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
@@ -733,6 +743,7 @@ void Instruction::
 getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                     MDNode*> > &Result) const {
   Result.clear();
+  ContextLockGuard Guard(getContext());
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
          "Shouldn't have called this");
@@ -750,6 +761,7 @@ getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  ContextLockGuard Guard(getContext());
   getContext().pImpl->MetadataStore.erase(this);
   setHasMetadataHashEntry(false);
 }
@@ -772,6 +784,7 @@ MDNode *Type::getMetadataImpl(StringRef Kind) const {
 /// Node is null.
 void Type::setMetadata(unsigned KindID, MDNode *Node) {
   if (Node == 0 && !hasMetadata()) return;
+  ContextLockGuard Guard(getContext());
   
   // Handle the case when we're adding/updating metadata on a type.
   if (Node) {
@@ -822,7 +835,8 @@ void Type::setMetadata(unsigned KindID, MDNode *Node) {
 
 MDNode *Type::getMetadataImpl(unsigned KindID) const {
   if (!hasMetadataHashEntry()) return 0;
-  
+
+  ContextLockGuard Guard(getContext());
   LLVMContextImpl::MDMapTy &Info = getContext().pImpl->TypeMetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
   
@@ -836,6 +850,7 @@ MDNode *Type::getMetadataImpl(unsigned KindID) const {
 void Type::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
 							MDNode*> > &Result) const {
   Result.clear();
+  ContextLockGuard Guard(getContext());
   
   assert(hasMetadataHashEntry() &&
 	 getContext().pImpl->TypeMetadataStore.count(this) &&
@@ -855,6 +870,7 @@ void Type::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
 /// this instruction.
 void Type::clearMetadataHashEntries() {
   assert(hasMetadataHashEntry() && "Caller should check");
+  ContextLockGuard Guard(getContext());
   getContext().pImpl->TypeMetadataStore.erase(this);
   setHasMetadataHashEntry(false);
 }
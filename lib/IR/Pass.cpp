@@ -97,6 +97,11 @@ PMDataManager *Pass::getAsPMDataManager() {
   return 0;
 }
 
+Pass *Pass::clone() const {
+  // By default, passes cannot be copied.
+  return 0;
+}
+
 void Pass::setResolver(AnalysisResolver *AR) {
   assert(!Resolver && "Resolver is already set");
   Resolver = AR;
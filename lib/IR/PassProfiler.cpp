@@ -0,0 +1,369 @@
+//===- PassProfiler.cpp - Record the cost of each pass run ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the PassProfiler and its JSON and Chrome trace-event
+// output.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/PassProfiler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<std::string>
+PassProfileFile("pass-profile", cl::value_desc("filename"),
+  cl::desc("Record the time, instruction count change and memory change of "
+           "each pass run, and write them to <filename> on exit"));
+
+static cl::opt<PassProfiler::OutputFormat>
+PassProfileFormat("pass-profile-format",
+  cl::desc("Format of the -pass-profile output"),
+  cl::init(PassProfiler::JSON),
+  cl::values(clEnumValN(PassProfiler::JSON, "json",
+                        "JSON with every pass run and totals per pass"),
+             clEnumValN(PassProfiler::ChromeTrace, "chrome",
+                        "Chrome trace-event format"),
+             clEnumValEnd));
+
+volatile sys::cas_flag PassProfiler::Started = 0;
+
+namespace {
+
+/// PassRun - One recorded run of a pass.
+struct PassRun {
+  std::string Pass;
+  std::string Unit;
+  const char *Kind;
+  unsigned Thread;
+  uint64_t Start;
+  uint64_t Duration;
+  uint64_t InstructionsBefore;
+  uint64_t InstructionsAfter;
+  int64_t MemoryDelta;
+};
+
+/// PassTotal - The sum of the runs of one pass.
+struct PassTotal {
+  StringRef Pass;
+  unsigned NumRuns;
+  uint64_t Duration;
+  int64_t InstructionDelta;
+  int64_t MemoryDelta;
+};
+
+/// PassProfile - The runs recorded since the profiler was last started.
+struct PassProfile {
+  sys::SmartMutex<true> Lock;
+  std::vector<PassRun> Runs;
+
+  /// The time the profiler was started at, in microseconds.  Run start times
+  /// are relative to it.
+  uint64_t Origin;
+
+  /// Numbers the threads that run passes in the order they first do, as
+  /// trace viewers want small thread ids.  The thread local holds the number
+  /// plus one, so that zero means none assigned yet.
+  sys::ThreadLocal<const void> ThreadNumber;
+  volatile sys::cas_flag NumThreads;
+
+  PassProfile() : Origin(0), NumThreads(0) {}
+
+  unsigned getThreadNumber() {
+    uintptr_t N = reinterpret_cast<uintptr_t>(ThreadNumber.get());
+    if (N == 0) {
+      N = sys::AtomicIncrement(&NumThreads);
+      ThreadNumber.set(reinterpret_cast<const void *>(N));
+    }
+    return N - 1;
+  }
+};
+
+}
+
+/// writeRequestedProfile - Write the profile to the -pass-profile file.
+static void writeRequestedProfile() {
+  std::string ErrMsg;
+  if (PassProfiler::write(PassProfileFile, PassProfileFormat, ErrMsg))
+    errs() << "error: cannot write pass profile: " << ErrMsg << '\n';
+}
+
+namespace {
+/// PassProfileWriter - Writes the profile to the -pass-profile file when it
+/// is destroyed at llvm_shutdown.
+struct PassProfileWriter {
+  ~PassProfileWriter() { writeRequestedProfile(); }
+};
+
+}
+
+static ManagedStatic<PassProfile> Profile;
+static ManagedStatic<PassProfileWriter> ProfileWriter;
+
+static uint64_t getTimeInMicroseconds() {
+  return sys::TimeValue::now().usec();
+}
+
+void PassProfiler::start() {
+  sys::SmartScopedLock<true> Lock(Profile->Lock);
+  Profile->Runs.clear();
+  Profile->Origin = getTimeInMicroseconds();
+  sys::CompareAndSwap(&Started, 1, 0);
+}
+
+void PassProfiler::stop() {
+  sys::CompareAndSwap(&Started, 0, 1);
+}
+
+void PassProfiler::startIfRequested() {
+  if (PassProfileFile.empty() || Started)
+    return;
+  start();
+  // Constructed after the profile, so that it is destroyed before it.
+  *ProfileWriter;
+}
+
+void PassProfiler::writeIfRequested() {
+  if (PassProfileFile.empty() || !Started)
+    return;
+  writeRequestedProfile();
+}
+
+/// printJSONString - Print \p S as a quoted JSON string.
+static void printJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (StringRef::iterator I = S.begin(), E = S.end(); I != E; ++I) {
+    unsigned char C = *I;
+    switch (C) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (C < 0x20)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+    }
+  }
+  OS << '"';
+}
+
+/// printRunCounters - Print the instruction counts and memory change of
+/// \p Run as JSON members.
+static void printRunCounters(raw_ostream &OS, const PassRun &Run) {
+  OS << "\"instructions_before\": " << Run.InstructionsBefore
+     << ", \"instructions_after\": " << Run.InstructionsAfter
+     << ", \"malloc_delta\": " << Run.MemoryDelta;
+}
+
+static void printJSON(raw_ostream &OS, const std::vector<PassRun> &Runs) {
+  OS << "{\n  \"runs\": [";
+  for (unsigned I = 0, E = Runs.size(); I != E; ++I) {
+    const PassRun &Run = Runs[I];
+    OS << (I ? ",\n" : "\n") << "    {\"pass\": ";
+    printJSONString(OS, Run.Pass);
+    OS << ", \"kind\": \"" << Run.Kind << "\", \"unit\": ";
+    printJSONString(OS, Run.Unit);
+    OS << ", \"thread\": " << Run.Thread << ", \"start_us\": " << Run.Start
+       << ", \"wall_us\": " << Run.Duration << ", ";
+    printRunCounters(OS, Run);
+    OS << '}';
+  }
+  OS << "\n  ],\n";
+
+  // Sum up the runs of each pass, keeping the passes in the order they first
+  // ran in.
+  std::vector<PassTotal> Totals;
+  StringMap<unsigned> TotalIndex;
+  for (unsigned I = 0, E = Runs.size(); I != E; ++I) {
+    const PassRun &Run = Runs[I];
+    unsigned Index = TotalIndex.GetOrCreateValue(Run.Pass, Totals.size())
+                         .getValue();
+    if (Index == Totals.size()) {
+      PassTotal T = { Run.Pass, 0, 0, 0, 0 };
+      Totals.push_back(T);
+    }
+    PassTotal &T = Totals[Index];
+    ++T.NumRuns;
+    T.Duration += Run.Duration;
+    T.InstructionDelta +=
+        int64_t(Run.InstructionsAfter) - int64_t(Run.InstructionsBefore);
+    T.MemoryDelta += Run.MemoryDelta;
+  }
+
+  OS << "  \"totals\": [";
+  for (unsigned I = 0, E = Totals.size(); I != E; ++I) {
+    const PassTotal &T = Totals[I];
+    OS << (I ? ",\n" : "\n") << "    {\"pass\": ";
+    printJSONString(OS, T.Pass);
+    OS << ", \"runs\": " << T.NumRuns << ", \"wall_us\": " << T.Duration
+       << ", \"instruction_delta\": " << T.InstructionDelta
+       << ", \"malloc_delta\": " << T.MemoryDelta << '}';
+  }
+  OS << "\n  ]\n}\n";
+}
+
+static void printChromeTrace(raw_ostream &OS,
+                             const std::vector<PassRun> &Runs) {
+  OS << "{\"traceEvents\": [";
+  for (unsigned I = 0, E = Runs.size(); I != E; ++I) {
+    const PassRun &Run = Runs[I];
+    OS << (I ? ",\n" : "\n") << "  {\"name\": ";
+    printJSONString(OS, Run.Pass);
+    OS << ", \"cat\": \"" << Run.Kind << "\", \"ph\": \"X\", \"ts\": "
+       << Run.Start << ", \"dur\": " << Run.Duration
+       << ", \"pid\": 0, \"tid\": " << Run.Thread << ", \"args\": {\"unit\": ";
+    printJSONString(OS, Run.Unit);
+    OS << ", ";
+    printRunCounters(OS, Run);
+    OS << "}}";
+  }
+  OS << "\n]}\n";
+}
+
+void PassProfiler::print(raw_ostream &OS, OutputFormat Format) {
+  sys::SmartScopedLock<true> Lock(Profile->Lock);
+  if (Format == ChromeTrace)
+    printChromeTrace(OS, Profile->Runs);
+  else
+    printJSON(OS, Profile->Runs);
+}
+
+bool PassProfiler::write(StringRef Filename, OutputFormat Format,
+                         std::string &ErrMsg) {
+  raw_fd_ostream OS(Filename.str().c_str(), ErrMsg, sys::fs::F_Text);
+  if (!ErrMsg.empty())
+    return true;
+  print(OS, Format);
+  return false;
+}
+
+//===----------------------------------------------------------------------===//
+// PassProfileRegion implementation
+//===----------------------------------------------------------------------===//
+
+PassProfileRegion::PassProfileRegion(Pass *P, Module &M)
+    : P(0), M(0), BB(0), IsSCC(false) {
+  if (!PassProfiler::isStarted())
+    return;
+  this->M = &M;
+  Unit = M.getModuleIdentifier();
+  begin(P, "module");
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, Function &F)
+    : P(0), M(0), BB(0), IsSCC(false) {
+  if (!PassProfiler::isStarted())
+    return;
+  Functions.push_back(&F);
+  Unit = F.getName();
+  begin(P, "function");
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, BasicBlock &BB)
+    : P(0), M(0), BB(0), IsSCC(false) {
+  if (!PassProfiler::isStarted())
+    return;
+  this->BB = &BB;
+  Unit = (BB.getParent()->getName() + ":" + BB.getName()).str();
+  begin(P, "basicblock");
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, ArrayRef<Function *> SCC)
+    : P(0), M(0), BB(0), IsSCC(true) {
+  if (!PassProfiler::isStarted())
+    return;
+  for (unsigned I = 0, E = SCC.size(); I != E; ++I) {
+    if (!SCC[I])
+      continue;
+    if (!Unit.empty())
+      Unit += ", ";
+    Unit += SCC[I]->getName();
+  }
+  // Until the caller says otherwise, the component is left as it was.
+  InstructionsAfter = countInstructions(SCC);
+  begin(P, "scc");
+}
+
+void PassProfileRegion::begin(Pass *P, const char *Kind) {
+  // Pass managers are made of the runs of the passes they contain.
+  if (P->getAsPMDataManager())
+    return;
+  this->P = P;
+  this->Kind = Kind;
+  InstructionsBefore = countInstructions();
+  MemoryBefore = sys::Process::GetMallocUsage();
+  StartTime = getTimeInMicroseconds();
+}
+
+uint64_t
+PassProfileRegion::countInstructions(ArrayRef<Function *> Functions) {
+  uint64_t Count = 0;
+  for (unsigned N = 0, NE = Functions.size(); N != NE; ++N) {
+    if (!Functions[N])
+      continue;
+    for (Function::const_iterator I = Functions[N]->begin(),
+                                  E = Functions[N]->end();
+         I != E; ++I)
+      Count += I->size();
+  }
+  return Count;
+}
+
+uint64_t PassProfileRegion::countInstructions() const {
+  if (IsSCC)
+    return InstructionsAfter;
+  if (BB)
+    return BB->size();
+  uint64_t Count = 0;
+  if (M) {
+    for (Module::const_iterator F = M->begin(), FE = M->end(); F != FE; ++F)
+      for (Function::const_iterator I = F->begin(), E = F->end(); I != E; ++I)
+        Count += I->size();
+    return Count;
+  }
+  return countInstructions(Functions);
+}
+
+PassProfileRegion::~PassProfileRegion() {
+  if (!P)
+    return;
+  uint64_t EndTime = getTimeInMicroseconds();
+
+  PassRun Run;
+  Run.Pass = P->getPassName();
+  Run.Unit.swap(Unit);
+  Run.Kind = Kind;
+  Run.Duration = EndTime - StartTime;
+  Run.InstructionsBefore = InstructionsBefore;
+  Run.InstructionsAfter = countInstructions();
+  Run.MemoryDelta =
+      int64_t(sys::Process::GetMallocUsage()) - int64_t(MemoryBefore);
+
+  sys::SmartScopedLock<true> Lock(Profile->Lock);
+  Run.Thread = Profile->getThreadNumber();
+  // A run that began before the profiler was restarted starts at zero.
+  Run.Start = StartTime > Profile->Origin ? StartTime - Profile->Origin : 0;
+  Profile->Runs.push_back(Run);
+}
@@ -311,6 +311,7 @@ IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
     break;
   }
   
+  ContextLockGuard Guard(C);
   IntegerType *&Entry = C.pImpl->IntegerTypes[NumBits];
   
   if (Entry == 0)
@@ -355,6 +356,7 @@ FunctionType::FunctionType(Type *Result, ArrayRef<Type*> Params,
 FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
   LLVMContextImpl::FunctionTypeMap::iterator I =
     pImpl->FunctionTypes.find_as(Key);
@@ -399,6 +401,7 @@ bool FunctionType::isValidArgumentType(Type *ArgTy) {
 StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes, 
                             bool isPacked) {
   LLVMContextImpl *pImpl = Context.pImpl;
+  ContextLockGuard Guard(pImpl);
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
   LLVMContextImpl::StructTypeMap::iterator I =
     pImpl->AnonStructTypes.find_as(Key);
@@ -425,6 +428,7 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
     setSubclassData(getSubclassData() | SCDB_Packed);
 
   unsigned NumElements = Elements.size();
+  ContextLockGuard Guard(getContext());
   Type **Elts = getContext().pImpl->TypeAllocator.Allocate<Type*>(NumElements);
   memcpy(Elts, Elements.data(), sizeof(Elements[0]) * NumElements);
   
@@ -435,6 +439,7 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 void StructType::setName(StringRef Name) {
   if (Name == getName()) return;
 
+  ContextLockGuard Guard(getContext());
   StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
   typedef StringMap<StructType *>::MapEntryTy EntryTy;
 
@@ -486,6 +491,7 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  ContextLockGuard Guard(Context);
   StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -613,6 +619,7 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
+  ContextLockGuard Guard(getContext());
   return getContext().pImpl->NamedStructTypes.lookup(Name);
 }
 
@@ -678,6 +685,7 @@ ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   ArrayType *&Entry = 
     pImpl->ArrayTypes[std::make_pair(ElementType, NumElements)];
   
@@ -707,6 +715,7 @@ VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
          "Elements of a VectorType must be a primitive type");
   
   LLVMContextImpl *pImpl = ElementType->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   VectorType *&Entry = ElementType->getContext().pImpl
     ->VectorTypes[std::make_pair(ElementType, NumElements)];
   
@@ -729,10 +738,25 @@ PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
   LLVMContextImpl *CImpl = EltTy->getContext().pImpl;
-  
+
   // Since AddressSpace #0 is the common case, we special case it.
-  PointerType *&Entry = AddressSpace == 0 ? CImpl->PointerTypes[EltTy]
-     : CImpl->ASPointerTypes[std::make_pair(EltTy, AddressSpace)];
+  if (AddressSpace == 0) {
+    if (PointerType *PT = CImpl->PointerTypes.lookup(EltTy))
+      return PT;
+    PointerType *NewPT;
+    {
+      // The type allocator is shared with the other type tables.
+      ContextLockGuard Guard(CImpl);
+      NewPT = new (CImpl->TypeAllocator) PointerType(EltTy, 0);
+    }
+    // If another thread won the race, NewPT stays in the allocator unused
+    // until the context goes away.
+    return CImpl->PointerTypes.insert(EltTy, NewPT);
+  }
+
+  ContextLockGuard Guard(CImpl);
+  PointerType *&Entry =
+    CImpl->ASPointerTypes[std::make_pair(EltTy, AddressSpace)];
 
   if (Entry == 0)
     Entry = new (CImpl->TypeAllocator) PointerType(EltTy, AddressSpace);
@@ -11,7 +11,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/IR/Argument.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 #include <new>
 
 namespace llvm {
@@ -142,4 +147,45 @@ User *Use::getUser() const {
     : reinterpret_cast<User*>(const_cast<Use*>(End));
 }
 
+//===----------------------------------------------------------------------===//
+//                         Use list locking Implementation
+//===----------------------------------------------------------------------===//
+
+std::atomic<unsigned> Use::NumMultithreadedContexts(0);
+
+static ManagedStatic<sys::Mutex> SharedUseListLock;
+
+/// needsUseListLock - Instructions and arguments can only be used from within
+/// their own function, so their use lists are never touched concurrently.
+/// Neither are the use lists of values whose context is not multithreaded.
+static bool needsUseListLock(const Value *V) {
+  return !isa<Instruction>(V) && !isa<Argument>(V) &&
+         V->getContext().isMultithreaded();
+}
+
+void Use::addToListLocked(Use **List) {
+  if (!needsUseListLock(Val))
+    return addToListImpl(List);
+  sys::ScopedLock Guard(*SharedUseListLock);
+  addToListImpl(List);
+}
+
+void Use::removeFromListLocked() {
+  if (!needsUseListLock(Val))
+    return removeFromListImpl();
+  sys::ScopedLock Guard(*SharedUseListLock);
+  removeFromListImpl();
+}
+
+void SharedUseListGuard::lock(const Value *V) {
+  if (!needsUseListLock(V))
+    return;
+  SharedUseListLock->acquire();
+  Locked = true;
+}
+
+void SharedUseListGuard::unlock() {
+  SharedUseListLock->release();
+}
+
 } // End llvm namespace
@@ -57,7 +57,10 @@ Use *User::allocHungoffUses(unsigned N) const {
 //===----------------------------------------------------------------------===//
 
 void *User::operator new(size_t s, unsigned Us) {
-  void *Storage = ::operator new(s + sizeof(Use) * Us);
+  return initOperands(::operator new(s + sizeof(Use) * Us), Us);
+}
+
+void *User::initOperands(void *Storage, unsigned Us) {
   Use *Start = static_cast<Use*>(Storage);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
@@ -90,6 +90,7 @@ Value::~Value() {
 /// hasNUses - Return true if this Value has exactly N users.
 ///
 bool Value::hasNUses(unsigned N) const {
+  SharedUseListGuard Guard(this);
   const_use_iterator UI = use_begin(), E = use_end();
 
   for (; N; --N, ++UI)
@@ -101,6 +102,7 @@ bool Value::hasNUses(unsigned N) const {
 /// logically equivalent to getNumUses() >= N.
 ///
 bool Value::hasNUsesOrMore(unsigned N) const {
+  SharedUseListGuard Guard(this);
   const_use_iterator UI = use_begin(), E = use_end();
 
   for (; N; --N, ++UI)
@@ -118,6 +120,7 @@ bool Value::isUsedInBasicBlock(const BasicBlock *BB) const {
   //
   // Scan both lists simultaneously until one is exhausted. This limits the
   // search to the shorter list.
+  SharedUseListGuard Guard(this);
   BasicBlock::const_iterator BI = BB->begin(), BE = BB->end();
   const_use_iterator UI = use_begin(), UE = use_end();
   for (; BI != BE && UI != UE; ++BI, ++UI) {
@@ -137,6 +140,7 @@ bool Value::isUsedInBasicBlock(const BasicBlock *BB) const {
 /// is a linear time operation.  Use hasOneUse or hasNUses to check for specific
 /// values.
 unsigned Value::getNumUses() const {
+  SharedUseListGuard Guard(this);
   return (unsigned)std::distance(use_begin(), use_end());
 }
 
@@ -196,6 +200,10 @@ void Value::setName(const Twine &NewName) {
   if (getSymTab(this, ST))
     return;  // Cannot set a name on this value (e.g. constant).
 
+  // Global names live in the module's symbol table, which other threads may
+  // be reading while the context is multithreaded.
+  ContextLockGuard Guard(getContext().pImpl, isa<GlobalValue>(this));
+
   if (Function *F = dyn_cast<Function>(this))
     getContext().pImpl->IntrinsicIDCache.erase(F);
 
@@ -526,6 +534,7 @@ LLVMContext &Value::getContext() const { return VTy->getContext(); }
 /// List is known to point into the existing use list.
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
+  ContextLockGuard Guard(VP.getPointer()->getContext().pImpl);
 
   // Splice ourselves into the list.
   Next = *List;
@@ -539,6 +548,7 @@ void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
 
 void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
   assert(List && "Must insert after existing node");
+  ContextLockGuard Guard(VP.getPointer()->getContext().pImpl);
 
   Next = List->Next;
   setPrevPtr(&List->Next);
@@ -552,6 +562,7 @@ void ValueHandleBase::AddToUseList() {
   assert(VP.getPointer() && "Null pointer doesn't have a use list!");
 
   LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
 
   if (VP.getPointer()->HasValueHandle) {
     // If this value already has a ValueHandle, then it must be in the
@@ -595,6 +606,7 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(VP.getPointer() && VP.getPointer()->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  ContextLockGuard Guard(VP.getPointer()->getContext().pImpl);
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -625,6 +637,7 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = V->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[V];
   assert(Entry && "Value bit set but no entries exist");
 
@@ -683,6 +696,7 @@ void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
   LLVMContextImpl *pImpl = Old->getContext().pImpl;
+  ContextLockGuard Guard(pImpl);
   ValueHandleBase *Entry = pImpl->ValueHandles[Old];
 
   assert(Entry && "Value bit set but no entries exist");
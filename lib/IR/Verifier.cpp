@@ -2396,15 +2396,22 @@ struct VerifierLegacyPass : public FunctionPass {
 
   Verifier V;
   bool FatalErrors;
+  /// True for copies made with clone, which leave checking the module as a
+  /// whole to the original.
+  bool IsCopy;
 
-  VerifierLegacyPass() : FunctionPass(ID), FatalErrors(true) {
+  VerifierLegacyPass() : FunctionPass(ID), FatalErrors(true), IsCopy(false) {
     initializeVerifierLegacyPassPass(*PassRegistry::getPassRegistry());
   }
-  explicit VerifierLegacyPass(bool FatalErrors)
-      : FunctionPass(ID), V(dbgs()), FatalErrors(FatalErrors) {
+  explicit VerifierLegacyPass(bool FatalErrors, bool IsCopy = false)
+      : FunctionPass(ID), V(dbgs()), FatalErrors(FatalErrors), IsCopy(IsCopy) {
     initializeVerifierLegacyPassPass(*PassRegistry::getPassRegistry());
   }
 
+  Pass *clone() const {
+    return new VerifierLegacyPass(FatalErrors, /*IsCopy=*/true);
+  }
+
   bool runOnFunction(Function &F) {
     if (!V.verify(F) && FatalErrors)
       report_fatal_error("Broken function found, compilation aborted!");
@@ -2413,6 +2420,8 @@ struct VerifierLegacyPass : public FunctionPass {
   }
 
   bool doFinalization(Module &M) {
+    if (IsCopy)
+      return false;
     if (!V.verify(M) && FatalErrors)
       report_fatal_error("Broken module found, compilation aborted!");
 
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/LTO/LTOCodeGenerator.h"
+#include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -26,6 +27,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassProfiler.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/InitializePasses.h"
 #include "llvm/LTO/LTOModule.h"
@@ -39,10 +41,12 @@
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Target/TargetLibraryInfo.h"
@@ -52,6 +56,7 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 using namespace llvm;
 
 const char* LTOCodeGenerator::getVersionString() {
@@ -67,7 +72,7 @@ LTOCodeGenerator::LTOCodeGenerator()
       TargetMach(NULL), EmitDwarfDebugInfo(false), ScopeRestrictionsDone(false),
       CodeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
       InternalizeStrategy(LTO_INTERNALIZE_FULL), NativeObjectFile(NULL),
-      DiagHandler(NULL), DiagContext(NULL) {
+      CodeGenParallelism(1), DiagHandler(NULL), DiagContext(NULL) {
   initializeLTOPasses();
 }
 
@@ -115,6 +120,9 @@ void LTOCodeGenerator::initializeLTOPasses() {
 }
 
 bool LTOCodeGenerator::addModule(LTOModule* mod, std::string& errMsg) {
+  if (mod->parseModule(errMsg))
+    return false;
+
   bool ret = Linker.linkInModule(mod->getLLVVMModule(), &errMsg);
 
   const std::vector<const char*> &undefs = mod->getAsmUndefinedRefs();
@@ -282,6 +290,70 @@ const void* LTOCodeGenerator::compile(size_t* length,
   return NativeObjectFile->getBufferStart();
 }
 
+bool LTOCodeGenerator::compile_to_files(const char ***names,
+                                        unsigned *numNames,
+                                        bool disableOpt,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        std::string &errMsg) {
+  if (!optimize(disableOpt, disableInline, disableGVNLoadPRE, errMsg))
+    return false;
+
+  unsigned NumPartitions = CodeGenParallelism;
+  if (NumPartitions == 0)
+    NumPartitions = ThreadPool::getDefaultThreadCount();
+
+  // An empty partition list means the merged module is compiled as a whole.
+  std::vector<std::string> Partitions;
+  if (NumPartitions > 1)
+    splitCodeGenModule(NumPartitions, Partitions);
+  unsigned NumObjects = Partitions.empty() ? 1 : Partitions.size();
+
+  // make unique temp .o files to put the generated object files
+  std::vector<std::string> Filenames;
+  std::vector<tool_output_file *> ObjFiles;
+  std::vector<raw_ostream *> Outs;
+  for (unsigned I = 0; I != NumObjects; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    error_code EC = sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      break;
+    }
+    Filenames.push_back(Filename.str());
+    ObjFiles.push_back(new tool_output_file(Filename.c_str(), FD));
+    Outs.push_back(&ObjFiles.back()->os());
+  }
+
+  bool genResult = ObjFiles.size() == NumObjects &&
+                   generateObjectFiles(Partitions, Outs, errMsg);
+
+  for (unsigned I = 0, E = ObjFiles.size(); I != E; ++I) {
+    ObjFiles[I]->os().close();
+    if (ObjFiles[I]->os().has_error()) {
+      ObjFiles[I]->os().clear_error();
+      genResult = false;
+    }
+    ObjFiles[I]->keep();
+    delete ObjFiles[I];
+  }
+
+  if (!genResult) {
+    for (unsigned I = 0, E = Filenames.size(); I != E; ++I)
+      sys::fs::remove(Twine(Filenames[I]));
+    return false;
+  }
+
+  NativeObjectPaths.swap(Filenames);
+  NativeObjectNames.clear();
+  for (unsigned I = 0, E = NativeObjectPaths.size(); I != E; ++I)
+    NativeObjectNames.push_back(NativeObjectPaths[I].c_str());
+  *names = &NativeObjectNames[0];
+  *numNames = NativeObjectNames.size();
+  return true;
+}
+
 bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   if (TargetMach != NULL)
     return true;
@@ -462,11 +534,10 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          bool DisableOpt,
-                                          bool DisableInline,
-                                          bool DisableGVNLoadPRE,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimize(bool DisableOpt,
+                                bool DisableInline,
+                                bool DisableGVNLoadPRE,
+                                std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
@@ -502,9 +573,18 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+
+  return true;
+}
+
+/// Run the code generator for \p M, writing an object file to \p out.
+static bool codegenModule(Module &M, TargetMachine &TM, raw_ostream &out,
+                          std::string &errMsg) {
   PassManager codeGenPasses;
 
-  codeGenPasses.add(new DataLayoutPass(mergedModule));
+  codeGenPasses.add(new DataLayoutPass(&M));
 
   formatted_raw_ostream Out(out);
 
@@ -512,18 +592,314 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
   codeGenPasses.add(createObjCARCContractPass());
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, Out,
-                                      TargetMachine::CGFT_ObjectFile)) {
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return false;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  codeGenPasses.run(M);
+
+  return true;
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          bool DisableOpt,
+                                          bool DisableInline,
+                                          bool DisableGVNLoadPRE,
+                                          std::string &errMsg) {
+  if (!optimize(DisableOpt, DisableInline, DisableGVNLoadPRE, errMsg))
+    return false;
+
+  raw_ostream *Out = &out;
+  return generateObjectFiles(ArrayRef<std::string>(), Out, errMsg);
+}
+
+/// Add to \p Refs every global value that \p C refers to, looking through
+/// constant expressions and aggregates.  Functions whose blocks are referenced
+/// through a blockaddress are added to \p BlockRefs instead, as the
+/// reference is only meaningful next to the body of the function.
+static void collectGlobalRefs(const Constant *C,
+                              SmallPtrSet<const GlobalValue *, 8> &Refs,
+                              SmallPtrSet<const GlobalValue *, 8> &BlockRefs,
+                              SmallPtrSet<const Constant *, 8> &Visited) {
+  if (!Visited.insert(C))
+    return;
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+    Refs.insert(GV);
+    return;
+  }
+  if (const BlockAddress *BA = dyn_cast<BlockAddress>(C)) {
+    BlockRefs.insert(BA->getFunction());
+    return;
+  }
+  for (User::const_op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    collectGlobalRefs(cast<Constant>(*I), Refs, BlockRefs, Visited);
+}
+
+/// Return true if \p GV can be copied into every partition that refers to it
+/// instead of tying those partitions together: a local constant whose address
+/// is not significant and whose initializer refers to no other global.
+static bool isDuplicableConstant(const GlobalValue *GV) {
+  const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV);
+  if (!Var || !Var->hasLocalLinkage() || !Var->isConstant() ||
+      !Var->hasUnnamedAddr() || !Var->hasInitializer())
+    return false;
+  SmallPtrSet<const GlobalValue *, 8> Refs;
+  SmallPtrSet<const Constant *, 8> Visited;
+  collectGlobalRefs(Var->getInitializer(), Refs, Refs, Visited);
+  return Refs.empty();
+}
+
+/// Turn \p GV into an external declaration.  Aliases cannot be declarations,
+/// so they are replaced by a declaration of the aliased type.
+static void makeDeclaration(GlobalValue *GV) {
+  if (Function *F = dyn_cast<Function>(GV)) {
+    F->deleteBody();
+    return;
+  }
+  if (GlobalVariable *Var = dyn_cast<GlobalVariable>(GV)) {
+    Var->setInitializer(0);
+    Var->setLinkage(GlobalValue::ExternalLinkage);
+    return;
+  }
 
+  GlobalAlias *GA = cast<GlobalAlias>(GV);
+  Module *M = GA->getParent();
+  Type *Ty = GA->getType()->getElementType();
+  GlobalValue *Decl;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+    Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", M);
+  else
+    Decl = new GlobalVariable(*M, Ty, false, GlobalValue::ExternalLinkage, 0,
+                              "", 0, GlobalVariable::NotThreadLocal,
+                              GA->getType()->getAddressSpace());
+  Decl->setVisibility(GA->getVisibility());
+  Decl->takeName(GA);
+  GA->replaceAllUsesWith(ConstantExpr::getBitCast(Decl, GA->getType()));
+  GA->eraseFromParent();
+}
+
+/// Split the optimized merged module into at most \p N partitions and append
+/// the bitcode of each one to \p Partitions.  Definitions are distributed so
+/// that every local symbol lands in the same partition as all of its users;
+/// only externally visible symbols are referenced across partitions.  Nothing
+/// is appended if the module does not split into at least two partitions.
+void LTOCodeGenerator::splitCodeGenModule(unsigned N,
+                                          std::vector<std::string> &Partitions) {
+  Module *mergedModule = Linker.getModule();
+
+  // Collect the definitions to distribute along with a rough cost for each.
+  std::vector<const GlobalValue *> Defs;
+  DenseMap<const GlobalValue *, unsigned> Weights;
+  for (Module::iterator I = mergedModule->begin(), E = mergedModule->end();
+       I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    unsigned Weight = 1;
+    for (Function::iterator BB = I->begin(), BE = I->end(); BB != BE; ++BB)
+      Weight += BB->size();
+    Defs.push_back(I);
+    Weights[I] = Weight;
+  }
+  for (Module::global_iterator I = mergedModule->global_begin(),
+         E = mergedModule->global_end(); I != E; ++I) {
+    if (I->isDeclaration() || isDuplicableConstant(I))
+      continue;
+    Defs.push_back(I);
+    Weights[I] = 1;
+  }
+  for (Module::alias_iterator I = mergedModule->alias_begin(),
+         E = mergedModule->alias_end(); I != E; ++I) {
+    Defs.push_back(I);
+    Weights[I] = 1;
+  }
+
+  // Group the definitions that must be emitted together.
+  EquivalenceClasses<const GlobalValue *> Classes;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I)
+    Classes.insert(Defs[I]);
+
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    const GlobalValue *GV = Defs[I];
+    if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      if (const GlobalValue *Aliasee =
+              const_cast<GlobalAlias *>(GA)->getAliasedGlobal())
+        if (Weights.count(Aliasee))
+          Classes.unionSets(GV, Aliasee);
+      continue;
+    }
+
+    SmallPtrSet<const GlobalValue *, 8> Refs, BlockRefs;
+    SmallPtrSet<const Constant *, 8> Visited;
+    if (const Function *F = dyn_cast<Function>(GV)) {
+      for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+           ++BB)
+        for (BasicBlock::const_iterator II = BB->begin(), IE = BB->end();
+             II != IE; ++II)
+          for (User::const_op_iterator OI = II->op_begin(),
+                 OE = II->op_end(); OI != OE; ++OI)
+            if (const Constant *C = dyn_cast<Constant>(*OI))
+              collectGlobalRefs(C, Refs, BlockRefs, Visited);
+    } else {
+      collectGlobalRefs(cast<GlobalVariable>(GV)->getInitializer(), Refs,
+                        BlockRefs, Visited);
+    }
+
+    for (SmallPtrSet<const GlobalValue *, 8>::iterator RI = Refs.begin(),
+           RE = Refs.end(); RI != RE; ++RI)
+      if ((*RI)->hasLocalLinkage() && Weights.count(*RI))
+        Classes.unionSets(GV, *RI);
+    for (SmallPtrSet<const GlobalValue *, 8>::iterator RI = BlockRefs.begin(),
+           RE = BlockRefs.end(); RI != RE; ++RI)
+      if (Weights.count(*RI))
+        Classes.unionSets(GV, *RI);
+  }
+
+  // Weigh each group, keeping them in module order so that the result is
+  // deterministic.
+  std::vector<std::pair<unsigned, const GlobalValue *> > Groups;
+  DenseMap<const GlobalValue *, unsigned> GroupIndex;
+  for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+    const GlobalValue *Leader = Classes.getLeaderValue(Defs[I]);
+    std::pair<DenseMap<const GlobalValue *, unsigned>::iterator, bool> Ins =
+        GroupIndex.insert(std::make_pair(Leader, (unsigned)Groups.size()));
+    if (Ins.second)
+      Groups.push_back(std::make_pair(0u, Leader));
+    Groups[Ins.first->second].first += Weights[Defs[I]];
+  }
+  if (Groups.size() < 2)
+    return;
+  N = std::min<unsigned>(N, Groups.size());
+
+  // Hand out the groups heaviest first, each to the lightest partition.
+  std::vector<unsigned> Order(Groups.size());
+  for (unsigned I = 0, E = Order.size(); I != E; ++I)
+    Order[I] = I;
+  std::stable_sort(Order.begin(), Order.end(),
+                   [&Groups](unsigned A, unsigned B) {
+    return Groups[A].first > Groups[B].first;
+  });
+
+  std::vector<unsigned> Load(N, 0);
+  DenseMap<const GlobalValue *, unsigned> PartitionOf;
+  for (unsigned I = 0, E = Order.size(); I != E; ++I) {
+    unsigned Target = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Load[Target] += Groups[Order[I]].first;
+    PartitionOf[Groups[Order[I]].second] = Target;
+  }
+
+  for (unsigned P = 0; P != N; ++P) {
+    ValueToValueMapTy VMap;
+    OwningPtr<Module> Part(CloneModule(mergedModule, VMap));
+
+    // Drop everything that belongs to another partition.  Local symbols are
+    // erased once nothing refers to them anymore; appending globals such as
+    // llvm.global_ctors must only be emitted once.
+    std::vector<GlobalValue *> Erase;
+    for (unsigned I = 0, E = Defs.size(); I != E; ++I) {
+      if (PartitionOf[Classes.getLeaderValue(Defs[I])] == P)
+        continue;
+      GlobalValue *GV = cast<GlobalValue>(VMap[Defs[I]]);
+      bool IsLocal = GV->hasLocalLinkage() || GV->hasAppendingLinkage();
+      makeDeclaration(GV);
+      if (IsLocal)
+        Erase.push_back(GV);
+    }
+    for (Module::global_iterator I = Part->global_begin(),
+           E = Part->global_end(); I != E; ++I)
+      if (isDuplicableConstant(I))
+        Erase.push_back(I);
+
+    for (unsigned I = 0, E = Erase.size(); I != E; ++I) {
+      Erase[I]->removeDeadConstantUsers();
+      if (!Erase[I]->use_empty()) {
+        assert(isDuplicableConstant(Erase[I]) &&
+               "Local symbol used from another partition!");
+        continue;
+      }
+      Erase[I]->eraseFromParent();
+    }
+
+    // Module-level inline asm is emitted with the first partition only.
+    if (P != 0)
+      Part->setModuleInlineAsm("");
+
+    std::string Bitcode;
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(Part.get(), OS);
+    OS.flush();
+    Partitions.push_back(Bitcode);
+  }
+}
+
+namespace {
+/// Parameters of one parallel code generation job.
+struct CodeGenJob {
+  const std::string *Bitcode;
+  raw_ostream *Out;
+  std::string ErrMsg;
+  bool Success;
+};
+}
+
+/// Generate code for the merged module, or, if \p partitions is not empty,
+/// for each of the partitions produced by splitCodeGenModule() in parallel.
+/// Object file I is written to \p outs[I].
+bool LTOCodeGenerator::generateObjectFiles(ArrayRef<std::string> partitions,
+                                           ArrayRef<raw_ostream *> outs,
+                                           std::string &errMsg) {
+  // The linker loading libLTO may never call llvm_shutdown, so a requested
+  // pass profile is written as soon as the passes are done.
+  if (partitions.empty()) {
+    assert(outs.size() == 1 && "Expected exactly one output!");
+    bool Success =
+        codegenModule(*Linker.getModule(), *TargetMach, *outs[0], errMsg);
+    PassProfiler::writeIfRequested();
+    return Success;
+  }
+
+  assert(partitions.size() == outs.size() && "One output per partition!");
+  std::vector<CodeGenJob> Jobs(partitions.size());
+  {
+    ThreadPool Pool(partitions.size());
+    for (unsigned I = 0, E = partitions.size(); I != E; ++I) {
+      CodeGenJob &Job = Jobs[I];
+      Job.Bitcode = &partitions[I];
+      Job.Out = outs[I];
+      Job.Success = false;
+      Pool.async([this, &Job] {
+        // Each partition gets its own context and target machine, so that
+        // nothing is shared with the other threads.
+        LLVMContext Ctx;
+        if (DiagHandler)
+          Ctx.setDiagnosticHandler(LTOCodeGenerator::DiagnosticHandler, this);
+        OwningPtr<MemoryBuffer> Buffer(
+            MemoryBuffer::getMemBuffer(*Job.Bitcode, "ld-temp.o", false));
+        ErrorOr<Module *> MOrErr = parseBitcodeFile(Buffer.get(), Ctx);
+        if (error_code EC = MOrErr.getError()) {
+          Job.ErrMsg = EC.message();
+          return;
+        }
+        OwningPtr<Module> M(MOrErr.get());
+        OwningPtr<TargetMachine> TM(TargetMach->getTarget().createTargetMachine(
+            TargetMach->getTargetTriple(), TargetMach->getTargetCPU(),
+            TargetMach->getTargetFeatureString(), Options,
+            TargetMach->getRelocationModel(), TargetMach->getCodeModel(),
+            TargetMach->getOptLevel()));
+        Job.Success = codegenModule(*M, *TM, *Job.Out, Job.ErrMsg);
+      });
+    }
+  }
+  PassProfiler::writeIfRequested();
+
+  for (unsigned I = 0, E = Jobs.size(); I != E; ++I) {
+    if (!Jobs[I].Success) {
+      errMsg = Jobs[I].ErrMsg;
+      return false;
+    }
+  }
   return true;
 }
 
@@ -579,6 +955,8 @@ void LTOCodeGenerator::DiagnosticHandler2(const DiagnosticInfo &DI) {
   // If this method has been called it means someone has set up an external
   // diagnostic handler. Assert on that.
   assert(DiagHandler && "Invalid diagnostic handler");
+  // Parallel code generation may report from several threads at once.
+  MutexGuard Locked(DiagLock);
   (*DiagHandler)(Severity, MsgStorage.c_str(), DiagContext);
 }
 
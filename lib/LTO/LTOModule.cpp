@@ -16,6 +16,7 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Bitcode/SymbolSummary.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
@@ -135,10 +136,9 @@ LTOModule *LTOModule::makeLTOModule(const void *mem, size_t length,
   return makeLTOModule(buffer.take(), options, errMsg);
 }
 
-LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
-                                    TargetOptions options,
-                                    std::string &errMsg) {
-  // parse bitcode buffer
+/// parseBitcode - Parse and materialize the module in \p buffer, which it
+/// takes ownership of.
+static Module *parseBitcode(MemoryBuffer *buffer, std::string &errMsg) {
   ErrorOr<Module *> ModuleOrErr =
       getLazyBitcodeModule(buffer, getGlobalContext());
   if (error_code EC = ModuleOrErr.getError()) {
@@ -146,9 +146,67 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
     delete buffer;
     return NULL;
   }
-  OwningPtr<Module> m(ModuleOrErr.get());
+  Module *m = ModuleOrErr.get();
+  m->materializeAllPermanently();
+  return m;
+}
+
+/// canUseSummary - Return true if the symbols in \p summary are the ones
+/// parseSymbols would find in the module.
+static bool canUseSummary(const BitcodeSymbolSummary &summary,
+                          const TargetMachine &target) {
+  // Module asm, linker options and ObjC class data add symbols and options
+  // that only the module knows about.
+  if (summary.hasFlag(BitcodeSymbolSummary::HasModuleAsm) ||
+      summary.hasFlag(BitcodeSymbolSummary::HasLinkerOptions) ||
+      summary.hasFlag(BitcodeSymbolSummary::HasObjCSections))
+    return false;
+
+  // The linker names were mangled for the module's data layout.
+  if (summary.DataLayout.empty() ||
+      summary.DataLayout !=
+          target.getDataLayout()->getStringRepresentation())
+    return false;
 
-  std::string TripleStr = m->getTargetTriple();
+  bool isMachO = Triple(target.getTargetTriple()).isOSBinFormatMachO();
+  for (unsigned i = 0, e = summary.Symbols.size(); i != e; ++i) {
+    const BitcodeSymbol &sym = summary.Symbols[i];
+    // Mach-O names private symbols after the section they end up in.
+    if (isMachO && sym.Linkage == GlobalValue::PrivateLinkage)
+      return false;
+    // Whether a linkonce_odr symbol can be hidden depends on how its address
+    // is used; see canBeHidden.
+    if (sym.Linkage == GlobalValue::LinkOnceODRLinkage &&
+        sym.Visibility == GlobalValue::DefaultVisibility &&
+        !sym.hasFlag(BitcodeSymbol::UnnamedAddr) &&
+        (sym.Kind != BitcodeSymbol::Variable ||
+         sym.hasFlag(BitcodeSymbol::Constant)))
+      return false;
+  }
+  return true;
+}
+
+LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
+                                    TargetOptions options,
+                                    std::string &errMsg) {
+  OwningPtr<MemoryBuffer> Buffer(buffer);
+
+  // If the bitcode starts with a symbol summary, the module may not have to
+  // be parsed until it is linked.
+  OwningPtr<BitcodeSymbolSummary> Summary;
+  ErrorOr<BitcodeSymbolSummary *> SummaryOrErr =
+      readBitcodeSymbolSummary(buffer, getGlobalContext());
+  if (!SummaryOrErr.getError())
+    Summary.reset(SummaryOrErr.get());
+
+  OwningPtr<Module> m;
+  if (!Summary) {
+    m.reset(parseBitcode(Buffer.take(), errMsg));
+    if (!m)
+      return NULL;
+  }
+
+  std::string TripleStr = m ? m->getTargetTriple() : Summary->TargetTriple;
   if (TripleStr.empty())
     TripleStr = sys::getDefaultTargetTriple();
   llvm::Triple Triple(TripleStr);
@@ -173,7 +231,15 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
 
   TargetMachine *target = march->createTargetMachine(TripleStr, CPU, FeatureStr,
                                                      options);
-  m->materializeAllPermanently();
+
+  if (Summary && !canUseSummary(*Summary, *target)) {
+    Summary.reset();
+    m.reset(parseBitcode(Buffer.take(), errMsg));
+    if (!m) {
+      delete target;
+      return NULL;
+    }
+  }
 
   LTOModule *Ret = new LTOModule(m.take(), target);
 
@@ -186,6 +252,13 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
       target->getTargetLowering()->getObjFileLowering();
   const_cast<TargetLoweringObjectFile &>(TLOF).Initialize(Context, *target);
 
+  if (Summary) {
+    Ret->_buffer.swap(Buffer);
+    Ret->_triple = Summary->TargetTriple;
+    Ret->parseSummarySymbols(*Summary);
+    return Ret;
+  }
+
   if (Ret->parseSymbols(errMsg)) {
     delete Ret;
     return NULL;
@@ -196,6 +269,18 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
   return Ret;
 }
 
+/// parseModule - Parse the module if its symbols came from a symbol summary.
+bool LTOModule::parseModule(std::string &errMsg) {
+  if (_module)
+    return false;
+
+  _module.reset(parseBitcode(_buffer.take(), errMsg));
+  if (!_module)
+    return true;
+  _module->setTargetTriple(_triple);
+  return false;
+}
+
 /// Create a MemoryBuffer from a memory range with an optional name.
 MemoryBuffer *LTOModule::makeBuffer(const void *mem, size_t length,
                                     StringRef name) {
@@ -359,6 +444,51 @@ void LTOModule::addDefinedFunctionSymbol(const Function *f) {
   addDefinedSymbol(f, true);
 }
 
+/// getDefinedAttributes - Return the attributes of a defined symbol.
+static uint32_t getDefinedAttributes(GlobalValue::LinkageTypes linkage,
+                                     GlobalValue::VisibilityTypes visibility,
+                                     unsigned align, bool isFunction,
+                                     bool isConstant, bool canBeHidden) {
+  // set alignment part log2() can have rounding errors
+  uint32_t attr = align ? countTrailingZeros(align) : 0;
+
+  // set permissions part
+  if (isFunction)
+    attr |= LTO_SYMBOL_PERMISSIONS_CODE;
+  else if (isConstant)
+    attr |= LTO_SYMBOL_PERMISSIONS_RODATA;
+  else
+    attr |= LTO_SYMBOL_PERMISSIONS_DATA;
+
+  // set definition part
+  if (GlobalValue::isWeakLinkage(linkage) ||
+      GlobalValue::isLinkOnceLinkage(linkage) ||
+      GlobalValue::isLinkerPrivateWeakLinkage(linkage))
+    attr |= LTO_SYMBOL_DEFINITION_WEAK;
+  else if (GlobalValue::isCommonLinkage(linkage))
+    attr |= LTO_SYMBOL_DEFINITION_TENTATIVE;
+  else
+    attr |= LTO_SYMBOL_DEFINITION_REGULAR;
+
+  // set scope part
+  if (visibility == GlobalValue::HiddenVisibility)
+    attr |= LTO_SYMBOL_SCOPE_HIDDEN;
+  else if (visibility == GlobalValue::ProtectedVisibility)
+    attr |= LTO_SYMBOL_SCOPE_PROTECTED;
+  else if (canBeHidden)
+    attr |= LTO_SYMBOL_SCOPE_DEFAULT_CAN_BE_HIDDEN;
+  else if (GlobalValue::isExternalLinkage(linkage) ||
+           GlobalValue::isWeakLinkage(linkage) ||
+           GlobalValue::isLinkOnceLinkage(linkage) ||
+           GlobalValue::isCommonLinkage(linkage) ||
+           GlobalValue::isLinkerPrivateWeakLinkage(linkage))
+    attr |= LTO_SYMBOL_SCOPE_DEFAULT;
+  else
+    attr |= LTO_SYMBOL_SCOPE_INTERNAL;
+
+  return attr;
+}
+
 static bool canBeHidden(const GlobalValue *GV) {
   // FIXME: this is duplicated with another static function in AsmPrinter.cpp
   GlobalValue::LinkageTypes L = GV->getLinkage();
@@ -389,49 +519,20 @@ void LTOModule::addDefinedSymbol(const GlobalValue *def, bool isFunction) {
   if (def->getName().startswith("llvm."))
     return;
 
-  // string is owned by _defines
   SmallString<64> Buffer;
   _target->getNameWithPrefix(Buffer, def, _mangler);
 
-  // set alignment part log2() can have rounding errors
-  uint32_t align = def->getAlignment();
-  uint32_t attr = align ? countTrailingZeros(def->getAlignment()) : 0;
-
-  // set permissions part
-  if (isFunction) {
-    attr |= LTO_SYMBOL_PERMISSIONS_CODE;
-  } else {
-    const GlobalVariable *gv = dyn_cast<GlobalVariable>(def);
-    if (gv && gv->isConstant())
-      attr |= LTO_SYMBOL_PERMISSIONS_RODATA;
-    else
-      attr |= LTO_SYMBOL_PERMISSIONS_DATA;
-  }
-
-  // set definition part
-  if (def->hasWeakLinkage() || def->hasLinkOnceLinkage() ||
-      def->hasLinkerPrivateWeakLinkage())
-    attr |= LTO_SYMBOL_DEFINITION_WEAK;
-  else if (def->hasCommonLinkage())
-    attr |= LTO_SYMBOL_DEFINITION_TENTATIVE;
-  else
-    attr |= LTO_SYMBOL_DEFINITION_REGULAR;
-
-  // set scope part
-  if (def->hasHiddenVisibility())
-    attr |= LTO_SYMBOL_SCOPE_HIDDEN;
-  else if (def->hasProtectedVisibility())
-    attr |= LTO_SYMBOL_SCOPE_PROTECTED;
-  else if (canBeHidden(def))
-    attr |= LTO_SYMBOL_SCOPE_DEFAULT_CAN_BE_HIDDEN;
-  else if (def->hasExternalLinkage() || def->hasWeakLinkage() ||
-           def->hasLinkOnceLinkage() || def->hasCommonLinkage() ||
-           def->hasLinkerPrivateWeakLinkage())
-    attr |= LTO_SYMBOL_SCOPE_DEFAULT;
-  else
-    attr |= LTO_SYMBOL_SCOPE_INTERNAL;
+  const GlobalVariable *gv = dyn_cast<GlobalVariable>(def);
+  uint32_t attr = getDefinedAttributes(
+      def->getLinkage(), def->getVisibility(), def->getAlignment(), isFunction,
+      gv && gv->isConstant(), def->hasDefaultVisibility() && canBeHidden(def));
+  addDefinedSymbol(Buffer, attr, isFunction, def);
+}
 
-  StringSet::value_type &entry = _defines.GetOrCreateValue(Buffer);
+void LTOModule::addDefinedSymbol(StringRef name, uint32_t attr,
+                                 bool isFunction, const GlobalValue *def) {
+  // string is owned by _defines
+  StringSet::value_type &entry = _defines.GetOrCreateValue(name);
   entry.setValue(1);
 
   // fill information structure
@@ -529,6 +630,13 @@ LTOModule::addPotentialUndefinedSymbol(const GlobalValue *decl, bool isFunc) {
   SmallString<64> name;
   _target->getNameWithPrefix(name, decl, _mangler);
 
+  addPotentialUndefinedSymbol(name, decl->hasExternalWeakLinkage(), isFunc,
+                              decl);
+}
+
+void LTOModule::addPotentialUndefinedSymbol(StringRef name, bool isWeak,
+                                            bool isFunc,
+                                            const GlobalValue *decl) {
   StringMap<NameAndAttributes>::value_type &entry =
     _undefines.GetOrCreateValue(name);
 
@@ -540,7 +648,7 @@ LTOModule::addPotentialUndefinedSymbol(const GlobalValue *decl, bool isFunc) {
 
   info.name = entry.getKey().data();
 
-  if (decl->hasExternalWeakLinkage())
+  if (isWeak)
     info.attributes = LTO_SYMBOL_DEFINITION_WEAKUNDEF;
   else
     info.attributes = LTO_SYMBOL_DEFINITION_UNDEFINED;
@@ -810,6 +918,48 @@ bool LTOModule::parseSymbols(std::string &errMsg) {
       addDefinedDataSymbol(a);
   }
 
+  addUndefinedSymbols();
+  return false;
+}
+
+/// parseSummarySymbols - Add the symbols of a symbol summary to the defined
+/// and undefined lists, as parseSymbols would add those of the module.
+void LTOModule::parseSummarySymbols(const BitcodeSymbolSummary &summary) {
+  for (unsigned i = 0, e = summary.Symbols.size(); i != e; ++i) {
+    const BitcodeSymbol &sym = summary.Symbols[i];
+    // ignore all llvm.* symbols
+    if (StringRef(sym.Name).startswith("llvm."))
+      continue;
+
+    bool isFunction = sym.Kind == BitcodeSymbol::Function;
+    if (sym.Kind == BitcodeSymbol::Alias) {
+      // ignore all aliases to declarations
+      if (sym.hasFlag(BitcodeSymbol::AliasOfDeclaration))
+        continue;
+    } else if (sym.hasFlag(BitcodeSymbol::Declaration) ||
+               GlobalValue::isAvailableExternallyLinkage(sym.Linkage)) {
+      addPotentialUndefinedSymbol(
+          sym.LinkerName, GlobalValue::isExternalWeakLinkage(sym.Linkage),
+          isFunction, 0);
+      continue;
+    }
+
+    // canUseSummary made sure that no symbol needs canBeHidden's analysis.
+    bool autoHide = sym.Linkage == GlobalValue::LinkOnceODRLinkage &&
+                    sym.Visibility == GlobalValue::DefaultVisibility &&
+                    sym.hasFlag(BitcodeSymbol::UnnamedAddr);
+    uint32_t attr = getDefinedAttributes(
+        sym.Linkage, sym.Visibility, sym.Alignment, isFunction,
+        sym.hasFlag(BitcodeSymbol::Constant), autoHide);
+    addDefinedSymbol(sym.LinkerName, attr, isFunction, 0);
+  }
+
+  addUndefinedSymbols();
+}
+
+/// addUndefinedSymbols - Add the undefined symbols which have not been defined
+/// after all to the list.
+void LTOModule::addUndefinedSymbols() {
   // make symbols for all undefines
   for (StringMap<NameAndAttributes>::iterator u =_undefines.begin(),
          e = _undefines.end(); u != e; ++u) {
@@ -819,8 +969,6 @@ bool LTOModule::parseSymbols(std::string &errMsg) {
     NameAndAttributes info = u->getValue();
     _symbols.push_back(info);
   }
-
-  return false;
 }
 
 /// parseMetadata - Parse metadata from the module
@@ -854,9 +854,12 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   }
   
   // If the function is to be lazily linked, don't create it just yet.
-  // The ValueMaterializerTy will deal with creating it if it's used.
+  // The ValueMaterializerTy will deal with creating it if it's used.  When
+  // only needed definitions are linked, this applies to every function the
+  // destination does not already refer to.
   if (!DGV && (SF->hasLocalLinkage() || SF->hasLinkOnceLinkage() ||
-               SF->hasAvailableExternallyLinkage())) {
+               SF->hasAvailableExternallyLinkage() ||
+               (Mode & Linker::LinkOnlyNeeded))) {
     DoNotLinkFromSource.insert(SF);
     return false;
   }
@@ -981,7 +984,7 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
     ValueMap[I] = DI;
   }
 
-  if (Mode == Linker::DestroySource) {
+  if (!(Mode & Linker::PreserveSource)) {
     // Splice the body of the source function into the dest function.
     Dst->getBasicBlockList().splice(Dst->end(), Src->getBasicBlockList());
     
@@ -1302,49 +1305,33 @@ bool ModuleLinker::run() {
   // be referenced are in DstM.
   linkGlobalInits();
 
-  // Process vector of lazily linked in functions.
-  bool LinkedInAnyFunctions;
-  do {
-    LinkedInAnyFunctions = false;
-    
-    for(std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
-        E = LazilyLinkFunctions.end(); I != E; ++I) {      
-      Function *SF = *I;
-      if (!SF)
-        continue;
-
-      Function *DF = cast<Function>(ValueMap[SF]);
-      if (SF->hasPrefixData()) {
-        // Link in the prefix data.
-        DF->setPrefixData(MapValue(SF->getPrefixData(),
-                                   ValueMap,
-                                   RF_None,
-                                   &TypeMap,
-                                   &ValMaterializer));
-      }
+  // Process vector of lazily linked in functions.  Linking a body may append
+  // further functions to the vector, so it is walked by index.
+  for (unsigned i = 0; i != LazilyLinkFunctions.size(); ++i) {
+    Function *SF = LazilyLinkFunctions[i];
 
-      // Materialize if necessary.
-      if (SF->isDeclaration()) {
-        if (!SF->isMaterializable())
-          continue;
-        if (SF->Materialize(&ErrorMsg))
-          return true;
-      }
-      
-      // Erase from vector *before* the function body is linked - linkFunctionBody could
-      // invalidate I.
-      LazilyLinkFunctions.erase(I);
-
-      // Link in function body.
-      linkFunctionBody(DF, SF);
-      SF->Dematerialize();
+    Function *DF = cast<Function>(ValueMap[SF]);
+    if (SF->hasPrefixData()) {
+      // Link in the prefix data.
+      DF->setPrefixData(MapValue(SF->getPrefixData(),
+                                 ValueMap,
+                                 RF_None,
+                                 &TypeMap,
+                                 &ValMaterializer));
+    }
 
-      // Set flag to indicate we may have more functions to lazily link in
-      // since we linked in a function.
-      LinkedInAnyFunctions = true;
-      break;
+    // Materialize if necessary.
+    if (SF->isDeclaration()) {
+      if (!SF->isMaterializable())
+        continue;
+      if (SF->Materialize(&ErrorMsg))
+        return true;
     }
-  } while (LinkedInAnyFunctions);
+
+    // Link in function body.
+    linkFunctionBody(DF, SF);
+    SF->Dematerialize();
+  }
   
   // Now that all of the types from the source are used, resolve any structs
   // copied over to the dest that didn't exist there.
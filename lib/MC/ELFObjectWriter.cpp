@@ -28,15 +28,38 @@
 #include "llvm/MC/MCObjectWriter.h"
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCValue.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
 #include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#endif
+
 using namespace llvm;
 
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+static cl::opt<unsigned>
+WriteThreads("elf-write-threads", cl::Hidden,
+             cl::desc("Number of threads used to write ELF section contents "
+                      "(0 = one per hardware thread for large objects)"),
+             cl::init(0));
+
+/// Objects smaller than this are written on one thread by default.
+static const uint64_t ParallelWriteThreshold = 1 << 20;
+
+/// The most section contents the workers buffer ahead of the writing.
+/// Sections larger than this are not buffered at all, but written straight
+/// to the stream when their turn comes.
+static const uint64_t MaxBufferedBytes = 64 << 20;
+
 namespace {
 class ELFObjectWriter : public MCObjectWriter {
   protected:
@@ -55,9 +78,13 @@ class ELFObjectWriter : public MCObjectWriter {
     static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
                                           const MCSectionData &SD);
 
-    void WriteDataSectionData(MCAssembler &Asm,
+    void WriteDataSectionData(const MCAssembler &Asm,
                               const MCAsmLayout &Layout,
-                              const MCSectionELF &Section);
+                              const MCSectionData &SD);
+
+    void EncodeSectionData(const MCAssembler &Asm, const MCAsmLayout &Layout,
+                           const MCSectionData &SD,
+                           SmallVectorImpl<char> &Buffer);
 
     /*static bool isFixupKindX86RIPRel(unsigned Kind) {
       return Kind == X86::reloc_riprel_4byte ||
@@ -1452,11 +1479,43 @@ uint64_t ELFObjectWriter::GetSectionAddressSize(const MCAsmLayout &Layout,
   return Layout.getSectionAddressSize(&SD);
 }
 
-void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
-                                           const MCAsmLayout &Layout,
-                                           const MCSectionELF &Section) {
-  const MCSectionData &SD = Asm.getOrCreateSectionData(Section);
+namespace {
+/// An object writer that only provides the primitives for writing section
+/// contents, for sections written somewhere other than the object writer's
+/// stream.
+class SectionContentsWriter : public MCObjectWriter {
+public:
+  SectionContentsWriter(raw_ostream &OS, bool IsLittleEndian)
+    : MCObjectWriter(OS, IsLittleEndian) {}
+
+  virtual void ExecutePostLayoutBinding(MCAssembler &Asm,
+                                        const MCAsmLayout &Layout) {
+    llvm_unreachable("Only for writing section contents!");
+  }
+  virtual void RecordRelocation(const MCAssembler &Asm,
+                                const MCAsmLayout &Layout,
+                                const MCFragment *Fragment,
+                                const MCFixup &Fixup, MCValue Target,
+                                uint64_t &FixedValue) {
+    llvm_unreachable("Only for writing section contents!");
+  }
+  virtual void WriteObject(MCAssembler &Asm, const MCAsmLayout &Layout) {
+    llvm_unreachable("Only for writing section contents!");
+  }
+};
+
+/// A section whose contents a worker encodes ahead of the writing.
+struct BufferedSection {
+  SmallVector<char, 0> Contents;
+  /// Set by the worker once Contents is complete.
+  bool Done;
+  BufferedSection() : Done(false) {}
+};
+}
 
+void ELFObjectWriter::WriteDataSectionData(const MCAssembler &Asm,
+                                           const MCAsmLayout &Layout,
+                                           const MCSectionData &SD) {
   uint64_t Padding = OffsetToAlignment(OS.tell(), SD.getAlignment());
   WriteZeros(Padding);
 
@@ -1472,6 +1531,19 @@ void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
   }
 }
 
+/// EncodeSectionData - Encode the contents of the regular section \p SD into
+/// \p Buffer.  Only the layout is read, so this may run on a worker thread.
+void ELFObjectWriter::EncodeSectionData(const MCAssembler &Asm,
+                                        const MCAsmLayout &Layout,
+                                        const MCSectionData &SD,
+                                        SmallVectorImpl<char> &Buffer) {
+  Buffer.reserve(GetSectionFileSize(Layout, SD));
+  raw_svector_ostream Out(Buffer);
+  SectionContentsWriter Writer(Out, isLittleEndian());
+  Asm.writeSectionData(&SD, Layout, &Writer);
+  Out.flush();
+}
+
 void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
                                          const GroupMapTy &GroupMap,
                                          const MCAsmLayout &Layout,
@@ -1616,13 +1688,97 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
     FileOff += GetSectionFileSize(Layout, SD);
   }
 
+  unsigned NumThreads = WriteThreads;
+  if (NumThreads == 0)
+    NumThreads = FileOff >= ParallelWriteThreshold
+                     ? ThreadPool::getDefaultThreadCount() : 1;
+#if !LLVM_ENABLE_THREADS
+  NumThreads = 1;
+#endif
+  NumThreads = std::min(NumThreads, NumSections);
+
+  // With several threads, workers encode the regular sections into buffers
+  // in file order, while this thread writes the sections out in order as
+  // soon as they are done.  The workers stay at most MaxBufferedBytes ahead
+  // of the writing.  Metadata sections, which are already in memory,
+  // virtual sections and sections too large to buffer are written by this
+  // thread directly.
+  std::vector<BufferedSection> Buffers;
+  std::vector<bool> IsBuffered;
+#if LLVM_ENABLE_THREADS
+  std::mutex Lock;
+  std::condition_variable Progress;
+  unsigned NextSection = 0;
+  uint64_t BufferedBytes = 0;
+  OwningPtr<ThreadPool> Pool;
+  if (NumThreads > 1) {
+    Buffers.resize(NumSections);
+    IsBuffered.resize(NumSections);
+    for (unsigned i = 0; i < NumSections; ++i) {
+      const MCSectionData &SD = Asm.getOrCreateSectionData(*Sections[i]);
+      IsBuffered[i] = !IsELFMetaDataSection(SD) &&
+                      !SD.getSection().isVirtualSection() &&
+                      GetSectionFileSize(Layout, SD) <= MaxBufferedBytes;
+    }
+    Pool.reset(new ThreadPool(NumThreads));
+    for (unsigned t = 0; t != NumThreads; ++t)
+      Pool->async([&] {
+        while (true) {
+          unsigned i;
+          {
+            std::unique_lock<std::mutex> Guard(Lock);
+            while (NextSection != NumSections && !IsBuffered[NextSection])
+              ++NextSection;
+            if (NextSection == NumSections)
+              break;
+            uint64_t Size = GetSectionFileSize(
+                Layout, Asm.getOrCreateSectionData(*Sections[NextSection]));
+            Progress.wait(Guard, [&] {
+              return BufferedBytes == 0 ||
+                     BufferedBytes + Size <= MaxBufferedBytes;
+            });
+            i = NextSection++;
+            BufferedBytes += Size;
+          }
+          EncodeSectionData(Asm, Layout,
+                            Asm.getOrCreateSectionData(*Sections[i]),
+                            Buffers[i].Contents);
+          std::lock_guard<std::mutex> Guard(Lock);
+          Buffers[i].Done = true;
+          Progress.notify_all();
+        }
+      });
+  }
+#endif
+
+  auto WriteSection = [&](unsigned i) {
+    const MCSectionData &SD = Asm.getOrCreateSectionData(*Sections[i]);
+    if (IsBuffered.empty() || !IsBuffered[i]) {
+      WriteDataSectionData(Asm, Layout, SD);
+      return;
+    }
+#if LLVM_ENABLE_THREADS
+    {
+      std::unique_lock<std::mutex> Guard(Lock);
+      Progress.wait(Guard, [&] { return Buffers[i].Done; });
+    }
+    WriteZeros(OffsetToAlignment(OS.tell(), SD.getAlignment()));
+    OS.write(Buffers[i].Contents.data(), Buffers[i].Contents.size());
+    SmallVector<char, 0>().swap(Buffers[i].Contents);
+    uint64_t Size = GetSectionFileSize(Layout, SD);
+    std::lock_guard<std::mutex> Guard(Lock);
+    BufferedBytes -= Size;
+    Progress.notify_all();
+#endif
+  };
+
   // Write out the ELF header ...
   WriteHeader(Asm, SectionHeaderOffset, NumSections + 1);
 
   // ... then the regular sections ...
   // + because of .shstrtab
   for (unsigned i = 0; i < NumRegularSections + 1; ++i)
-    WriteDataSectionData(Asm, Layout, *Sections[i]);
+    WriteSection(i);
 
   uint64_t Padding = OffsetToAlignment(OS.tell(), NaturalAlignment);
   WriteZeros(Padding);
@@ -1633,7 +1789,12 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
 
   // ... and then the remaining sections ...
   for (unsigned i = NumRegularSections + 1; i < NumSections; ++i)
-    WriteDataSectionData(Asm, Layout, *Sections[i]);
+    WriteSection(i);
+
+#if LLVM_ENABLE_THREADS
+  if (Pool)
+    Pool->wait();
+#endif
 }
 
 bool
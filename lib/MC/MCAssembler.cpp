@@ -28,6 +28,7 @@
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -51,6 +52,7 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(RelaxationVisits, "Number of fragments visited during relaxation");
 }
 }
 
@@ -534,9 +536,7 @@ static void writeFragmentContents(const MCFragment &F, MCObjectWriter *OW) {
 
 /// \brief Write the fragment \p F to the output file.
 static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
-                          const MCFragment &F) {
-  MCObjectWriter *OW = &Asm.getWriter();
-
+                          const MCFragment &F, MCObjectWriter *OW) {
   // FIXME: Embed in fragments instead?
   uint64_t FragmentSize = Asm.computeFragmentSize(Layout, F);
 
@@ -684,6 +684,12 @@ static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
 
 void MCAssembler::writeSectionData(const MCSectionData *SD,
                                    const MCAsmLayout &Layout) const {
+  writeSectionData(SD, Layout, &getWriter());
+}
+
+void MCAssembler::writeSectionData(const MCSectionData *SD,
+                                   const MCAsmLayout &Layout,
+                                   MCObjectWriter *OW) const {
   // Ignore virtual sections.
   if (SD->getSection().isVirtualSection()) {
     assert(Layout.getSectionFileSize(SD) == 0 && "Invalid size for section!");
@@ -723,14 +729,14 @@ void MCAssembler::writeSectionData(const MCSectionData *SD,
     return;
   }
 
-  uint64_t Start = getWriter().getStream().tell();
+  uint64_t Start = OW->getStream().tell();
   (void)Start;
 
   for (MCSectionData::const_iterator it = SD->begin(), ie = SD->end();
        it != ie; ++it)
-    writeFragment(*this, Layout, *it);
+    writeFragment(*this, Layout, *it, OW);
 
-  assert(getWriter().getStream().tell() - Start ==
+  assert(OW->getStream().tell() - Start ==
          Layout.getSectionAddressSize(SD));
 }
 
@@ -750,6 +756,363 @@ uint64_t MCAssembler::handleFixup(const MCAsmLayout &Layout,
   return FixedValue;
 }
 
+namespace {
+/// The part of the layout a fragment's relaxation depends on: the sizes of
+/// the fragments with layout order Lo to Hi in section SD.  SD is null if the
+/// fragment does not depend on the layout at all, and Unknown is set if it
+/// may depend on anything.
+struct RelaxDependency {
+  const MCSectionData *SD;
+  unsigned Lo, Hi;
+  bool Unknown;
+
+  RelaxDependency() : SD(0), Lo(~0U), Hi(0), Unknown(false) {}
+
+  void merge(const RelaxDependency &Other) {
+    if (Other.Unknown || (SD && Other.SD && SD != Other.SD)) {
+      Unknown = true;
+      return;
+    }
+    if (!Other.SD)
+      return;
+    SD = Other.SD;
+    Lo = std::min(Lo, Other.Lo);
+    Hi = std::max(Hi, Other.Hi);
+  }
+};
+
+/// Collects the fragments an expression's value is measured from.  When
+/// every fragment added is matched by one subtracted, the value is a distance
+/// within a section, and only changes with the fragments in between.
+class ExprAnchors {
+  const MCAssembler &Asm;
+  RelaxDependency Dep;
+  int Balance;
+  bool Opaque;
+
+public:
+  explicit ExprAnchors(const MCAssembler &Asm)
+    : Asm(Asm), Balance(0), Opaque(false) {}
+
+  void addFragment(const MCFragment *F, int Sign) {
+    if (Dep.SD && Dep.SD != F->getParent()) {
+      Dep.Unknown = true;
+      return;
+    }
+    Dep.SD = F->getParent();
+    Dep.Lo = std::min(Dep.Lo, F->getLayoutOrder());
+    Dep.Hi = std::max(Dep.Hi, F->getLayoutOrder());
+    Balance += Sign;
+  }
+
+  /// Value computed by something other than plain sums and differences, so
+  /// the section offsets of the anchors matter, not just their distance.
+  void setOpaque() { Opaque = true; }
+
+  void addExpr(const MCExpr *E, int Sign) {
+    switch (E->getKind()) {
+    case MCExpr::Constant:
+      return;
+    case MCExpr::Target:
+      Dep.Unknown = true;
+      return;
+    case MCExpr::SymbolRef: {
+      const MCSymbol &Sym = cast<MCSymbolRefExpr>(E)->getSymbol();
+      if (Sym.isVariable())
+        return addExpr(Sym.getVariableValue(), Sign);
+      if (!Sym.isInSection())
+        return;
+      if (const MCFragment *F = Asm.getSymbolData(Sym).getFragment())
+        addFragment(F, Sign);
+      else
+        Dep.Unknown = true;
+      return;
+    }
+    case MCExpr::Unary: {
+      const MCUnaryExpr *UE = cast<MCUnaryExpr>(E);
+      if (UE->getOpcode() == MCUnaryExpr::Minus)
+        Sign = -Sign;
+      else if (UE->getOpcode() != MCUnaryExpr::Plus)
+        Opaque = true;
+      return addExpr(UE->getSubExpr(), Sign);
+    }
+    case MCExpr::Binary: {
+      const MCBinaryExpr *BE = cast<MCBinaryExpr>(E);
+      addExpr(BE->getLHS(), Sign);
+      if (BE->getOpcode() == MCBinaryExpr::Sub)
+        Sign = -Sign;
+      else if (BE->getOpcode() != MCBinaryExpr::Add)
+        Opaque = true;
+      return addExpr(BE->getRHS(), Sign);
+    }
+    }
+    llvm_unreachable("Invalid expression kind!");
+  }
+
+  RelaxDependency getDependency() const {
+    RelaxDependency Result = Dep;
+    // An offset from the start of the section changes with everything before.
+    if (Result.SD && (Balance != 0 || Opaque))
+      Result.Lo = 0;
+    return Result;
+  }
+};
+}
+
+/// getRelaxDependency - Work out which fragments the encoding of \p F
+/// depends on.  This relies on the backend deciding whether to relax a fixup
+/// from its value alone.
+static RelaxDependency getRelaxDependency(const MCAssembler &Asm,
+                                          const MCFragment &F) {
+  RelaxDependency Dep;
+  switch (F.getKind()) {
+  default:
+    break;
+  case MCFragment::FT_Relaxable: {
+    const MCRelaxableFragment &RF = cast<MCRelaxableFragment>(F);
+    for (MCRelaxableFragment::const_fixup_iterator it = RF.fixup_begin(),
+           ie = RF.fixup_end(); it != ie; ++it) {
+      const MCFixupKindInfo &Info =
+        Asm.getBackend().getFixupKindInfo(it->getKind());
+      ExprAnchors Anchors(Asm);
+      Anchors.addExpr(it->getValue(), 1);
+      if (Info.Flags & MCFixupKindInfo::FKF_IsPCRel)
+        Anchors.addFragment(&F, -1);
+      if (Info.Flags & MCFixupKindInfo::FKF_IsAlignedDownTo32Bits)
+        Anchors.setOpaque();
+      Dep.merge(Anchors.getDependency());
+    }
+    break;
+  }
+  case MCFragment::FT_Dwarf:
+  case MCFragment::FT_DwarfFrame:
+  case MCFragment::FT_LEB: {
+    ExprAnchors Anchors(Asm);
+    if (const MCDwarfLineAddrFragment *DF = dyn_cast<MCDwarfLineAddrFragment>(&F))
+      Anchors.addExpr(&DF->getAddrDelta(), 1);
+    else if (const MCDwarfCallFrameFragment *DF =
+               dyn_cast<MCDwarfCallFrameFragment>(&F))
+      Anchors.addExpr(&DF->getAddrDelta(), 1);
+    else
+      Anchors.addExpr(&cast<MCLEBFragment>(F).getValue(), 1);
+    Dep.merge(Anchors.getDependency());
+    break;
+  }
+  }
+  return Dep;
+}
+
+struct MCAssembler::RelaxState {
+  /// A fragment which may need relaxing.
+  struct Candidate {
+    MCFragment *F;
+    /// The section whose layout this candidate depends on, once known.
+    const MCSectionData *DepSD;
+    /// The layout orders this candidate depends on within DepSD.
+    unsigned Lo, Hi;
+    /// The candidate has to be looked at again after any change at all.
+    bool Always;
+    /// The candidate has to be looked at again.
+    bool Dirty;
+    /// The candidate can no longer change.
+    bool Done;
+
+    explicit Candidate(MCFragment *F)
+      : F(F), DepSD(0), Lo(0), Hi(0), Always(false), Dirty(true),
+        Done(false) {}
+  };
+
+  /// A candidate, by section and index within the section.
+  typedef std::pair<unsigned, unsigned> CandidateRef;
+
+  struct Section {
+    /// The candidates in this section, in layout order.
+    std::vector<Candidate> Candidates;
+    /// The layout orders of the fragments whose size depends on where they
+    /// are placed.
+    std::vector<unsigned> Barriers;
+    /// The candidates, in any section, which depend on this section.
+    std::vector<CandidateRef> Dependents;
+    unsigned NumDirty;
+
+    Section() : NumDirty(0) {}
+  };
+
+  /// The sections, indexed by layout order.
+  std::vector<Section> Sections;
+  /// The candidates which depend on the layout in ways we cannot track.
+  std::vector<CandidateRef> AlwaysDirty;
+
+  RelaxState(const MCAsmLayout &Layout, bool TrackNothing) {
+    const SmallVectorImpl<MCSectionData *> &Order = Layout.getSectionOrder();
+    Sections.resize(Order.size());
+    for (unsigned i = 0, e = Order.size(); i != e; ++i) {
+      Section &S = Sections[i];
+      for (MCSectionData::iterator I = Order[i]->begin(), IE = Order[i]->end();
+           I != IE; ++I) {
+        switch (I->getKind()) {
+        case MCFragment::FT_Align:
+        case MCFragment::FT_Org:
+          S.Barriers.push_back(I->getLayoutOrder());
+          break;
+        case MCFragment::FT_Relaxable:
+        case MCFragment::FT_Dwarf:
+        case MCFragment::FT_DwarfFrame:
+        case MCFragment::FT_LEB:
+          // With bundling, padding can change anywhere.
+          if (TrackNothing)
+            AlwaysDirty.push_back(CandidateRef(i, S.Candidates.size()));
+          S.Candidates.push_back(Candidate(I));
+          S.Candidates.back().Always = TrackNothing;
+          break;
+        default:
+          break;
+        }
+      }
+      S.NumDirty = S.Candidates.size();
+    }
+  }
+
+  void markDirty(CandidateRef Ref) {
+    Candidate &C = Sections[Ref.first].Candidates[Ref.second];
+    if (C.Dirty || C.Done)
+      return;
+    C.Dirty = true;
+    ++Sections[Ref.first].NumDirty;
+  }
+
+  /// Record what the candidate depends on after a visit.
+  void setDependency(CandidateRef Ref, const RelaxDependency &Dep) {
+    Candidate &C = Sections[Ref.first].Candidates[Ref.second];
+    if (C.Always)
+      return;
+    if (Dep.Unknown || (C.DepSD && Dep.SD && C.DepSD != Dep.SD)) {
+      C.Always = true;
+      AlwaysDirty.push_back(Ref);
+      return;
+    }
+    if (!Dep.SD)
+      return;
+    if (!C.DepSD) {
+      C.DepSD = Dep.SD;
+      Sections[Dep.SD->getLayoutOrder()].Dependents.push_back(Ref);
+    }
+    C.Lo = Dep.Lo;
+    C.Hi = Dep.Hi;
+  }
+
+  /// Queue up the candidates affected by the fragments of section
+  /// \p SectionIndex at the layout orders in \p Changed, sorted, changing
+  /// size.
+  void markChanged(unsigned SectionIndex, ArrayRef<unsigned> Changed) {
+    const Section &S = Sections[SectionIndex];
+    for (unsigned i = 0, e = S.Dependents.size(); i != e; ++i) {
+      const Candidate &C =
+        Sections[S.Dependents[i].first].Candidates[S.Dependents[i].second];
+      if (!C.Dirty && !C.Done && !C.Always &&
+          isAffected(C.Lo, C.Hi, Changed, S.Barriers))
+        markDirty(S.Dependents[i]);
+    }
+    for (unsigned i = 0, e = AlwaysDirty.size(); i != e; ++i)
+      markDirty(AlwaysDirty[i]);
+  }
+
+  /// Return true if the distance between fragments \p Lo and \p Hi may have
+  /// changed.
+  static bool isAffected(unsigned Lo, unsigned Hi, ArrayRef<unsigned> Changed,
+                         ArrayRef<unsigned> Barriers) {
+    // Something in between changed size...
+    const unsigned *I = std::lower_bound(Changed.begin(), Changed.end(), Lo);
+    if (I != Changed.end() && *I <= Hi)
+      return true;
+    // ...or an alignment in between was moved, and may have changed with it.
+    const unsigned *B = std::upper_bound(Barriers.begin(), Barriers.end(), Hi);
+    return B != Barriers.begin() && *--B >= Lo && Changed.front() < *B;
+  }
+};
+
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCRelaxableFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
+
+void MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, RelaxState &State,
+                                    unsigned SectionIndex) {
+  RelaxState::Section &S = State.Sections[SectionIndex];
+  // The layout orders of the fragments which changed during this pass.
+  // Offsets are not recomputed until the pass is over, so later fragments may
+  // be looked at with stale offsets, but those fragments are affected by the
+  // changes and will be queued up again.
+  SmallVector<unsigned, 16> Changed;
+  // The relaxed instructions, by index in S.Candidates.
+  SmallVector<unsigned, 16> Relaxed;
+  MCFragment *FirstChanged = 0;
+
+  for (unsigned i = 0, e = S.Candidates.size(); i != e && S.NumDirty; ++i) {
+    RelaxState::Candidate &C = S.Candidates[i];
+    if (!C.Dirty)
+      continue;
+    C.Dirty = false;
+    --S.NumDirty;
+    ++stats::RelaxationVisits;
+
+    // Once an instruction cannot be relaxed any further, it stays the size it
+    // is.
+    if (MCRelaxableFragment *RF = dyn_cast<MCRelaxableFragment>(C.F))
+      if (!getBackend().mayNeedRelaxation(RF->getInst())) {
+        C.Done = true;
+        continue;
+      }
+
+    if (relaxFragment(Layout, *C.F)) {
+      if (!FirstChanged)
+        FirstChanged = C.F;
+      Changed.push_back(C.F->getLayoutOrder());
+      if (isa<MCRelaxableFragment>(C.F))
+        Relaxed.push_back(i);
+    }
+    State.setDependency(RelaxState::CandidateRef(SectionIndex, i),
+                        getRelaxDependency(*this, *C.F));
+  }
+
+  if (!FirstChanged)
+    return;
+  // When a fragment is relaxed, all the fragments following it should get
+  // invalidated because their offset is going to change.
+  Layout.invalidateFragmentsFrom(FirstChanged);
+  State.markChanged(SectionIndex, Changed);
+  // A relaxed instruction may need relaxing again.
+  for (unsigned i = 0, e = Relaxed.size(); i != e; ++i)
+    State.markDirty(RelaxState::CandidateRef(SectionIndex, Relaxed[i]));
+}
+
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout, RelaxState &State) {
+  ++stats::RelaxationSteps;
+
+  for (unsigned i = 0, e = State.Sections.size(); i != e; ++i)
+    while (State.Sections[i].NumDirty)
+      layoutSectionOnce(Layout, State, i);
+
+  // Changes in later sections may have affected earlier ones.
+  for (unsigned i = 0, e = State.Sections.size(); i != e; ++i)
+    if (State.Sections[i].NumDirty)
+      return true;
+  return false;
+}
+
 void MCAssembler::Finish() {
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - pre-layout\n--\n";
@@ -781,7 +1144,8 @@ void MCAssembler::Finish() {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout))
+  RelaxState State(Layout, isBundlingEnabled());
+  while (layoutOnce(Layout, State))
     continue;
 
   DEBUG_WITH_TYPE("mc-dump", {
@@ -937,61 +1301,6 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = NULL;
-
-  // Attempt to relax all the fragments in the section.
-  for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
-    default:
-      break;
-    case MCFragment::FT_Relaxable:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
-      break;
-    case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
-    case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
-    case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
-      break;
-    }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
-  }
-  if (FirstRelaxedFragment) {
-    Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
-  }
-  return false;
-}
-
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
-  ++stats::RelaxationSteps;
-
-  bool WasRelaxed = false;
-  for (iterator it = begin(), ie = end(); it != ie; ++it) {
-    MCSectionData &SD = *it;
-    while (layoutSectionOnce(Layout, SD))
-      WasRelaxed = true;
-  }
-
-  return WasRelaxed;
-}
-
 void MCAssembler::finishLayout(MCAsmLayout &Layout) {
   // The layout is done. Mark every fragment as valid.
   for (unsigned int i = 0, n = Layout.getSectionOrder().size(); i != n; ++i) {
@@ -39,8 +39,8 @@ MCContext::MCContext(const MCAsmInfo *mai, const MCRegisterInfo *mri,
                      const MCObjectFileInfo *mofi, const SourceMgr *mgr,
                      bool DoAutoReset) :
   SrcMgr(mgr), MAI(mai), MRI(mri), MOFI(mofi),
-  Allocator(), Symbols(Allocator), UsedNames(Allocator),
-  NextUniqueID(0),
+  Allocator(), UsedNames(Allocator),
+  NextUniqueID(0), Multithreaded(false), CreationLock(/*recursive=*/true),
   CurrentDwarfLoc(0,0,0,DWARF2_FLAG_IS_STMT,0,0),
   DwarfLocSeen(false), GenDwarfForAssembly(false), GenDwarfFileNumber(0),
   AllowTemporaryLabels(true), DwarfCompileUnitID(0), AutoReset(DoAutoReset) {
@@ -113,19 +113,49 @@ void MCContext::reset() {
 // Symbol Manipulation
 //===----------------------------------------------------------------------===//
 
+namespace {
+/// CreationGuard - Holds the creation lock of a multithreaded context.
+class CreationGuard {
+  sys::MutexImpl *Locked;
+public:
+  CreationGuard(sys::MutexImpl &Lock, bool Multithreaded) : Locked(0) {
+    if (Multithreaded) {
+      Lock.acquire();
+      Locked = &Lock;
+    }
+  }
+  ~CreationGuard() {
+    if (Locked)
+      Locked->release();
+  }
+};
+}
+
 MCSymbol *MCContext::GetOrCreateSymbol(StringRef Name) {
   assert(!Name.empty() && "Normal symbols cannot be unnamed!");
 
-  // Do the lookup and get the entire StringMapEntry.  We want access to the
-  // key if we are creating the entry.
-  StringMapEntry<MCSymbol*> &Entry = Symbols.GetOrCreateValue(Name);
-  MCSymbol *Sym = Entry.getValue();
+  unsigned Hash = SymbolTable::hash(Name);
+  if (!Multithreaded) {
+    StringMapEntry<MCSymbol*> &Entry = Symbols.GetOrCreateValue(Name, Hash);
+    MCSymbol *Sym = Entry.getValue();
+    if (!Sym) {
+      Sym = CreateSymbol(Name);
+      Entry.setValue(Sym);
+    }
+    return Sym;
+  }
+
+  if (MCSymbol *Sym = Symbols.lookup(Name, Hash))
+    return Sym;
 
-  if (Sym)
+  // Another thread may have created the symbol since the lookup; creating it
+  // twice would rename the second copy.
+  CreationGuard Guard(CreationLock, Multithreaded);
+  if (MCSymbol *Sym = Symbols.lookup(Name, Hash))
     return Sym;
 
-  Sym = CreateSymbol(Name);
-  Entry.setValue(Sym);
+  MCSymbol *Sym = CreateSymbol(Name);
+  Symbols.insert(Name, Sym, Hash);
   return Sym;
 }
 
@@ -160,12 +190,18 @@ MCSymbol *MCContext::GetOrCreateSymbol(const Twine &Name) {
 }
 
 MCSymbol *MCContext::CreateTempSymbol() {
+  CreationGuard Guard(CreationLock, Multithreaded);
   SmallString<128> NameSV;
   raw_svector_ostream(NameSV)
     << MAI->getPrivateGlobalPrefix() << "tmp" << NextUniqueID++;
   return CreateSymbol(NameSV);
 }
 
+unsigned MCContext::getUniqueSymbolID() {
+  CreationGuard Guard(CreationLock, Multithreaded);
+  return NextUniqueID++;
+}
+
 unsigned MCContext::NextInstance(int64_t LocalLabelVal) {
   MCLabel *&Label = Instances[LocalLabelVal];
   if (!Label)
@@ -675,20 +675,24 @@ bool AsmParser::Run(bool NoInitialTextSection, bool NoFinalize) {
   // as otherwise we won't necessarilly have seen everything yet.
   if (!NoFinalize && MAI.hasSubsectionsViaSymbols()) {
     const MCContext::SymbolTable &Symbols = getContext().getSymbols();
-    for (MCContext::SymbolTable::const_iterator i = Symbols.begin(),
-                                                e = Symbols.end();
-         i != e; ++i) {
-      MCSymbol *Sym = i->getValue();
-      // Variable symbols may not be marked as defined, so check those
-      // explicitly. If we know it's a variable, we have a definition for
-      // the purposes of this check.
-      if (Sym->isTemporary() && !Sym->isVariable() && !Sym->isDefined())
-        // FIXME: We would really like to refer back to where the symbol was
-        // first referenced for a source location. We need to add something
-        // to track that. Currently, we just point to the end of the file.
-        printMessage(
-            getLexer().getLoc(), SourceMgr::DK_Error,
-            "assembler local symbol '" + Sym->getName() + "' not defined");
+    for (unsigned Shard = 0; Shard != MCContext::SymbolTable::NumShards;
+         ++Shard) {
+      const MCContext::SymbolTable::MapTy &Map = Symbols.getShardMap(Shard);
+      for (MCContext::SymbolTable::MapTy::const_iterator i = Map.begin(),
+                                                         e = Map.end();
+           i != e; ++i) {
+        MCSymbol *Sym = i->getValue();
+        // Variable symbols may not be marked as defined, so check those
+        // explicitly. If we know it's a variable, we have a definition for
+        // the purposes of this check.
+        if (Sym->isTemporary() && !Sym->isVariable() && !Sym->isDefined())
+          // FIXME: We would really like to refer back to where the symbol was
+          // first referenced for a source location. We need to add something
+          // to track that. Currently, we just point to the end of the file.
+          printMessage(
+              getLexer().getLoc(), SourceMgr::DK_Error,
+              "assembler local symbol '" + Sym->getName() + "' not defined");
+      }
     }
   }
 
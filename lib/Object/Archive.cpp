@@ -437,22 +437,35 @@ Archive::symbol_iterator Archive::symbol_end() const {
     Symbol(this, symbol_count, 0));
 }
 
-Archive::child_iterator Archive::findSym(StringRef name) const {
-  Archive::symbol_iterator bs = symbol_begin();
-  Archive::symbol_iterator es = symbol_end();
-  Archive::child_iterator result;
-  
+void Archive::buildSymbolIndex() const {
+  SymbolIndex.reset(new StringMap<Symbol>());
   StringRef symname;
-  for (; bs != es; ++bs) {
+  for (symbol_iterator bs = symbol_begin(), es = symbol_end(); bs != es;
+       ++bs) {
+    // The names after one that cannot be read cannot be found either.
     if (bs->getName(symname))
-        return child_end();
-    if (symname == name) {
-      if (bs->getMember(result))
-        return child_end();
-      return result;
-    }
+      break;
+    // Keep the first entry for a name.
+    SymbolIndex->GetOrCreateValue(symname, *bs);
+  }
+}
+
+Archive::child_iterator Archive::findSym(StringRef name) const {
+  const Symbol *Sym;
+  {
+    sys::ScopedLock Guard(SymbolIndexLock);
+    if (!SymbolIndex)
+      buildSymbolIndex();
+    StringMap<Symbol>::const_iterator I = SymbolIndex->find(name);
+    if (I == SymbolIndex->end())
+      return child_end();
+    Sym = &I->getValue();
   }
-  return child_end();
+
+  Archive::child_iterator result;
+  if (Sym->getMember(result))
+    return child_end();
+  return result;
 }
 
 bool Archive::hasSymbolTable() const {
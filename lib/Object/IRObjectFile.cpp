@@ -12,90 +12,72 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Bitcode/SymbolSummary.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Object/IRObjectFile.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 using namespace object;
 
 IRObjectFile::IRObjectFile(MemoryBuffer *Object, error_code &EC,
                            LLVMContext &Context, bool BufferOwned)
-    : SymbolicFile(Binary::ID_IR, Object, BufferOwned) {
-  ErrorOr<Module*> MOrErr = parseBitcodeFile(Object, Context);
-  if ((EC = MOrErr.getError()))
+    : SymbolicFile(Binary::ID_IR, Object, BufferOwned), Context(Context) {
+  // A summary tells us everything about the symbols; leave the module alone.
+  ErrorOr<BitcodeSymbolSummary *> SummaryOrErr =
+      readBitcodeSymbolSummary(Object, Context);
+  if ((EC = SummaryOrErr.getError()))
     return;
-
-  M.reset(MOrErr.get());
-
-  // If we have a DataLayout, setup a mangler.
-  const DataLayout *DL = M->getDataLayout();
-  if (!DL)
+  Summary.reset(SummaryOrErr.get());
+  if (Summary)
     return;
 
-  Mang.reset(new Mangler(DL));
+  EC = parseModule();
 }
 
-static const GlobalValue &getGV(DataRefImpl &Symb) {
-  return *reinterpret_cast<GlobalValue*>(Symb.p & ~uintptr_t(3));
-}
+IRObjectFile::~IRObjectFile() {}
 
-static uintptr_t skipEmpty(Module::const_alias_iterator I, const Module &M) {
-  if (I == M.alias_end())
-    return 3;
-  const GlobalValue *GV = &*I;
-  return reinterpret_cast<uintptr_t>(GV) | 2;
-}
+error_code IRObjectFile::parseModule() const {
+  ErrorOr<Module*> MOrErr = parseBitcodeFile(Data, Context);
+  if (error_code EC = MOrErr.getError())
+    return EC;
+
+  M.reset(MOrErr.get());
+  for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I)
+    Symbols.push_back(I);
+  for (Module::const_global_iterator I = M->global_begin(),
+         E = M->global_end(); I != E; ++I)
+    Symbols.push_back(I);
+  for (Module::const_alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    Symbols.push_back(I);
 
-static uintptr_t skipEmpty(Module::const_global_iterator I, const Module &M) {
-  if (I == M.global_end())
-    return skipEmpty(M.alias_begin(), M);
-  const GlobalValue *GV = &*I;
-  return reinterpret_cast<uintptr_t>(GV) | 1;
+  // If we have a DataLayout, setup a mangler.
+  if (const DataLayout *DL = M->getDataLayout())
+    Mang.reset(new Mangler(DL));
+  return object_error::success;
 }
 
-static uintptr_t skipEmpty(Module::const_iterator I, const Module &M) {
-  if (I == M.end())
-    return skipEmpty(M.global_begin(), M);
-  const GlobalValue *GV = &*I;
-  return reinterpret_cast<uintptr_t>(GV) | 0;
+size_t IRObjectFile::getNumSymbols() const {
+  return Summary ? Summary->Symbols.size() : Symbols.size();
 }
 
 void IRObjectFile::moveSymbolNext(DataRefImpl &Symb) const {
-  const GlobalValue *GV = &getGV(Symb);
-  const Module &M = *GV->getParent();
-  uintptr_t Res;
-  switch (Symb.p & 3) {
-  case 0: {
-    Module::const_iterator Iter(static_cast<const Function*>(GV));
-    ++Iter;
-    Res = skipEmpty(Iter, M);
-    break;
-  }
-  case 1: {
-    Module::const_global_iterator Iter(static_cast<const GlobalVariable*>(GV));
-    ++Iter;
-    Res = skipEmpty(Iter, M);
-    break;
-  }
-  case 2: {
-    Module::const_alias_iterator Iter(static_cast<const GlobalAlias*>(GV));
-    ++Iter;
-    Res = skipEmpty(Iter, M);
-    break;
-  }
-  case 3:
-    llvm_unreachable("Invalid symbol reference");
-  }
-
-  Symb.p = Res;
+  assert(Symb.p < getNumSymbols() && "Invalid symbol reference");
+  ++Symb.p;
 }
 
 error_code IRObjectFile::printSymbolName(raw_ostream &OS,
                                          DataRefImpl Symb) const {
-  const GlobalValue &GV = getGV(Symb);
+  if (Summary) {
+    OS << Summary->Symbols[Symb.p].LinkerName;
+    return object_error::success;
+  }
 
+  const GlobalValue &GV = *Symbols[Symb.p];
   if (Mang)
     Mang->getNameWithPrefix(OS, &GV, false);
   else
@@ -104,40 +86,56 @@ error_code IRObjectFile::printSymbolName(raw_ostream &OS,
   return object_error::success;
 }
 
-uint32_t IRObjectFile::getSymbolFlags(DataRefImpl Symb) const {
-  const GlobalValue &GV = getGV(Symb);
-
+static uint32_t getLinkageFlags(GlobalValue::LinkageTypes Linkage,
+                               bool IsDeclaration) {
   uint32_t Res = BasicSymbolRef::SF_None;
-  if (GV.isDeclaration() || GV.hasAvailableExternallyLinkage())
+  if (IsDeclaration || GlobalValue::isAvailableExternallyLinkage(Linkage))
     Res |= BasicSymbolRef::SF_Undefined;
-  if (GV.hasPrivateLinkage() || GV.hasLinkerPrivateLinkage() ||
-      GV.hasLinkerPrivateWeakLinkage())
+  if (GlobalValue::isPrivateLinkage(Linkage) ||
+      GlobalValue::isLinkerPrivateLinkage(Linkage) ||
+      GlobalValue::isLinkerPrivateWeakLinkage(Linkage))
     Res |= BasicSymbolRef::SF_FormatSpecific;
-  if (!GV.hasLocalLinkage())
+  if (!GlobalValue::isLocalLinkage(Linkage))
     Res |= BasicSymbolRef::SF_Global;
-  if (GV.hasCommonLinkage())
+  if (GlobalValue::isCommonLinkage(Linkage))
     Res |= BasicSymbolRef::SF_Common;
-  if (GV.hasLinkOnceLinkage() || GV.hasWeakLinkage())
+  if (GlobalValue::isLinkOnceLinkage(Linkage) ||
+      GlobalValue::isWeakLinkage(Linkage))
     Res |= BasicSymbolRef::SF_Weak;
 
   return Res;
 }
 
+uint32_t IRObjectFile::getSymbolFlags(DataRefImpl Symb) const {
+  if (Summary) {
+    const BitcodeSymbol &Sym = Summary->Symbols[Symb.p];
+    return getLinkageFlags(Sym.Linkage,
+                           Sym.hasFlag(BitcodeSymbol::Declaration));
+  }
+
+  const GlobalValue &GV = *Symbols[Symb.p];
+  return getLinkageFlags(GV.getLinkage(), GV.isDeclaration());
+}
+
 const GlobalValue &IRObjectFile::getSymbolGV(DataRefImpl Symb) const {
-  const GlobalValue &GV = getGV(Symb);
-  return GV;
+  if (!M)
+    if (error_code EC = parseModule())
+      report_fatal_error(Twine("Could not parse bitcode file ") +
+                         Data->getBufferIdentifier() + ": " + EC.message());
+  assert(Symbols.size() == getNumSymbols() &&
+         "Symbol summary does not match the module!");
+  return *Symbols[Symb.p];
 }
 
 basic_symbol_iterator IRObjectFile::symbol_begin_impl() const {
-  Module::const_iterator I = M->begin();
   DataRefImpl Ret;
-  Ret.p = skipEmpty(I, *M);
+  Ret.p = 0;
   return basic_symbol_iterator(BasicSymbolRef(Ret, this));
 }
 
 basic_symbol_iterator IRObjectFile::symbol_end_impl() const {
   DataRefImpl Ret;
-  Ret.p = 3;
+  Ret.p = getNumSymbols();
   return basic_symbol_iterator(BasicSymbolRef(Ret, this));
 }
 
@@ -0,0 +1,56 @@
+//=-- SampleProf.cpp - Sample profiling format support --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains common definitions used in the reading and writing of
+// sample profile data.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProf.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+
+/// \brief Add \p N times \p Weight to \p Sum.  Returns false on overflow.
+static bool addSamples(uint32_t &Sum, uint32_t N, unsigned Weight) {
+  uint64_t Product = (uint64_t)N * Weight;
+  if (Product > UINT32_MAX - Sum)
+    return false;
+  Sum += Product;
+  return true;
+}
+
+bool FunctionSamples::merge(const FunctionSamples &Other, unsigned Weight) {
+  if (!addSamples(TotalSamples, Other.TotalSamples, Weight) ||
+      !addSamples(TotalHeadSamples, Other.TotalHeadSamples, Weight))
+    return false;
+  for (BodySampleMap::const_iterator I = Other.BodySamples.begin(),
+                                     E = Other.BodySamples.end();
+       I != E; ++I)
+    if (!addSamples(BodySamples[I->first], I->second, Weight))
+      return false;
+  return true;
+}
+
+/// \brief Print this function profile on stream \p OS.
+///
+/// \param OS Stream to emit the output to.
+void FunctionSamples::print(raw_ostream &OS) const {
+  OS << TotalSamples << ", " << TotalHeadSamples << ", " << BodySamples.size()
+     << " sampled lines\n";
+  SmallVector<std::pair<uint32_t, uint32_t>, 32> Lines(BodySamples.begin(),
+                                                       BodySamples.end());
+  std::sort(Lines.begin(), Lines.end());
+  for (unsigned I = 0, E = Lines.size(); I != E; ++I)
+    OS << "\tline offset: " << Lines[I].first
+       << ", number of samples: " << Lines[I].second << "\n";
+  OS << "\n";
+}
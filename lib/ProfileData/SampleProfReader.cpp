@@ -0,0 +1,358 @@
+//===- SampleProfReader.cpp - Read LLVM sample profile data ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the class that reads LLVM sample profiles.  It
+// supports two file formats: text and binary.  The text format is useful
+// for debugging and testing, while the binary format is meant for the large
+// profiles of production builds.  The layout of a binary profile is
+// described in SampleProfWriter.cpp.
+//
+// For a profile to produce meaningful data, the program needs to be
+// compiled with some debug information (at minimum, line numbers:
+// -gline-tables-only). Otherwise, it will be impossible to match IR
+// instructions to the line numbers collected by the profiler.
+//
+// From the profile file, we are interested in collecting the
+// following information:
+//
+// * A list of functions included in the profile (mangled names).
+//
+// * For each function F:
+//   1. The total number of samples collected in F.
+//
+//   2. The samples collected at each line in F. To provide some
+//      protection against source code shuffling, line numbers should
+//      be relative to the start of the function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <cctype>
+
+using namespace llvm;
+
+SampleProfileReader::~SampleProfileReader() {}
+
+SampleProfileReader *SampleProfileReader::create(StringRef Filename) {
+  OwningPtr<MemoryBuffer> Buffer;
+  // The buffer need not be null terminated; this lets large binary profiles
+  // be mapped instead of read.
+  error_code EC = MemoryBuffer::getFile(Filename, Buffer, -1,
+                                        /*RequiresNullTerminator=*/false);
+  if (EC)
+    report_fatal_error("Could not open file " + Filename + ": " + EC.message());
+
+  SampleProfileReader *Reader;
+  if (SampleProfileReaderBinary::hasFormat(*Buffer))
+    Reader = new SampleProfileReaderBinary(Buffer.take(), Filename);
+  else
+    Reader = new SampleProfileReaderText(Buffer.take(), Filename);
+  Reader->read();
+  return Reader;
+}
+
+void SampleProfileReader::reportParseError(int64_t LineNumber,
+                                           Twine Msg) const {
+  report_fatal_error(Filename + ":" + Twine(LineNumber) + ": " + Msg + "\n");
+}
+
+void SampleProfileReader::printFunctionProfile(raw_ostream &OS,
+                                               StringRef FName) {
+  FunctionSamples FS;
+  getSamples(FName, FS);
+  OS << "Function: " << FName << ":\n";
+  FS.print(OS);
+}
+
+void SampleProfileReader::dumpFunctionProfile(StringRef FName) {
+  printFunctionProfile(dbgs(), FName);
+}
+
+void SampleProfileReader::dump() {
+  std::vector<StringRef> Names;
+  getFunctionNames(Names);
+  for (unsigned I = 0, E = Names.size(); I != E; ++I)
+    dumpFunctionProfile(Names[I]);
+}
+
+//===----------------------------------------------------------------------===//
+// Text format
+//===----------------------------------------------------------------------===//
+
+/// \brief Load samples from a text file.
+///
+/// The file contains a list of samples for every function executed at
+/// runtime. Each function profile has the following format:
+///
+///    function1:total_samples:total_head_samples
+///    offset1[.discriminator]: number_of_samples [fn1:num fn2:num ... ]
+///    offset2[.discriminator]: number_of_samples [fn3:num fn4:num ... ]
+///    ...
+///    offsetN[.discriminator]: number_of_samples [fn5:num fn6:num ... ]
+///
+/// Function names must be mangled in order for the profile loader to
+/// match them in the current translation unit. The two numbers in the
+/// function header specify how many total samples were accumulated in
+/// the function (first number), and the total number of samples accumulated
+/// at the prologue of the function (second number). This head sample
+/// count provides an indicator of how frequent is the function invoked.
+///
+/// Each sampled line may contain several items. Some are optional
+/// (marked below):
+///
+/// a- Source line offset. This number represents the line number
+///    in the function where the sample was collected. The line number
+///    is always relative to the line where symbol of the function
+///    is defined. So, if the function has its header at line 280,
+///    the offset 13 is at line 293 in the file.
+///
+/// b- [OPTIONAL] Discriminator. This is used if the sampled program
+///    was compiled with DWARF discriminator support
+///    (http://wiki.dwarfstd.org/index.php?title=Path_Discriminators)
+///    This is currently only emitted by GCC and we just ignore it.
+///
+///    FIXME: Handle discriminators, since they are needed to distinguish
+///           multiple control flow within a single source LOC.
+///
+/// c- Number of samples. This is the number of samples collected by
+///    the profiler at this source location.
+///
+/// d- [OPTIONAL] Potential call targets and samples. If present, this
+///    line contains a call instruction. This models both direct and
+///    indirect calls. Each called target is listed together with the
+///    number of samples. For example,
+///
+///    130: 7  foo:3  bar:2  baz:7
+///
+///    The above means that at relative line offset 130 there is a
+///    call instruction that calls one of foo(), bar() and baz(). With
+///    baz() being the relatively more frequent call target.
+///
+///    FIXME: This is currently unhandled, but it has a lot of
+///           potential for aiding the inliner.
+///
+///
+/// Since this is a flat profile, a function that shows up more than
+/// once gets all its samples aggregated across all its instances.
+///
+/// FIXME: flat profiles are too imprecise to provide good optimization
+///        opportunities. Convert them to context-sensitive profile.
+///
+/// This textual representation is useful to generate unit tests and
+/// for debugging purposes, but it should not be used to generate
+/// profiles for large programs, as the representation is extremely
+/// inefficient.
+void SampleProfileReaderText::read() {
+  // line_iterator needs a null-terminated buffer, which a mapped file need
+  // not be.  Text profiles are small, so just copy it.
+  Buffer.reset(MemoryBuffer::getMemBufferCopy(Buffer->getBuffer(),
+                                              Buffer->getBufferIdentifier()));
+  line_iterator LineIt(*Buffer, '#');
+
+  // Read the profile of each function. Since each function may be
+  // mentioned more than once, and we are collecting flat profiles,
+  // accumulate samples as we parse them.
+  Regex HeadRE("^([^:]+):([0-9]+):([0-9]+)$");
+  Regex LineSample("^([0-9]+)(\\.[0-9]+)?: ([0-9]+)(.*)$");
+  while (!LineIt.is_at_eof()) {
+    // Read the header of each function. The function header should
+    // have this format:
+    //
+    //        function_name:total_samples:total_head_samples
+    //
+    // See above for an explanation of each field.
+    SmallVector<StringRef, 3> Matches;
+    if (!HeadRE.match(*LineIt, &Matches))
+      reportParseError(LineIt.line_number(),
+                       "Expected 'mangled_name:NUM:NUM', found " + *LineIt);
+    assert(Matches.size() == 4);
+    StringRef FName = Matches[1];
+    unsigned NumSamples, NumHeadSamples;
+    Matches[2].getAsInteger(10, NumSamples);
+    Matches[3].getAsInteger(10, NumHeadSamples);
+    Profiles[FName] = FunctionSamples();
+    FunctionSamples &FProfile = Profiles[FName];
+    FProfile.addTotalSamples(NumSamples);
+    FProfile.addHeadSamples(NumHeadSamples);
+    ++LineIt;
+
+    // Now read the body. The body of the function ends when we reach
+    // EOF or when we see the start of the next function.
+    while (!LineIt.is_at_eof() && isdigit((*LineIt)[0])) {
+      if (!LineSample.match(*LineIt, &Matches))
+        reportParseError(
+            LineIt.line_number(),
+            "Expected 'NUM[.NUM]: NUM[ mangled_name:NUM]*', found " + *LineIt);
+      assert(Matches.size() == 5);
+      unsigned LineOffset, NumSamples;
+      Matches[1].getAsInteger(10, LineOffset);
+
+      // FIXME: Handle discriminator information (in Matches[2]).
+
+      Matches[3].getAsInteger(10, NumSamples);
+
+      // FIXME: Handle called targets (in Matches[4]).
+
+      // When dealing with instruction weights, we use the value
+      // zero to indicate the absence of a sample. If we read an
+      // actual zero from the profile file, return it as 1 to
+      // avoid the confusion later on.
+      if (NumSamples == 0)
+        NumSamples = 1;
+      FProfile.addBodySamples(LineOffset, NumSamples);
+      ++LineIt;
+    }
+  }
+}
+
+bool SampleProfileReaderText::getSamples(StringRef FName,
+                                         FunctionSamples &FS) {
+  StringMap<FunctionSamples>::const_iterator I = Profiles.find(FName);
+  if (I == Profiles.end())
+    return false;
+  FS = I->getValue();
+  return true;
+}
+
+void SampleProfileReaderText::getFunctionNames(
+    std::vector<StringRef> &Names) {
+  for (StringMap<FunctionSamples>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Names.push_back(I->getKey());
+}
+
+//===----------------------------------------------------------------------===//
+// Binary format
+//===----------------------------------------------------------------------===//
+
+bool SampleProfileReaderBinary::hasFormat(const MemoryBuffer &Buffer) {
+  if (Buffer.getBufferSize() < sizeof(uint64_t))
+    return false;
+  return support::endian::read<uint64_t, support::little, support::unaligned>(
+             Buffer.getBufferStart()) == sampleprof::SPMagic();
+}
+
+void SampleProfileReaderBinary::reportFormatError(Twine Msg) const {
+  report_fatal_error(Filename + ": malformed binary sample profile: " + Msg +
+                     "\n");
+}
+
+const char *SampleProfileReaderBinary::getData(uint64_t Offset,
+                                               uint64_t Size) const {
+  uint64_t BufferSize = Buffer->getBufferSize();
+  if (Offset > BufferSize || Size > BufferSize - Offset)
+    reportFormatError("offset " + Twine(Offset) + " is past the end");
+  return Buffer->getBufferStart() + Offset;
+}
+
+uint32_t SampleProfileReaderBinary::readWord(uint64_t Offset) const {
+  return support::endian::read<uint32_t, support::little, support::unaligned>(
+      getData(Offset, sizeof(uint32_t)));
+}
+
+uint32_t SampleProfileReaderBinary::readULEB(uint64_t &Offset) const {
+  uint64_t Value = 0;
+  unsigned Shift = 0;
+  uint8_t Byte;
+  do {
+    if (Shift >= 32)
+      reportFormatError("number at offset " + Twine(Offset) + " is too large");
+    Byte = *getData(Offset++, 1);
+    Value |= uint64_t(Byte & 0x7f) << Shift;
+    Shift += 7;
+  } while (Byte & 0x80);
+  if (Value > UINT32_MAX)
+    reportFormatError("number at offset " + Twine(Offset) + " is too large");
+  return Value;
+}
+
+StringRef SampleProfileReaderBinary::readName(uint64_t &Offset) const {
+  uint32_t Length = readULEB(Offset);
+  StringRef Name(getData(Offset, Length), Length);
+  Offset += Length;
+  return Name;
+}
+
+/// \brief Check the header of a binary profile.
+///
+/// Nothing but the header is read here; the bucket table and the records
+/// are only touched by lookups.
+void SampleProfileReaderBinary::read() {
+  // The header is the magic number, the version, the number of functions
+  // and the number of buckets.
+  if (readWord(8) != sampleprof::SPVersion())
+    reportFormatError("unsupported version " + Twine(readWord(8)));
+  NumFunctions = readWord(12);
+  NumBuckets = readWord(16);
+  if (NumBuckets == 0 || !isPowerOf2_32(NumBuckets))
+    reportFormatError("bad bucket count " + Twine(NumBuckets));
+  uint64_t TableEnd = 20 + uint64_t(NumBuckets) * 4;
+  getData(20, TableEnd - 20);
+
+  // Every function has an 8-byte entry in a bucket past the bucket table, so
+  // a count the rest of the buffer cannot hold is corrupt.
+  if (uint64_t(NumFunctions) * 8 > Buffer->getBufferSize() - TableEnd)
+    reportFormatError("bad function count " + Twine(NumFunctions));
+}
+
+bool SampleProfileReaderBinary::getSamples(StringRef FName,
+                                           FunctionSamples &FS) {
+  uint32_t Hash = HashString(FName);
+  uint32_t Bucket = readWord(20 + uint64_t(Hash & (NumBuckets - 1)) * 4);
+  if (Bucket == 0)
+    return false;
+
+  uint32_t NumEntries = readWord(Bucket);
+  for (uint32_t I = 0; I != NumEntries; ++I) {
+    uint64_t Entry = uint64_t(Bucket) + 4 + uint64_t(I) * 8;
+    if (readWord(Entry) != Hash)
+      continue;
+    uint64_t Offset = readWord(Entry + 4);
+    if (readName(Offset) != FName)
+      continue;
+
+    // The record goes on with the total and head samples and the number of
+    // sampled lines, each line being an offset and a sample count.
+    FS = FunctionSamples();
+    FS.addTotalSamples(readULEB(Offset));
+    FS.addHeadSamples(readULEB(Offset));
+    uint32_t NumLines = readULEB(Offset);
+    for (uint32_t L = 0; L != NumLines; ++L) {
+      uint32_t LineOffset = readULEB(Offset);
+      FS.addBodySamples(LineOffset, readULEB(Offset));
+    }
+    return true;
+  }
+  return false;
+}
+
+void SampleProfileReaderBinary::getFunctionNames(
+    std::vector<StringRef> &Names) {
+  Names.reserve(Names.size() + NumFunctions);
+  for (uint32_t B = 0; B != NumBuckets; ++B) {
+    uint32_t Bucket = readWord(20 + uint64_t(B) * 4);
+    if (Bucket == 0)
+      continue;
+    uint32_t NumEntries = readWord(Bucket);
+    for (uint32_t I = 0; I != NumEntries; ++I) {
+      uint64_t Offset = readWord(uint64_t(Bucket) + 8 + uint64_t(I) * 8);
+      Names.push_back(readName(Offset));
+    }
+  }
+}
@@ -0,0 +1,195 @@
+//===- SampleProfWriter.cpp - Write LLVM sample profile data --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the class that writes LLVM sample profiles.  The text
+// format is described in SampleProfReader.cpp.
+//
+// A binary profile is an on-disk chained hash table keyed by function name.
+// The header and the index are made of 32-bit little-endian words, and all
+// offsets are from the start of the file:
+//
+//   header:  magic (64 bits), version, number of functions,
+//            number of buckets (a power of two)
+//   buckets: the offset of each bucket, or 0 if it is empty
+//   bucket:  number of entries, then for each entry the name hash and
+//            the offset of the function record
+//
+// The function records follow the index.  Their numbers are ULEB128
+// encoded to keep them compact:
+//
+//   record:  name length, name bytes, total samples, head samples,
+//            number of sampled lines, then for each line its offset and
+//            number of samples
+//
+// A function goes into the bucket selected by the low bits of the
+// HashString hash of its name.  The hash is part of the format, so it must
+// not follow changes to the hash functions used for in-memory tables.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+bool SampleProfileWriter::addFunctionSamples(StringRef FName,
+                                             const FunctionSamples &FS,
+                                             unsigned Weight) {
+  return Profiles[FName].merge(FS, Weight);
+}
+
+void SampleProfileWriter::write(raw_ostream &OS, ProfileFormat Format) const {
+  if (Format == Text)
+    writeText(OS);
+  else
+    writeBinary(OS);
+}
+
+typedef const StringMapEntry<FunctionSamples> *ProfileEntry;
+
+static bool compareProfileNames(ProfileEntry A, ProfileEntry B) {
+  return A->getKey() < B->getKey();
+}
+
+/// \brief Return the profiles of \p Profiles in name order.
+static void sortProfiles(const StringMap<FunctionSamples> &Profiles,
+                         std::vector<ProfileEntry> &Sorted) {
+  Sorted.reserve(Profiles.size());
+  for (StringMap<FunctionSamples>::const_iterator I = Profiles.begin(),
+                                                  E = Profiles.end();
+       I != E; ++I)
+    Sorted.push_back(&*I);
+  std::sort(Sorted.begin(), Sorted.end(), compareProfileNames);
+}
+
+/// \brief Return the sampled lines of \p FS in line order.
+static void sortLines(const FunctionSamples &FS,
+                      SmallVectorImpl<std::pair<uint32_t, uint32_t> > &Lines) {
+  const BodySampleMap &Body = FS.getBodySamples();
+  Lines.clear();
+  Lines.append(Body.begin(), Body.end());
+  std::sort(Lines.begin(), Lines.end());
+}
+
+void SampleProfileWriter::writeText(raw_ostream &OS) const {
+  std::vector<ProfileEntry> Sorted;
+  sortProfiles(Profiles, Sorted);
+  SmallVector<std::pair<uint32_t, uint32_t>, 32> Lines;
+  for (unsigned I = 0, E = Sorted.size(); I != E; ++I) {
+    const FunctionSamples &FS = Sorted[I]->getValue();
+    OS << Sorted[I]->getKey() << ":" << FS.getTotalSamples() << ":"
+       << FS.getHeadSamples() << "\n";
+    sortLines(FS, Lines);
+    for (unsigned L = 0, LE = Lines.size(); L != LE; ++L)
+      OS << Lines[L].first << ": " << Lines[L].second << "\n";
+  }
+}
+
+namespace {
+/// BinaryBuffer - Builds the binary profile in memory, as offsets in the
+/// header point forward into the file.
+class BinaryBuffer {
+  std::vector<char> Data;
+
+public:
+  uint32_t size() const { return Data.size(); }
+
+  void writeWord(uint32_t Word) {
+    char Bytes[4];
+    support::endian::write<uint32_t, support::little, support::unaligned>(
+        Bytes, Word);
+    Data.insert(Data.end(), Bytes, Bytes + 4);
+  }
+
+  void writeULEB(uint32_t Value) {
+    uint8_t Bytes[8];
+    unsigned Size = encodeULEB128(Value, Bytes);
+    Data.insert(Data.end(), Bytes, Bytes + Size);
+  }
+
+  void writeBytes(StringRef S) { Data.insert(Data.end(), S.begin(), S.end()); }
+
+  void patchWord(uint32_t Offset, uint32_t Word) {
+    support::endian::write<uint32_t, support::little, support::unaligned>(
+        &Data[Offset], Word);
+  }
+
+  StringRef str() const {
+    return Data.empty() ? StringRef() : StringRef(&Data[0], Data.size());
+  }
+};
+}
+
+void SampleProfileWriter::writeBinary(raw_ostream &OS) const {
+  std::vector<ProfileEntry> Sorted;
+  sortProfiles(Profiles, Sorted);
+
+  // Keep the load factor at most 3/4.
+  uint32_t NumFunctions = Sorted.size();
+  uint32_t NumBuckets = NextPowerOf2(NumFunctions + NumFunctions / 3);
+
+  std::vector<std::vector<std::pair<uint32_t, uint32_t> > > Buckets(
+      NumBuckets);
+  for (uint32_t I = 0; I != NumFunctions; ++I) {
+    uint32_t Hash = HashString(Sorted[I]->getKey());
+    Buckets[Hash & (NumBuckets - 1)].push_back(std::make_pair(Hash, I));
+  }
+
+  BinaryBuffer B;
+  uint64_t Magic = sampleprof::SPMagic();
+  B.writeWord(uint32_t(Magic));
+  B.writeWord(uint32_t(Magic >> 32));
+  B.writeWord(sampleprof::SPVersion());
+  B.writeWord(NumFunctions);
+  B.writeWord(NumBuckets);
+
+  // The bucket offsets and the record offsets in the entries are filled in
+  // once the records are laid out.
+  uint32_t BucketTable = B.size();
+  for (uint32_t I = 0; I != NumBuckets; ++I)
+    B.writeWord(0);
+  std::vector<uint32_t> EntryOffsets(NumFunctions);
+  for (uint32_t I = 0; I != NumBuckets; ++I) {
+    if (Buckets[I].empty())
+      continue;
+    B.patchWord(BucketTable + I * 4, B.size());
+    B.writeWord(Buckets[I].size());
+    for (unsigned J = 0, JE = Buckets[I].size(); J != JE; ++J) {
+      B.writeWord(Buckets[I][J].first);
+      EntryOffsets[Buckets[I][J].second] = B.size();
+      B.writeWord(0);
+    }
+  }
+
+  SmallVector<std::pair<uint32_t, uint32_t>, 32> Lines;
+  for (uint32_t I = 0; I != NumFunctions; ++I) {
+    B.patchWord(EntryOffsets[I], B.size());
+    StringRef Name = Sorted[I]->getKey();
+    const FunctionSamples &FS = Sorted[I]->getValue();
+    B.writeULEB(Name.size());
+    B.writeBytes(Name);
+    B.writeULEB(FS.getTotalSamples());
+    B.writeULEB(FS.getHeadSamples());
+    sortLines(FS, Lines);
+    B.writeULEB(Lines.size());
+    for (unsigned L = 0, LE = Lines.size(); L != LE; ++L) {
+      B.writeULEB(Lines[L].first);
+      B.writeULEB(Lines[L].second);
+    }
+  }
+
+  OS << B.str();
+}
@@ -12,7 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Compiler.h"
 #include <cassert>
 using namespace llvm;
@@ -50,18 +50,40 @@ void StringMapImpl::init(unsigned InitSize) {
 }
 
 
+/// hash - Return the hash value the table uses for \p Key.  The bucket array
+/// keeps it next to each entry, so it is computed once per key and operation.
+/// Iteration order follows from it and ends up in object files (the DWARF
+/// name tables, for one), so this is the hash_value algorithm with a fixed
+/// seed rather than hash_value itself, whose seed may vary between executions.
+unsigned StringMapImpl::hash(StringRef Key) {
+  using namespace hashing::detail;
+  const uint64_t Seed = 0xff51afd7ed558ccdULL;
+  const char *S = Key.data();
+  size_t Length = Key.size();
+  if (Length <= 64)
+    return static_cast<unsigned>(hash_short(S, Length, Seed));
+
+  const char *AlignedEnd = S + (Length & ~63);
+  hash_state State = hash_state::create(S, Seed);
+  for (S += 64; S != AlignedEnd; S += 64)
+    State.mix(S);
+  if (Length & 63)
+    State.mix(Key.end() - 64);
+  return static_cast<unsigned>(State.finalize(Length));
+}
+
 /// LookupBucketFor - Look up the bucket that the specified string should end
 /// up in.  If it already exists as a key in the map, the Item pointer for the
 /// specified bucket will be non-null.  Otherwise, it will be null.  In either
 /// case, the FullHashValue field of the bucket will be set to the hash value
-/// of the string.
-unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
+/// of the string, which is FullHashValue.
+unsigned StringMapImpl::LookupBucketFor(StringRef Name,
+                                        unsigned FullHashValue) {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) {  // Hash table unallocated so far?
     init(16);
     HTSize = NumBuckets;
   }
-  unsigned FullHashValue = HashString(Name);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
@@ -113,10 +135,9 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 /// FindKey - Look up the bucket that contains the specified key. If it exists
 /// in the map, return the bucket number of the key.  Otherwise return -1.
 /// This does not modify the map.
-int StringMapImpl::FindKey(StringRef Key) const {
+int StringMapImpl::FindKey(StringRef Key, unsigned FullHashValue) const {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
@@ -0,0 +1,105 @@
+//===-- llvm/Support/ThreadPool.cpp - A simple thread pool ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+
+using namespace llvm;
+
+#if LLVM_ENABLE_THREADS
+
+unsigned ThreadPool::getDefaultThreadCount() {
+  unsigned N = std::thread::hardware_concurrency();
+  return N ? N : 1;
+}
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadCount(ThreadCount ? ThreadCount : getDefaultThreadCount()),
+      ActiveTasks(0), Stopping(false) {
+  // ManagedStatics and the pass registry only lock once LLVM knows it is
+  // running multithreaded.
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+
+  Workers.reserve(this->ThreadCount);
+  for (unsigned I = 0; I != this->ThreadCount; ++I)
+    Workers.push_back(std::thread(&ThreadPool::runWorker, this));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> Lock(QueueLock);
+    Stopping = true;
+  }
+  QueueCondition.notify_all();
+  for (unsigned I = 0, E = Workers.size(); I != E; ++I)
+    Workers[I].join();
+}
+
+void ThreadPool::runWorker() {
+  while (true) {
+    TaskTy Task;
+    {
+      std::unique_lock<std::mutex> Lock(QueueLock);
+      while (!Stopping && Tasks.empty())
+        QueueCondition.wait(Lock);
+      // Drain the queue before honoring a stop request.
+      if (Tasks.empty())
+        return;
+      Task = Tasks.front();
+      Tasks.pop_front();
+      ++ActiveTasks;
+    }
+
+    Task();
+
+    {
+      std::unique_lock<std::mutex> Lock(QueueLock);
+      --ActiveTasks;
+      if (ActiveTasks == 0 && Tasks.empty())
+        CompletionCondition.notify_all();
+    }
+  }
+}
+
+void ThreadPool::async(TaskTy Task) {
+  {
+    std::unique_lock<std::mutex> Lock(QueueLock);
+    Tasks.push_back(Task);
+  }
+  QueueCondition.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> Lock(QueueLock);
+  while (ActiveTasks != 0 || !Tasks.empty())
+    CompletionCondition.wait(Lock);
+}
+
+#else // LLVM_ENABLE_THREADS
+
+unsigned ThreadPool::getDefaultThreadCount() {
+  return 1;
+}
+
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1) {}
+
+ThreadPool::~ThreadPool() {}
+
+void ThreadPool::async(TaskTy Task) {
+  Task();
+}
+
+void ThreadPool::wait() {}
+
+#endif // LLVM_ENABLE_THREADS
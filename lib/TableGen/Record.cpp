@@ -600,7 +600,7 @@ IntInit::convertInitializerBitRange(const std::vector<unsigned> &Bits) const {
 void StringInit::anchor() { }
 
 StringInit *StringInit::get(StringRef V) {
-  static Pool<StringMap<StringInit *> > ThePool;
+  static Pool<StringMap<StringInit *, BumpPtrAllocator> > ThePool;
 
   StringInit *&I = ThePool[V];
   if (!I) I = new StringInit(V);
@@ -9,13 +9,16 @@
 //
 // This pass looks for equivalent functions that are mergable and folds them.
 //
-// A hash is computed from the function, based on its type and number of
-// basic blocks.
+// A structural hash is computed from the function, based on its type and on
+// the instructions it executes: the opcode, type and operand kinds of each
+// instruction, walked in the same CFG order the equality comparison uses.
+// Functions are kept in a tree ordered by that hash.
 //
-// Once all hashes are computed, we perform an expensive equality comparison
-// on each function pair. This takes n^2/2 comparisons per bucket, so it's
-// important that the hash function be high quality. The equality comparison
-// iterates through each instruction in each basic block.
+// A new function is only compared against the functions with the same hash.
+// This is an expensive equality comparison on each function pair, taking
+// n^2/2 comparisons per bucket, so it's important that the hash function be
+// high quality. The equality comparison iterates through each instruction in
+// each basic block.
 //
 // When a match is found the functions are folded. If both functions are
 // overridable, we move the functionality into a new internal function and
@@ -45,9 +48,11 @@
 
 #define DEBUG_TYPE "mergefunc"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
-#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Constants.h"
@@ -64,6 +69,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Support/raw_ostream.h"
+#include <map>
 #include <vector>
 using namespace llvm;
 
@@ -81,79 +87,59 @@ static Type::TypeID getTypeIDForHash(Type *Ty) {
   return Ty->getTypeID();
 }
 
+/// Adds the parts of \p I that FunctionComparator requires to be equal to
+/// the running hash \p H.
+static hash_code profileInstruction(hash_code H, const Instruction *I) {
+  // Equivalent GEPs may differ in everything but the offset they compute, so
+  // only their opcode goes into the hash.
+  if (isa<GetElementPtrInst>(I))
+    return hash_combine(H, I->getOpcode());
+
+  H = hash_combine(H, I->getOpcode(), getTypeIDForHash(I->getType()),
+                   I->getNumOperands(), I->getRawSubclassOptionalData());
+  for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
+    const Value *Op = I->getOperand(i);
+    // Constants of different kinds compare equal when they have the same bit
+    // pattern, such as a null pointer and a zero integer or a global and a
+    // bitcast of it, so all constants share one marker.
+    unsigned Kind = isa<Constant>(Op) ? unsigned(Value::ConstantFirstVal)
+                                      : Op->getValueID();
+    H = hash_combine(H, Kind, getTypeIDForHash(Op->getType()));
+  }
+  if (const CmpInst *CI = dyn_cast<CmpInst>(I))
+    H = hash_combine(H, CI->getPredicate());
+  return H;
+}
+
 /// Creates a hash-code for the function which is the same for any two
-/// functions that will compare equal, without looking at the instructions
-/// inside the function.
-static unsigned profileFunction(const Function *F) {
+/// functions that will compare equal. The blocks are visited in the order
+/// FunctionComparator::compare walks them, so that unreachable blocks are
+/// left out of the hash just as they are left out of the comparison.
+static uint64_t profileFunction(const Function *F) {
   FunctionType *FTy = F->getFunctionType();
 
-  FoldingSetNodeID ID;
-  ID.AddInteger(F->size());
-  ID.AddInteger(F->getCallingConv());
-  ID.AddBoolean(F->hasGC());
-  ID.AddBoolean(FTy->isVarArg());
-  ID.AddInteger(getTypeIDForHash(FTy->getReturnType()));
+  hash_code H = hash_combine(F->getCallingConv(), F->hasGC(), FTy->isVarArg(),
+                             getTypeIDForHash(FTy->getReturnType()));
   for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
-    ID.AddInteger(getTypeIDForHash(FTy->getParamType(i)));
-  return ID.ComputeHash();
-}
-
-namespace {
-
-/// ComparableFunction - A struct that pairs together functions with a
-/// DataLayout so that we can keep them together as elements in the DenseSet.
-class ComparableFunction {
-public:
-  static const ComparableFunction EmptyKey;
-  static const ComparableFunction TombstoneKey;
-  static DataLayout * const LookupOnly;
-
-  ComparableFunction(Function *Func, const DataLayout *DL)
-    : Func(Func), Hash(profileFunction(Func)), DL(DL) {}
-
-  Function *getFunc() const { return Func; }
-  unsigned getHash() const { return Hash; }
-  const DataLayout *getDataLayout() const { return DL; }
-
-  // Drops AssertingVH reference to the function. Outside of debug mode, this
-  // does nothing.
-  void release() {
-    assert(Func &&
-           "Attempted to release function twice, or release empty/tombstone!");
-    Func = NULL;
+    H = hash_combine(H, getTypeIDForHash(FTy->getParamType(i)));
+
+  SmallVector<const BasicBlock *, 8> BBs;
+  SmallPtrSet<const BasicBlock *, 16> VisitedBBs;
+  BBs.push_back(&F->getEntryBlock());
+  VisitedBBs.insert(BBs[0]);
+  while (!BBs.empty()) {
+    const BasicBlock *BB = BBs.pop_back_val();
+    H = hash_combine(H, BB->size());
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I)
+      H = profileInstruction(H, I);
+
+    const TerminatorInst *TI = BB->getTerminator();
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+      if (VisitedBBs.insert(TI->getSuccessor(i)))
+        BBs.push_back(TI->getSuccessor(i));
   }
-
-private:
-  explicit ComparableFunction(unsigned Hash)
-    : Func(NULL), Hash(Hash), DL(NULL) {}
-
-  AssertingVH<Function> Func;
-  unsigned Hash;
-  const DataLayout *DL;
-};
-
-const ComparableFunction ComparableFunction::EmptyKey = ComparableFunction(0);
-const ComparableFunction ComparableFunction::TombstoneKey =
-    ComparableFunction(1);
-DataLayout *const ComparableFunction::LookupOnly = (DataLayout*)(-1);
-
-}
-
-namespace llvm {
-  template <>
-  struct DenseMapInfo<ComparableFunction> {
-    static ComparableFunction getEmptyKey() {
-      return ComparableFunction::EmptyKey;
-    }
-    static ComparableFunction getTombstoneKey() {
-      return ComparableFunction::TombstoneKey;
-    }
-    static unsigned getHashValue(const ComparableFunction &CF) {
-      return CF.getHash();
-    }
-    static bool isEqual(const ComparableFunction &LHS,
-                        const ComparableFunction &RHS);
-  };
+  return H;
 }
 
 namespace {
@@ -564,21 +550,23 @@ public:
   bool runOnModule(Module &M);
 
 private:
-  typedef DenseSet<ComparableFunction> FnSetType;
+  /// The distinct functions, ordered by their structural hash. Functions
+  /// with equal hashes are kept next to each other.
+  typedef std::multimap<uint64_t, AssertingVH<Function> > FnTreeType;
 
   /// A work queue of functions that may have been modified and should be
   /// analyzed again.
   std::vector<WeakVH> Deferred;
 
-  /// Insert a ComparableFunction into the FnSet, or merge it away if it's
-  /// equal to one that's already present.
-  bool insert(ComparableFunction &NewF);
+  /// Insert a Function into the FnTree, or merge it away if it's equal to one
+  /// that's already present.
+  bool insert(Function *NewF);
 
-  /// Remove a Function from the FnSet and queue it up for a second sweep of
+  /// Remove a Function from the FnTree and queue it up for a second sweep of
   /// analysis.
   void remove(Function *F);
 
-  /// Find the functions that use this Value and remove them from FnSet and
+  /// Find the functions that use this Value and remove them from FnTree and
   /// queue the functions.
   void removeUsers(Value *V);
 
@@ -603,7 +591,11 @@ private:
 
   /// The set of all distinct functions. Use the insert() and remove() methods
   /// to modify it.
-  FnSetType FnSet;
+  FnTreeType FnTree;
+
+  /// The position of each function in FnTree, so that remove() need not
+  /// recompute the hash of a function that is being changed.
+  DenseMap<Function *, FnTreeType::iterator> FnTreeIndex;
 
   /// DataLayout for more accurate GEP comparisons. May be NULL.
   const DataLayout *DL;
@@ -630,7 +622,6 @@ bool MergeFunctions::runOnModule(Module &M) {
     if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage())
       Deferred.push_back(WeakVH(I));
   }
-  FnSet.resize(Deferred.size());
 
   do {
     std::vector<WeakVH> Worklist;
@@ -647,8 +638,7 @@ bool MergeFunctions::runOnModule(Module &M) {
       Function *F = cast<Function>(*I);
       if (!F->isDeclaration() && !F->hasAvailableExternallyLinkage() &&
           !F->mayBeOverridden()) {
-        ComparableFunction CF = ComparableFunction(F, DL);
-        Changed |= insert(CF);
+        Changed |= insert(F);
       }
     }
 
@@ -662,38 +652,18 @@ bool MergeFunctions::runOnModule(Module &M) {
       Function *F = cast<Function>(*I);
       if (!F->isDeclaration() && !F->hasAvailableExternallyLinkage() &&
           F->mayBeOverridden()) {
-        ComparableFunction CF = ComparableFunction(F, DL);
-        Changed |= insert(CF);
+        Changed |= insert(F);
       }
     }
-    DEBUG(dbgs() << "size of FnSet: " << FnSet.size() << '\n');
+    DEBUG(dbgs() << "size of FnTree: " << FnTree.size() << '\n');
   } while (!Deferred.empty());
 
-  FnSet.clear();
+  FnTree.clear();
+  FnTreeIndex.clear();
 
   return Changed;
 }
 
-bool DenseMapInfo<ComparableFunction>::isEqual(const ComparableFunction &LHS,
-                                               const ComparableFunction &RHS) {
-  if (LHS.getFunc() == RHS.getFunc() &&
-      LHS.getHash() == RHS.getHash())
-    return true;
-  if (!LHS.getFunc() || !RHS.getFunc())
-    return false;
-
-  // One of these is a special "underlying pointer comparison only" object.
-  if (LHS.getDataLayout() == ComparableFunction::LookupOnly ||
-      RHS.getDataLayout() == ComparableFunction::LookupOnly)
-    return false;
-
-  assert(LHS.getDataLayout() == RHS.getDataLayout() &&
-         "Comparing functions for different targets");
-
-  return FunctionComparator(LHS.getDataLayout(), LHS.getFunc(),
-                            RHS.getFunc()).compare();
-}
-
 // Replace direct callers of Old with New.
 void MergeFunctions::replaceDirectCallers(Function *Old, Function *New) {
   Constant *BitcastNew = ConstantExpr::getBitCast(New, Old->getType());
@@ -834,54 +804,64 @@ void MergeFunctions::mergeTwoFunctions(Function *F, Function *G) {
   ++NumFunctionsMerged;
 }
 
-// Insert a ComparableFunction into the FnSet, or merge it away if equal to one
-// that was already inserted.
-bool MergeFunctions::insert(ComparableFunction &NewF) {
-  std::pair<FnSetType::iterator, bool> Result = FnSet.insert(NewF);
-  if (Result.second) {
-    DEBUG(dbgs() << "Inserting as unique: " << NewF.getFunc()->getName() << '\n');
+// Insert a Function into the FnTree, or merge it away if equal to one that
+// was already inserted. Only the functions with the same hash are compared.
+bool MergeFunctions::insert(Function *NewF) {
+  uint64_t Hash = profileFunction(NewF);
+  std::pair<FnTreeType::iterator, FnTreeType::iterator> Range =
+      FnTree.equal_range(Hash);
+
+  FnTreeType::iterator Found = Range.second;
+  for (FnTreeType::iterator I = Range.first; I != Range.second; ++I) {
+    if (FunctionComparator(DL, NewF, I->second).compare()) {
+      Found = I;
+      break;
+    }
+  }
+
+  if (Found == Range.second) {
+    FnTreeIndex[NewF] =
+        FnTree.insert(Range.second, std::make_pair(Hash, NewF));
+    DEBUG(dbgs() << "Inserting as unique: " << NewF->getName() << '\n');
     return false;
   }
 
-  const ComparableFunction &OldF = *Result.first;
+  Function *OldF = Found->second;
 
   // Don't merge tiny functions, since it can just end up making the function
   // larger.
   // FIXME: Should still merge them if they are unnamed_addr and produce an
   // alias.
-  if (NewF.getFunc()->size() == 1) {
-    if (NewF.getFunc()->front().size() <= 2) {
-      DEBUG(dbgs() << NewF.getFunc()->getName()
-            << " is to small to bother merging\n");
+  if (NewF->size() == 1) {
+    if (NewF->front().size() <= 2) {
+      DEBUG(dbgs() << NewF->getName() << " is to small to bother merging\n");
       return false;
     }
   }
 
   // Never thunk a strong function to a weak function.
-  assert(!OldF.getFunc()->mayBeOverridden() ||
-         NewF.getFunc()->mayBeOverridden());
+  assert(!OldF->mayBeOverridden() || NewF->mayBeOverridden());
 
-  DEBUG(dbgs() << "  " << OldF.getFunc()->getName() << " == "
-               << NewF.getFunc()->getName() << '\n');
+  DEBUG(dbgs() << "  " << OldF->getName() << " == " << NewF->getName()
+               << '\n');
 
-  Function *DeleteF = NewF.getFunc();
-  NewF.release();
-  mergeTwoFunctions(OldF.getFunc(), DeleteF);
+  mergeTwoFunctions(OldF, NewF);
   return true;
 }
 
-// Remove a function from FnSet. If it was already in FnSet, add it to Deferred
-// so that we'll look at it in the next round.
+// Remove a function from FnTree. If it was already in FnTree, add it to
+// Deferred so that we'll look at it in the next round.
 void MergeFunctions::remove(Function *F) {
-  // We need to make sure we remove F, not a function "equal" to F per the
+  // Look F up by pointer rather than by hash: the caller is about to change
+  // F, and we must remove F itself, not a function "equal" to F per the
   // function equality comparator.
-  //
-  // The special "lookup only" ComparableFunction bypasses the expensive
-  // function comparison in favour of a pointer comparison on the underlying
-  // Function*'s.
-  ComparableFunction CF = ComparableFunction(F, ComparableFunction::LookupOnly);
-  if (FnSet.erase(CF)) {
-    DEBUG(dbgs() << "Removed " << F->getName() << " from set and deferred it.\n");
+  DenseMap<Function *, FnTreeType::iterator>::iterator I =
+      FnTreeIndex.find(F);
+  if (I != FnTreeIndex.end()) {
+    FnTree.erase(I->second);
+    FnTreeIndex.erase(I);
+    DEBUG(dbgs() << "Removed " << F->getName()
+                 << " from set and deferred it.\n");
     Deferred.push_back(F);
   }
 }
@@ -101,6 +101,8 @@ public:
     initializeInstCombinerPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *clone() const { return new InstCombiner(); }
+
 public:
   virtual bool runOnFunction(Function &F);
 
@@ -37,6 +37,8 @@ namespace {
       initializeADCEPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new ADCE(); }
+
     virtual bool runOnFunction(Function& F);
 
     virtual void getAnalysisUsage(AnalysisUsage& AU) const {
@@ -269,8 +269,9 @@ static void CollectBasicBlocks(SmallPtrSet<BasicBlock *, 4> &BBs, Function &F,
                                User *U) {
   if (Instruction *I = dyn_cast<Instruction>(U))
     BBs.insert(I->getParent());
-  else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(U))
+  else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(U)) {
     // Find all users of this constant expression.
+    SharedUseListGuard UseListGuard(CE);
     for (Value::use_iterator UU = CE->use_begin(), E = CE->use_end();
          UU != E; ++UU)
       // Only record users that are instructions. We don't want to go down a
@@ -279,6 +280,7 @@ static void CollectBasicBlocks(SmallPtrSet<BasicBlock *, 4> &BBs, Function &F,
       if (Instruction *I = dyn_cast<Instruction>(*UU))
         if(I->getParent()->getParent() == &F)
           BBs.insert(I->getParent());
+  }
 }
 
 /// \brief Find the instruction we should insert the constant materialization
@@ -355,6 +357,7 @@ void ConstantHoisting::EmitBaseConstants(Function &F, User *U,
   ConstantExpr *CE = cast<ConstantExpr>(U);
   SmallVector<std::pair<Instruction *, Instruction *>, 8> WorkList;
   DEBUG(dbgs() << "Visit ConstantExpr " << *CE << '\n');
+  SharedUseListGuard UseListGuard(CE);
   for (Value::use_iterator UU = CE->use_begin(), E = CE->use_end();
        UU != E; ++UU) {
     DEBUG(dbgs() << "Check user "; UU->print(dbgs()); dbgs() << '\n');
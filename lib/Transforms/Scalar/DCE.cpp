@@ -79,6 +79,8 @@ namespace {
       initializeDCEPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new DCE(); }
+
     virtual bool runOnFunction(Function &F);
 
      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -53,6 +53,8 @@ namespace {
       initializeDSEPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new DSE(); }
+
     virtual bool runOnFunction(Function &F) {
       if (skipOptnoneFunction(F))
         return false;
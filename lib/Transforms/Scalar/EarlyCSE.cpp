@@ -303,6 +303,8 @@ public:
     initializeEarlyCSEPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *clone() const { return new EarlyCSE(); }
+
   bool runOnFunction(Function &F);
 
 private:
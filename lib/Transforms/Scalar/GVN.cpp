@@ -615,6 +615,8 @@ namespace {
       initializeGVNPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new GVN(NoLoads); }
+
     bool runOnFunction(Function &F);
 
     /// markInstructionForDeletion - This removes the specified instruction from
@@ -77,6 +77,8 @@ namespace {
       initializeLICMPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new LICM(); }
+
     virtual bool runOnLoop(Loop *L, LPPassManager &LPM);
 
     /// This transformation requires natural loop information & requires that
@@ -788,6 +790,8 @@ void LICM::PromoteAliasSet(AliasSet &AS,
     if (SomePtr->getType() != ASIV->getType())
       return;
 
+    // ASIV may be a global used by functions other threads are working on.
+    SharedUseListGuard UseListGuard(ASIV);
     for (Value::use_iterator UI = ASIV->use_begin(), UE = ASIV->use_end();
          UI != UE; ++UI) {
       // Ignore instructions that are outside the loop.
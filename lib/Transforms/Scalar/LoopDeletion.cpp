@@ -33,6 +33,8 @@ namespace {
       initializeLoopDeletionPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new LoopDeletion(); }
+
     // Possibly eliminate loop L if it is dead.
     bool runOnLoop(Loop *L, LPPassManager &LPM);
 
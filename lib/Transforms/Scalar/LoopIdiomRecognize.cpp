@@ -144,6 +144,8 @@ namespace {
       DL = 0; DT = 0; SE = 0; TLI = 0; TTI = 0;
     }
 
+    virtual Pass *clone() const { return new LoopIdiomRecognize(); }
+
     bool runOnLoop(Loop *L, LPPassManager &LPM);
     bool runOnLoopBlock(BasicBlock *BB, const SCEV *BECount,
                         SmallVectorImpl<BasicBlock*> &ExitBlocks);
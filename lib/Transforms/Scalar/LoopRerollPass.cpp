@@ -125,6 +125,8 @@ namespace {
       initializeLoopRerollPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new LoopReroll(); }
+
     bool runOnLoop(Loop *L, LPPassManager &LPM);
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -43,6 +43,8 @@ namespace {
       initializeLoopRotatePass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new LoopRotate(); }
+
     // LCSSA form makes instruction renaming easier.
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addPreserved<DominatorTreeWrapperPass>();
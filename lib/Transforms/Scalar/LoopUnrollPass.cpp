@@ -65,6 +65,21 @@ namespace {
       initializeLoopUnrollPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const {
+      // The constructor resolves its arguments against the command line, so
+      // copy the resolved settings instead of passing the arguments on.
+      LoopUnroll *Copy = new LoopUnroll();
+      Copy->CurrentCount = CurrentCount;
+      Copy->CurrentThreshold = CurrentThreshold;
+      Copy->CurrentAllowPartial = CurrentAllowPartial;
+      Copy->CurrentRuntime = CurrentRuntime;
+      Copy->UserCount = UserCount;
+      Copy->UserThreshold = UserThreshold;
+      Copy->UserAllowPartial = UserAllowPartial;
+      Copy->UserRuntime = UserRuntime;
+      return Copy;
+    }
+
     /// A magic value for use with the Threshold parameter to indicate
     /// that the loop unroll should be performed regardless of how much
     /// code expansion would result.
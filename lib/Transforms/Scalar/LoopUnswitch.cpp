@@ -156,6 +156,8 @@ namespace {
         initializeLoopUnswitchPass(*PassRegistry::getPassRegistry());
       }
 
+    virtual Pass *clone() const { return new LoopUnswitch(OptimizeForSize); }
+
     bool runOnLoop(Loop *L, LPPassManager &LPM);
     bool processCurrentLoop();
 
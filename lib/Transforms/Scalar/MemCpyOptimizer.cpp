@@ -315,6 +315,8 @@ namespace {
       DL = 0;
     }
 
+    virtual Pass *clone() const { return new MemCpyOpt(); }
+
     bool runOnFunction(Function &F);
 
   private:
@@ -167,6 +167,8 @@ namespace {
       initializeReassociatePass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new Reassociate(); }
+
     bool runOnFunction(Function &F);
 
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -975,6 +975,9 @@ public:
         C(0), DL(0), DT(0) {
     initializeSROAPass(*PassRegistry::getPassRegistry());
   }
+
+  virtual Pass *clone() const { return new SROA(RequiresDomTree); }
+
   bool runOnFunction(Function &F);
   void getAnalysisUsage(AnalysisUsage &AU) const;
 
@@ -128,6 +128,7 @@ namespace {
           hasSubelementAccess(false), hasALoadOrStore(false) {}
     };
 
+  protected:
     /// SRThreshold - The maximum alloca size to considered for SROA.
     unsigned SRThreshold;
 
@@ -143,6 +144,7 @@ namespace {
     /// converting to scalar
     unsigned ScalarLoadThreshold;
 
+  private:
     void MarkUnsafe(AllocaInfo &I, Instruction *User) {
       I.isUnsafe = true;
       DEBUG(dbgs() << "  Transformation preventing inst: " << *User << '\n');
@@ -193,6 +195,11 @@ namespace {
       initializeSROA_DTPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const {
+      return new SROA_DT(SRThreshold, StructMemberThreshold,
+                         ArrayElementThreshold, ScalarLoadThreshold);
+    }
+
     // getAnalysisUsage - This pass does not require any passes, but we know it
     // will not alter the CFG, so say so.
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -210,6 +217,11 @@ namespace {
       initializeSROA_SSAUpPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const {
+      return new SROA_SSAUp(SRThreshold, StructMemberThreshold,
+                            ArrayElementThreshold, ScalarLoadThreshold);
+    }
+
     // getAnalysisUsage - This pass does not require any passes, but we know it
     // will not alter the CFG, so say so.
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
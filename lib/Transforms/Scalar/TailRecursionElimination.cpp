@@ -89,6 +89,8 @@ namespace {
       initializeTailCallElimPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new TailCallElim(); }
+
     virtual void getAnalysisUsage(AnalysisUsage &AU) const;
 
     virtual bool runOnFunction(Function &F);
@@ -247,6 +247,8 @@ struct LCSSA : public FunctionPass {
     initializeLCSSAPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *clone() const { return new LCSSA(); }
+
   // Cached analysis information for the current function.
   DominatorTree *DT;
   LoopInfo *LI;
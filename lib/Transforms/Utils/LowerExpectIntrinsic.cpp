@@ -52,6 +52,8 @@ namespace {
       initializeLowerExpectIntrinsicPass(*PassRegistry::getPassRegistry());
     }
 
+    virtual Pass *clone() const { return new LowerExpectIntrinsic(); }
+
     bool runOnFunction(Function &F);
   };
 }
@@ -1008,6 +1008,10 @@ struct LoopVectorize : public FunctionPass {
     initializeLoopVectorizePass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *clone() const {
+    return new LoopVectorize(DisableUnrolling, AlwaysVectorize);
+  }
+
   ScalarEvolution *SE;
   const DataLayout *DL;
   LoopInfo *LI;
@@ -3528,6 +3532,7 @@ static Value *stripGetElementPtr(Value *Ptr, ScalarEvolution *SE,
 ///\brief Look for a cast use of the passed value.
 static Value *getUniqueCastUse(Value *Ptr, Loop *Lp, Type *Ty) {
   Value *UniqueCast = 0;
+  SharedUseListGuard UseListGuard(Ptr);
   for (Value::use_iterator UI = Ptr->use_begin(), UE = Ptr->use_end(); UI != UE;
        ++UI) {
     CastInst *CI = dyn_cast<CastInst>(*UI);
@@ -1783,6 +1783,8 @@ struct SLPVectorizer : public FunctionPass {
     initializeSLPVectorizerPass(*PassRegistry::getPassRegistry());
   }
 
+  virtual Pass *clone() const { return new SLPVectorizer(); }
+
   ScalarEvolution *SE;
   const DataLayout *DL;
   TargetTransformInfo *TTI;
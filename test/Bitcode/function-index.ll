@@ -0,0 +1,48 @@
+; Test that the writer emits a function index and that the reader can use it
+; to materialize individual function bodies.
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+; RUN: llvm-as < %s | llvm-extract -func=caller -S | FileCheck %s -check-prefix=EXTRACT
+; RUN: sed -e 's/^;TRIPLE://' %s | llvm-as | llvm-extract -func=callee -S \
+; RUN:   | FileCheck %s -check-prefix=DARWIN
+
+;TRIPLE:target triple = "x86_64-apple-macosx10.9.0"
+; DARWIN: target triple = "x86_64-apple-macosx10.9.0"
+
+; BC: <FNINDEXOFFSET
+; BC: <FUNCTION_INDEX_BLOCK
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: <ENTRY
+; BC-NEXT: </FUNCTION_INDEX_BLOCK>
+; BC-NEXT: </MODULE_BLOCK>
+
+@g = global i32 0
+
+; CHECK: define i32 @callee(i32 %x)
+; CHECK-NEXT: %y = add i32 %x, 1
+; DARWIN: define i32 @callee(i32 %x)
+; DARWIN-NEXT: %y = add i32 %x, 1
+define i32 @callee(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+declare void @ext()
+
+; CHECK: define void @other()
+; CHECK-NEXT: call void @ext()
+define void @other() {
+  call void @ext()
+  ret void
+}
+
+; CHECK: define i32 @caller()
+; CHECK-NEXT: %v = call i32 @callee(i32 3)
+; EXTRACT: declare i32 @callee(i32)
+; EXTRACT: define i32 @caller()
+; EXTRACT-NEXT: %v = call i32 @callee(i32 3)
+define i32 @caller() {
+  %v = call i32 @callee(i32 3)
+  ret i32 %v
+}
@@ -0,0 +1,52 @@
+; Check that encoding function bodies on several threads produces the same
+; bitcode as the serial writer.
+; RUN: llvm-as < %s -o %t.serial.bc
+; RUN: llvm-as -bitcode-writer-threads=4 < %s -o %t.parallel.bc
+; RUN: cmp %t.serial.bc %t.parallel.bc
+; RUN: llvm-dis < %t.parallel.bc | FileCheck %s
+
+@table = constant [2 x i8*] [i8* blockaddress(@jumps, %one), i8* blockaddress(@jumps, %two)]
+@str = private constant [6 x i8] c"hello\00"
+
+; CHECK: define i32 @jumps(i32 %i)
+define i32 @jumps(i32 %i) {
+entry:
+  %p = getelementptr [2 x i8*]* @table, i32 0, i32 %i
+  %dest = load i8** %p
+  indirectbr i8* %dest, [label %one, label %two]
+one:
+  ret i32 1
+two:
+  ret i32 2
+}
+
+; CHECK: define float @fp(float %x)
+; CHECK: fadd fast float %x, 1.000000e+00, !fpmath !0
+define float @fp(float %x) {
+  %y = fadd fast float %x, 1.0, !fpmath !0
+  ret float %y
+}
+
+; CHECK: define i8* @hello()
+define i8* @hello() {
+  call void @llvm.dbg.value(metadata !{i32 0}, i64 0, metadata !1)
+  ret i8* getelementptr ([6 x i8]* @str, i32 0, i32 0)
+}
+
+; CHECK: define i32 @loop(i32 %n)
+define i32 @loop(i32 %n) {
+entry:
+  br label %body
+body:
+  %i = phi i32 [ 0, %entry ], [ %next, %body ]
+  %next = add nsw i32 %i, 1
+  %done = icmp eq i32 %next, %n
+  br i1 %done, label %exit, label %body
+exit:
+  ret i32 %next
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata)
+
+!0 = metadata !{float 2.500000e+00}
+!1 = metadata !{i32 42}
@@ -0,0 +1,49 @@
+; Test that the writer puts a symbol summary in front of the module, and that
+; readers of symbol tables see the same symbols with and without it.
+; RUN: llvm-as -bitcode-symbol-summary < %s | llvm-bcanalyzer -dump \
+; RUN:   | FileCheck %s -check-prefix=BC
+; RUN: llvm-as -bitcode-symbol-summary < %s | llvm-dis | FileCheck %s
+; RUN: llvm-as < %s -o %t0
+; RUN: llvm-as -bitcode-symbol-summary < %s -o %t1
+; RUN: llvm-nm %t0 > %t0.nm
+; RUN: llvm-nm %t1 > %t1.nm
+; RUN: diff %t0.nm %t1.nm
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; BC: <SYMBOL_SUMMARY_BLOCK
+; BC-NEXT: <TRIPLE
+; BC-NEXT: <DATALAYOUT
+; BC-NEXT: <FLAGS op0=0/>
+; The records are [kind, linkage, visibility, flags, alignment, size, ...].
+; BC-NEXT: <SYMBOL op0=0 op1=0 op2=0 op3=0 op4=0 op5=2
+; BC-NEXT: <SYMBOL op0=0 op1=0 op2=0 op3=1 op4=0 op5=0
+; BC-NEXT: <SYMBOL op0=0 op1=11 op2=1 op3=2 op4=0 op5=1
+; BC-NEXT: <SYMBOL op0=1 op1=0 op2=0 op3=0 op4=3 op5=4
+; BC-NEXT: <SYMBOL op0=1 op1=8 op2=0 op3=0 op4=0 op5=8
+; BC-NEXT: <SYMBOL op0=1 op1=0 op2=0 op3=1 op4=0 op5=0
+; BC-NEXT: <SYMBOL op0=1 op1=3 op2=0 op3=4 op4=0 op5=4
+; BC-NEXT: <SYMBOL op0=2 op1=0 op2=0 op3=0
+; BC-NEXT: <CALLS op0=0 op1=1/>
+; BC-NEXT: </SYMBOL_SUMMARY_BLOCK>
+; BC: <MODULE_BLOCK
+
+; CHECK: @g = global i32 1, align 4
+@g = global i32 1, align 4
+@c = common global i64 0
+@e = external global i32
+@i = internal constant i32 3
+@a = alias i32* @g
+
+; CHECK: define void @f()
+define void @f() {
+  call void @h()
+  ret void
+}
+
+declare void @h()
+
+define linkonce_odr hidden void @l() unnamed_addr {
+  ret void
+}
@@ -1,4 +1,5 @@
 ; RUN: llc < %s -mtriple x86_64-apple-darwin | FileCheck %s
+; RUN: llc < %s -mtriple x86_64-apple-darwin -machine-pass-threads=2 | FileCheck %s
 
 define void @bar(i32 %argc) #0 {
 ; CHECK-LABEL: bar:
@@ -0,0 +1,57 @@
+; RUN: llc < %s -mtriple=x86_64-linux-gnu -o %t.serial
+; RUN: llc < %s -mtriple=x86_64-linux-gnu -machine-pass-threads=3 -o %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+
+; Running the machine passes of several functions at once must not change
+; the output, nor the order the functions are emitted in.
+
+; CHECK-LABEL: sum:
+; CHECK: ret
+; CHECK-LABEL: max:
+; CHECK: ret
+; CHECK-LABEL: callee_saved:
+; CHECK: pushq %rbx
+; CHECK: ret
+
+define i32 @sum(i32* %p, i32 %n) {
+entry:
+  %cmp4 = icmp sgt i32 %n, 0
+  br i1 %cmp4, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ %inc, %loop ], [ 0, %entry ]
+  %acc = phi i32 [ %add, %loop ], [ 0, %entry ]
+  %idx = sext i32 %i to i64
+  %gep = getelementptr inbounds i32* %p, i64 %idx
+  %v = load i32* %gep
+  %add = add nsw i32 %v, %acc
+  %inc = add nsw i32 %i, 1
+  %done = icmp eq i32 %inc, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %add, %loop ]
+  ret i32 %r
+}
+
+define i32 @max(i32 %a, i32 %b) {
+  %c = icmp sgt i32 %a, %b
+  %r = select i1 %c, i32 %a, i32 %b
+  ret i32 %r
+}
+
+declare i32 @ext(i32)
+
+define i32 @callee_saved(i32 %x) {
+  %a = call i32 @ext(i32 %x)
+  %b = call i32 @ext(i32 %a)
+  %r = add i32 %b, %x
+  ret i32 %r
+}
+
+define double @fp(double %a, double %b) {
+  %m = fmul double %a, %b
+  %s = fadd double %m, %a
+  ret double %s
+}
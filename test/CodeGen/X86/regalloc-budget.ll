@@ -0,0 +1,83 @@
+; RUN: llc < %s -mtriple=x86_64-linux-gnu -verify-machineinstrs \
+; RUN:     -regalloc-report-budget -o /dev/null 2>&1 | FileCheck %s -check-prefix=FULL
+; RUN: llc < %s -mtriple=x86_64-linux-gnu -verify-machineinstrs \
+; RUN:     -regalloc-budget=1 -regalloc-report-budget 2>&1 | FileCheck %s -check-prefix=SPILL
+
+; Once the greedy allocator has used up its budget on a function, it stops
+; splitting and evicting and just spills what does not fit.
+
+; FULL: regalloc: pressure: full allocation
+; SPILL: regalloc: pressure: assign-or-spill allocation
+; SPILL: {{^}}pressure:
+; SPILL: callq g
+; SPILL: ret
+
+declare void @g()
+
+define i32 @pressure(i32* %p) {
+entry:
+  %p1 = getelementptr i32* %p, i64 1
+  %p2 = getelementptr i32* %p, i64 2
+  %p3 = getelementptr i32* %p, i64 3
+  %p4 = getelementptr i32* %p, i64 4
+  %p5 = getelementptr i32* %p, i64 5
+  %p6 = getelementptr i32* %p, i64 6
+  %p7 = getelementptr i32* %p, i64 7
+  %p8 = getelementptr i32* %p, i64 8
+  %p9 = getelementptr i32* %p, i64 9
+  %p10 = getelementptr i32* %p, i64 10
+  %p11 = getelementptr i32* %p, i64 11
+  %p12 = getelementptr i32* %p, i64 12
+  %p13 = getelementptr i32* %p, i64 13
+  %p14 = getelementptr i32* %p, i64 14
+  %p15 = getelementptr i32* %p, i64 15
+  %v0 = load volatile i32* %p
+  %v1 = load volatile i32* %p1
+  %v2 = load volatile i32* %p2
+  %v3 = load volatile i32* %p3
+  %v4 = load volatile i32* %p4
+  %v5 = load volatile i32* %p5
+  %v6 = load volatile i32* %p6
+  %v7 = load volatile i32* %p7
+  %v8 = load volatile i32* %p8
+  %v9 = load volatile i32* %p9
+  %v10 = load volatile i32* %p10
+  %v11 = load volatile i32* %p11
+  %v12 = load volatile i32* %p12
+  %v13 = load volatile i32* %p13
+  %v14 = load volatile i32* %p14
+  %v15 = load volatile i32* %p15
+  call void @g()
+  %s1 = add i32 %v0, %v1
+  %s2 = add i32 %s1, %v2
+  %s3 = add i32 %s2, %v3
+  %s4 = add i32 %s3, %v4
+  %s5 = add i32 %s4, %v5
+  %s6 = add i32 %s5, %v6
+  %s7 = add i32 %s6, %v7
+  %s8 = add i32 %s7, %v8
+  %s9 = add i32 %s8, %v9
+  %s10 = add i32 %s9, %v10
+  %s11 = add i32 %s10, %v11
+  %s12 = add i32 %s11, %v12
+  %s13 = add i32 %s12, %v13
+  %s14 = add i32 %s13, %v14
+  %s15 = add i32 %s14, %v15
+  %m1 = mul i32 %v0, %v1
+  %m2 = mul i32 %m1, %v2
+  %m3 = mul i32 %m2, %v3
+  %m4 = mul i32 %m3, %v4
+  %m5 = mul i32 %m4, %v5
+  %m6 = mul i32 %m5, %v6
+  %m7 = mul i32 %m6, %v7
+  %m8 = mul i32 %m7, %v8
+  %m9 = mul i32 %m8, %v9
+  %m10 = mul i32 %m9, %v10
+  %m11 = mul i32 %m10, %v11
+  %m12 = mul i32 %m11, %v12
+  %m13 = mul i32 %m12, %v13
+  %m14 = mul i32 %m13, %v14
+  %m15 = mul i32 %m14, %v15
+  %r = xor i32 %s15, %m15
+  ret i32 %r
+}
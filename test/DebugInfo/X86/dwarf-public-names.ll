@@ -43,11 +43,11 @@
 ; LINUX: debug_pubnames
 
 ; Check for each name in the output.
-; LINUX: global_namespace_variable
-; LINUX: global_namespace_function
+; LINUX: global_function
 ; LINUX: static_member_function
+; LINUX: global_namespace_function
 ; LINUX: global_variable
-; LINUX: global_function
+; LINUX: global_namespace_variable
 ; LINUX: member_function
 
 %struct.C = type { i8 }
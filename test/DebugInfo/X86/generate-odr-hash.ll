@@ -151,8 +151,8 @@
 ; SINGLE-NEXT: unit_size = 0x00000061
 ; FISSION-NEXT: unit_size = 0x00000028
 ; CHECK-NEXT: Offset Name
-; CHECK-NEXT: "int"
 ; CHECK-NEXT: "echidna::capybara::mongoose::fluffy"
+; CHECK-NEXT: "int"
 ; SINGLE-NEXT: unit_size = 0x0000003e
 ; FISSION-NEXT: unit_size = 0x00000028
 ; CHECK-NEXT: Offset Name
@@ -39,11 +39,11 @@
 
 ; ASM: .section        .debug_gnu_pubnames
 ; ASM: .byte   32                      # Kind: VARIABLE, EXTERNAL
-; ASM-NEXT: .asciz  "global_variable"       # External Name
+; ASM-NEXT: .asciz  "C::static_member_variable" # External Name
 
 ; ASM: .section        .debug_gnu_pubtypes
 ; ASM: .byte   16                      # Kind: TYPE, EXTERNAL
-; ASM-NEXT: .asciz  "C"                     # External Name
+; ASM-NEXT: .asciz  "ns::D"                 # External Name
 
 ; CHECK: .debug_info contents:
 ; CHECK: Compile Unit: length = [[UNIT_SIZE:[0-9a-f]+]]
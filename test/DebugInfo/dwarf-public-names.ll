@@ -40,11 +40,11 @@
 ; CHECK: version = 0x0002
 
 ; Check for each name in the output.
-; CHECK: global_namespace_variable
-; CHECK: global_namespace_function
+; CHECK: global_function
 ; CHECK: static_member_function
+; CHECK: global_namespace_function
 ; CHECK: global_variable
-; CHECK: global_function
+; CHECK: global_namespace_variable
 ; CHECK: member_function
 
 %struct.C = type { i8 }
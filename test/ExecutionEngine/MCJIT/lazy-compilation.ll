@@ -0,0 +1,48 @@
+; RUN: %lli_mcjit -lazy-mcjit %s > /dev/null
+; RUN: not %lli_mcjit %s 2>&1 | FileCheck %s
+
+; Only functions that are called get compiled, so the reference to an
+; undefined function in @never_called is harmless unless compiling eagerly.
+; CHECK: Program used external function 'no_such_function'
+
+@counter = internal global i32 0
+@fn = internal global i32 (i32)* @fib
+
+declare void @no_such_function()
+
+define void @never_called() {
+  call void @no_such_function()
+  ret void
+}
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %c = icmp slt i32 %n, 2
+  br i1 %c, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+
+done:
+  %old = load i32* @counter
+  %new = add i32 %old, 1
+  store i32 %new, i32* @counter
+  ret i32 %n
+}
+
+define i32 @main() {
+  %f = load i32 (i32)** @fn
+  %r = call i32 %f(i32 10)
+  %leaves = load i32* @counter
+  ; fib(10) = 55, reached through 89 leaves.
+  %ok1 = icmp eq i32 %r, 55
+  %ok2 = icmp eq i32 %leaves, 89
+  %ok = and i1 %ok1, %ok2
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,48 @@
+; RUN: llvm-as < %s >%t1
+; RUN: llvm-lto -j 2 -disable-opt -exported-symbol=foo -exported-symbol=bar \
+; RUN:     -exported-symbol=baz -o %t2 %t1
+; RUN: llvm-nm %t2.0 | FileCheck %s -check-prefix=PART0
+; RUN: llvm-nm %t2.1 | FileCheck %s -check-prefix=PART1
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The constructor, the internal state it initializes and every function using
+; that state must share a partition.
+; PART0: b counter
+; PART0: T foo
+; PART0: t init
+; PART0-NOT: bar
+; PART0-NOT: baz
+
+; PART1-NOT: counter
+; PART1: T bar
+; PART1: T baz
+; PART1: U foo
+; PART1-NOT: init
+
+@.str = private unnamed_addr constant [4 x i8] c"abc\00"
+@counter = internal global i32 0
+@llvm.global_ctors = appending global [1 x { i32, void ()* }] [{ i32, void ()* } { i32 65535, void ()* @init }]
+
+define internal void @init() {
+  store i32 1, i32* @counter
+  ret void
+}
+
+define i32 @foo() {
+  %v = load i32* @counter
+  %w = add i32 %v, 1
+  store i32 %w, i32* @counter
+  %x = mul i32 %w, %v
+  ret i32 %x
+}
+
+define i8* @bar() {
+  ret i8* getelementptr ([4 x i8]* @.str, i32 0, i32 0)
+}
+
+define i8* @baz() {
+  call i32 @foo()
+  ret i8* getelementptr ([4 x i8]* @.str, i32 0, i32 0)
+}
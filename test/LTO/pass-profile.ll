@@ -0,0 +1,28 @@
+; RUN: llvm-as < %s > %t1
+; RUN: llvm-lto -exported-symbol=foo -pass-profile=%t.json -o %t2 %t1
+; RUN: FileCheck %s < %t.json
+; RUN: llvm-lto -j 2 -exported-symbol=foo -exported-symbol=bar \
+; RUN:     -pass-profile=%t.j2.json -o %t3 %t1
+; RUN: FileCheck %s < %t.j2.json
+
+; The profile is written once code generation is done, for libLTO clients
+; that never call llvm_shutdown.  It covers both the LTO pipeline and the code
+; generator.
+
+; CHECK: "runs": [
+; CHECK: {"pass": "Internalize Global Symbols", "kind": "module",
+; CHECK: {"pass": "X86 DAG->DAG Instruction Selection", "kind": "function", "unit": "foo",
+; CHECK: "totals": [
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 1
+  ret i32 %a
+}
+
+define i32 @bar(i32 %x) {
+  %a = mul i32 %x, 3
+  ret i32 %a
+}
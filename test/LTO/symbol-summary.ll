@@ -0,0 +1,62 @@
+; Test that the symbols llvm-lto reads from a symbol summary are the ones it
+; finds in the module.
+; RUN: llvm-as < %s -o %t0
+; RUN: llvm-as -bitcode-symbol-summary < %s -o %t1
+; RUN: llvm-lto -list-symbols-only %t0 | tail -n +2 > %t0.syms
+; RUN: llvm-lto -list-symbols-only %t1 | tail -n +2 > %t1.syms
+; RUN: diff %t0.syms %t1.syms
+; RUN: FileCheck %s < %t1.syms
+
+; Linking a module that was not parsed yet has to parse it first.
+; RUN: llvm-lto -o %t2 -exported-symbol=f -exported-symbol=g %t1 -disable-opt
+; RUN: llvm-nm %t2 | FileCheck %s -check-prefix=NM
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: {{[0-9a-f]+}} f
+; CHECK-NEXT: {{[0-9a-f]+}} l
+; CHECK-NEXT: {{[0-9a-f]+}} pr
+; CHECK-NEXT: {{[0-9a-f]+}} g
+; CHECK-NEXT: {{[0-9a-f]+}} c
+; CHECK-NEXT: {{[0-9a-f]+}} w
+; CHECK-NEXT: {{[0-9a-f]+}} i
+; CHECK-NEXT: {{[0-9a-f]+}} h
+; CHECK-NEXT: {{[0-9a-f]+}} lc
+; CHECK-NEXT: {{[0-9a-f]+}} a
+; CHECK-NOT: llvm.
+
+; NM: T f
+; NM: D g
+
+@g = global i32 1, align 4
+@c = common global i32 0
+@e = external global i32
+@ew = extern_weak global i32
+@w = weak global [4 x i8] zeroinitializer, align 16
+@i = internal constant i32 3
+@h = hidden global i32 6
+@lc = linkonce_odr global i32 7
+@a = alias i32* @g
+@llvm.used = appending global [1 x i8*] [i8* bitcast (i32* @i to i8*)], section "llvm.metadata"
+
+define void @f() {
+  call void @d()
+  ret void
+}
+
+declare void @d()
+
+declare void @llvm.trap()
+
+define linkonce_odr void @l() unnamed_addr {
+  ret void
+}
+
+define available_externally void @ae() {
+  ret void
+}
+
+define protected void @pr() {
+  ret void
+}
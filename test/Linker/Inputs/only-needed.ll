@@ -0,0 +1,24 @@
+@gv = global i32 0
+
+define internal i32 @internal_helper() {
+  ret i32 0
+}
+
+define i32 @needed() {
+  %v = call i32 @helper()
+  ret i32 %v
+}
+
+define i32 @helper() {
+  %v = call i32 @internal_helper()
+  ret i32 %v
+}
+
+define i32 @unneeded() {
+  %v = call i32 @unneeded_helper()
+  ret i32 %v
+}
+
+define i32 @unneeded_helper() {
+  ret i32 1
+}
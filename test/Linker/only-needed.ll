@@ -0,0 +1,23 @@
+; RUN: llvm-as %S/Inputs/only-needed.ll -o %t.bc
+; RUN: llvm-link -only-needed -S %s %t.bc | FileCheck %s
+; RUN: llvm-link -S %s %t.bc | FileCheck %s -check-prefix=ALL
+
+; Only the functions reachable from @main are linked in; globals are linked
+; as usual.
+
+; CHECK: @gv = global i32 0
+; CHECK: define i32 @main()
+; CHECK: define i32 @needed()
+; CHECK: define i32 @helper()
+; CHECK: define internal i32 @internal_helper()
+; CHECK-NOT: unneeded
+
+; ALL: define i32 @unneeded()
+; ALL: define i32 @unneeded_helper()
+
+define i32 @main() {
+  %v = call i32 @needed()
+  ret i32 %v
+}
+
+declare i32 @needed()
@@ -0,0 +1,50 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -elf-write-threads=1 %s -o %t1
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -elf-write-threads=4 %s -o %t4
+// RUN: cmp %t1 %t4
+// RUN: llvm-readobj -s -sd %t4 | FileCheck %s
+
+// Sections are encoded concurrently and written in order; the result must not
+// depend on how many threads do it.
+
+        .text
+        .globl  f
+f:
+        callq   g
+        jmp     .Lend
+        .p2align 4
+        nop
+.Lend:
+        retq
+
+        .section .text.g,"axG",@progbits,g,comdat
+        .globl  g
+g:
+        retq
+
+        .data
+        .p2align 3
+        .quad   f
+        .long   1
+
+        .section .rodata,"a",@progbits
+        .asciz  "hello"
+
+        .bss
+        .zero   64
+
+        .section .debug_str,"MS",@progbits,1
+        .asciz  "str"
+
+// CHECK:      Name: .text
+// CHECK:      SectionData (
+// CHECK-NEXT:   0000: E8000000 00EB0A66 0F1F8400 00000000
+// CHECK-NEXT:   0010: 90C3
+// CHECK-NEXT: )
+// CHECK:      Name: .data
+// CHECK:      SectionData (
+// CHECK-NEXT:   0000: 00000000 00000000 01000000
+// CHECK-NEXT: )
+// CHECK:      Name: .rodata
+// CHECK:      SectionData (
+// CHECK-NEXT:   0000: 68656C6C 6F00
+// CHECK-NEXT: )
@@ -0,0 +1,48 @@
+// RUN: llvm-mc -triple x86_64-pc-linux-gnu -filetype=obj %s -o %t.o
+// RUN: llvm-objdump -d -r -threads=1 %t.o > %t.serial
+// RUN: llvm-objdump -d -r -threads=4 %t.o > %t.parallel
+// RUN: diff %t.serial %t.parallel
+// RUN: FileCheck %s < %t.parallel
+
+// Every symbol is disassembled on its own; the output keeps the symbols in
+// address order, with each relocation under the instruction it applies to.
+
+// CHECK: Disassembly of section .text:
+// CHECK: {{^}}first:
+// CHECK-NEXT: 0: e8 00 00 00 00 callq 0
+// CHECK-NEXT: 1: R_X86_64_PC32 ext1-4-P
+// CHECK-NEXT: 5: c3 retq
+// CHECK: {{^}}second:
+// CHECK-NEXT: 7: 48 8b 05 00 00 00 00 movq (%rip), %rax
+// CHECK-NEXT: a: R_X86_64_PC32 ext2-4-P
+// CHECK: {{^}}third:
+// CHECK-NEXT: 11: 90 nop
+// CHECK: {{^}}fourth:
+// CHECK-NEXT: 14: e8 00 00 00 00 callq 0
+// CHECK-NEXT: 15: R_X86_64_PC32 ext3-4-P
+// CHECK-NEXT: 19: c3 retq
+// CHECK: Disassembly of section .text.other:
+// CHECK-NEXT: {{^}}other:
+// CHECK-NEXT: 0: c3 retq
+
+        .text
+first:
+        call    ext1
+        ret
+        nop
+second:
+        movq    ext2(%rip), %rax
+        ret
+        nop
+        nop
+third:
+        nop
+        ret
+        nop
+fourth:
+        call    ext3
+        ret
+
+        .section .text.other,"ax",@progbits
+other:
+        ret
@@ -0,0 +1,62 @@
+# RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t
+# RUN: llvm-objdump -d %t | FileCheck %s
+# RUN: llvm-readobj -s -sd %t | FileCheck --check-prefix=DATA %s
+
+# Relaxation only revisits the fragments which earlier changes may have
+# affected.  Check that it still finds all of them.
+
+# Relaxing the second jump pushes the target of the first out of range.
+        .section .text.cascade,"ax",@progbits
+cascade:
+        jmp .Lcascade
+        .fill 124, 1, 0x90
+        jmp .Lcascade_far
+.Lcascade:
+        ret
+        .fill 200, 1, 0x90
+.Lcascade_far:
+        ret
+
+# CHECK-LABEL: {{^}}cascade:
+# CHECK-NEXT:        0: e9 81 00 00 00
+# CHECK:            81: e9 c9 00 00 00
+
+# Relaxing the first jump moves everything after it, which changes the
+# padding the alignment between the second jump and its target needs.
+        .section .text.align,"ax",@progbits
+align:
+        jmp .Lalign_far
+        .fill 14, 1, 0x90
+        jmp .Lalign
+        .fill 110, 1, 0x90
+        .p2align 4
+        .fill 10, 1, 0x90
+.Lalign:
+        ret
+        .fill 200, 1, 0x90
+.Lalign_far:
+        ret
+
+# CHECK-LABEL: {{^}}align:
+# CHECK-NEXT:        0: e9
+# CHECK:            13: e9 82 00 00 00
+
+# Relaxation in one section changes a LEB128 in another.
+        .section .text.leb,"ax",@progbits
+leb:
+.Lleb_start:
+        jmp .Lleb_far
+        .fill 124, 1, 0x90
+.Lleb_end:
+        .fill 200, 1, 0x90
+.Lleb_far:
+        ret
+
+        .data
+        .uleb128 .Lleb_end - .Lleb_start
+        .byte 0xff
+
+# DATA:      Name: .data
+# DATA:      SectionData (
+# DATA-NEXT:   0000: 8101FF
+# DATA-NEXT: )
@@ -0,0 +1,62 @@
+; REQUIRES: function-arenas
+; RUN: opt < %s -function-arenas -extract-blocks -instcombine -S | FileCheck %s
+; RUN: opt < %s -function-arenas -extract-blocks -function-pass-threads=4 \
+; RUN:   -instcombine -S | FileCheck %s
+
+; The block extractor moves every block into a function of its own, so the
+; instructions of the new functions still belong to the arenas of the
+; functions they were parsed into.  Function passes running on several
+; threads then free them into those arenas while other threads allocate from
+; them.
+
+define i32 @f(i32 %x) {
+entry:
+  %e = add i32 %x, 0
+  br label %body
+
+body:
+  %a = add i32 %e, 0
+  %b = mul i32 %a, 1
+  store i32 %b, i32* @g
+  ret i32 %b
+}
+
+define i32 @h(i32 %x) {
+entry:
+  %e = xor i32 %x, 0
+  br label %body
+
+body:
+  %a = or i32 %e, 0
+  %b = sub i32 %a, 0
+  store i32 %b, i32* @g
+  ret i32 %b
+}
+
+@g = global i32 0
+
+; CHECK-LABEL: define i32 @f(
+; CHECK: call void @f_entry.ce(i32 %x,
+; CHECK: call void @f_body(
+
+; CHECK-LABEL: define i32 @h(
+; CHECK: call void @h_entry.ce(i32 %x,
+; CHECK: call void @h_body(
+
+; CHECK-LABEL: define internal void @f_entry.ce(
+; CHECK-NOT: = add
+; CHECK: store i32 %x, i32* %e.out
+
+; CHECK-LABEL: define internal void @f_body(
+; CHECK-NOT: = add
+; CHECK-NOT: = mul
+; CHECK: store i32 %e.reload, i32* @g
+
+; CHECK-LABEL: define internal void @h_entry.ce(
+; CHECK-NOT: = xor
+; CHECK: store i32 %x, i32* %e.out
+
+; CHECK-LABEL: define internal void @h_body(
+; CHECK-NOT: = or
+; CHECK-NOT: = sub
+; CHECK: store i32 %e.reload, i32* @g
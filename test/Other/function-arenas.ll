@@ -0,0 +1,43 @@
+; REQUIRES: function-arenas
+; RUN: opt < %s -function-arenas -O2 -S | FileCheck %s
+; RUN: opt < %s -function-arenas -function-pass-threads=4 -O2 -S \
+; RUN:   | FileCheck %s
+; RUN: llvm-as < %s | opt -function-arenas -O2 -S | FileCheck %s
+
+; Allocating function bodies from arenas must not change the result.  The
+; inliner runs outside of any FunctionArenaScope, so the copy of @select it
+; makes in @caller comes from the heap, and globaldce then deletes @select
+; together with its arena.  Freeing an instruction into the arena of another
+; function is covered by function-arenas-extract.ll and the unit tests.
+
+define internal i32 @select(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %zero
+    i32 1, label %one
+  ]
+zero:
+  br label %exit
+one:
+  br label %exit
+default:
+  %y = mul i32 %x, %x
+  br label %exit
+exit:
+  %r = phi i32 [ 7, %zero ], [ 9, %one ], [ %y, %default ]
+  ret i32 %r
+}
+
+define i32 @caller(i32 %x) {
+; CHECK-LABEL: define i32 @caller(
+; CHECK: switch i32 %x
+; CHECK: mul i32 %x, %x
+; CHECK: phi i32
+; CHECK-NOT: call
+  %a = call i32 @select(i32 %x)
+  %b = add i32 %a, 1
+  %c = sub i32 %b, 1
+  ret i32 %c
+}
+
+; CHECK-NOT: define internal i32 @select
@@ -0,0 +1,121 @@
+; RUN: opt < %s -loop-rotate -licm -indvars -loop-deletion -loop-unroll -S \
+; RUN:   > %t.serial
+; RUN: opt < %s -function-pass-threads=4 -loop-rotate -licm -indvars \
+; RUN:   -loop-deletion -loop-unroll -S > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; RUN: opt < %s -O2 -S > %t.O2.serial
+; RUN: opt < %s -function-pass-threads=4 -O2 -S > %t.O2.parallel
+; RUN: diff %t.O2.serial %t.O2.parallel
+
+; Function pass managers with a nested loop pass manager give every worker
+; thread its own copy of the loop pass manager and its passes.  The result
+; must be the same as running serially.
+
+; CHECK-LABEL: define i32 @sum(
+; CHECK-NOT: phi
+; CHECK: ret i32 45
+define i32 @sum() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %s.next = add i32 %s, %i
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 10
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
+
+; CHECK-LABEL: define void @hoist(
+; CHECK: mul i32 %a, %b
+; CHECK: br label
+define void @hoist(i32* %p, i32 %n, i32 %a, i32 %b) {
+entry:
+  %guard = icmp sgt i32 %n, 0
+  br i1 %guard, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %inv = mul i32 %a, %b
+  %idx = getelementptr i32* %p, i32 %i
+  store i32 %inv, i32* %idx
+  %i.next = add nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; CHECK-LABEL: define void @dead(
+; CHECK-NOT: phi
+; CHECK: ret void
+define void @dead(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp sge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i32 @nested(i32* %p, i32 %n, i32 %m) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.inner, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %acc.in = phi i32 [ %acc, %outer ], [ %acc.inner, %inner ]
+  %row = mul i32 %i, %m
+  %k = add i32 %row, %j
+  %idx = getelementptr i32* %p, i32 %k
+  %v = load i32* %idx
+  %acc.inner = add i32 %acc.in, %v
+  %j.next = add i32 %j, 1
+  %inner.done = icmp sge i32 %j.next, %m
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add i32 %i, 1
+  %outer.done = icmp sge i32 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret i32 %acc.inner
+}
+
+; CHECK-LABEL: define i32 @unroll(
+; CHECK-NOT: phi
+; CHECK: %s.next.3 = add
+define i32 @unroll(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %idx = getelementptr i32* %p, i32 %i
+  %v = load i32* %idx
+  %s.next = add i32 %s, %v
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, 4
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s.next
+}
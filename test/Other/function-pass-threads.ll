@@ -0,0 +1,77 @@
+; RUN: opt < %s -instcombine -simplifycfg -S | FileCheck %s
+; RUN: opt < %s -function-pass-threads=4 -instcombine -simplifycfg -S \
+; RUN:   | FileCheck %s
+
+; Running function passes on several threads must give the same result as
+; running them serially, including when the passes create new constants and
+; insert new declarations into the module.
+
+@g = global i32 0
+@str = private unnamed_addr constant [6 x i8] c"hello\00"
+@str2 = private unnamed_addr constant [4 x i8] c"bye\00"
+@fmt = private unnamed_addr constant [4 x i8] c"%s\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+; CHECK-LABEL: define i32 @f1(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i32 3, i32* @g
+; CHECK-NEXT: ret i32 3
+define i32 @f1(i32 %x) {
+entry:
+  %a = add i32 1, 2
+  store i32 %a, i32* @g
+  ret i32 %a
+}
+
+; CHECK-LABEL: define i32 @f2(
+; CHECK: %puts = call i32 @puts(i8* getelementptr inbounds ([6 x i8]* @str, i64 0, i64 0))
+; CHECK-NEXT: ret i32 0
+define i32 @f2() {
+entry:
+  %fmt = getelementptr [4 x i8]* @fmt, i64 0, i64 0
+  %s = getelementptr [6 x i8]* @str, i64 0, i64 0
+  %r = call i32 (i8*, ...)* @printf(i8* %fmt, i8* %s)
+  ret i32 0
+}
+
+; CHECK-LABEL: define i32 @f3(
+; CHECK: %puts = call i32 @puts(i8* getelementptr inbounds ([4 x i8]* @str2, i64 0, i64 0))
+; CHECK-NEXT: ret i32 0
+define i32 @f3() {
+entry:
+  %fmt = getelementptr [4 x i8]* @fmt, i64 0, i64 0
+  %s = getelementptr [4 x i8]* @str2, i64 0, i64 0
+  %r = call i32 (i8*, ...)* @printf(i8* %fmt, i8* %s)
+  ret i32 0
+}
+
+; CHECK-LABEL: define i32 @f4(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %[[SEL:.*]] = select i1 %c, i32 7, i32 11
+; CHECK-NEXT: ret i32 %[[SEL]]
+define i32 @f4(i1 %c) {
+entry:
+  br i1 %c, label %t, label %f
+t:
+  br label %m
+f:
+  br label %m
+m:
+  %p = phi i32 [ 7, %t ], [ 11, %f ]
+  ret i32 %p
+}
+
+; CHECK-LABEL: define i64 @f5(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %[[Z:.*]] = zext i32 %x to i64
+; CHECK-NEXT: %[[M:.*]] = shl nuw nsw i64 %[[Z]], 3
+; CHECK-NEXT: ret i64 %[[M]]
+define i64 @f5(i32 %x) {
+entry:
+  %z = zext i32 %x to i64
+  %m = mul i64 %z, 8
+  ret i64 %m
+}
+
+; CHECK: declare i32 @puts(i8* nocapture)
@@ -0,0 +1,20 @@
+; ArgumentPromotion replaces @callee with a new function and deletes the old
+; one while it runs, so the instructions after the run are those of the
+; replacement.
+; RUN: opt -argpromotion -pass-profile=%t.json -disable-output %s
+; RUN: FileCheck %s < %t.json
+
+; CHECK: {"pass": "Promote 'by reference' arguments to scalars", "kind": "scc", "unit": "callee", {{.*}} "instructions_before": 2, "instructions_after": 1,
+; CHECK: {"pass": "Promote 'by reference' arguments to scalars", "kind": "scc", "unit": "caller", {{.*}} "instructions_before": 5, "instructions_after": 5,
+
+define internal i32 @callee(i32* %p) {
+  %v = load i32* %p
+  ret i32 %v
+}
+
+define i32 @caller(i32 %x) {
+  %a = alloca i32
+  store i32 %x, i32* %a
+  %r = call i32 @callee(i32* %a)
+  ret i32 %r
+}
@@ -0,0 +1,21 @@
+; RUN: opt -instcombine -globaldce -pass-profile=%t.json -disable-output %s
+; RUN: FileCheck %s < %t.json
+; RUN: opt -instcombine -pass-profile=%t.trace -pass-profile-format=chrome \
+; RUN:   -disable-output %s
+; RUN: FileCheck %s -check-prefix=TRACE < %t.trace
+
+; CHECK: "runs": [
+; CHECK: {"pass": "Combine redundant instructions", "kind": "function", "unit": "foo", "thread": 0, "start_us": {{[0-9]+}}, "wall_us": {{[0-9]+}}, "instructions_before": 3, "instructions_after": 1, "malloc_delta": {{-?[0-9]+}}}
+; CHECK: {"pass": "Dead Global Elimination", "kind": "module", "unit": "{{.*}}pass-profile.ll", {{.*}} "instructions_before": 1, "instructions_after": 1,
+; CHECK: "totals": [
+; CHECK: {"pass": "Combine redundant instructions", "runs": 1, "wall_us": {{[0-9]+}}, "instruction_delta": -2,
+
+; TRACE: {"traceEvents": [
+; TRACE: {"name": "Combine redundant instructions", "cat": "function", "ph": "X", "ts": {{[0-9]+}}, "dur": {{[0-9]+}}, "pid": 0, "tid": 0, "args": {"unit": "foo", "instructions_before": 3, "instructions_after": 1, "malloc_delta": {{-?[0-9]+}}}}
+; TRACE: ]}
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 1
+  ret i32 %b
+}
@@ -0,0 +1,76 @@
+; RUN: opt -mergefunc -S < %s | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; The comparison treats constants of different kinds or types as equal when
+; they have the same bit pattern, so the hash must not tell them apart.
+
+@g = global i32 0
+
+; A global and a bitcast of it.
+define internal i64 @a(i64 %x) {
+; CHECK-LABEL: @a(
+  %p = getelementptr i32* @g, i64 1
+  %i = ptrtoint i32* %p to i64
+  %r = add i64 %i, %x
+  ret i64 %r
+}
+
+define internal i64 @b(i64 %x) {
+; CHECK-NOT: @b(
+  %p = getelementptr i8* bitcast (i32* @g to i8*), i64 4
+  %i = ptrtoint i8* %p to i64
+  %r = add i64 %i, %x
+  ret i64 %r
+}
+
+; Null pointers of different types.
+define internal void @c(i8** %p, i8** %q) {
+; CHECK-LABEL: @c(
+  store i8* null, i8** %p
+  store i8* null, i8** %q
+  ret void
+}
+
+define internal void @d(i32** %p, i32** %q) {
+; CHECK-NOT: @d(
+  store i32* null, i32** %p
+  store i32* null, i32** %q
+  ret void
+}
+
+; Integers with different values still keep functions apart.
+define internal i64 @e(i64 %x) {
+; CHECK-LABEL: @e(
+; CHECK: mul i64 %x, 3
+  %y = mul i64 %x, 3
+  %z = add i64 %y, %x
+  ret i64 %z
+}
+
+define internal i64 @f(i64 %x) {
+; CHECK-LABEL: @f(
+; CHECK: mul i64 %x, 5
+  %y = mul i64 %x, 5
+  %z = add i64 %y, %x
+  ret i64 %z
+}
+
+define i64 @user(i64 %x, i8** %p, i32** %q) {
+; CHECK-LABEL: @user(
+; CHECK: call i64 @a(i64 %x)
+; CHECK: call i64 @a(i64 %x)
+; CHECK: call void {{.*}}@c
+; CHECK: call void {{.*}}@c
+; CHECK: call i64 @e(i64 %x)
+; CHECK: call i64 @f(i64 %x)
+  %1 = call i64 @a(i64 %x)
+  %2 = call i64 @b(i64 %x)
+  call void @c(i8** %p, i8** %p)
+  call void @d(i32** %q, i32** %q)
+  %3 = call i64 @e(i64 %x)
+  %4 = call i64 @f(i64 %x)
+  %5 = add i64 %1, %2
+  %6 = add i64 %5, %3
+  %7 = add i64 %6, %4
+  ret i64 %7
+}
@@ -0,0 +1,46 @@
+; RUN: opt -mergefunc -S < %s | FileCheck %s
+
+; The hash only covers the blocks reachable from the entry block, like the
+; comparison itself, so a dead block does not keep these from being merged.
+
+define internal i32 @a(i32 %x) {
+; CHECK-LABEL: @a(
+entry:
+  %y = add i32 %x, 1
+  %z = mul i32 %y, %x
+  ret i32 %z
+}
+
+define internal i32 @b(i32 %x) {
+; CHECK-NOT: @b(
+entry:
+  %y = add i32 %x, 1
+  %z = mul i32 %y, %x
+  ret i32 %z
+
+dead:
+  ret i32 0
+}
+
+; @c has the same signature but a different body, so it stays.
+define internal i32 @c(i32 %x) {
+; CHECK-LABEL: @c(
+; CHECK: sub i32
+entry:
+  %y = sub i32 %x, 1
+  %z = mul i32 %y, %x
+  ret i32 %z
+}
+
+define i32 @user(i32 %x) {
+; CHECK-LABEL: @user(
+; CHECK: call i32 @a(i32 %x)
+; CHECK: call i32 @a(i32 %x)
+; CHECK: call i32 @c(i32 %x)
+  %1 = call i32 @a(i32 %x)
+  %2 = call i32 @b(i32 %x)
+  %3 = call i32 @c(i32 %x)
+  %4 = add i32 %1, %2
+  %5 = add i32 %4, %3
+  ret i32 %5
+}
@@ -1,4 +1,6 @@
 ; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/branch.prof | opt -analyze -branch-prob | FileCheck %s
+; RUN: llvm-profdata -sample -binary %S/Inputs/branch.prof -o %t.prof
+; RUN: opt < %s -sample-profile -sample-profile-file=%t.prof | opt -analyze -branch-prob | FileCheck %s
 
 ; Original C++ code for this test case:
 ;
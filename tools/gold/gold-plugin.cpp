@@ -86,6 +86,8 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Number of partitions to run code generation on in parallel.
+  static unsigned Parallelism = 1;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -107,6 +109,9 @@ namespace options {
       extra_library_path = opt.substr(strlen("extra_library_path="));
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, Parallelism))
+        (*message)(LDPL_FATAL, "Invalid parallelism level: %s", opt_);
     } else if (opt.startswith("obj-path=")) {
       obj_path = opt.substr(strlen("obj-path="));
     } else if (opt == "emit-llvm") {
@@ -447,13 +452,17 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  std::string ObjPath;
+  std::vector<std::string> ObjPaths;
   {
-    const char *Temp;
-    if (lto_codegen_compile_to_file(code_gen, &Temp)) {
-      (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
+    const char **Temps;
+    unsigned NumTemps;
+    lto_codegen_set_parallelism(code_gen, options::Parallelism);
+    if (lto_codegen_compile_to_files(code_gen, &Temps, &NumTemps)) {
+      (*message)(LDPL_ERROR, "Could not produce the object files\n");
+      lto_codegen_dispose(code_gen);
+      return LDPS_ERR;
     }
-    ObjPath = Temp;
+    ObjPaths.assign(Temps, Temps + NumTemps);
   }
 
   lto_codegen_dispose(code_gen);
@@ -465,10 +474,12 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(ObjPath.c_str()) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", ObjPath.c_str());
-    return LDPS_ERR;
+  for (unsigned i = 0, e = ObjPaths.size(); i != e; ++i) {
+    if ((*add_input_file)(ObjPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", ObjPaths[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -478,7 +489,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(ObjPath);
+    Cleanup.insert(Cleanup.end(), ObjPaths.begin(), ObjPaths.end());
 
   return LDPS_OK;
 }
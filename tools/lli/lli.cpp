@@ -176,6 +176,12 @@ namespace {
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
 
+  cl::opt<bool>
+  LazyMCJIT("lazy-mcjit",
+            cl::desc("Compile each function with MCJIT only when it is first "
+                     "called"),
+            cl::init(false));
+
   cl::opt<Reloc::Model>
   RelocModel("relocation-model",
              cl::desc("Choose relocation model"),
@@ -570,6 +576,11 @@ int main(int argc, char **argv, char * const *envp) {
     NoLazyCompilation = true;
   }
   EE->DisableLazyCompilation(NoLazyCompilation);
+  if (LazyMCJIT && RemoteMCJIT) {
+    errs() << "warning: remote mcjit does not support lazy compilation\n";
+    LazyMCJIT = false;
+  }
+  EE->EnableLazyModuleSplitting(LazyMCJIT);
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
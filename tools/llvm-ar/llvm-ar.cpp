@@ -16,6 +16,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
@@ -23,6 +24,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -70,6 +72,11 @@ RestOfArgs(cl::Positional, cl::OneOrMore,
 
 std::string Options;
 
+static cl::opt<unsigned>
+Threads("threads", cl::desc("Number of threads used to read the members' "
+                            "symbols (0 = one per hardware thread)"),
+        cl::init(0));
+
 // MoreHelp - Provide additional help output explaining the operations and
 // modifiers of llvm-ar. This object instructs the CommandLine library
 // to print the text of the constructor when the --help option is given.
@@ -690,60 +697,100 @@ static void writeStringTable(raw_fd_ostream &Out,
   Out.seek(Pos);
 }
 
+namespace {
+/// The archive index entries of one member.
+struct MemberSymbols {
+  bool IsObject;
+  /// The names of the symbols, each terminated by a null.
+  std::string Names;
+  unsigned NumSymbols;
+  error_code EC;
+
+  MemberSymbols() : IsObject(false), NumSymbols(0) {}
+};
+}
+
+/// readMemberSymbols - Read the symbols that belong in the archive index from
+/// \p Buffer.  Bitcode members are read into \p Context.
+static void readMemberSymbols(MemoryBuffer *Buffer, LLVMContext &Context,
+                              MemberSymbols &Result) {
+  ErrorOr<object::SymbolicFile *> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(
+          Buffer, false, sys::fs::file_magic::unknown, &Context);
+  if (!ObjOrErr)
+    return;  // FIXME: check only for "not an object file" errors.
+  OwningPtr<object::SymbolicFile> Obj(ObjOrErr.get());
+  Result.IsObject = true;
+
+  raw_string_ostream NameOS(Result.Names);
+  for (object::basic_symbol_iterator I = Obj->symbol_begin(),
+                                     E = Obj->symbol_end();
+       I != E; ++I) {
+    uint32_t Symflags = I->getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+    if ((Result.EC = I->printName(NameOS)))
+      return;
+    NameOS << '\0';
+    ++Result.NumSymbols;
+  }
+}
+
 static void writeSymbolTable(
     raw_fd_ostream &Out, ArrayRef<NewArchiveIterator> Members,
     ArrayRef<MemoryBuffer *> Buffers,
     std::vector<std::pair<unsigned, unsigned> > &MemberOffsetRefs) {
+  // Reading the members' symbols is most of the work, so it is spread over
+  // threads, each with a context of its own for bitcode members.
+  unsigned NumMembers = Members.size();
+  std::vector<MemberSymbols> Symbols(NumMembers);
+  volatile sys::cas_flag NextMember = 0;
+  auto ReadSymbols = [&] {
+    LLVMContext Context;
+    while (true) {
+      unsigned i = sys::AtomicIncrement(&NextMember) - 1;
+      if (i >= NumMembers)
+        break;
+      readMemberSymbols(Buffers[i], Context, Symbols[i]);
+    }
+  };
+  unsigned NumThreads = Threads ? Threads : ThreadPool::getDefaultThreadCount();
+  NumThreads = std::min(NumThreads, NumMembers);
+  if (NumThreads > 1) {
+    ThreadPool Pool(NumThreads);
+    for (unsigned i = 0; i != NumThreads; ++i)
+      Pool.async(ReadSymbols);
+    Pool.wait();
+  } else {
+    ReadSymbols();
+  }
+
   unsigned StartOffset = 0;
-  unsigned MemberNum = 0;
-  std::string NameBuf;
-  raw_string_ostream NameOS(NameBuf);
   unsigned NumSyms = 0;
-  std::vector<object::SymbolicFile *> DeleteIt;
-  LLVMContext &Context = getGlobalContext();
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
-       I != E; ++I, ++MemberNum) {
-    MemoryBuffer *MemberBuffer = Buffers[MemberNum];
-    ErrorOr<object::SymbolicFile *> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, false, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr)
-      continue;  // FIXME: check only for "not an object file" errors.
-    object::SymbolicFile *Obj = ObjOrErr.get();
-
-    DeleteIt.push_back(Obj);
+  for (unsigned MemberNum = 0; MemberNum != NumMembers; ++MemberNum) {
+    const MemberSymbols &MS = Symbols[MemberNum];
+    failIfError(MS.EC);
+    if (!MS.IsObject)
+      continue;
+
     if (!StartOffset) {
       printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0, 0);
       StartOffset = Out.tell();
       print32BE(Out, 0);
     }
 
-    for (object::basic_symbol_iterator I = Obj->symbol_begin(),
-                                       E = Obj->symbol_end();
-         I != E; ++I) {
-      uint32_t Symflags = I->getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-      failIfError(I->printName(NameOS));
-      NameOS << '\0';
+    for (unsigned i = 0; i != MS.NumSymbols; ++i) {
       ++NumSyms;
       MemberOffsetRefs.push_back(std::make_pair(Out.tell(), MemberNum));
       print32BE(Out, 0);
     }
   }
-  Out << NameOS.str();
-
-  for (std::vector<object::SymbolicFile *>::iterator I = DeleteIt.begin(),
-                                                     E = DeleteIt.end();
-       I != E; ++I) {
-    object::SymbolicFile *O = *I;
-    delete O;
-  }
+  for (unsigned MemberNum = 0; MemberNum != NumMembers; ++MemberNum)
+    Out << Symbols[MemberNum].Names;
 
   if (StartOffset == 0)
     return;
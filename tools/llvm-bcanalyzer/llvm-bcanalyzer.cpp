@@ -110,6 +110,8 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::METADATA_BLOCK_ID:        return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID:   return "METADATA_ATTACHMENT_BLOCK";
   case bitc::USELIST_BLOCK_ID:         return "USELIST_BLOCK_ID";
+  case bitc::FUNCTION_INDEX_BLOCK_ID:  return "FUNCTION_INDEX_BLOCK";
+  case bitc::SYMBOL_SUMMARY_BLOCK_ID:  return "SYMBOL_SUMMARY_BLOCK";
   }
 }
 
@@ -157,6 +159,7 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::MODULE_CODE_ALIAS:       return "ALIAS";
     case bitc::MODULE_CODE_PURGEVALS:   return "PURGEVALS";
     case bitc::MODULE_CODE_GCNAME:      return "GCNAME";
+    case bitc::MODULE_CODE_FNINDEXOFFSET: return "FNINDEXOFFSET";
     }
   case bitc::PARAMATTR_BLOCK_ID:
     switch (CodeID) {
@@ -274,6 +277,20 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     default:return 0;
     case bitc::USELIST_CODE_ENTRY:   return "USELIST_CODE_ENTRY";
     }
+  case bitc::FUNCTION_INDEX_BLOCK_ID:
+    switch(CodeID) {
+    default:return 0;
+    case bitc::FUNCTION_INDEX_CODE_ENTRY: return "ENTRY";
+    }
+  case bitc::SYMBOL_SUMMARY_BLOCK_ID:
+    switch(CodeID) {
+    default:return 0;
+    case bitc::SUMMARY_CODE_TRIPLE:      return "TRIPLE";
+    case bitc::SUMMARY_CODE_DATALAYOUT:  return "DATALAYOUT";
+    case bitc::SUMMARY_CODE_FLAGS:       return "FLAGS";
+    case bitc::SUMMARY_CODE_SYMBOL:      return "SYMBOL";
+    case bitc::SUMMARY_CODE_CALLS:       return "CALLS";
+    }
   }
 }
 
@@ -52,6 +52,16 @@ static cl::opt<bool>
 PrintInlining("inlining", cl::init(false),
               cl::desc("Print all inlined frames for a given address"));
 
+static cl::opt<bool>
+Preload("preload", cl::init(false),
+        cl::desc("Parse and index all debug information before using it"));
+
+static cl::opt<unsigned>
+PreloadThreads("preload-threads", cl::init(0),
+               cl::desc("Number of threads used by -preload "
+                        "(0 = one per hardware thread)"),
+               cl::Hidden);
+
 static cl::opt<DIDumpType>
 DumpType("debug-dump", cl::init(DIDT_All),
   cl::desc("Dump of debug sections:"),
@@ -102,6 +112,8 @@ static void DumpInput(const StringRef &Filename) {
   OwningPtr<ObjectFile> Obj(ObjOrErr.get());
 
   OwningPtr<DIContext> DICtx(DIContext::getDWARFContext(Obj.get()));
+  if (Preload)
+    DICtx->preload(PreloadThreads);
 
   if (Address == -1ULL) {
     outs() << Filename
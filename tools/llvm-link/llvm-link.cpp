@@ -54,16 +54,24 @@ static cl::opt<bool>
 SuppressWarnings("suppress-warnings", cl::desc("Suppress all linking warnings"),
                  cl::init(false));
 
+static cl::opt<bool>
+OnlyNeeded("only-needed",
+           cl::desc("Link in only the functions the first input needs"));
+
 // LoadFile - Read the specified bitcode file in and return it.  This routine
-// searches the link path for the specified file to try to find it...
+// searches the link path for the specified file to try to find it...  Function
+// bodies are read on demand if Lazy is set.
 //
 static inline Module *LoadFile(const char *argv0, const std::string &FN,
-                               LLVMContext& Context) {
+                               LLVMContext& Context, bool Lazy = false) {
   SMDiagnostic Err;
   if (Verbose) errs() << "Loading '" << FN << "'\n";
   Module* Result = 0;
 
-  Result = ParseIRFile(FN, Err, Context);
+  if (Lazy)
+    Result = getLazyIRFileModule(FN, Err, Context);
+  else
+    Result = ParseIRFile(FN, Err, Context);
   if (Result) return Result;   // Load successful!
 
   Err.print(argv0, errs());
@@ -92,7 +100,8 @@ int main(int argc, char **argv) {
 
   Linker L(Composite.get(), SuppressWarnings);
   for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
-    OwningPtr<Module> M(LoadFile(argv[0], InputFilenames[i], Context));
+    OwningPtr<Module> M(LoadFile(argv[0], InputFilenames[i], Context,
+                                 OnlyNeeded));
     if (M.get() == 0) {
       errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
       return 1;
@@ -100,7 +109,10 @@ int main(int argc, char **argv) {
 
     if (Verbose) errs() << "Linking in '" << InputFilenames[i] << "'\n";
 
-    if (L.linkInModule(M.get(), &ErrorMessage)) {
+    unsigned Mode = Linker::DestroySource;
+    if (OnlyNeeded)
+      Mode |= Linker::LinkOnlyNeeded;
+    if (L.linkInModule(M.get(), Mode, &ErrorMessage)) {
       errs() << argv[0] << ": link error in '" << InputFilenames[i]
              << "': " << ErrorMessage << "\n";
       return 1;
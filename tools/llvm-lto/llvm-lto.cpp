@@ -12,12 +12,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
@@ -37,6 +41,16 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::init(1),
+  cl::desc("Split code generation into this many parallel partitions; with "
+           "-o, partition N is written to <filename>.N"));
+
+static cl::opt<bool>
+ListSymbolsOnly("list-symbols-only", cl::init(false),
+  cl::desc("Instead of running LTO, list the symbols and their attributes "
+           "in each input file"));
+
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::OneOrMore,
   cl::desc("<input bitcode files>"));
@@ -79,6 +93,25 @@ int main(int argc, char **argv) {
   // set up the TargetOptions for the machine
   TargetOptions Options = InitTargetOptionsFromCodeGenFlags();
 
+  if (ListSymbolsOnly) {
+    for (unsigned i = 0; i < InputFilenames.size(); ++i) {
+      std::string error;
+      OwningPtr<LTOModule> Module(
+          LTOModule::makeLTOModule(InputFilenames[i].c_str(), Options, error));
+      if (!error.empty()) {
+        errs() << argv[0] << ": error loading file '" << InputFilenames[i]
+               << "': " << error << "\n";
+        return 1;
+      }
+
+      outs() << InputFilenames[i] << ":\n";
+      for (unsigned I = 0, E = Module->getSymbolCount(); I != E; ++I)
+        outs() << format("%08x ", Module->getSymbolAttributes(I))
+               << Module->getSymbolName(I) << "\n";
+    }
+    return 0;
+  }
+
   unsigned BaseArg = 0;
 
   LTOCodeGenerator CodeGen;
@@ -130,7 +163,43 @@ int main(int argc, char **argv) {
   for (unsigned i = 0; i < KeptDSOSyms.size(); ++i)
     CodeGen.addMustPreserveSymbol(KeptDSOSyms[i].c_str());
 
-  if (!OutputFilename.empty()) {
+  if (Parallelism != 1) {
+    std::string ErrorInfo;
+    const char **Names = NULL;
+    unsigned NumNames = 0;
+    CodeGen.setCodeGenParallelism(Parallelism);
+    if (!CodeGen.compile_to_files(&Names, &NumNames, DisableOpt, DisableInline,
+                                  DisableGVNLoadPRE, ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    for (unsigned I = 0; I != NumNames; ++I) {
+      if (OutputFilename.empty()) {
+        outs() << "Wrote native object file '" << Names[I] << "'\n";
+        continue;
+      }
+
+      OwningPtr<MemoryBuffer> Buffer;
+      if (error_code EC = MemoryBuffer::getFile(Names[I], Buffer, -1, false)) {
+        errs() << argv[0] << ": error reading the file '" << Names[I]
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      sys::fs::remove(Names[I]);
+
+      std::string PartFilename = OutputFilename + "." + utostr(I);
+      raw_fd_ostream FileStream(PartFilename.c_str(), ErrorInfo,
+                                sys::fs::F_None);
+      if (!ErrorInfo.empty()) {
+        errs() << argv[0] << ": error opening the file '" << PartFilename
+               << "': " << ErrorInfo << "\n";
+        return 1;
+      }
+      FileStream << Buffer->getBuffer();
+    }
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code = CodeGen.compile(&len, DisableOpt, DisableInline,
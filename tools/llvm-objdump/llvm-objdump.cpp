@@ -21,6 +21,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCAtom.h"
 #include "llvm/MC/MCContext.h"
@@ -57,12 +58,18 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 #include <algorithm>
 #include <cctype>
 #include <cstring>
 
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#endif
+
 using namespace llvm;
 using namespace object;
 
@@ -147,6 +154,11 @@ YAMLCFG("yaml-cfg",
         cl::desc("Create a CFG and write it as a YAML MCModule."),
         cl::value_desc("yaml output file"));
 
+static cl::opt<unsigned>
+Threads("threads", cl::desc("Number of threads used to disassemble "
+                            "(0 = one per hardware thread)"),
+        cl::init(0));
+
 static StringRef ToolName;
 
 bool llvm::error(error_code EC) {
@@ -234,6 +246,10 @@ static void emitDOTFile(const char *FileName, const MCFunction &f,
 }
 
 void llvm::DumpBytes(StringRef bytes) {
+  DumpBytes(bytes, outs());
+}
+
+void llvm::DumpBytes(StringRef bytes, raw_ostream &OS) {
   static const char hex_rep[] = "0123456789abcdef";
   // FIXME: The real way to do this is to figure out the longest instruction
   //        and align to that size before printing. I'll fix this when I get
@@ -256,7 +272,7 @@ void llvm::DumpBytes(StringRef bytes) {
   }
 
   output[sizeof(output) - 1] = 0;
-  outs() << output;
+  OS << output;
 }
 
 bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
@@ -266,6 +282,114 @@ bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
   return a_addr < b_addr;
 }
 
+namespace {
+/// A relocation as it is printed under the instruction it applies to.
+struct PrintedReloc {
+  uint64_t Offset;
+  SmallString<16> Name;
+  SmallString<32> Val;
+};
+
+/// Prints the relocations of a section in address order, each one under the
+/// first instruction that ends past it.
+class RelocPrinter {
+  ArrayRef<PrintedReloc> Relocs;
+  uint64_t SectionAddr;
+  unsigned Next;
+
+public:
+  RelocPrinter(ArrayRef<PrintedReloc> Relocs, uint64_t SectionAddr)
+      : Relocs(Relocs), SectionAddr(SectionAddr), Next(0) {}
+
+  /// printBefore - Print the relocations below \p End that have not been
+  /// printed yet.
+  void printBefore(raw_ostream &OS, uint64_t End) {
+    for (; Next != Relocs.size() && Relocs[Next].Offset < End; ++Next)
+      OS << format("\t\t\t%8" PRIx64 ": ", SectionAddr + Relocs[Next].Offset)
+         << Relocs[Next].Name << "\t" << Relocs[Next].Val << "\n";
+  }
+};
+
+/// The part of a text section from one symbol up to the next, which is
+/// disassembled on its own.
+struct DisassemblyChunk {
+  StringRef Name;
+  uint64_t Start;
+  uint64_t End;
+  /// The disassembly, when it is buffered rather than printed directly.
+  std::string Text;
+  /// The offset in Text after each instruction, paired with the section
+  /// offset the instruction ends at, so that the relocations can be printed
+  /// in between once the chunk's turn comes.
+  std::vector<std::pair<size_t, uint64_t> > Breaks;
+  unsigned NumInvalid;
+  /// Set by the worker once Text is complete.
+  bool Done;
+};
+}
+
+/// DisassembleChunk - Disassemble \p Chunk to \p OS.  With a RelocPrinter
+/// the relocations and warnings are printed as they come up; without one
+/// they are recorded in \p Chunk for PrintChunk.
+static void DisassembleChunk(DisassemblyChunk &Chunk, MCDisassembler &DisAsm,
+                             MCInstPrinter &IP, StringRef Bytes,
+                             uint64_t SectionAddr, raw_ostream &OS,
+                             RelocPrinter *Relocs, raw_ostream &DebugOut) {
+  SmallString<40> Comments;
+  raw_svector_ostream CommentStream(Comments);
+  StringRefMemoryObject memoryObject(Bytes, SectionAddr);
+  uint64_t Size;
+  Chunk.NumInvalid = 0;
+
+  OS << '\n' << Chunk.Name << ":\n";
+  for (uint64_t Index = Chunk.Start; Index < Chunk.End; Index += Size) {
+    MCInst Inst;
+
+    if (DisAsm.getInstruction(Inst, Size, memoryObject, SectionAddr + Index,
+                              DebugOut, CommentStream)) {
+      OS << format("%8" PRIx64 ":", SectionAddr + Index);
+      if (!NoShowRawInsn) {
+        OS << "\t";
+        DumpBytes(StringRef(Bytes.data() + Index, Size), OS);
+      }
+      IP.printInst(&Inst, OS, "");
+      OS << CommentStream.str();
+      Comments.clear();
+      OS << "\n";
+    } else {
+      if (Relocs)
+        errs() << ToolName << ": warning: invalid instruction encoding\n";
+      else
+        ++Chunk.NumInvalid;
+      if (Size == 0)
+        Size = 1; // skip illegible bytes
+    }
+
+    // Print relocation for instruction.
+    if (Relocs)
+      Relocs->printBefore(OS, Index + Size);
+    else
+      Chunk.Breaks.push_back(std::make_pair(OS.tell(), Index + Size));
+  }
+}
+
+#if LLVM_ENABLE_THREADS
+/// PrintChunk - Print a chunk that DisassembleChunk buffered, with the
+/// relocations where a direct run would have put them.
+static void PrintChunk(const DisassemblyChunk &Chunk, RelocPrinter &Relocs) {
+  for (unsigned i = 0; i != Chunk.NumInvalid; ++i)
+    errs() << ToolName << ": warning: invalid instruction encoding\n";
+  StringRef Text = Chunk.Text;
+  size_t Pos = 0;
+  for (unsigned i = 0, e = Chunk.Breaks.size(); i != e; ++i) {
+    outs() << Text.slice(Pos, Chunk.Breaks[i].first);
+    Relocs.printBefore(outs(), Chunk.Breaks[i].second);
+    Pos = Chunk.Breaks[i].first;
+  }
+  outs() << Text.substr(Pos);
+}
+#endif
+
 static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   const Target *TheTarget = getTarget(Obj);
   // getTarget() will have already issued a diagnostic if necessary, so
@@ -469,20 +593,28 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     if (Symbols.empty())
       Symbols.push_back(std::make_pair(0, name));
 
-
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
-
     StringRef Bytes;
     if (error(I->getContents(Bytes)))
       break;
-    StringRefMemoryObject memoryObject(Bytes, SectionAddr);
-    uint64_t Size;
-    uint64_t Index;
 
-    std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
-    std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
-    // Disassemble symbol by symbol.
+    // Resolve the relocations up front, so that the workers below only read
+    // them.
+    std::vector<PrintedReloc> Relocs;
+    for (std::vector<RelocationRef>::const_iterator RI = Rels.begin(),
+                                                    RE = Rels.end();
+         RI != RE; ++RI) {
+      bool hidden = false;
+      if (error(RI->getHidden(hidden)) || hidden)
+        continue;
+      PrintedReloc R;
+      if (error(RI->getOffset(R.Offset)) || error(RI->getTypeName(R.Name)) ||
+          error(RI->getValueString(R.Val)))
+        continue;
+      Relocs.push_back(R);
+    }
+
+    // Split the section at the symbols.
+    std::vector<DisassemblyChunk> Chunks;
     for (unsigned si = 0, se = Symbols.size(); si != se; ++si) {
       uint64_t Start = Symbols[si].first;
       uint64_t End;
@@ -497,60 +629,96 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         // This symbol has the same address as the next symbol. Skip it.
         continue;
 
-      outs() << '\n' << Symbols[si].second << ":\n";
+      DisassemblyChunk Chunk;
+      Chunk.Name = Symbols[si].second;
+      Chunk.Start = Start;
+      Chunk.End = End;
+      Chunk.Done = false;
+      Chunks.push_back(Chunk);
+    }
+    unsigned NumChunks = Chunks.size();
+    RelocPrinter Printer(Relocs, SectionAddr);
 
 #ifndef NDEBUG
-      raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
+    raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
 #else
-      raw_ostream &DebugOut = nulls();
+    raw_ostream &DebugOut = nulls();
 #endif
 
-      for (Index = Start; Index < End; Index += Size) {
-        MCInst Inst;
+    // The symbolizer keeps state in a shared MCContext, so it only runs on
+    // this thread, and so does anything writing to the debug stream.
+    unsigned NumThreads = Threads ? Threads : ThreadPool::getDefaultThreadCount();
+#ifndef NDEBUG
+    if (DebugFlag)
+      NumThreads = 1;
+#endif
+#if !LLVM_ENABLE_THREADS
+    NumThreads = 1;
+#endif
+    if (Symbolize)
+      NumThreads = 1;
+    NumThreads = std::min(NumThreads, NumChunks);
+
+    if (NumThreads <= 1) {
+      for (unsigned ci = 0; ci != NumChunks; ++ci)
+        DisassembleChunk(Chunks[ci], *DisAsm, *IP, Bytes, SectionAddr, outs(),
+                         &Printer, DebugOut);
+      continue;
+    }
 
-        if (DisAsm->getInstruction(Inst, Size, memoryObject,
-                                   SectionAddr + Index,
-                                   DebugOut, CommentStream)) {
-          outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-          if (!NoShowRawInsn) {
-            outs() << "\t";
-            DumpBytes(StringRef(Bytes.data() + Index, Size));
+#if LLVM_ENABLE_THREADS
+    // Otherwise workers, each with a disassembler and printer of its own,
+    // buffer the chunks while this thread prints them in order as soon as
+    // they are done.  The workers stay at most MaxAhead chunks ahead of the
+    // printing, which bounds the memory held in buffers.
+    std::mutex Lock;
+    std::condition_variable Progress;
+    unsigned NextChunk = 0;
+    unsigned NumPrinted = 0;
+    const unsigned MaxAhead = NumThreads * 4;
+    ThreadPool Pool(NumThreads);
+    for (unsigned i = 0; i != NumThreads; ++i)
+      Pool.async([&] {
+        OwningPtr<MCDisassembler> D(TheTarget->createMCDisassembler(*STI));
+        OwningPtr<MCInstPrinter> P(TheTarget->createMCInstPrinter(
+            AsmPrinterVariant, *AsmInfo, *MII, *MRI, *STI));
+        while (true) {
+          unsigned ci;
+          {
+            std::unique_lock<std::mutex> Guard(Lock);
+            Progress.wait(Guard, [&] {
+              return NextChunk == NumChunks ||
+                     NextChunk < NumPrinted + MaxAhead;
+            });
+            if (NextChunk == NumChunks)
+              break;
+            ci = NextChunk++;
           }
-          IP->printInst(&Inst, outs(), "");
-          outs() << CommentStream.str();
-          Comments.clear();
-          outs() << "\n";
-        } else {
-          errs() << ToolName << ": warning: invalid instruction encoding\n";
-          if (Size == 0)
-            Size = 1; // skip illegible bytes
+          {
+            raw_string_ostream OS(Chunks[ci].Text);
+            DisassembleChunk(Chunks[ci], *D, *P, Bytes, SectionAddr, OS, 0,
+                             nulls());
+          }
+          std::lock_guard<std::mutex> Guard(Lock);
+          Chunks[ci].Done = true;
+          Progress.notify_all();
         }
+      });
 
-        // Print relocation for instruction.
-        while (rel_cur != rel_end) {
-          bool hidden = false;
-          uint64_t addr;
-          SmallString<16> name;
-          SmallString<32> val;
-
-          // If this relocation is hidden, skip it.
-          if (error(rel_cur->getHidden(hidden))) goto skip_print_rel;
-          if (hidden) goto skip_print_rel;
-
-          if (error(rel_cur->getOffset(addr))) goto skip_print_rel;
-          // Stop when rel_cur's address is past the current instruction.
-          if (addr >= Index + Size) break;
-          if (error(rel_cur->getTypeName(name))) goto skip_print_rel;
-          if (error(rel_cur->getValueString(val))) goto skip_print_rel;
-
-          outs() << format("\t\t\t%8" PRIx64 ": ", SectionAddr + addr) << name
-                 << "\t" << val << "\n";
-
-        skip_print_rel:
-          ++rel_cur;
-        }
+    for (unsigned ci = 0; ci != NumChunks; ++ci) {
+      {
+        std::unique_lock<std::mutex> Guard(Lock);
+        Progress.wait(Guard, [&] { return Chunks[ci].Done; });
       }
+      PrintChunk(Chunks[ci], Printer);
+      std::string().swap(Chunks[ci].Text);
+      std::vector<std::pair<size_t, uint64_t> >().swap(Chunks[ci].Breaks);
+      std::lock_guard<std::mutex> Guard(Lock);
+      ++NumPrinted;
+      Progress.notify_all();
     }
+    Pool.wait();
+#endif
   }
 }
 
@@ -7,25 +7,45 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// llvm-profdata merges .profdata files.
+// llvm-profdata merges .profdata files and sample profiles.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ProfileData/SampleProfReader.h"
+#include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace llvm;
 
-static cl::opt<std::string> Filename1(cl::Positional, cl::Required,
-                                      cl::desc("file1"));
-static cl::opt<std::string> Filename2(cl::Positional, cl::Required,
-                                      cl::desc("file2"));
+static cl::list<std::string> InputFilenames(cl::Positional, cl::ZeroOrMore,
+                                            cl::desc("<filenames...>"));
+
+static cl::list<std::string>
+WeightedInputFilenames("weighted-input", cl::value_desc("weight,filename"),
+                       cl::desc("Input file whose counts are multiplied by "
+                                "weight"));
+
+static cl::opt<std::string>
+InputFilenamesFile("input-files", cl::value_desc("filename"),
+                   cl::desc("File listing the input files, one per line, "
+                            "each optionally preceded by 'weight,'"));
+
+static cl::opt<unsigned>
+Threads("threads", cl::desc("Number of threads used to read the input files "
+                            "(0 = one per hardware thread)"),
+        cl::init(0));
 
 static cl::opt<std::string> OutputFilename("output", cl::value_desc("output"),
                                            cl::init("-"),
@@ -33,6 +53,12 @@ static cl::opt<std::string> OutputFilename("output", cl::value_desc("output"),
 static cl::alias OutputFilenameA("o", cl::desc("Alias for --output"),
                                  cl::aliasopt(OutputFilename));
 
+static cl::opt<bool> SampleProfiles("sample",
+                                    cl::desc("Merge sample profiles"));
+
+static cl::opt<bool> BinaryOutput("binary",
+                                  cl::desc("Write a binary sample profile"));
+
 static bool readLine(const char *&Start, const char *End, StringRef &S) {
   if (Start == End)
     return false;
@@ -92,87 +118,272 @@ static void exitWithError(const std::string &Message,
   ::exit(1);
 }
 
-//===----------------------------------------------------------------------===//
-int main(int argc, char **argv) {
-  // Print a stack trace if we signal out.
-  sys::PrintStackTraceOnErrorSignal();
-  PrettyStackTraceProgram X(argc, argv);
-  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+namespace {
+/// WeightedFile - An input file and the weight of its counts.
+struct WeightedFile {
+  std::string Filename;
+  uint64_t Weight;
 
-  cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
+  WeightedFile(StringRef Filename, uint64_t Weight)
+      : Filename(Filename), Weight(Weight) {}
+};
+}
 
-  OwningPtr<MemoryBuffer> File1;
-  OwningPtr<MemoryBuffer> File2;
-  if (error_code ec = MemoryBuffer::getFile(Filename1, File1))
-    exitWithError(ec.message(), Filename1);
-  if (error_code ec = MemoryBuffer::getFile(Filename2, File2))
-    exitWithError(ec.message(), Filename2);
+/// parseWeightedFile - Parse "weight,filename", or a bare filename, which
+/// gets a weight of one.
+static WeightedFile parseWeightedFile(StringRef Arg) {
+  std::pair<StringRef, StringRef> Split = Arg.split(',');
+  if (Split.second.empty())
+    return WeightedFile(Arg, 1);
+  uint64_t Weight;
+  if (!getNumber(Split.first, Weight) || Split.first.empty() || Weight == 0)
+    exitWithError("invalid weight '" + Split.first.str() + "'", Arg);
+  return WeightedFile(Split.second, Weight);
+}
 
-  if (OutputFilename.empty())
-    OutputFilename = "-";
+/// collectInputs - Gather the input files from the command line and the file
+/// list, in that order.
+static void collectInputs(std::vector<WeightedFile> &Inputs) {
+  for (unsigned I = 0, E = InputFilenames.size(); I != E; ++I)
+    Inputs.push_back(WeightedFile(InputFilenames[I], 1));
+  for (unsigned I = 0, E = WeightedInputFilenames.size(); I != E; ++I)
+    Inputs.push_back(parseWeightedFile(WeightedInputFilenames[I]));
 
-  std::string ErrorInfo;
-  raw_fd_ostream Output(OutputFilename.data(), ErrorInfo, sys::fs::F_Text);
-  if (!ErrorInfo.empty())
-    exitWithError(ErrorInfo, OutputFilename);
+  if (InputFilenamesFile.empty())
+    return;
+  OwningPtr<MemoryBuffer> List;
+  if (error_code ec = MemoryBuffer::getFile(InputFilenamesFile, List))
+    exitWithError(ec.message(), InputFilenamesFile);
+  const char *P = List->getBufferStart();
+  const char *End = List->getBufferEnd();
+  StringRef Line;
+  while (readLine(P, End, Line)) {
+    Line = Line.trim();
+    if (!Line.empty() && Line[0] != '#')
+      Inputs.push_back(parseWeightedFile(Line));
+  }
+}
 
-  const char *Start1 = File1->getBufferStart();
-  const char *Start2 = File2->getBufferStart();
-  const char *End1 = File1->getBufferEnd();
-  const char *End2 = File2->getBufferEnd();
-  const char *P1 = Start1;
-  const char *P2 = Start2;
+/// mergeSampleProfiles - Sum the samples of every function over \p Inputs,
+/// which may be text or binary sample profiles, into one profile.
+static void mergeSampleProfiles(const std::vector<WeightedFile> &Inputs,
+                                raw_ostream &Output) {
+  SampleProfileWriter Writer;
+  for (unsigned I = 0, E = Inputs.size(); I != E; ++I) {
+    // Sample counts are 32 bits wide, and so are their weights.
+    if (Inputs[I].Weight > UINT32_MAX)
+      exitWithError("weight " + utostr(Inputs[I].Weight) +
+                        " is too large for a sample profile",
+                    Inputs[I].Filename);
+    OwningPtr<SampleProfileReader> Reader(
+        SampleProfileReader::create(Inputs[I].Filename));
+    std::vector<StringRef> Names;
+    Reader->getFunctionNames(Names);
+    for (unsigned N = 0, NE = Names.size(); N != NE; ++N) {
+      FunctionSamples FS;
+      Reader->getSamples(Names[N], FS);
+      if (!Writer.addFunctionSamples(Names[N], FS, Inputs[I].Weight))
+        exitWithError("counter overflow", Inputs[I].Filename);
+    }
+  }
+  Writer.write(Output, BinaryOutput ? SampleProfileWriter::Binary
+                                    : SampleProfileWriter::Text);
+}
 
-  StringRef Line1, Line2;
-  int64_t Num = 0;
-  while (readLine(P1, End1, Line1)) {
-    ++Num;
-    if (!readLine(P2, End2, Line2))
-      exitWithError("truncated file", Filename2, Num);
+namespace {
+/// FunctionCounts - The counters of one function in an input file.
+struct FunctionCounts {
+  /// Name - The name of the function, pointing into the input buffer.
+  StringRef Name;
+  /// Line - The line of the function header, for diagnostics.
+  int64_t Line;
+  std::vector<uint64_t> Counts;
+};
 
-    std::vector<StringRef> Words1, Words2;
-    if (splitWords(Line1, Words1) != splitWords(Line2, Words2))
-      exitWithError("data mismatch", Filename2, Num);
+/// ParsedProfile - The contents of an instrumentation profile, or the first
+/// error found in it.
+struct ParsedProfile {
+  OwningPtr<MemoryBuffer> Buffer;
+  std::vector<FunctionCounts> Functions;
+  std::string Error;
+  int64_t ErrorLine;
 
-    if (Words1.size() > 2)
-      exitWithError("invalid data", Filename1, Num);
+  ParsedProfile() : ErrorLine(-1) {}
 
-    if (Words1.empty()) {
-      Output << "\n";
+  void setError(const std::string &Message, int64_t Line = -1) {
+    Error = Message;
+    ErrorLine = Line;
+  }
+};
+
+/// MergedFunction - The counters accumulated for one function.
+struct MergedFunction {
+  /// Counts - The sum of the weighted counters.  Their number stands in for
+  /// a structural hash of the function: inputs that disagree on it were
+  /// not produced by the same code.
+  std::vector<uint64_t> Counts;
+};
+}
+
+/// parseInstrProfile - Read the instrumentation profile \p Filename.  Each
+/// function has a header line with its name and number of counters, followed
+/// by one line per counter.  Blank lines may separate functions.
+static void parseInstrProfile(const std::string &Filename,
+                              ParsedProfile &Result) {
+  if (error_code ec = MemoryBuffer::getFile(Filename, Result.Buffer))
+    return Result.setError(ec.message());
+
+  const char *P = Result.Buffer->getBufferStart();
+  const char *End = Result.Buffer->getBufferEnd();
+  StringRef Line;
+  std::vector<StringRef> Words;
+  int64_t Num = 0;
+  while (readLine(P, End, Line)) {
+    ++Num;
+    if (splitWords(Line, Words) == 0)
       continue;
+    if (Words.size() != 2)
+      return Result.setError("invalid data", Num);
+
+    uint64_t NumCounts;
+    if (!getNumber(Words[1], NumCounts))
+      return Result.setError("bad function count", Num);
+    Result.Functions.push_back(FunctionCounts());
+    FunctionCounts &FC = Result.Functions.back();
+    FC.Name = Words[0];
+    FC.Line = Num;
+    FC.Counts.reserve(std::min<uint64_t>(NumCounts, End - P));
+
+    for (uint64_t I = 0; I != NumCounts; ++I) {
+      if (!readLine(P, End, Line))
+        return Result.setError("truncated file", Num + 1);
+      ++Num;
+      uint64_t Count;
+      if (splitWords(Line, Words) != 1 || !getNumber(Words[0], Count))
+        return Result.setError("invalid counter", Num);
+      FC.Counts.push_back(Count);
     }
+  }
+}
 
-    if (Words1.size() == 2) {
-      if (Words1[0] != Words2[0])
-        exitWithError("function name mismatch", Filename2, Num);
+/// addCounts - Add \p N times \p Weight to \p Sum.  Returns false on
+/// overflow.
+static bool addCounts(uint64_t &Sum, uint64_t N, uint64_t Weight) {
+  if (Weight != 1 && N > UINT64_MAX / Weight)
+    return false;
+  N *= Weight;
+  if (Sum + N < Sum)
+    return false;
+  Sum += N;
+  return true;
+}
 
-      uint64_t N1, N2;
-      if (!getNumber(Words1[1], N1))
-        exitWithError("bad function count", Filename1, Num);
-      if (!getNumber(Words2[1], N2))
-        exitWithError("bad function count", Filename2, Num);
+/// mergeInstrProfiles - Sum the counters of every function over \p Inputs.
+///
+/// Workers parse the inputs a batch at a time, and the main thread folds
+/// each batch into the result in input order, so only one batch of inputs
+/// is in memory at once and errors are reported for the first bad input.
+/// Functions are written in the order they first appear in.
+static void mergeInstrProfiles(const std::vector<WeightedFile> &Inputs,
+                               raw_ostream &Output) {
+  StringMap<MergedFunction> Functions;
+  std::vector<StringMapEntry<MergedFunction> *> Order;
 
-      if (N1 != N2)
-        exitWithError("function count mismatch", Filename2, Num);
+  unsigned NumThreads = Threads ? Threads : ThreadPool::getDefaultThreadCount();
+  unsigned NumInputs = Inputs.size();
+  NumThreads = std::max(1u, std::min(NumThreads, NumInputs));
+  OwningPtr<ThreadPool> Pool;
+  if (NumThreads > 1)
+    Pool.reset(new ThreadPool(NumThreads));
 
-      Output << Line1 << "\n";
-      continue;
+  unsigned BatchSize = NumThreads * 4;
+  for (unsigned Begin = 0; Begin < NumInputs; Begin += BatchSize) {
+    unsigned BatchEnd = std::min(NumInputs, Begin + BatchSize);
+    std::vector<ParsedProfile> Batch(BatchEnd - Begin);
+    volatile sys::cas_flag NextInput = 0;
+    auto ParseInputs = [&] {
+      while (true) {
+        unsigned I = sys::AtomicIncrement(&NextInput) - 1;
+        if (I >= Batch.size())
+          break;
+        parseInstrProfile(Inputs[Begin + I].Filename, Batch[I]);
+      }
+    };
+    if (Pool) {
+      for (unsigned I = 0; I != NumThreads; ++I)
+        Pool->async(ParseInputs);
+      Pool->wait();
+    } else {
+      ParseInputs();
     }
 
-    uint64_t N1, N2;
-    if (!getNumber(Words1[0], N1))
-      exitWithError("invalid counter", Filename1, Num);
-    if (!getNumber(Words2[0], N2))
-      exitWithError("invalid counter", Filename2, Num);
+    for (unsigned I = 0, E = Batch.size(); I != E; ++I) {
+      const WeightedFile &Input = Inputs[Begin + I];
+      ParsedProfile &Profile = Batch[I];
+      if (!Profile.Error.empty())
+        exitWithError(Profile.Error, Input.Filename, Profile.ErrorLine);
 
-    uint64_t Sum = N1 + N2;
-    if (Sum < N1)
-      exitWithError("counter overflow", Filename2, Num);
+      for (unsigned F = 0, FE = Profile.Functions.size(); F != FE; ++F) {
+        const FunctionCounts &FC = Profile.Functions[F];
+        unsigned NumFunctions = Functions.size();
+        StringMapEntry<MergedFunction> &Entry =
+            Functions.GetOrCreateValue(FC.Name);
+        std::vector<uint64_t> &Counts = Entry.getValue().Counts;
+        if (Functions.size() != NumFunctions) {
+          Order.push_back(&Entry);
+          Counts.resize(FC.Counts.size());
+        } else if (Counts.size() != FC.Counts.size()) {
+          exitWithError("function count mismatch", Input.Filename, FC.Line);
+        }
+        for (unsigned C = 0, CE = Counts.size(); C != CE; ++C)
+          if (!addCounts(Counts[C], FC.Counts[C], Input.Weight))
+            exitWithError("counter overflow", Input.Filename, FC.Line + C + 1);
+      }
+    }
+  }
 
-    Output << N1 + N2 << "\n";
+  for (unsigned I = 0, E = Order.size(); I != E; ++I) {
+    if (I)
+      Output << "\n";
+    const std::vector<uint64_t> &Counts = Order[I]->getValue().Counts;
+    Output << Order[I]->getKey() << " " << Counts.size() << "\n";
+    for (unsigned C = 0, CE = Counts.size(); C != CE; ++C)
+      Output << Counts[C] << "\n";
   }
-  if (readLine(P2, End2, Line2))
-    exitWithError("truncated file", Filename1, Num + 1);
+}
+
+//===----------------------------------------------------------------------===//
+int main(int argc, char **argv) {
+  // Print a stack trace if we signal out.
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y; // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
+
+  std::vector<WeightedFile> Inputs;
+  collectInputs(Inputs);
+  if (Inputs.empty()) {
+    errs() << "error: no input files\n";
+    return 1;
+  }
+  if (BinaryOutput && !SampleProfiles) {
+    errs() << "error: -binary only applies to sample profiles\n";
+    return 1;
+  }
+
+  if (OutputFilename.empty())
+    OutputFilename = "-";
+
+  std::string ErrorInfo;
+  raw_fd_ostream Output(OutputFilename.data(), ErrorInfo,
+                        BinaryOutput ? sys::fs::F_None : sys::fs::F_Text);
+  if (!ErrorInfo.empty())
+    exitWithError(ErrorInfo, OutputFilename);
 
+  if (SampleProfiles)
+    mergeSampleProfiles(Inputs, Output);
+  else
+    mergeInstrProfiles(Inputs, Output);
   return 0;
 }
@@ -16,12 +16,15 @@
 #include "llvm/Config/config.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/MachO.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -52,7 +55,7 @@ static void patchFunctionNameInDILineInfo(const std::string &NewFunctionName,
 }
 
 ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-    : Module(Obj), DebugInfoContext(DICtx) {
+    : Module(Obj), DebugInfoContext(DICtx), Preloaded(false) {
   for (symbol_iterator si = Module->symbol_begin(), se = Module->symbol_end();
        si != se; ++si) {
     addSymbol(si);
@@ -66,6 +69,27 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
       addSymbol(si);
     }
   }
+  sortSymbols(Functions);
+  sortSymbols(Objects);
+}
+
+void ModuleInfo::sortSymbols(SymbolVectorTy &Symbols) {
+  // FIXME: If a function has alias, there are two entries in symbol table
+  // with same address size. Make sure we choose the correct one.
+  std::stable_sort(Symbols.begin(), Symbols.end());
+  Symbols.erase(std::unique(Symbols.begin(), Symbols.end(),
+                            [](const SymbolDesc &LHS, const SymbolDesc &RHS) {
+                              return LHS.Addr == RHS.Addr;
+                            }),
+                Symbols.end());
+}
+
+void ModuleInfo::preload() {
+  if (Preloaded)
+    return;
+  if (DebugInfoContext)
+    DebugInfoContext->preload(0);
+  Preloaded = true;
 }
 
 void ModuleInfo::addSymbol(const symbol_iterator &Sym) {
@@ -93,29 +117,29 @@ void ModuleInfo::addSymbol(const symbol_iterator &Sym) {
   // Mach-O symbol table names have leading underscore, skip it.
   if (Module->isMachO() && SymbolName.size() > 0 && SymbolName[0] == '_')
     SymbolName = SymbolName.drop_front();
-  // FIXME: If a function has alias, there are two entries in symbol table
-  // with same address size. Make sure we choose the correct one.
-  SymbolMapTy &M = SymbolType == SymbolRef::ST_Function ? Functions : Objects;
-  SymbolDesc SD = { SymbolAddress, SymbolSize };
-  M.insert(std::make_pair(SD, SymbolName));
+  SymbolVectorTy &M =
+      SymbolType == SymbolRef::ST_Function ? Functions : Objects;
+  SymbolDesc SD = { SymbolAddress, SymbolSize, SymbolName };
+  M.push_back(SD);
 }
 
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
                                         std::string &Name, uint64_t &Addr,
                                         uint64_t &Size) const {
-  const SymbolMapTy &M = Type == SymbolRef::ST_Function ? Functions : Objects;
+  const SymbolVectorTy &M =
+      Type == SymbolRef::ST_Function ? Functions : Objects;
   if (M.empty())
     return false;
-  SymbolDesc SD = { Address, Address };
-  SymbolMapTy::const_iterator it = M.upper_bound(SD);
+  SymbolDesc SD = { Address, Address, StringRef() };
+  SymbolVectorTy::const_iterator it = std::upper_bound(M.begin(), M.end(), SD);
   if (it == M.begin())
     return false;
   --it;
-  if (it->first.Size != 0 && it->first.Addr + it->first.Size <= Address)
+  if (it->Size != 0 && it->Addr + it->Size <= Address)
     return false;
-  Name = it->second.str();
-  Addr = it->first.Addr;
-  Size = it->first.Size;
+  Name = it->Name.str();
+  Addr = it->Addr;
+  Size = it->Size;
   return true;
 }
 
@@ -179,7 +203,92 @@ const char LLVMSymbolizer::kBadString[] = "??";
 
 std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                                           uint64_t ModuleOffset) {
-  ModuleInfo *Info = getOrCreateModuleInfo(ModuleName);
+  return symbolizeCode(getOrCreateModuleInfo(ModuleName), ModuleOffset);
+}
+
+std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
+                                          uint64_t ModuleOffset) {
+  ModuleInfo *Info = 0;
+  if (Opts.UseSymbolTable)
+    Info = getOrCreateModuleInfo(ModuleName);
+  return symbolizeData(Info, ModuleOffset);
+}
+
+namespace {
+struct RequestOrder {
+  const std::vector<LLVMSymbolizer::Request> &Requests;
+  const std::vector<ModuleInfo *> &Infos;
+
+  RequestOrder(const std::vector<LLVMSymbolizer::Request> &Requests,
+               const std::vector<ModuleInfo *> &Infos)
+      : Requests(Requests), Infos(Infos) {}
+
+  bool operator()(unsigned LHS, unsigned RHS) const {
+    if (Infos[LHS] != Infos[RHS])
+      return Infos[LHS] < Infos[RHS];
+    return Requests[LHS].ModuleOffset < Requests[RHS].ModuleOffset;
+  }
+};
+}
+
+void LLVMSymbolizer::symbolizeBatch(const std::vector<Request> &Requests,
+                                    std::vector<std::string> &Results,
+                                    unsigned NumThreads) {
+  // Neither the module cache nor lazily parsed debug info is thread-safe, so
+  // every module is loaded and fully indexed before any lookup is made.
+  unsigned NumRequests = Requests.size();
+  std::vector<ModuleInfo *> Infos(NumRequests);
+  for (unsigned i = 0; i != NumRequests; ++i) {
+    if (Requests[i].IsData && !Opts.UseSymbolTable)
+      continue;
+    if (ModuleInfo *Info = getOrCreateModuleInfo(Requests[i].ModuleName)) {
+      Info->preload();
+      Infos[i] = Info;
+    }
+  }
+
+  // Nearby addresses in the same module share most of the data a lookup
+  // touches, so hand them out together.
+  std::vector<unsigned> Order(NumRequests);
+  for (unsigned i = 0; i != NumRequests; ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(), RequestOrder(Requests, Infos));
+
+  Results.clear();
+  Results.resize(NumRequests);
+  const unsigned ChunkSize = 64;
+  unsigned NumChunks = (NumRequests + ChunkSize - 1) / ChunkSize;
+  volatile sys::cas_flag NextChunk = 0;
+  auto Symbolize = [&] {
+    while (true) {
+      unsigned Chunk = sys::AtomicIncrement(&NextChunk) - 1;
+      if (Chunk >= NumChunks)
+        break;
+      unsigned End = std::min(NumRequests, (Chunk + 1) * ChunkSize);
+      for (unsigned i = Chunk * ChunkSize; i != End; ++i) {
+        const Request &R = Requests[Order[i]];
+        const ModuleInfo *Info = Infos[Order[i]];
+        Results[Order[i]] = R.IsData ? symbolizeData(Info, R.ModuleOffset)
+                                     : symbolizeCode(Info, R.ModuleOffset);
+      }
+    }
+  };
+
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  NumThreads = std::min(NumThreads, NumChunks);
+  if (NumThreads > 1) {
+    ThreadPool Pool(NumThreads);
+    for (unsigned i = 0; i != NumThreads; ++i)
+      Pool.async(Symbolize);
+    Pool.wait();
+  } else {
+    Symbolize();
+  }
+}
+
+std::string LLVMSymbolizer::symbolizeCode(const ModuleInfo *Info,
+                                          uint64_t ModuleOffset) const {
   if (Info == 0)
     return printDILineInfo(DILineInfo());
   if (Opts.PrintInlining) {
@@ -198,16 +307,14 @@ std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   return printDILineInfo(LineInfo);
 }
 
-std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
-                                          uint64_t ModuleOffset) {
+std::string LLVMSymbolizer::symbolizeData(const ModuleInfo *Info,
+                                          uint64_t ModuleOffset) const {
   std::string Name = kBadString;
   uint64_t Start = 0;
   uint64_t Size = 0;
-  if (Opts.UseSymbolTable) {
-    if (ModuleInfo *Info = getOrCreateModuleInfo(ModuleName)) {
-      if (Info->symbolizeData(ModuleOffset, Name, Start, Size) && Opts.Demangle)
-        Name = DemangleName(Name);
-    }
+  if (Opts.UseSymbolTable && Info) {
+    if (Info->symbolizeData(ModuleOffset, Name, Start, Size) && Opts.Demangle)
+      Name = DemangleName(Name);
   }
   std::stringstream ss;
   ss << Name << "\n" << Start << " " << Size << "\n";
@@ -401,6 +508,8 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   DIContext *Context = DIContext::getDWARFContext(DbgObj);
   assert(Context);
   ModuleInfo *Info = new ModuleInfo(Obj, Context);
+  if (Opts.Preload)
+    Info->preload();
   Modules.insert(make_pair(ModuleName, Info));
   return Info;
 }
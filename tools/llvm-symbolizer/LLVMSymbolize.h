@@ -21,6 +21,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include <map>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -37,12 +38,13 @@ public:
     bool PrintFunctions : 1;
     bool PrintInlining : 1;
     bool Demangle : 1;
+    bool Preload : 1;
     std::string DefaultArch;
     Options(bool UseSymbolTable = true, bool PrintFunctions = true,
             bool PrintInlining = true, bool Demangle = true,
-            std::string DefaultArch = "")
+            std::string DefaultArch = "", bool Preload = false)
         : UseSymbolTable(UseSymbolTable), PrintFunctions(PrintFunctions),
-          PrintInlining(PrintInlining), Demangle(Demangle),
+          PrintInlining(PrintInlining), Demangle(Demangle), Preload(Preload),
           DefaultArch(DefaultArch) {
     }
   };
@@ -58,6 +60,18 @@ public:
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+
+  struct Request {
+    std::string ModuleName;
+    uint64_t ModuleOffset;
+    bool IsData;
+  };
+  // Symbolizes all of Requests on NumThreads threads (0 means one per
+  // hardware thread) and returns the results in the same order. The modules
+  // are loaded and their debug info indexed first; the lookups are then
+  // made in parallel, grouped by module and sorted by address.
+  void symbolizeBatch(const std::vector<Request> &Requests,
+                      std::vector<std::string> &Results, unsigned NumThreads);
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
@@ -71,6 +85,10 @@ private:
   ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName);
 
   std::string printDILineInfo(DILineInfo LineInfo) const;
+  std::string symbolizeCode(const ModuleInfo *Info,
+                            uint64_t ModuleOffset) const;
+  std::string symbolizeData(const ModuleInfo *Info,
+                            uint64_t ModuleOffset) const;
 
   // Owns all the parsed binaries and object files.
   SmallVector<Binary*, 4> ParsedBinariesAndObjects;
@@ -98,6 +116,10 @@ public:
   bool symbolizeData(uint64_t ModuleOffset, std::string &Name, uint64_t &Start,
                      uint64_t &Size) const;
 
+  // Parses and indexes all debug info, after which the lookups above do not
+  // modify the module and may be made from several threads at once.
+  void preload();
+
 private:
   bool getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
                               std::string &Name, uint64_t &Addr,
@@ -105,19 +127,24 @@ private:
   void addSymbol(const symbol_iterator &Sym);
   ObjectFile *Module;
   OwningPtr<DIContext> DebugInfoContext;
+  bool Preloaded;
 
   struct SymbolDesc {
     uint64_t Addr;
     // If size is 0, assume that symbol occupies the whole memory range up to
     // the following symbol.
     uint64_t Size;
+    StringRef Name;
     friend bool operator<(const SymbolDesc &s1, const SymbolDesc &s2) {
       return s1.Addr < s2.Addr;
     }
   };
-  typedef std::map<SymbolDesc, StringRef> SymbolMapTy;
-  SymbolMapTy Functions;
-  SymbolMapTy Objects;
+  // Symbols sorted by address, with only the first symbol seen at any given
+  // address.
+  typedef std::vector<SymbolDesc> SymbolVectorTy;
+  static void sortSymbols(SymbolVectorTy &Symbols);
+  SymbolVectorTy Functions;
+  SymbolVectorTy Objects;
 };
 
 } // namespace symbolize
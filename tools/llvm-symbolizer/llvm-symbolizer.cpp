@@ -51,23 +51,36 @@ static cl::opt<std::string> ClDefaultArch("default-arch", cl::init(""),
                                           cl::desc("Default architecture "
                                                    "(for multi-arch objects)"));
 
+static cl::opt<bool>
+ClPreload("preload", cl::init(false),
+          cl::desc("Parse and index all debug information of a module when "
+                   "it is first used"));
+
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read addresses in batches, each ended by an empty line or "
+                 "the end of input, and symbolize each batch in parallel"));
+
+static cl::opt<unsigned>
+ClThreads("threads", cl::init(0),
+          cl::desc("Number of threads used by -batch "
+                   "(0 = one per hardware thread)"));
+
 static cl::opt<std::string>
 ClBinaryName("obj", cl::init(""),
              cl::desc("Path to object file to be symbolized (if not provided, "
                       "object file should be specified for each input line)"));
 
-static bool parseCommand(bool &IsData, std::string &ModuleName,
-                         uint64_t &ModuleOffset) {
+static const int kMaxInputStringLength = 1024;
+
+static bool parseCommand(const char *InputString, bool &IsData,
+                         std::string &ModuleName, uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
   const char *kCodeCmd = "CODE ";
-  const int kMaxInputStringLength = 1024;
   const char kDelimiters[] = " \n";
-  char InputString[kMaxInputStringLength];
-  if (!fgets(InputString, sizeof(InputString), stdin))
-    return false;
   IsData = false;
   ModuleName = "";
-  char *pos = InputString;
+  const char *pos = InputString;
   if (strncmp(pos, kDataCmd, strlen(kDataCmd)) == 0) {
     IsData = true;
     pos += strlen(kDataCmd);
@@ -84,7 +97,7 @@ static bool parseCommand(bool &IsData, std::string &ModuleName,
     if (*pos == '"' || *pos == '\'') {
       char quote = *pos;
       pos++;
-      char *end = strchr(pos, quote);
+      const char *end = strchr(pos, quote);
       if (end == 0)
         return false;
       ModuleName = std::string(pos, end - pos);
@@ -113,13 +126,45 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClUseSymbolTable, ClPrintFunctions,
-                               ClPrintInlining, ClDemangle, ClDefaultArch);
+                               ClPrintInlining, ClDemangle, ClDefaultArch,
+                               ClPreload);
   LLVMSymbolizer Symbolizer(Opts);
 
+  char InputString[kMaxInputStringLength];
+  if (ClBatch) {
+    bool Done = false;
+    std::vector<LLVMSymbolizer::Request> Batch;
+    std::vector<std::string> Results;
+    while (!Done) {
+      Batch.clear();
+      while (true) {
+        if (!fgets(InputString, sizeof(InputString), stdin)) {
+          Done = true;
+          break;
+        }
+        if (InputString[strspn(InputString, "\r\n")] == '\0')
+          break;
+        LLVMSymbolizer::Request R;
+        if (!parseCommand(InputString, R.IsData, R.ModuleName,
+                          R.ModuleOffset)) {
+          Done = true;
+          break;
+        }
+        Batch.push_back(R);
+      }
+      Symbolizer.symbolizeBatch(Batch, Results, ClThreads);
+      for (unsigned i = 0, e = Results.size(); i != e; ++i)
+        outs() << Results[i] << "\n";
+      outs().flush();
+    }
+    return 0;
+  }
+
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
-  while (parseCommand(IsData, ModuleName, ModuleOffset)) {
+  while (fgets(InputString, sizeof(InputString), stdin) &&
+         parseCommand(InputString, IsData, ModuleName, ModuleOffset)) {
     std::string Result =
         IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
                : Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
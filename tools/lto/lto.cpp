@@ -317,6 +317,25 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
                               sLastErrorString);
 }
 
+/// lto_codegen_set_parallelism - Sets the number of partitions that
+/// lto_codegen_compile_to_files() generates code for in parallel.
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned num_partitions) {
+  cg->setCodeGenParallelism(num_partitions);
+}
+
+/// lto_codegen_compile_to_files - Generates code for all added modules into one
+/// native object file per partition. The names of the files are written to
+/// names. Returns true on error.
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                                  unsigned *num_files) {
+  if (!parsedOptions) {
+    cg->parseCodeGenDebugOptions();
+    parsedOptions = true;
+  }
+  return !cg->compile_to_files(names, num_files, DisableOpt, DisableInline,
+                               DisableGVNLoadPRE, sLastErrorString);
+}
+
 /// lto_codegen_debug_options - Used to pass extra options to the code
 /// generator.
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
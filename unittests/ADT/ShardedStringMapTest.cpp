@@ -0,0 +1,98 @@
+//===- llvm/unittest/ADT/ShardedStringMapTest.cpp - ShardedStringMap tests ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ShardedStringMap.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <vector>
+using namespace llvm;
+
+namespace {
+
+TEST(ShardedStringMapTest, Basic) {
+  ShardedStringMap<unsigned> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.lookup("a"));
+
+  EXPECT_EQ(1u, Map.insert("a", 1).getValue());
+  // The first value inserted for a key wins.
+  StringMapEntry<unsigned> &Entry = Map.insert("a", 2);
+  EXPECT_EQ(1u, Entry.getValue());
+  EXPECT_EQ("a", Entry.getKey());
+
+  for (unsigned I = 0; I != 1000; ++I)
+    Map.insert(Twine(I).str(), I + 10);
+  EXPECT_EQ(1001u, Map.size());
+  for (unsigned I = 0; I != 1000; ++I)
+    EXPECT_EQ(I + 10, Map.lookup(Twine(I).str()));
+
+  // Every entry is in exactly one shard.
+  unsigned Seen = 0;
+  for (unsigned S = 0; S != ShardedStringMap<unsigned>::NumShards; ++S)
+    Seen += Map.getShardMap(S).size();
+  EXPECT_EQ(1001u, Seen);
+
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.lookup("a"));
+}
+
+TEST(ShardedStringMapTest, PrecomputedHash) {
+  ShardedStringMap<unsigned> Map;
+  unsigned Hash = ShardedStringMap<unsigned>::hash("sym");
+  EXPECT_EQ(StringMapImpl::hash("sym"), Hash);
+
+  StringMapEntry<unsigned> &Entry = Map.GetOrCreateValue("sym", Hash);
+  EXPECT_EQ(0u, Entry.getValue());
+  Entry.setValue(7);
+  EXPECT_EQ(&Entry, &Map.GetOrCreateValue("sym", Hash));
+  EXPECT_EQ(7u, Map.lookup("sym", Hash));
+  EXPECT_EQ(7u, Map.lookup("sym"));
+  EXPECT_EQ(7u, Map.insert("sym", 8, Hash).getValue());
+
+  unsigned OtherHash = ShardedStringMap<unsigned>::hash("other");
+  EXPECT_EQ(0u, Map.lookup("other", OtherHash));
+  EXPECT_EQ(9u, Map.insert("other", 9, OtherHash).getValue());
+  EXPECT_EQ(9u, Map.lookup("other"));
+  EXPECT_EQ(2u, Map.size());
+}
+
+TEST(ShardedStringMapTest, Multithreaded) {
+  ShardedStringMap<unsigned> Map;
+  Map.setMultithreaded(true);
+
+  // Several threads race to publish a value for the same keys; all of them
+  // must end up seeing the same winner.
+  const unsigned NumThreads = 4, NumKeys = 2000;
+  std::vector<std::vector<unsigned> > Results(NumThreads);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned T = 0; T != NumThreads; ++T) {
+      Pool.async([&, T] {
+        for (unsigned I = 0; I != NumKeys; ++I) {
+          std::string Key = "sym" + Twine(I).str();
+          unsigned V = Map.lookup(Key);
+          if (!V)
+            V = Map.insert(Key, T * NumKeys + I + 1).getValue();
+          Results[T].push_back(V);
+        }
+      });
+    }
+  }
+
+  Map.setMultithreaded(false);
+  EXPECT_EQ(NumKeys, Map.size());
+  for (unsigned T = 1; T != NumThreads; ++T)
+    EXPECT_EQ(Results[0], Results[T]);
+  for (unsigned I = 0; I != NumKeys; ++I)
+    EXPECT_EQ((Results[0][I] - 1) % NumKeys, I);
+}
+
+} // end anonymous namespace
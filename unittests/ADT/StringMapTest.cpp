@@ -8,7 +8,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "gtest/gtest.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/DataTypes.h"
 using namespace llvm;
 
@@ -218,4 +220,43 @@ TEST_F(StringMapTest, NonDefaultConstructable) {
   ASSERT_EQ(iter->second.i, 123);
 }
 
+// Test that entries stay intact while the table grows past many rehashes.
+TEST_F(StringMapTest, GrowTest) {
+  StringMap<unsigned> Map;
+  for (unsigned i = 0; i != 2000; ++i)
+    Map[std::string("key") + Twine(i).str()] = i;
+  EXPECT_EQ(2000u, Map.size());
+  for (unsigned i = 0; i != 2000; ++i)
+    EXPECT_EQ(i, Map.lookup(std::string("key") + Twine(i).str()));
+  EXPECT_EQ(0u, Map.count("key2000"));
+}
+
+// Test a map whose entries come from a BumpPtrAllocator.
+TEST_F(StringMapTest, BumpPtrAllocatorTest) {
+  StringMap<unsigned, BumpPtrAllocator> Map;
+  Map["alpha"] = 1;
+  Map["beta"] = 2;
+  Map.GetOrCreateValue("gamma", 3);
+  Map.erase("beta");
+  Map["beta"] = 4;
+  EXPECT_EQ(3u, Map.size());
+  EXPECT_EQ(1u, Map.lookup("alpha"));
+  EXPECT_EQ(4u, Map.lookup("beta"));
+  EXPECT_EQ(3u, Map.lookup("gamma"));
+  EXPECT_EQ("gamma", Map.find("gamma")->getKey());
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+}
+
+// Test that the table hashes keys of every length the way hash_value does
+// with its default seed.
+TEST_F(StringMapTest, HashTest) {
+  std::string Key;
+  for (unsigned i = 0; i != 200; ++i) {
+    EXPECT_EQ(static_cast<unsigned>(hash_value(StringRef(Key))),
+              StringMapImpl::hash(Key)) << "length " << i;
+    Key += char('a' + i % 26);
+  }
+}
+
 } // end anonymous namespace
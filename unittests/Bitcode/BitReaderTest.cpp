@@ -62,5 +62,41 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+TEST(BitReaderTest, MaterializeSingleFunctionFromIndex) {
+  LLVMContext Context;
+  SmallString<1024> Mem;
+  {
+    Module M("test-index", Context);
+    FunctionType *FuncTy = FunctionType::get(Type::getVoidTy(Context), false);
+    for (unsigned i = 0; i != 3; ++i) {
+      Function *F = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                     "f" + Twine(i), &M);
+      BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+      ReturnInst::Create(Context, Entry);
+    }
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
+  ErrorOr<Module *> ModuleOrErr = getLazyBitcodeModule(Buffer, Context);
+  ASSERT_FALSE(ModuleOrErr.getError());
+  OwningPtr<Module> M(ModuleOrErr.get());
+
+  Function *F1 = M->getFunction("f1");
+  ASSERT_TRUE(F1 && F1->isMaterializable());
+  std::string ErrInfo;
+  EXPECT_FALSE(F1->Materialize(&ErrInfo));
+  EXPECT_FALSE(F1->isDeclaration());
+  EXPECT_TRUE(isa<ReturnInst>(F1->getEntryBlock().getTerminator()));
+
+  // The other bodies are still on disk.
+  EXPECT_TRUE(M->getFunction("f0")->isMaterializable());
+  EXPECT_TRUE(M->getFunction("f2")->isMaterializable());
+
+  EXPECT_FALSE(M->materializeAll());
+  EXPECT_FALSE(verifyModule(*M));
+}
+
 }
 }
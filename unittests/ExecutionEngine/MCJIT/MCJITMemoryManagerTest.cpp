@@ -10,6 +10,7 @@
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -168,5 +169,68 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, ReusesReleasedSlabs) {
+  SectionMemoryManager::SlabPool Pool;
+
+  {
+    SectionMemoryManager MemMgr(Pool);
+    EXPECT_NE((uint8_t*)0, MemMgr.allocateCodeSection(256, 0, 1, ""));
+    EXPECT_NE((uint8_t*)0, MemMgr.allocateDataSection(256, 0, 2, "", true));
+    EXPECT_NE((uint8_t*)0, MemMgr.allocateDataSection(256, 0, 3, "", false));
+    std::string Error;
+    EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  }
+  size_t Mapped = Pool.getMappedBytes();
+  EXPECT_NE(0U, Mapped);
+  EXPECT_EQ(Mapped, Pool.getFreeBytes());
+
+  // A second manager is served entirely from the slabs the first gave back,
+  // and gets them back writable.
+  {
+    SectionMemoryManager MemMgr(Pool);
+    uint8_t *code = MemMgr.allocateCodeSection(256, 0, 1, "");
+    uint8_t *data = MemMgr.allocateDataSection(256, 0, 2, "", true);
+    ASSERT_NE((uint8_t*)0, code);
+    ASSERT_NE((uint8_t*)0, data);
+    code[0] = 1;
+    data[0] = 2;
+    EXPECT_EQ(Mapped, Pool.getMappedBytes());
+  }
+  EXPECT_EQ(Mapped, Pool.getMappedBytes());
+}
+
+TEST(MCJITMemoryManagerTest, AllocateAfterFinalize) {
+  SectionMemoryManager::SlabPool Pool;
+  SectionMemoryManager MemMgr(Pool);
+  std::string Error;
+
+  uint8_t *code1 = MemMgr.allocateCodeSection(16, 0, 1, "");
+  ASSERT_NE((uint8_t*)0, code1);
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+
+  // Finalized pages are never written again, so the next section starts on
+  // a fresh, writable page of the same slab.
+  uint8_t *code2 = MemMgr.allocateCodeSection(16, 0, 2, "");
+  ASSERT_NE((uint8_t*)0, code2);
+  EXPECT_NE(code1, code2);
+  EXPECT_EQ(0U, (uintptr_t)code2 % sys::process::get_self()->page_size());
+  code2[0] = 0xC3;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  EXPECT_EQ(Pool.getSlabSize(), Pool.getMappedBytes());
+}
+
+TEST(MCJITMemoryManagerTest, OversizedSlabsAreUnmapped) {
+  SectionMemoryManager::SlabPool Pool(4096);
+  {
+    SectionMemoryManager MemMgr(Pool);
+    size_t Big = (Pool.getSlabSize() << SectionMemoryManager::SlabPool::
+                                            MaxSizeClass) + 1;
+    EXPECT_NE((uint8_t*)0, MemMgr.allocateDataSection(Big, 0, 1, "", false));
+    EXPECT_LT(Big, Pool.getMappedBytes());
+  }
+  EXPECT_EQ(0U, Pool.getMappedBytes());
+  EXPECT_EQ(0U, Pool.getFreeBytes());
+}
+
 } // Namespace
 
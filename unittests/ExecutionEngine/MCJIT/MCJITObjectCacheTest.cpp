@@ -12,10 +12,14 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -86,6 +90,42 @@ private:
   bool                            DuplicateInserted;
 };
 
+/// A FileObjectCache that counts how many objects it was handed, which is
+/// how many modules MCJIT had to compile.
+class CountingFileObjectCache : public FileObjectCache {
+public:
+  CountingFileObjectCache(StringRef Dir, const TargetMachine *TM,
+                          uint64_t MaxSize = 0)
+    : FileObjectCache(Dir, TM, MaxSize), NumCompiled(0) {}
+
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) {
+    ++NumCompiled;
+    FileObjectCache::notifyObjectCompiled(M, Obj);
+  }
+
+  unsigned NumCompiled;
+};
+
+/// Count the objects in a cache directory.
+static unsigned countCachedObjects(StringRef Dir) {
+  unsigned Count = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC))
+    if (sys::path::extension(I->path()) == ".o")
+      ++Count;
+  return Count;
+}
+
+/// Remove a cache directory and everything in it.
+static void removeCacheDir(StringRef Dir) {
+  error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC))
+    sys::fs::remove(I->path());
+  sys::fs::remove(Dir);
+}
+
 class MCJITObjectCacheTest : public testing::Test, public MCJITTestBase {
 protected:
 
@@ -238,5 +278,80 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITObjectCacheTest, FileCacheReusesObjects) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> Dir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-object-cache", Dir));
+
+  // The first engine has to compile the module and stores the object.
+  createJIT(M.take());
+  CountingFileObjectCache Cache1(Dir, TheJIT->getTargetMachine());
+  TheJIT->setObjectCache(&Cache1);
+  compileAndRun();
+  EXPECT_EQ(1U, Cache1.NumCompiled);
+  EXPECT_EQ(1U, countCachedObjects(Dir));
+  TheJIT.reset();
+
+  // A fresh engine and cache find the object for an identical module.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  createJIT(M.take());
+  CountingFileObjectCache Cache2(Dir, TheJIT->getTargetMachine());
+  TheJIT->setObjectCache(&Cache2);
+  compileAndRun();
+  EXPECT_EQ(0U, Cache2.NumCompiled);
+  TheJIT.reset();
+
+  // A module with different contents is a miss.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  createJIT(M.take());
+  CountingFileObjectCache Cache3(Dir, TheJIT->getTargetMachine());
+  TheJIT->setObjectCache(&Cache3);
+  compileAndRun(ReplacementRC);
+  EXPECT_EQ(1U, Cache3.NumCompiled);
+  EXPECT_EQ(2U, countCachedObjects(Dir));
+  TheJIT.reset();
+
+  removeCacheDir(Dir);
+}
+
+TEST(FileObjectCacheTest, PruneEvictsLeastRecentlyUsed) {
+  SmallString<128> Dir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-object-cache", Dir));
+
+  // Create three 100-byte objects, used at increasing times.
+  const char *const Names[] = { "old.o", "middle.o", "new.o" };
+  for (unsigned i = 0; i != 3; ++i) {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Names[i]);
+    int FD;
+    ASSERT_FALSE(sys::fs::openFileForWrite(Path.str(), FD, sys::fs::F_None));
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << std::string(100, 'x');
+    OS.flush();
+    ASSERT_FALSE(sys::fs::setLastModificationAndAccessTime(
+        FD, sys::TimeValue(1000000 + i * 1000, 0)));
+  }
+
+  FileObjectCache Cache(Dir, 0, 250);
+  Cache.prune();
+
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, "old.o");
+  EXPECT_FALSE(sys::fs::exists(Path.str()));
+  Path = Dir;
+  sys::path::append(Path, "middle.o");
+  EXPECT_TRUE(sys::fs::exists(Path.str()));
+  Path = Dir;
+  sys::path::append(Path, "new.o");
+  EXPECT_TRUE(sys::fs::exists(Path.str()));
+
+  removeCacheDir(Dir);
+}
+
 } // Namespace
 
@@ -14,6 +14,7 @@
 
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -187,4 +188,40 @@ TEST_F(MCJITTest, multiple_functions) {
 
 #endif /*!defined(__arm__)*/
 
+class ObjectCountingListener : public JITEventListener {
+public:
+  ObjectCountingListener() : NumObjects(0) {}
+  virtual void NotifyObjectEmitted(const ObjectImage &Obj) { ++NumObjects; }
+  unsigned NumObjects;
+};
+
+TEST_F(MCJITTest, lazy_compilation) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Add = insertAddFunction(M.get());
+  Function *Caller =
+      insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), Add);
+  insertAccumulateFunction(M.get());
+
+  createJIT(M.take());
+  TheJIT->EnableLazyModuleSplitting();
+  ObjectCountingListener Listener;
+  TheJIT->RegisterJITEventListener(&Listener);
+
+  uint64_t ptr = TheJIT->getFunctionAddress(Caller->getName().str());
+  ASSERT_TRUE(0 != ptr) << "Unable to get pointer to caller from JIT";
+  // Only the stubs have been compiled so far.
+  EXPECT_EQ(1u, Listener.NumObjects);
+
+  int32_t(*FuncPtr)(int32_t, int32_t) = (int32_t(*)(int32_t, int32_t))ptr;
+  EXPECT_EQ(7, FuncPtr(3, 4)) << "Incorrect result returned from function";
+  // Calling compiled the caller and the callee, but not the third function.
+  EXPECT_EQ(3u, Listener.NumObjects);
+
+  EXPECT_EQ(9, FuncPtr(4, 5));
+  EXPECT_EQ(3u, Listener.NumObjects);
+
+  TheJIT->UnregisterJITEventListener(&Listener);
+}
+
 }
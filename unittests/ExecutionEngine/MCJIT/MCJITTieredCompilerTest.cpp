@@ -0,0 +1,145 @@
+//===- MCJITTieredCompilerTest.cpp - Unit tests for TieredCompiler --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MCJITTestBase.h"
+#include "llvm/ExecutionEngine/TieredCompiler.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class MCJITTieredCompilerTest : public testing::Test, public MCJITTestBase {
+protected:
+  virtual void SetUp() {
+    M.reset(createEmptyModule("<main>"));
+    Callbacks = 0;
+  }
+
+  // Inserts
+  //   static int32_t counter = 0;
+  //   int32_t bump() { return ++counter; }
+  // The counter is internal, so it has to be shared between the tiers by
+  // the TieredCompiler.
+  Function *insertBumpFunction(Module *M) {
+    GlobalVariable *Counter = insertGlobalInt32(M, "counter", 0);
+    Counter->setLinkage(GlobalValue::InternalLinkage);
+    Function *Result = startFunction<int32_t(void)>(M, "bump");
+    Value *Old = Builder.CreateLoad(Counter);
+    Value *New = Builder.CreateAdd(Old, ConstantInt::get(Old->getType(), 1));
+    Builder.CreateStore(New, Counter);
+    endFunctionWithRet(Result, New);
+    return Result;
+  }
+
+  TieredCompiler::CallbackTy countCallbacks() {
+    return [this](const std::string &Error) {
+      EXPECT_EQ("", Error);
+      ++Callbacks;
+    };
+  }
+
+  OwningPtr<Module> M;
+  unsigned Callbacks;
+};
+
+TEST_F(MCJITTieredCompilerTest, PatchesEntrySlot) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  insertBumpFunction(M.get());
+  std::string Error;
+  OwningPtr<TieredCompiler> TC(TieredCompiler::create(
+      M.take(), &Error, TieredCompiler::BaselineFastISel, CodeGenOpt::Default,
+      countCallbacks()));
+  ASSERT_TRUE(TC.get() != 0) << Error;
+
+  void *const volatile *Slot = TC->getEntrySlot("bump");
+  ASSERT_TRUE(Slot != 0);
+  EXPECT_TRUE(TC->getEntrySlot("missing") == 0);
+
+  // Whichever tier the slot points at, the counter is the same.
+  int32_t (*Bump)() = (int32_t(*)())(intptr_t)*Slot;
+  EXPECT_EQ(1, Bump());
+
+  void *BaselineAddr = (void *)(intptr_t)
+      TC->getBaselineEngine()->getFunctionAddress("bump");
+  TC->waitForOptimizedCode();
+  EXPECT_TRUE(TC->isOptimized());
+  EXPECT_EQ(1u, Callbacks);
+  EXPECT_TRUE(BaselineAddr != *Slot);
+  EXPECT_TRUE(Slot == TC->getEntrySlot("bump"));
+
+  Bump = (int32_t(*)())(intptr_t)*Slot;
+  EXPECT_EQ(2, Bump());
+  EXPECT_EQ(3, Bump());
+}
+
+TEST_F(MCJITTieredCompilerTest, InterpreterBaseline) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *F = insertBumpFunction(M.get());
+  std::string Error;
+  OwningPtr<TieredCompiler> TC(TieredCompiler::create(
+      M.take(), &Error, TieredCompiler::BaselineInterpreter,
+      CodeGenOpt::Default, countCallbacks()));
+  ASSERT_TRUE(TC.get() != 0) << Error;
+
+  std::vector<GenericValue> NoArgs;
+  EXPECT_EQ(1u, TC->runFunction(F, NoArgs).IntVal.getZExtValue());
+
+  TC->waitForOptimizedCode();
+  EXPECT_TRUE(TC->isOptimized());
+  EXPECT_EQ(1u, Callbacks);
+
+  // The optimized code picks up where the interpreter left off.
+  EXPECT_EQ(2u, TC->runFunction(F, NoArgs).IntVal.getZExtValue());
+  void *const volatile *Slot = TC->getEntrySlot("bump");
+  ASSERT_TRUE(Slot != 0);
+  int32_t (*Bump)() = (int32_t(*)())(intptr_t)*Slot;
+  EXPECT_EQ(3, Bump());
+}
+
+TEST_F(MCJITTieredCompilerTest, GlobalCtors) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // void init() { counter = 41; }, registered in llvm.global_ctors.
+  insertBumpFunction(M.get());
+  Function *Init = startFunction<void(void)>(M.get(), "init");
+  Builder.CreateStore(ConstantInt::get(Type::getInt32Ty(Context), 41),
+                      M->getNamedGlobal("counter"));
+  Builder.CreateRetVoid();
+  appendToGlobalCtors(*M, Init, 65535);
+
+  std::string Error;
+  OwningPtr<TieredCompiler> TC(TieredCompiler::create(
+      M.take(), &Error, TieredCompiler::BaselineFastISel, CodeGenOpt::Default,
+      countCallbacks()));
+  ASSERT_TRUE(TC.get() != 0) << Error;
+
+  TC->getBaselineEngine()->runStaticConstructorsDestructors(false);
+  void *const volatile *Slot = TC->getEntrySlot("bump");
+  ASSERT_TRUE(Slot != 0);
+  int32_t (*Bump)() = (int32_t(*)())(intptr_t)*Slot;
+  EXPECT_EQ(42, Bump());
+
+  TC->waitForOptimizedCode();
+  EXPECT_TRUE(TC->isOptimized());
+  EXPECT_EQ(1u, Callbacks);
+
+  // The shared counter was initialized by the first tier; running the
+  // constructors of the optimized engine must not reset it.
+  ExecutionEngine *OptEE = TC->getOptimizedEngine();
+  ASSERT_TRUE(OptEE != 0);
+  OptEE->runStaticConstructorsDestructors(false);
+  Bump = (int32_t(*)())(intptr_t)*Slot;
+  EXPECT_EQ(43, Bump());
+}
+
+}
@@ -9,10 +9,13 @@
 
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/ThreadPool.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -256,5 +259,84 @@ TEST(ConstantsTest, AsInstructionsTest) {
 
 #undef CHECK
 
+TEST(ConstantsTest, MultithreadedUniquing) {
+  LLVMContext Context;
+  Context.setMultithreaded(true);
+  Module M("m", Context);
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  GlobalVariable *G = new GlobalVariable(M, Int32Ty, false,
+                                         GlobalValue::ExternalLinkage, 0, "g");
+
+  // Build the same constants from several threads at once; uniquing must
+  // still hand every thread the same objects.
+  const unsigned NumThreads = 4, NumConstants = 500;
+  std::vector<std::vector<Constant *> > Results(NumThreads);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned T = 0; T != NumThreads; ++T) {
+      Pool.async([&, T] {
+        for (unsigned I = 0; I != NumConstants; ++I) {
+          Constant *C = ConstantInt::get(Int32Ty, I);
+          Constant *Sum = ConstantExpr::getAdd(ConstantExpr::getPtrToInt(G,
+                                                                 Int32Ty), C);
+          Type *ArrTy = ArrayType::get(Int32Ty, I % 7 + 1);
+          Results[T].push_back(C);
+          Results[T].push_back(Sum);
+          Results[T].push_back(UndefValue::get(ArrTy));
+        }
+      });
+    }
+  }
+
+  for (unsigned T = 1; T != NumThreads; ++T)
+    EXPECT_EQ(Results[0], Results[T]);
+
+  Context.setMultithreaded(false);
+  EXPECT_FALSE(Context.isMultithreaded());
+}
+
+TEST(ConstantsTest, MultithreadedFunctionBuilding) {
+  LLVMContext Context;
+  Context.setMultithreaded(true);
+  Module M("m", Context);
+
+  // Several threads generate functions into the same module, hitting the
+  // sharded constant and pointer type tables from all sides.
+  const unsigned NumThreads = 4, NumFunctions = 50;
+  std::vector<std::vector<Value *> > Results(NumThreads);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned T = 0; T != NumThreads; ++T) {
+      Pool.async([&, T] {
+        for (unsigned I = 0; I != NumFunctions; ++I) {
+          Type *IntTy = Type::getIntNTy(Context, I % 3 ? 32 : 17);
+          Type *PtrTy = PointerType::getUnqual(ArrayType::get(IntTy, I + 1));
+          Constant *Int = ConstantInt::get(IntTy, I * 1000);
+          Constant *FP = ConstantFP::get(Type::getDoubleTy(Context), I + 0.5);
+          Results[T].push_back(Int);
+          Results[T].push_back(FP);
+          Results[T].push_back(Constant::getNullValue(PtrTy));
+
+          FunctionType *FTy = FunctionType::get(IntTy, PtrTy, false);
+          Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                         "f" + Twine(T) + "_" + Twine(I), &M);
+          IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+          Value *Elt = Builder.CreateConstGEP2_32(F->arg_begin(), 0, I);
+          Value *Sum = Builder.CreateAdd(Builder.CreateLoad(Elt), Int);
+          Builder.CreateStore(Sum, Elt);
+          Builder.CreateRet(Sum);
+        }
+      });
+    }
+  }
+
+  for (unsigned T = 1; T != NumThreads; ++T)
+    EXPECT_EQ(Results[0], Results[T]);
+  EXPECT_EQ(NumThreads * NumFunctions, M.size());
+  EXPECT_FALSE(verifyModule(M));
+
+  Context.setMultithreaded(false);
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -0,0 +1,209 @@
+//===- llvm/unittest/IR/FunctionArenaTest.cpp - Function arena tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FunctionArena.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Config/config.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class FunctionArenaTest : public testing::Test {
+protected:
+  FunctionArenaTest() : M(new Module("FunctionArenaTest", Ctx)) {
+    Ctx.setFunctionArenas(true);
+    Int32 = Type::getInt32Ty(Ctx);
+  }
+
+  Function *makeFunction(StringRef Name) {
+    Type *Params[] = { Int32, Int32 };
+    FunctionType *FTy = FunctionType::get(Int32, Params, false);
+    return Function::Create(FTy, GlobalValue::ExternalLinkage, Name, M.get());
+  }
+
+  LLVMContext Ctx;
+  OwningPtr<Module> M;
+  Type *Int32;
+};
+
+TEST_F(FunctionArenaTest, DisabledByDefault) {
+  LLVMContext Other;
+  EXPECT_FALSE(Other.hasFunctionArenas());
+
+  OwningPtr<Module> OtherM(new Module("Other", Other));
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Other), false);
+  Function *F =
+      Function::Create(FTy, GlobalValue::ExternalLinkage, "f", OtherM.get());
+  EXPECT_EQ(0, F->getArena());
+
+  FunctionArenaScope Scope(*F);
+  BasicBlock *BB = BasicBlock::Create(Other, "entry", F);
+  ReturnInst::Create(Other, BB);
+  EXPECT_FALSE(verifyFunction(*F));
+}
+
+#if LLVM_ENABLE_FUNCTION_ARENAS
+
+TEST_F(FunctionArenaTest, AllocatesFromArena) {
+  Function *F = makeFunction("f");
+  FunctionArena *Arena = F->getArena();
+  ASSERT_NE((FunctionArena *)0, Arena);
+  EXPECT_EQ(0U, Arena->getTotalMemory());
+
+  FunctionArenaScope Scope(*F);
+  BasicBlock *BB = BasicBlock::Create(Ctx, "entry", F);
+  IRBuilder<> Builder(BB);
+  Function::arg_iterator AI = F->arg_begin();
+  Value *A = AI++;
+  Value *B = AI;
+  Value *Sum = Builder.CreateAdd(A, B);
+  Builder.CreateRet(Sum);
+  EXPECT_NE(0U, Arena->getTotalMemory());
+  EXPECT_FALSE(verifyFunction(*F));
+}
+
+TEST_F(FunctionArenaTest, ReusesErasedInstructions) {
+  Function *F = makeFunction("f");
+  FunctionArenaScope Scope(*F);
+  BasicBlock *BB = BasicBlock::Create(Ctx, "entry", F);
+  IRBuilder<> Builder(BB);
+  Function::arg_iterator AI = F->arg_begin();
+  Value *A = AI++;
+  Value *B = AI;
+
+  Instruction *Mul = cast<Instruction>(Builder.CreateMul(A, B));
+  void *Address = Mul;
+  Mul->eraseFromParent();
+
+  // An instruction with as many operands comes from the free list.
+  Instruction *Sub = cast<Instruction>(Builder.CreateSub(A, B));
+  EXPECT_EQ(Address, static_cast<void *>(Sub));
+  Builder.CreateRet(Sub);
+  EXPECT_FALSE(verifyFunction(*F));
+}
+
+TEST_F(FunctionArenaTest, InstructionOutlivesFunction) {
+  Function *F = makeFunction("f");
+  Function *G = makeFunction("g");
+
+  Instruction *Moved;
+  {
+    FunctionArenaScope Scope(*F);
+    BasicBlock *BB = BasicBlock::Create(Ctx, "entry", F);
+    Function::arg_iterator AI = F->arg_begin();
+    Value *A = AI++;
+    Value *B = AI;
+    Moved = BinaryOperator::CreateAdd(A, B, "moved", BB);
+    ReturnInst::Create(Ctx, ConstantInt::get(Int32, 0), BB);
+  }
+
+  FunctionArenaScope Scope(*G);
+  BasicBlock *BB = BasicBlock::Create(Ctx, "entry", G);
+  ReturnInst *Ret = ReturnInst::Create(Ctx, Moved, BB);
+  Function::arg_iterator AI = G->arg_begin();
+  Moved->setOperand(0, AI++);
+  Moved->setOperand(1, AI);
+  Moved->removeFromParent();
+  Moved->insertBefore(Ret);
+  F->eraseFromParent();
+
+  EXPECT_FALSE(verifyFunction(*G));
+  EXPECT_EQ(Moved, Ret->getReturnValue());
+}
+
+TEST_F(FunctionArenaTest, MultithreadedContext) {
+  // The arenas are locked while the context is multithreaded.  Freeing an
+  // instruction into the arena of another function goes through the lock of
+  // that arena.
+  Ctx.setMultithreaded(true);
+  Function *F = makeFunction("f");
+  Function *G = makeFunction("g");
+
+  Instruction *Moved;
+  {
+    FunctionArenaScope Scope(*F);
+    BasicBlock *BB = BasicBlock::Create(Ctx, "entry", F);
+    Moved = BinaryOperator::CreateNeg(ConstantInt::get(Int32, 1), "moved", BB);
+    ReturnInst::Create(Ctx, ConstantInt::get(Int32, 0), BB);
+  }
+
+  {
+    FunctionArenaScope Scope(*G);
+    BasicBlock *BB = BasicBlock::Create(Ctx, "entry", G);
+    ReturnInst::Create(Ctx, ConstantInt::get(Int32, 0), BB);
+    Moved->moveBefore(BB->getTerminator());
+  }
+  F->eraseFromParent();
+  Moved->eraseFromParent();
+  EXPECT_FALSE(verifyFunction(*G));
+  Ctx.setMultithreaded(false);
+}
+
+TEST_F(FunctionArenaTest, LargeInstructionsUseTheHeap) {
+  // More operands than the largest size class holds.
+  SmallVector<Type *, 300> Params(300, Int32);
+  FunctionType *CalleeTy = FunctionType::get(Int32, Params, false);
+  Function *Callee = Function::Create(CalleeTy, GlobalValue::ExternalLinkage,
+                                      "callee", M.get());
+
+  Function *F = makeFunction("f");
+  FunctionArenaScope Scope(*F);
+  BasicBlock *BB = BasicBlock::Create(Ctx, "entry", F);
+  SmallVector<Value *, 300> Args(300, ConstantInt::get(Int32, 1));
+  CallInst *Call = CallInst::Create(Callee, Args, "call", BB);
+  ReturnInst::Create(Ctx, Call, BB);
+  EXPECT_FALSE(verifyFunction(*F));
+}
+
+TEST_F(FunctionArenaTest, ParsedBodies) {
+  SMDiagnostic Err;
+  OwningPtr<Module> Parsed(ParseAssemblyString(
+      "define i32 @f(i32 %a, i32 %b) {\n"
+      "entry:\n"
+      "  %c = icmp slt i32 %a, %b\n"
+      "  br i1 %c, label %then, label %exit\n"
+      "then:\n"
+      "  %s = add i32 %a, %b\n"
+      "  br label %exit\n"
+      "exit:\n"
+      "  %r = phi i32 [ %s, %then ], [ %a, %entry ]\n"
+      "  ret i32 %r\n"
+      "}\n",
+      0, Err, Ctx));
+  ASSERT_TRUE(Parsed.isValid());
+  Function *F = Parsed->getFunction("f");
+  ASSERT_NE((FunctionArena *)0, F->getArena());
+  EXPECT_NE(0U, F->getArena()->getTotalMemory());
+  EXPECT_FALSE(verifyModule(*Parsed));
+}
+
+#else
+
+TEST_F(FunctionArenaTest, NotBuiltIn) {
+  // Without LLVM_ENABLE_FUNCTION_ARENAS, arenas cannot be enabled.
+  EXPECT_FALSE(Ctx.hasFunctionArenas());
+  EXPECT_EQ(0, makeFunction("f")->getArena());
+}
+
+#endif // LLVM_ENABLE_FUNCTION_ARENAS
+
+} // end anonymous namespace
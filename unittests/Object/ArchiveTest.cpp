@@ -0,0 +1,98 @@
+//===- llvm/unittest/Object/ArchiveTest.cpp - Tests for Archive -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/Archive.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+void writeField(raw_ostream &OS, StringRef Value, unsigned Width) {
+  OS << Value;
+  OS.indent(Width - Value.size());
+}
+
+void writeMember(raw_ostream &OS, StringRef Name, StringRef Data) {
+  writeField(OS, Name, 16);
+  writeField(OS, "0", 12);
+  writeField(OS, "0", 6);
+  writeField(OS, "0", 6);
+  writeField(OS, "644", 8);
+  writeField(OS, utostr(Data.size()), 10);
+  OS << "`\n" << Data;
+  if (Data.size() % 2)
+    OS << '\n';
+}
+
+void writeBE32(raw_ostream &OS, uint32_t Value) {
+  OS << char(Value >> 24) << char(Value >> 16) << char(Value >> 8)
+     << char(Value);
+}
+
+// Builds a GNU archive with two members, a.o and b.o, and a symbol table
+// in which foo is defined by both.
+std::string createArchive() {
+  const unsigned HeaderSize = 60;
+  std::string Names("foo\0bar\0foo\0baz\0", 16);
+  uint32_t SymtabSize = 4 + 4 * 4 + Names.size();
+  uint32_t AOffset = 8 + HeaderSize + SymtabSize;
+  uint32_t BOffset = AOffset + HeaderSize + 4;
+  uint32_t Members[] = { AOffset, BOffset, BOffset, AOffset };
+
+  std::string Symtab;
+  raw_string_ostream SymtabOS(Symtab);
+  writeBE32(SymtabOS, 4);
+  for (unsigned i = 0; i != 4; ++i)
+    writeBE32(SymtabOS, Members[i]);
+  SymtabOS << Names;
+  SymtabOS.flush();
+
+  std::string Result;
+  raw_string_ostream OS(Result);
+  OS << "!<arch>\n";
+  writeMember(OS, "/", Symtab);
+  writeMember(OS, "a.o/", "AAAA");
+  writeMember(OS, "b.o/", "BBBB");
+  return OS.str();
+}
+
+TEST(ArchiveTest, FindSym) {
+  std::string Data = createArchive();
+  error_code EC;
+  Archive A(MemoryBuffer::getMemBuffer(Data, "", false), EC);
+  ASSERT_FALSE(EC);
+  ASSERT_TRUE(A.hasSymbolTable());
+
+  StringRef Name;
+  Archive::child_iterator I = A.findSym("bar");
+  ASSERT_TRUE(I != A.child_end());
+  ASSERT_FALSE(I->getName(Name));
+  EXPECT_EQ("b.o", Name);
+  EXPECT_EQ("BBBB", I->getBuffer());
+
+  // The first definition wins.
+  I = A.findSym("foo");
+  ASSERT_TRUE(I != A.child_end());
+  ASSERT_FALSE(I->getName(Name));
+  EXPECT_EQ("a.o", Name);
+
+  I = A.findSym("baz");
+  ASSERT_TRUE(I != A.child_end());
+  ASSERT_FALSE(I->getName(Name));
+  EXPECT_EQ("a.o", Name);
+
+  EXPECT_TRUE(A.findSym("qux") == A.child_end());
+  EXPECT_TRUE(A.findSym("") == A.child_end());
+}
+
+}
@@ -0,0 +1,51 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Atomic.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  sys::cas_flag Count = 0;
+  ThreadPool Pool(4);
+  for (unsigned I = 0; I != 100; ++I)
+    Pool.async([&Count] { sys::AtomicIncrement(&Count); });
+  Pool.wait();
+  EXPECT_EQ(100u, Count);
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueue) {
+  std::vector<int> Results(64, 0);
+  {
+    ThreadPool Pool(2);
+    for (unsigned I = 0, E = Results.size(); I != E; ++I)
+      Pool.async([&Results, I] { Results[I] = I + 1; });
+  }
+  for (unsigned I = 0, E = Results.size(); I != E; ++I)
+    EXPECT_EQ(int(I + 1), Results[I]);
+}
+
+TEST(ThreadPoolTest, ReuseAfterWait) {
+  sys::cas_flag Count = 0;
+  ThreadPool Pool;
+  EXPECT_LE(1u, Pool.getThreadCount());
+  for (unsigned Round = 0; Round != 3; ++Round) {
+    for (unsigned I = 0; I != 10; ++I)
+      Pool.async([&Count] { sys::AtomicIncrement(&Count); });
+    Pool.wait();
+    EXPECT_EQ(10u * (Round + 1), Count);
+  }
+}
+
+}